@@ -29,6 +29,11 @@ void CryptoMbContext::scheduleCallback(enum RequestStatus status) {
   schedulable_->scheduleCallbackNextIteration();
 }
 
+void CryptoMbContext::complete(enum RequestStatus status) {
+  setStatus(status);
+  cb_.onPrivateKeyMethodComplete();
+}
+
 bool CryptoMbRsaContext::rsaInit(const uint8_t* in, size_t in_len) {
   if (rsa_ == nullptr) {
     return false;
@@ -56,6 +61,71 @@ bool CryptoMbRsaContext::rsaInit(const uint8_t* in, size_t in_len) {
   return true;
 }
 
+CryptoMbOffloadPool::CryptoMbOffloadPool(Thread::ThreadFactory& thread_factory,
+                                         uint32_t num_threads) {
+  threads_.reserve(num_threads);
+  for (uint32_t i = 0; i < num_threads; i++) {
+    threads_.push_back(thread_factory.createThread([this]() { threadRoutine(); },
+                                                   Thread::Options{"cryptomb_pool"}));
+  }
+}
+
+CryptoMbOffloadPool::~CryptoMbOffloadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    shutdown_ = true;
+  }
+  for (auto& thread : threads_) {
+    thread->join();
+  }
+}
+
+void CryptoMbOffloadPool::post(std::function<void()> operation) {
+  absl::MutexLock lock(&mutex_);
+  operations_.push_back(std::move(operation));
+}
+
+void CryptoMbOffloadPool::threadRoutine() {
+  std::vector<std::function<void()>> batch;
+  batch.reserve(CryptoMbQueue::MULTIBUFF_BATCH);
+  while (true) {
+    const auto condition = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return !operations_.empty() || shutdown_;
+    };
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(&condition));
+      if (operations_.empty()) {
+        // Shutting down with nothing left to run.
+        return;
+      }
+      // Take a batch of operations at once, so that a burst of handshakes is drained with few
+      // lock acquisitions.
+      while (!operations_.empty() && batch.size() < CryptoMbQueue::MULTIBUFF_BATCH) {
+        batch.push_back(std::move(operations_.front()));
+        operations_.pop_front();
+      }
+    }
+    ENVOY_LOG(debug, "CryptoMb offload thread processing {} requests", batch.size());
+    for (auto& operation : batch) {
+      operation();
+    }
+    batch.clear();
+  }
+}
+
+void CryptoMbOffloadTarget::post(Event::PostCb callback) {
+  absl::MutexLock lock(&mutex_);
+  if (dispatcher_ != nullptr) {
+    dispatcher_->post(std::move(callback));
+  }
+}
+
+void CryptoMbOffloadTarget::clear() {
+  absl::MutexLock lock(&mutex_);
+  dispatcher_ = nullptr;
+}
+
 namespace {
 
 int calculateDigest(const EVP_MD* md, const uint8_t* in, size_t in_len, unsigned char* hash,
@@ -109,6 +179,24 @@ ssl_private_key_result_t ecdsaPrivateKeySignInternal(CryptoMbPrivateKeyConnectio
     return ssl_private_key_failure;
   }
 
+  if (ops->offloadEnabled()) {
+    CryptoMbEcdsaContextSharedPtr mb_ctx =
+        std::make_shared<CryptoMbEcdsaContext>(std::move(ec_key), ops->dispatcher_, ops->cb_);
+    memcpy(mb_ctx->hash_, hash, hash_len); // NOLINT(safe-memcpy)
+    mb_ctx->hash_len_ = hash_len;
+    ops->offload(mb_ctx, [](CryptoMbContext& ctx) {
+      CryptoMbEcdsaContext& ecdsa_ctx = static_cast<CryptoMbEcdsaContext&>(ctx);
+      unsigned int sig_len;
+      if (!ECDSA_sign(0, ecdsa_ctx.hash_, ecdsa_ctx.hash_len_, ecdsa_ctx.out_buf_, &sig_len,
+                      ecdsa_ctx.ec_key_.get())) {
+        return RequestStatus::Error;
+      }
+      ecdsa_ctx.out_len_ = sig_len;
+      return RequestStatus::Success;
+    });
+    return ssl_private_key_retry;
+  }
+
   // Borrow "out" because it has been already initialized to the max_out size.
   if (!ECDSA_sign(0, hash, hash_len, out, &out_len_unsigned, ec_key.get())) {
     return ssl_private_key_failure;
@@ -469,8 +557,11 @@ void CryptoMbQueue::processRsaRequests() {
 CryptoMbPrivateKeyConnection::CryptoMbPrivateKeyConnection(Ssl::PrivateKeyConnectionCallbacks& cb,
                                                            Event::Dispatcher& dispatcher,
                                                            bssl::UniquePtr<EVP_PKEY> pkey,
-                                                           CryptoMbQueue& queue)
-    : queue_(queue), dispatcher_(dispatcher), cb_(cb), pkey_(std::move(pkey)) {}
+                                                           CryptoMbQueue& queue,
+                                                           CryptoMbOffloadPoolSharedPtr offload_pool,
+                                                           CryptoMbOffloadTargetSharedPtr offload_target)
+    : queue_(queue), dispatcher_(dispatcher), cb_(cb), pkey_(std::move(pkey)),
+      offload_pool_(std::move(offload_pool)), offload_target_(std::move(offload_target)) {}
 
 void CryptoMbPrivateKeyMethodProvider::registerPrivateKeyMethod(
     SSL* ssl, Ssl::PrivateKeyConnectionCallbacks& cb, Event::Dispatcher& dispatcher) {
@@ -483,16 +574,51 @@ void CryptoMbPrivateKeyMethodProvider::registerPrivateKeyMethod(
 
   CryptoMbQueue& queue = tls_->get()->queue_;
 
-  CryptoMbPrivateKeyConnection* ops =
-      new CryptoMbPrivateKeyConnection(cb, dispatcher, bssl::UpRef(pkey_), queue);
+  CryptoMbPrivateKeyConnection* ops = new CryptoMbPrivateKeyConnection(
+      cb, dispatcher, bssl::UpRef(pkey_), queue, offload_pool_, tls_->get()->offload_target_);
   SSL_set_ex_data(ssl, CryptoMbPrivateKeyMethodProvider::connectionIndex(), ops);
 }
 
 void CryptoMbPrivateKeyConnection::addToQueue(CryptoMbContextSharedPtr mb_ctx) {
+  if (offloadEnabled()) {
+    // Without the multi-buffer instructions, run the raw RSA private key operation in software.
+    // The input has already been padded, as it would be for the multi-buffer queue.
+    offload(std::move(mb_ctx), [](CryptoMbContext& ctx) {
+      CryptoMbRsaContext& rsa_ctx = static_cast<CryptoMbRsaContext&>(ctx);
+      size_t out_len;
+      if (!RSA_sign_raw(rsa_ctx.rsa_.get(), &out_len, rsa_ctx.out_buf_,
+                        CryptoMbContext::MAX_SIGNATURE_SIZE, rsa_ctx.in_buf_.get(),
+                        rsa_ctx.out_len_, RSA_NO_PADDING)) {
+        return RequestStatus::Error;
+      }
+      rsa_ctx.out_len_ = out_len;
+      return RequestStatus::Success;
+    });
+    return;
+  }
   mb_ctx_ = mb_ctx;
   queue_.addAndProcessEightRequests(mb_ctx_);
 }
 
+void CryptoMbPrivateKeyConnection::offload(
+    CryptoMbContextSharedPtr mb_ctx, std::function<enum RequestStatus(CryptoMbContext&)> operation) {
+  ASSERT(offloadEnabled());
+  mb_ctx_ = mb_ctx;
+  offload_pool_->post([mb_ctx = std::move(mb_ctx), operation = std::move(operation),
+                       target = offload_target_]() mutable {
+    const enum RequestStatus status = operation(*mb_ctx);
+    // Only the connection keeps the context alive once the result is posted, so a connection
+    // closed in the meantime drops the result instead of completing on freed callbacks.
+    std::weak_ptr<CryptoMbContext> weak_ctx = mb_ctx;
+    mb_ctx.reset();
+    target->post([weak_ctx, status]() {
+      if (CryptoMbContextSharedPtr ctx = weak_ctx.lock()) {
+        ctx->complete(status);
+      }
+    });
+  });
+}
+
 bool CryptoMbPrivateKeyMethodProvider::checkFips() {
   // `ipp-crypto` library is not fips-certified at the moment
   // (https://github.com/intel/ipp-crypto#certification).
@@ -521,7 +647,13 @@ CryptoMbPrivateKeyMethodProvider::CryptoMbPrivateKeyMethodProvider(
       stats_(generateCryptoMbStats("cryptomb", factory_context.scope())) {
 
   if (!ipp->mbxIsCryptoMbApplicable(0)) {
-    throw EnvoyException("Multi-buffer CPU instructions not available.");
+    if (conf.software_offload_threads() == 0) {
+      throw EnvoyException("Multi-buffer CPU instructions not available.");
+    }
+    ENVOY_LOG(info, "Multi-buffer CPU instructions not available, offloading to {} threads.",
+              conf.software_offload_threads());
+    offload_pool_ = std::make_shared<CryptoMbOffloadPool>(factory_context.api().threadFactory(),
+                                                          conf.software_offload_threads());
   }
 
   std::chrono::milliseconds poll_delay =
@@ -1,14 +1,19 @@
 #pragma once
 
+#include <deque>
+#include <functional>
+
 #include "envoy/api/api.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/ssl/private_key/private_key.h"
 #include "envoy/ssl/private_key/private_key_config.h"
+#include "envoy/thread/thread.h"
 #include "envoy/thread_local/thread_local.h"
 
 #include "source/common/common/c_smart_ptr.h"
 #include "source/common/common/logger.h"
 
+#include "absl/synchronization/mutex.h"
 #include "contrib/cryptomb/private_key_providers/source/cryptomb_stats.h"
 #include "contrib/cryptomb/private_key_providers/source/ipp_crypto.h"
 #include "contrib/envoy/extensions/private_key_providers/cryptomb/v3alpha/cryptomb.pb.h"
@@ -39,6 +44,9 @@ public:
   void setStatus(RequestStatus status) { status_ = status; }
   enum RequestStatus getStatus() { return status_; }
   void scheduleCallback(enum RequestStatus status);
+  // Completes an operation which was offloaded to another thread. Must be called from the worker
+  // thread owning the connection.
+  void complete(enum RequestStatus status);
 
   // Buffer length is the same as the max signature length (4096 bits = 512 bytes)
   unsigned char out_buf_[MAX_SIGNATURE_SIZE];
@@ -85,8 +93,60 @@ public:
   unsigned char lenstra_to_[MAX_SIGNATURE_SIZE];
 };
 
+// CryptoMbEcdsaContext is a CryptoMbContext which holds the ECDSA key and the digest to be
+// signed, for signing on an offload thread.
+class CryptoMbEcdsaContext : public CryptoMbContext {
+public:
+  CryptoMbEcdsaContext(bssl::UniquePtr<EC_KEY> ec_key, Event::Dispatcher& dispatcher,
+                       Ssl::PrivateKeyConnectionCallbacks& cb)
+      : CryptoMbContext(dispatcher, cb), ec_key_(std::move(ec_key)) {}
+
+  bssl::UniquePtr<EC_KEY> ec_key_;
+  unsigned char hash_[EVP_MAX_MD_SIZE];
+  unsigned int hash_len_{};
+};
+
 using CryptoMbContextSharedPtr = std::shared_ptr<CryptoMbContext>;
 using CryptoMbRsaContextSharedPtr = std::shared_ptr<CryptoMbRsaContext>;
+using CryptoMbEcdsaContextSharedPtr = std::shared_ptr<CryptoMbEcdsaContext>;
+
+// CryptoMbOffloadPool runs private key operations on dedicated threads when the CPU lacks the
+// multi-buffer instructions, so that the signing cost is not paid on the worker threads. Each
+// offload thread takes up to a batch of queued operations at a time.
+class CryptoMbOffloadPool : public Logger::Loggable<Logger::Id::connection> {
+public:
+  CryptoMbOffloadPool(Thread::ThreadFactory& thread_factory, uint32_t num_threads);
+  ~CryptoMbOffloadPool();
+
+  void post(std::function<void()> operation);
+
+private:
+  void threadRoutine();
+
+  absl::Mutex mutex_;
+  std::deque<std::function<void()>> operations_ ABSL_GUARDED_BY(mutex_);
+  bool shutdown_ ABSL_GUARDED_BY(mutex_){false};
+  std::vector<Thread::ThreadPtr> threads_;
+};
+
+using CryptoMbOffloadPoolSharedPtr = std::shared_ptr<CryptoMbOffloadPool>;
+
+// CryptoMbOffloadTarget delivers the results of offloaded operations to a worker thread. It is
+// cleared when the worker's thread local data is destroyed, and results arriving after that are
+// dropped rather than posted to a dispatcher which may no longer exist.
+class CryptoMbOffloadTarget {
+public:
+  explicit CryptoMbOffloadTarget(Event::Dispatcher& dispatcher) : dispatcher_(&dispatcher) {}
+
+  void post(Event::PostCb callback);
+  void clear();
+
+private:
+  absl::Mutex mutex_;
+  Event::Dispatcher* dispatcher_ ABSL_GUARDED_BY(mutex_);
+};
+
+using CryptoMbOffloadTargetSharedPtr = std::shared_ptr<CryptoMbOffloadTarget>;
 
 // CryptoMbQueue maintains the request queue and is able to process it.
 class CryptoMbQueue : public Logger::Loggable<Logger::Id::connection> {
@@ -132,13 +192,21 @@ class CryptoMbPrivateKeyConnection : public Logger::Loggable<Logger::Id::connect
 public:
   CryptoMbPrivateKeyConnection(Ssl::PrivateKeyConnectionCallbacks& cb,
                                Event::Dispatcher& dispatcher, bssl::UniquePtr<EVP_PKEY> pkey,
-                               CryptoMbQueue& queue);
+                               CryptoMbQueue& queue,
+                               CryptoMbOffloadPoolSharedPtr offload_pool = nullptr,
+                               CryptoMbOffloadTargetSharedPtr offload_target = nullptr);
   virtual ~CryptoMbPrivateKeyConnection() = default;
 
   bssl::UniquePtr<EVP_PKEY> getPrivateKey() { return bssl::UpRef(pkey_); };
   void logDebugMsg(std::string msg) { ENVOY_LOG(debug, "CryptoMb: {}", msg); }
   void logWarnMsg(std::string msg) { ENVOY_LOG(warn, "CryptoMb: {}", msg); }
   void addToQueue(CryptoMbContextSharedPtr mb_ctx);
+  // Whether private key operations are run on offload threads instead of the multi-buffer queue.
+  bool offloadEnabled() const { return offload_pool_ != nullptr; }
+  // Runs the operation on an offload thread and completes the context on this connection's
+  // worker thread.
+  void offload(CryptoMbContextSharedPtr mb_ctx,
+               std::function<enum RequestStatus(CryptoMbContext&)> operation);
 
   CryptoMbQueue& queue_;
   Event::Dispatcher& dispatcher_;
@@ -148,6 +216,8 @@ public:
 private:
   Event::FileEventPtr ssl_async_event_{};
   bssl::UniquePtr<EVP_PKEY> pkey_;
+  CryptoMbOffloadPoolSharedPtr offload_pool_;
+  CryptoMbOffloadTargetSharedPtr offload_target_;
 };
 
 // CryptoMbPrivateKeyMethodProvider handles the private key method operations for
@@ -179,11 +249,16 @@ private:
   struct ThreadLocalData : public ThreadLocal::ThreadLocalObject {
     ThreadLocalData(std::chrono::milliseconds poll_delay, enum KeyType type, int keysize,
                     IppCryptoSharedPtr ipp, Event::Dispatcher& d, CryptoMbStats& stats)
-        : queue_(poll_delay, type, keysize, ipp, d, stats){};
+        : queue_(poll_delay, type, keysize, ipp, d, stats),
+          offload_target_(std::make_shared<CryptoMbOffloadTarget>(d)){};
+    ~ThreadLocalData() override { offload_target_->clear(); }
     CryptoMbQueue queue_;
+    CryptoMbOffloadTargetSharedPtr offload_target_;
   };
 
   Ssl::BoringSslPrivateKeyMethodSharedPtr method_{};
+  // Set if the CPU lacks the multi-buffer instructions and software offload is configured.
+  CryptoMbOffloadPoolSharedPtr offload_pool_;
   Api::Api& api_;
   bssl::UniquePtr<EVP_PKEY> pkey_;
   enum KeyType key_type_;
@@ -13,8 +13,10 @@
 #include "contrib/cryptomb/private_key_providers/source/cryptomb_private_key_provider.h"
 #include "fake_factory.h"
 #include "gtest/gtest.h"
+#include "openssl/ecdsa.h"
 #include "openssl/evp.h"
 #include "openssl/rsa.h"
+#include "openssl/sha.h"
 
 namespace Envoy {
 namespace Extensions {
@@ -45,6 +47,16 @@ public:
   };
 };
 
+// Exits the dispatcher once an offloaded operation completes.
+class ExitDispatcherCallbacks : public Envoy::Ssl::PrivateKeyConnectionCallbacks {
+public:
+  explicit ExitDispatcherCallbacks(Event::Dispatcher& dispatcher) : dispatcher_(dispatcher) {}
+  void onPrivateKeyMethodComplete() override { dispatcher_.exit(); }
+
+private:
+  Event::Dispatcher& dispatcher_;
+};
+
 class CryptoMbProviderTest : public testing::Test {
 protected:
   CryptoMbProviderTest()
@@ -395,6 +407,45 @@ TEST_F(CryptoMbProviderRsaTest, TestRSAQueueSizeStatistics) {
   EXPECT_EQ(histogram_values[0], CryptoMbQueue::MULTIBUFF_BATCH);
 }
 
+TEST_F(CryptoMbProviderEcdsaTest, TestEcdsaSigningOffloaded) {
+  ExitDispatcherCallbacks cb(*dispatcher_);
+  auto pool = std::make_shared<CryptoMbOffloadPool>(api_->threadFactory(), 1);
+  auto target = std::make_shared<CryptoMbOffloadTarget>(*dispatcher_);
+  CryptoMbPrivateKeyConnection op(cb, *dispatcher_, bssl::UpRef(pkey_), queue_, pool, target);
+  res_ = ecdsaPrivateKeySignForTest(&op, out_, &out_len_, max_out_len_,
+                                    SSL_SIGN_ECDSA_SECP256R1_SHA256, in_, in_len_);
+  EXPECT_EQ(res_, ssl_private_key_retry);
+
+  // The signature is computed on the offload thread and completed on the dispatcher.
+  dispatcher_->run(Event::Dispatcher::RunType::RunUntilExit);
+  res_ = privateKeyCompleteForTest(&op, out_, &out_len_, max_out_len_);
+  EXPECT_EQ(res_, ssl_private_key_success);
+
+  uint8_t hash[SHA256_DIGEST_LENGTH];
+  SHA256(in_, in_len_, hash);
+  EXPECT_EQ(1, ECDSA_verify(0, hash, sizeof(hash), out_, out_len_,
+                            EVP_PKEY_get0_EC_KEY(pkey_.get())));
+}
+
+TEST_F(CryptoMbProviderRsaTest, TestRsaPkcs1SigningOffloaded) {
+  ExitDispatcherCallbacks cb(*dispatcher_);
+  auto pool = std::make_shared<CryptoMbOffloadPool>(api_->threadFactory(), 1);
+  auto target = std::make_shared<CryptoMbOffloadTarget>(*dispatcher_);
+  CryptoMbPrivateKeyConnection op(cb, *dispatcher_, bssl::UpRef(pkey_), queue_, pool, target);
+  res_ = rsaPrivateKeySignForTest(&op, nullptr, nullptr, max_out_len_, SSL_SIGN_RSA_PKCS1_SHA256,
+                                  in_, in_len_);
+  EXPECT_EQ(res_, ssl_private_key_retry);
+
+  dispatcher_->run(Event::Dispatcher::RunType::RunUntilExit);
+  res_ = privateKeyCompleteForTest(&op, out_, &out_len_, max_out_len_);
+  EXPECT_EQ(res_, ssl_private_key_success);
+
+  uint8_t hash[SHA256_DIGEST_LENGTH];
+  SHA256(in_, in_len_, hash);
+  EXPECT_EQ(1, RSA_verify(NID_sha256, hash, sizeof(hash), out_, out_len_,
+                          EVP_PKEY_get0_RSA(pkey_.get())));
+}
+
 } // namespace
 } // namespace CryptoMb
 } // namespace PrivateKeyMethodProvider
@@ -13,6 +13,16 @@
 namespace Envoy {
 namespace AccessLog {
 
+/**
+ * What an access log file does with a write when the buffer of the writing thread is full.
+ */
+enum class FileOverflowPolicy {
+  // The writing thread waits for the buffer to be flushed.
+  Block,
+  // The write is dropped and counted.
+  Drop,
+};
+
 class AccessLogFile {
 public:
   virtual ~AccessLogFile() = default;
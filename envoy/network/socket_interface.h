@@ -15,8 +15,13 @@ struct SocketCreationOptions {
   // and only valid on Linux.
   bool mptcp_enabled_{false};
 
+  // Specifies whether new connections should be steered to the listen sockets of a reuse_port group
+  // by the CPU which received them. This is only valid for Stream sockets, and only valid on Linux.
+  bool reuse_port_cpu_steering_{false};
+
   bool operator==(const SocketCreationOptions& rhs) const {
-    return mptcp_enabled_ == rhs.mptcp_enabled_;
+    return mptcp_enabled_ == rhs.mptcp_enabled_ &&
+           reuse_port_cpu_steering_ == rhs.reuse_port_cpu_steering_;
   }
 };
 
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <string>
 
+#include "envoy/access_log/access_log.h"
 #include "envoy/admin/v3/server_info.pb.h"
 #include "envoy/common/pure.h"
 #include "envoy/config/bootstrap/v3/bootstrap.pb.h"
@@ -200,6 +201,12 @@ public:
    */
   virtual std::chrono::milliseconds fileFlushIntervalMsec() const PURE;
 
+  /**
+   * @return AccessLog::FileOverflowPolicy what to do with log writes when the buffer of the
+   * writing thread is full.
+   */
+  virtual AccessLog::FileOverflowPolicy fileFlushOverflowPolicy() const PURE;
+
   /**
    * @return const std::string& the server's cluster.
    */
@@ -765,6 +765,12 @@ public:
    */
   virtual float peekaheadRatio() const PURE;
 
+  /**
+   * @return whether connection pools should size preconnects from the observed stream arrival rate
+   *         and connection establishment latency.
+   */
+  virtual bool adaptivePreconnect() const PURE;
+
   /**
    * @return soft limit on size of the cluster's connections read and write buffers.
    */
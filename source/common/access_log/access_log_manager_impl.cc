@@ -1,5 +1,7 @@
 #include "source/common/access_log/access_log_manager_impl.h"
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 
 #include "envoy/common/exception.h"
@@ -9,10 +11,34 @@
 #include "source/common/common/lock_guard.h"
 
 #include "absl/container/fixed_array.h"
+#include "absl/container/flat_hash_map.h"
 
 namespace Envoy {
 namespace AccessLog {
 
+namespace {
+
+std::atomic<uint64_t> next_file_id{0};
+
+// The rings of the calling thread, keyed by the id of the file they belong to. The files own the
+// rings, so entries of destroyed files expire. The rings still alive when the thread exits are
+// abandoned, for their files to release them once drained.
+struct ThreadRings {
+  ~ThreadRings() {
+    for (const auto& entry : rings_) {
+      if (AccessLogRingSharedPtr ring = entry.second.lock(); ring != nullptr) {
+        ring->abandon();
+      }
+    }
+  }
+
+  absl::flat_hash_map<uint64_t, std::weak_ptr<AccessLogRing>> rings_;
+};
+
+thread_local ThreadRings thread_rings;
+
+} // namespace
+
 AccessLogManagerImpl::~AccessLogManagerImpl() {
   for (auto& [log_key, log_file_ptr] : access_logs_) {
     ENVOY_LOG(debug, "destroying access logger {}", log_key);
@@ -34,23 +60,142 @@ AccessLogManagerImpl::createAccessLog(const Filesystem::FilePathAndType& file_in
   if (access_logs_.count(file_name)) {
     return access_logs_[file_name];
   }
+  if (flusher_ == nullptr) {
+    flusher_ = std::make_shared<AccessLogFlusher>(api_.threadFactory());
+  }
   access_logs_[file_name] =
       std::make_shared<AccessLogFileImpl>(std::move(file), dispatcher_, lock_, file_stats_,
-                                          file_flush_interval_msec_, api_.threadFactory());
+                                          file_flush_interval_msec_, flusher_,
+                                          file_overflow_policy_);
   return access_logs_[file_name];
 }
 
+AccessLogRing::AccessLogRing(uint64_t capacity, uint64_t max_overflow)
+    : capacity_(capacity), max_overflow_(max_overflow),
+      data_(std::make_unique<char[]>(capacity)) {}
+
+bool AccessLogRing::tryPush(absl::string_view data) {
+  // The producer is the only one to set overflowed_, so seeing it cleared means that the consumer
+  // has drained all earlier overflowed writes, and data can go to the ring without reordering.
+  if (!overflowed_.load(std::memory_order_acquire)) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (capacity_ - (head - tail) >= data.size()) {
+      const uint64_t offset = head % capacity_;
+      const uint64_t first = std::min<uint64_t>(data.size(), capacity_ - offset);
+      memcpy(data_.get() + offset, data.data(), first);
+      memcpy(data_.get(), data.data() + first, data.size() - first);
+      head_.store(head + data.size(), std::memory_order_release);
+      return true;
+    }
+  }
+  return tryPushOverflow(data);
+}
+
+bool AccessLogRing::tryPushOverflow(absl::string_view data) {
+  Thread::LockGuard overflow_lock(overflow_lock_);
+  if (overflow_.length() > 0 && overflow_.length() + data.size() > max_overflow_) {
+    return false;
+  }
+  overflow_.add(data.data(), data.size());
+  overflow_size_.store(overflow_.length(), std::memory_order_release);
+  overflowed_.store(true, std::memory_order_release);
+  return true;
+}
+
+uint64_t AccessLogRing::drainTo(Buffer::Instance& buffer) {
+  // Holding overflow_lock_ keeps the producer from overflowing between the drain of the ring and
+  // that of the overflow buffer, so that the ring only holds data written before the overflow.
+  Thread::LockGuard overflow_lock(overflow_lock_);
+  const uint64_t tail = tail_.load(std::memory_order_relaxed);
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  const uint64_t length = head - tail;
+  if (length > 0) {
+    const uint64_t offset = tail % capacity_;
+    const uint64_t first = std::min<uint64_t>(length, capacity_ - offset);
+    buffer.add(data_.get() + offset, first);
+    if (length > first) {
+      buffer.add(data_.get(), length - first);
+    }
+    tail_.store(head, std::memory_order_release);
+  }
+
+  const uint64_t overflow_length = overflow_.length();
+  if (overflow_length > 0) {
+    buffer.move(overflow_);
+    overflow_size_.store(0, std::memory_order_release);
+    overflowed_.store(false, std::memory_order_release);
+  }
+  return length + overflow_length;
+}
+
+AccessLogFlusher::AccessLogFlusher(Thread::ThreadFactory& thread_factory)
+    : thread_(thread_factory.createThread([this]() -> void { threadRoutine(); },
+                                          Thread::Options{"AccessLogFlush"})) {}
+
+AccessLogFlusher::~AccessLogFlusher() {
+  {
+    Thread::LockGuard lock(lock_);
+    exit_ = true;
+    work_event_.notifyOne();
+  }
+  thread_->join();
+}
+
+void AccessLogFlusher::requestFlush(AccessLogFileImpl& file) {
+  Thread::LockGuard lock(lock_);
+  pending_.push_back(&file);
+  work_event_.notifyOne();
+}
+
+void AccessLogFlusher::remove(AccessLogFileImpl& file) {
+  Thread::LockGuard lock(lock_);
+  // An ongoing flush may schedule another one, so wait for it before dropping scheduled flushes.
+  while (flushing_ == &file) {
+    idle_event_.wait(lock_);
+  }
+  pending_.erase(std::remove(pending_.begin(), pending_.end(), &file), pending_.end());
+}
+
+void AccessLogFlusher::threadRoutine() {
+  while (true) {
+    AccessLogFileImpl* file;
+    {
+      Thread::LockGuard lock(lock_);
+      flushing_ = nullptr;
+      idle_event_.notifyAll();
+
+      while (pending_.empty() && !exit_) {
+        // CondVar::wait() does not throw, so it's safe to pass the mutex rather than the guard.
+        work_event_.wait(lock_);
+      }
+
+      if (exit_) {
+        return;
+      }
+
+      file = pending_.front();
+      pending_.pop_front();
+      flushing_ = file;
+    }
+
+    file->flushFromFlusher();
+  }
+}
+
 AccessLogFileImpl::AccessLogFileImpl(Filesystem::FilePtr&& file, Event::Dispatcher& dispatcher,
                                      Thread::BasicLockable& lock, AccessLogFileStats& stats,
                                      std::chrono::milliseconds flush_interval_msec,
-                                     Thread::ThreadFactory& thread_factory)
-    : file_(std::move(file)), file_lock_(lock),
+                                     AccessLogFlusherSharedPtr flusher,
+                                     FileOverflowPolicy overflow_policy)
+    : id_(next_file_id++), file_(std::move(file)), file_lock_(lock),
       flush_timer_(dispatcher.createTimer([this]() -> void {
         stats_.flushed_by_timer_.inc();
-        flush_event_.notifyOne();
+        requestFlush();
         flush_timer_->enableTimer(flush_interval_msec_);
       })),
-      thread_factory_(thread_factory), flush_interval_msec_(flush_interval_msec), stats_(stats) {
+      flush_interval_msec_(flush_interval_msec), flusher_(std::move(flusher)),
+      overflow_policy_(overflow_policy), stats_(stats) {
   flush_timer_->enableTimer(flush_interval_msec_);
   auto open_result = open();
   if (!open_result.return_value_) {
@@ -75,20 +220,18 @@ Api::IoCallBoolResult AccessLogFileImpl::open() {
 void AccessLogFileImpl::reopen() { reopen_file_ = true; }
 
 AccessLogFileImpl::~AccessLogFileImpl() {
-  {
-    Thread::LockGuard lock(write_lock_);
-    flush_thread_exit_ = true;
-    flush_event_.notifyOne();
-  }
-
-  if (flush_thread_ != nullptr) {
-    flush_thread_->join();
-  }
+  // The flusher must be done with this file before the flush timer, which may schedule flushes, is
+  // destroyed along with it.
+  flusher_->remove(*this);
 
   // Flush any remaining data. If file was not opened for some reason, skip flushing part.
   if (file_->isOpen()) {
-    if (flush_buffer_.length() > 0) {
-      doWrite(flush_buffer_);
+    {
+      Thread::LockGuard flush_lock(flush_lock_);
+      drainRings();
+      if (about_to_write_buffer_.length() > 0) {
+        doWrite(about_to_write_buffer_);
+      }
     }
     const Api::IoCallBoolResult result = file_->close();
     ASSERT(result.return_value_, fmt::format("unable to close file '{}': {}", file_->path(),
@@ -125,91 +268,124 @@ void AccessLogFileImpl::doWrite(Buffer::Instance& buffer) {
   buffer.drain(buffer.length());
 }
 
-void AccessLogFileImpl::flushThreadFunc() {
-
-  while (true) {
-    std::unique_lock<Thread::BasicLockable> flush_lock;
-
-    {
-      Thread::LockGuard write_lock(write_lock_);
-
-      // flush_event_ can be woken up either by large enough flush_buffer or by timer.
-      // In case it was timer, flush_buffer_ can be empty.
-      while (flush_buffer_.length() == 0 && !flush_thread_exit_ && !reopen_file_) {
-        // CondVar::wait() does not throw, so it's safe to pass the mutex rather than the guard.
-        flush_event_.wait(write_lock_);
-      }
-
-      if (flush_thread_exit_) {
-        return;
+void AccessLogFileImpl::drainRings() {
+  {
+    Thread::LockGuard rings_lock(rings_lock_);
+    for (auto it = rings_.begin(); it != rings_.end();) {
+      // Checked before draining, so that the drain moves everything an abandoned ring holds.
+      const bool abandoned = (*it)->abandoned();
+      (*it)->drainTo(about_to_write_buffer_);
+      if (abandoned) {
+        it = rings_.erase(it);
+      } else {
+        ++it;
       }
-
-      flush_lock = std::unique_lock<Thread::BasicLockable>(flush_lock_);
-      about_to_write_buffer_.move(flush_buffer_);
-      ASSERT(flush_buffer_.length() == 0);
     }
+  }
+  if (overflow_policy_ == FileOverflowPolicy::Block) {
+    // Wake up writers waiting for room. Taking the lock ensures that a writer which found its ring
+    // full before the drain is already waiting.
+    { Thread::LockGuard space_lock(space_lock_); }
+    space_event_.notifyAll();
+  }
+}
 
-    // if we failed to reopen before, do it next loop.
-    if (reopen_file_) {
-      if (file_->isOpen()) {
-        const Api::IoCallBoolResult result = file_->close();
-        ASSERT(result.return_value_, fmt::format("unable to close file '{}': {}", file_->path(),
-                                                 result.err_->getErrorDetails()));
-      }
-      const Api::IoCallBoolResult open_result = open();
-      if (!open_result.return_value_) {
-        stats_.reopen_failed_.inc();
-      } else {
-        reopen_file_ = false;
-      }
+void AccessLogFileImpl::flushFromFlusher() {
+  Thread::LockGuard flush_lock(flush_lock_);
+  // Writes from here on need another flush.
+  flush_requested_ = false;
+  drainRings();
+
+  // if we failed to reopen before, do it next loop.
+  if (reopen_file_) {
+    if (file_->isOpen()) {
+      const Api::IoCallBoolResult result = file_->close();
+      ASSERT(result.return_value_, fmt::format("unable to close file '{}': {}", file_->path(),
+                                               result.err_->getErrorDetails()));
+    }
+    const Api::IoCallBoolResult open_result = open();
+    if (!open_result.return_value_) {
+      stats_.reopen_failed_.inc();
+      requestFlush();
+    } else {
+      reopen_file_ = false;
     }
-    // doWrite no matter file isOpen, if not, we can drain buffer
-    doWrite(about_to_write_buffer_);
   }
+  // doWrite no matter file isOpen, if not, we can drain buffer
+  doWrite(about_to_write_buffer_);
 }
 
 void AccessLogFileImpl::flush() {
-  std::unique_lock<Thread::BasicLockable> flush_buffer_lock;
-
-  {
-    Thread::LockGuard write_lock(write_lock_);
+  // flush_lock_ must be held while draining or else it is possible that the flusher has already
+  // drained the rings into about_to_write_buffer_ but has not yet completed doWrite(). This would
+  // allow flush() to return before the pending data has actually been written to disk.
+  Thread::LockGuard flush_lock(flush_lock_);
+  drainRings();
+  if (about_to_write_buffer_.length() == 0) {
+    return;
+  }
 
-    // flush_lock_ must be held while checking this or else it is
-    // possible that flushThreadFunc() has already moved data from
-    // flush_buffer_ to about_to_write_buffer_, has unlocked write_lock_,
-    // but has not yet completed doWrite(). This would allow flush() to
-    // return before the pending data has actually been written to disk.
-    flush_buffer_lock = std::unique_lock<Thread::BasicLockable>(flush_lock_);
+  doWrite(about_to_write_buffer_);
+}
 
-    if (flush_buffer_.length() == 0) {
-      return;
-    }
+void AccessLogFileImpl::requestFlush() {
+  if (!flush_requested_.exchange(true)) {
+    flusher_->requestFlush(*this);
+  }
+}
 
-    about_to_write_buffer_.move(flush_buffer_);
-    ASSERT(flush_buffer_.length() == 0);
+AccessLogRing* AccessLogFileImpl::threadRing() {
+  auto it = thread_rings.rings_.find(id_);
+  if (it == thread_rings.rings_.end()) {
+    return nullptr;
   }
+  // The file keeps the ring alive for as long as it can be written to.
+  AccessLogRingSharedPtr ring = it->second.lock();
+  ASSERT(ring != nullptr);
+  return ring.get();
+}
 
-  doWrite(about_to_write_buffer_);
+AccessLogRing& AccessLogFileImpl::createThreadRing() {
+  // Forget the rings of files which have been destroyed since this thread last saw a new file.
+  absl::erase_if(thread_rings.rings_, [](const auto& entry) { return entry.second.expired(); });
+  auto ring = std::make_shared<AccessLogRing>(RING_CAPACITY, MAX_OVERFLOW_BYTES);
+  {
+    Thread::LockGuard rings_lock(rings_lock_);
+    rings_.push_back(ring);
+  }
+  thread_rings.rings_.emplace(id_, ring);
+  return *ring;
 }
 
 void AccessLogFileImpl::write(absl::string_view data) {
-  Thread::LockGuard lock(write_lock_);
-
-  if (flush_thread_ == nullptr) {
-    createFlushStructures();
+  AccessLogRing* ring = threadRing();
+  const bool first_write = ring == nullptr;
+  if (first_write) {
+    ring = &createThreadRing();
   }
-
-  stats_.write_buffered_.inc();
+  // Account for the data before it becomes visible to the flusher, which subtracts it again.
   stats_.write_total_buffered_.add(data.length());
-  flush_buffer_.add(data.data(), data.size());
-  if (flush_buffer_.length() > MIN_FLUSH_SIZE) {
-    flush_event_.notifyOne();
+  if (!ring->tryPush(data)) {
+    if (overflow_policy_ == FileOverflowPolicy::Drop) {
+      stats_.write_total_buffered_.sub(data.length());
+      stats_.write_dropped_.inc();
+      requestFlush();
+      return;
+    }
+    Thread::LockGuard space_lock(space_lock_);
+    while (!ring->tryPush(data)) {
+      requestFlush();
+      // CondVar::wait() does not throw, so it's safe to pass the mutex rather than the guard.
+      space_event_.wait(space_lock_);
+    }
   }
-}
 
-void AccessLogFileImpl::createFlushStructures() {
-  flush_thread_ = thread_factory_.createThread([this]() -> void { flushThreadFunc(); },
-                                               Thread::Options{"AccessLogFlush"});
+  stats_.write_buffered_.inc();
+  // The first write of each thread is written out promptly rather than on the next timer, so that
+  // a newly configured log is visibly working.
+  if (first_write || ring->size() > MIN_FLUSH_SIZE) {
+    requestFlush();
+  }
 }
 
 } // namespace AccessLog
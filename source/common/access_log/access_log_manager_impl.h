@@ -1,6 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "envoy/access_log/access_log.h"
 #include "envoy/api/api.h"
@@ -10,6 +14,7 @@
 #include "envoy/stats/store.h"
 
 #include "source/common/buffer/buffer_impl.h"
+#include "source/common/common/lock_guard.h"
 #include "source/common/common/logger.h"
 #include "source/common/common/thread.h"
 
@@ -22,6 +27,7 @@ namespace Envoy {
   COUNTER(reopen_failed)                                                                           \
   COUNTER(write_buffered)                                                                          \
   COUNTER(write_completed)                                                                         \
+  COUNTER(write_dropped)                                                                           \
   COUNTER(write_failed)                                                                            \
   GAUGE(write_total_buffered, Accumulate)
 
@@ -31,12 +37,18 @@ struct AccessLogFileStats {
 
 namespace AccessLog {
 
+class AccessLogFileImpl;
+class AccessLogFlusher;
+using AccessLogFlusherSharedPtr = std::shared_ptr<AccessLogFlusher>;
+
 class AccessLogManagerImpl : public AccessLogManager, Logger::Loggable<Logger::Id::main> {
 public:
-  AccessLogManagerImpl(std::chrono::milliseconds file_flush_interval_msec, Api::Api& api,
+  AccessLogManagerImpl(std::chrono::milliseconds file_flush_interval_msec,
+                       FileOverflowPolicy file_overflow_policy, Api::Api& api,
                        Event::Dispatcher& dispatcher, Thread::BasicLockable& lock,
                        Stats::Store& stats_store)
-      : file_flush_interval_msec_(file_flush_interval_msec), api_(api), dispatcher_(dispatcher),
+      : file_flush_interval_msec_(file_flush_interval_msec),
+        file_overflow_policy_(file_overflow_policy), api_(api), dispatcher_(dispatcher),
         lock_(lock), file_stats_{
                          ACCESS_LOG_FILE_STATS(POOL_COUNTER_PREFIX(stats_store, "filesystem."),
                                                POOL_GAUGE_PREFIX(stats_store, "filesystem."))} {}
@@ -48,26 +60,135 @@ public:
 
 private:
   const std::chrono::milliseconds file_flush_interval_msec_;
+  const FileOverflowPolicy file_overflow_policy_;
   Api::Api& api_;
   Event::Dispatcher& dispatcher_;
   Thread::BasicLockable& lock_;
   AccessLogFileStats file_stats_;
+  // Shared by all files, and by the files themselves as they may outlive the manager.
+  AccessLogFlusherSharedPtr flusher_;
   absl::node_hash_map<std::string, AccessLogFileSharedPtr> access_logs_;
 };
 
+/**
+ * Single producer, single consumer byte ring buffer. Each thread writing to an access log file
+ * appends to its own ring without taking any lock. Rings are drained while holding the flush lock
+ * of the file, so there is only ever one consumer.
+ *
+ * Writes which do not fit in the ring, because it is full or they are larger than it, go to a heap
+ * allocated overflow buffer guarded by a lock instead. Once a write has overflowed, later writes
+ * go to the overflow buffer as well until it is drained, so that the data stays in order.
+ */
+class AccessLogRing {
+public:
+  /**
+   * @param capacity the size of the ring.
+   * @param max_overflow the number of bytes the overflow buffer can hold. A single write larger
+   *        than this is still accepted when the overflow buffer is empty.
+   */
+  AccessLogRing(uint64_t capacity, uint64_t max_overflow);
+
+  /**
+   * Copies data into the ring, or into the overflow buffer. Must only be called by the thread
+   * owning the ring.
+   * @return false if there is no room for data, in which case nothing is copied.
+   */
+  bool tryPush(absl::string_view data);
+
+  /**
+   * Moves all the data in the ring and then in the overflow buffer into buffer.
+   * @return the number of bytes moved.
+   */
+  uint64_t drainTo(Buffer::Instance& buffer);
+
+  /**
+   * @return the number of bytes in the ring and the overflow buffer. This is exact for the
+   * producer and a lower bound for the consumer.
+   */
+  uint64_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire) +
+           overflow_size_.load(std::memory_order_acquire);
+  }
+
+  uint64_t capacity() const { return capacity_; }
+
+  /**
+   * Marks the ring as no longer written to, as its thread has exited. Called by the owning thread.
+   */
+  void abandon() { abandoned_.store(true, std::memory_order_release); }
+
+  /**
+   * @return whether the ring was abandoned. Once it has, a drain moves all the data it will ever
+   * hold.
+   */
+  bool abandoned() const { return abandoned_.load(std::memory_order_acquire); }
+
+private:
+  bool tryPushOverflow(absl::string_view data);
+
+  const uint64_t capacity_;
+  const uint64_t max_overflow_;
+  const std::unique_ptr<char[]> data_;
+  // Total number of bytes ever pushed and drained. Only the producer advances head_, and only the
+  // consumer advances tail_.
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+  // Set by the producer when it writes to the overflow buffer, and cleared by the consumer once it
+  // has drained it.
+  std::atomic<bool> overflowed_{false};
+  std::atomic<uint64_t> overflow_size_{0};
+  std::atomic<bool> abandoned_{false};
+  Thread::MutexBasicLockable overflow_lock_;
+  Buffer::OwnedImpl overflow_ ABSL_GUARDED_BY(overflow_lock_);
+};
+
+using AccessLogRingSharedPtr = std::shared_ptr<AccessLogRing>;
+
+/**
+ * Thread which writes out the data buffered by the access log files of an AccessLogManagerImpl.
+ * Files ask for a flush when a buffer fills up or their flush timer fires, and the flusher writes
+ * them out one at a time. A single thread serves all files, as the disk writes are serialized by
+ * the cross process file lock anyway.
+ */
+class AccessLogFlusher {
+public:
+  explicit AccessLogFlusher(Thread::ThreadFactory& thread_factory);
+  ~AccessLogFlusher();
+
+  /**
+   * Schedules a flush of the file. The file must call remove() before it is destroyed.
+   */
+  void requestFlush(AccessLogFileImpl& file);
+
+  /**
+   * Cancels any scheduled flush of the file and waits for an ongoing one to complete.
+   */
+  void remove(AccessLogFileImpl& file);
+
+private:
+  void threadRoutine();
+
+  Thread::MutexBasicLockable lock_;
+  Thread::CondVar work_event_;
+  Thread::CondVar idle_event_;
+  std::deque<AccessLogFileImpl*> pending_ ABSL_GUARDED_BY(lock_);
+  AccessLogFileImpl* flushing_ ABSL_GUARDED_BY(lock_){};
+  bool exit_ ABSL_GUARDED_BY(lock_){};
+  Thread::ThreadPtr thread_;
+};
+
 /**
  * This is a file implementation geared for writing out access logs. It turn out that in certain
  * cases even if a standard file is opened with O_NONBLOCK, the kernel can still block when writing.
- * This implementation uses a flush thread per file, with the idea there aren't that many
- * files. If this turns out to be a good implementation we can potentially have a single flush
- * thread that flushes all files, but we will start with this.
+ * This implementation buffers writes in a ring per writing thread, so that workers never contend
+ * with each other, and leaves the disk writes to the AccessLogFlusher thread.
  */
 class AccessLogFileImpl : public AccessLogFile {
 public:
   AccessLogFileImpl(Filesystem::FilePtr&& file, Event::Dispatcher& dispatcher,
                     Thread::BasicLockable& lock, AccessLogFileStats& stats,
                     std::chrono::milliseconds flush_interval_msec,
-                    Thread::ThreadFactory& thread_factory);
+                    AccessLogFlusherSharedPtr flusher, FileOverflowPolicy overflow_policy);
   ~AccessLogFileImpl() override;
 
   // AccessLog::AccessLogFile
@@ -81,58 +202,76 @@ public:
   void reopen() override;
   void flush() override;
 
+  /**
+   * Writes out the buffered data, reopening the file first if requested. Called by the flusher.
+   */
+  void flushFromFlusher();
+
+  // Number of rings of threads writing to the file, for tests.
+  size_t numRingsForTest() {
+    Thread::LockGuard rings_lock(rings_lock_);
+    return rings_.size();
+  }
+
+  // Capacity of the ring of each writing thread.
+  static constexpr uint64_t RING_CAPACITY = 1024 * 64;
+  // Capacity of the overflow buffer of each ring, which takes writes that do not fit in the ring.
+  static constexpr uint64_t MAX_OVERFLOW_BYTES = RING_CAPACITY * 4;
+
 private:
+  // Returns the ring of the calling thread, or nullptr if the thread has not written to the file.
+  AccessLogRing* threadRing();
+  AccessLogRing& createThreadRing();
+  void requestFlush();
+  // Moves the data of all rings into about_to_write_buffer_, and releases the rings of threads
+  // which have exited. Requires flush_lock_.
+  void drainRings();
   void doWrite(Buffer::Instance& buffer);
-  void flushThreadFunc();
   Api::IoCallBoolResult open();
-  void createFlushStructures();
 
   // return default flags set which used by open
   static Filesystem::FlagSet defaultFlags();
 
-  // Minimum size before the flush thread will be told to flush.
-  static const uint64_t MIN_FLUSH_SIZE = 1024 * 64;
+  // Ring fill level above which the flusher will be told to flush.
+  static constexpr uint64_t MIN_FLUSH_SIZE = RING_CAPACITY / 2;
 
+  // Identifies the file in the thread local ring maps. Unlike the address, it is never reused.
+  const uint64_t id_;
   Filesystem::FilePtr file_;
 
   // These locks are always acquired in the following order if multiple locks are held:
-  //    1) write_lock_
-  //    2) flush_lock_
+  //    1) flush_lock_
+  //    2) rings_lock_ or space_lock_
   //    3) file_lock_
-  Thread::BasicLockable& file_lock_;      // This lock is used only by the flush thread when writing
-                                          // to disk. This is used to make sure that file blocks do
-                                          // not get interleaved by multiple processes writing to
-                                          // the same file during hot-restart.
+  Thread::BasicLockable& file_lock_;      // This lock is used only when writing to disk. This is
+                                          // used to make sure that file blocks do not get
+                                          // interleaved by multiple processes writing to the same
+                                          // file during hot-restart.
   Thread::MutexBasicLockable flush_lock_; // This lock is used to prevent simultaneous flushes from
-                                          // the flush thread and a synchronous flush. This protects
+                                          // the flusher and a synchronous flush. This protects
                                           // concurrent access to the about_to_write_buffer_, fd_,
-                                          // and all other data used during flushing and file
-                                          // re-opening.
-  Thread::MutexBasicLockable
-      write_lock_; // The lock is used when filling the flush buffer. It allows
-                   // multiple threads to write to the same file at relatively
-                   // high performance. It is always local to the process.
-  Thread::ThreadPtr flush_thread_;
-  Thread::CondVar flush_event_;
-  std::atomic<bool> flush_thread_exit_{};
+                                          // the consumer side of the rings, and all other data
+                                          // used during flushing and file re-opening.
+  Thread::MutexBasicLockable rings_lock_; // Only taken when a thread writes to the file for the
+                                          // first time, and when draining.
+  std::vector<AccessLogRingSharedPtr> rings_ ABSL_GUARDED_BY(rings_lock_);
+  // Writers blocked on a full ring wait on space_event_, which is signaled after every drain.
+  Thread::MutexBasicLockable space_lock_;
+  Thread::CondVar space_event_;
+  std::atomic<bool> flush_requested_{};
   std::atomic<bool> reopen_file_{};
-  Buffer::OwnedImpl
-      flush_buffer_ ABSL_GUARDED_BY(write_lock_); // This buffer is used by multiple threads. It
-                                                  // gets filled and then flushed either when max
-                                                  // size is reached or when a timer fires.
   // TODO(jmarantz): this should be ABSL_GUARDED_BY(flush_lock_) but the analysis cannot poke
   // through the std::make_unique assignment. I do not believe it's possible to annotate this
   // properly now due to limitations in the clang thread annotation analysis.
-  Buffer::OwnedImpl about_to_write_buffer_; // This buffer is used only by the flush thread. Data
-                                            // is moved from flush_buffer_ under lock, and then
-                                            // the lock is released so that flush_buffer_ can
-                                            // continue to fill. This buffer is then used for the
-                                            // final write to disk.
+  Buffer::OwnedImpl about_to_write_buffer_; // Data is moved from the rings into this buffer
+                                            // under flush_lock_, and then used for the final
+                                            // write to disk.
   Event::TimerPtr flush_timer_;
-  Thread::ThreadFactory& thread_factory_;
   const std::chrono::milliseconds flush_interval_msec_; // Time interval buffer gets flushed no
                                                         // matter if it reached the MIN_FLUSH_SIZE
                                                         // or not.
+  AccessLogFlusherSharedPtr flusher_;
+  const FileOverflowPolicy overflow_policy_;
   AccessLogFileStats& stats_;
 };
 
@@ -1,5 +1,7 @@
 #include "source/common/conn_pool/conn_pool_base.h"
 
+#include <algorithm>
+
 #include "source/common/common/assert.h"
 #include "source/common/common/debug_recursion_checker.h"
 #include "source/common/network/transport_socket_options_impl.h"
@@ -10,6 +12,19 @@
 namespace Envoy {
 namespace ConnectionPool {
 namespace {
+// The weight given to the newest sample in the adaptive preconnect moving averages.
+constexpr double AdaptivePreconnectSampleWeight = 0.2;
+// Bounds the streams anticipated by adaptive preconnect so that a burst of back to back streams
+// to a slow upstream does not translate into an unbounded number of preconnects.
+constexpr uint32_t MaxAdaptiveAnticipatedStreams = 64;
+
+double updateMovingAverage(double average, double sample) {
+  if (average == 0) {
+    return sample;
+  }
+  return AdaptivePreconnectSampleWeight * sample + (1 - AdaptivePreconnectSampleWeight) * average;
+}
+
 [[maybe_unused]] ssize_t connectingCapacity(const std::list<ActiveClientPtr>& connecting_clients) {
   ssize_t ret = 0;
   for (const auto& client : connecting_clients) {
@@ -96,8 +111,11 @@ bool ConnPoolImplBase::shouldCreateNewConnection(float global_preconnect_ratio)
     //
     // Local preconnect does not need to anticipate a stream. It is called as
     // new streams are established or torn down and simply attempts to maintain
-    // the correct ratio of streams and anticipated capacity.
-    return shouldConnect(pending_streams_.size(), num_active_streams_, connecting_stream_capacity_,
+    // the correct ratio of streams and anticipated capacity. With adaptive
+    // preconnect, the streams expected during a connection handshake are
+    // provisioned for as if they were already pending.
+    return shouldConnect(pending_streams_.size() + adaptiveAnticipatedStreams(),
+                         num_active_streams_, connecting_stream_capacity_,
                          perUpstreamPreconnectRatio());
   }
 }
@@ -106,6 +124,60 @@ float ConnPoolImplBase::perUpstreamPreconnectRatio() const {
   return host_->cluster().perUpstreamPreconnectRatio();
 }
 
+uint32_t ConnPoolImplBase::adaptiveAnticipatedStreams() const {
+  if (!host_->cluster().adaptivePreconnect() || !last_stream_arrival_.has_value() ||
+      stream_interval_ms_average_ == 0 || connect_latency_ms_average_ == 0) {
+    return 0;
+  }
+  // If no stream has arrived for longer than the average interval, the rate has dropped and
+  // the time since the last stream is the better estimate. This makes the estimate decay while
+  // the pool is idle, rather than preconnecting for a burst which has ended.
+  const double since_last_stream_ms =
+      std::chrono::duration<double, std::milli>(dispatcher_.timeSource().monotonicTime() -
+                                                last_stream_arrival_.value())
+          .count();
+  const double interval_ms = std::max(stream_interval_ms_average_, since_last_stream_ms);
+  // Only whole streams are anticipated, so a pool which sees less than one stream per
+  // connection establishment does not preconnect.
+  const uint32_t anticipated = static_cast<uint32_t>(
+      std::min<double>(connect_latency_ms_average_ / interval_ms,
+                       static_cast<double>(MaxAdaptiveAnticipatedStreams)));
+  // The anticipated streams are served by the unused capacity of the connected connections first,
+  // so only the remainder calls for new connections.
+  uint64_t ready_capacity = 0;
+  for (const ActiveClientPtr& client : ready_clients_) {
+    ready_capacity += std::max<int64_t>(client->currentUnusedCapacity(), 0);
+    if (ready_capacity >= anticipated) {
+      return 0;
+    }
+  }
+  return anticipated - ready_capacity;
+}
+
+void ConnPoolImplBase::recordStreamArrival() {
+  if (!host_->cluster().adaptivePreconnect()) {
+    return;
+  }
+  const MonotonicTime now = dispatcher_.timeSource().monotonicTime();
+  if (last_stream_arrival_.has_value()) {
+    // Clamp to a small positive value so back to back streams still move the average.
+    const double interval_ms = std::max(
+        std::chrono::duration<double, std::milli>(now - last_stream_arrival_.value()).count(),
+        0.001);
+    stream_interval_ms_average_ = updateMovingAverage(stream_interval_ms_average_, interval_ms);
+  }
+  last_stream_arrival_ = now;
+}
+
+void ConnPoolImplBase::recordConnectLatency(std::chrono::milliseconds latency) {
+  if (!host_->cluster().adaptivePreconnect()) {
+    return;
+  }
+  // Sub-millisecond connects are rounded up so that they are still sampled.
+  connect_latency_ms_average_ = updateMovingAverage(
+      connect_latency_ms_average_, std::max<double>(static_cast<double>(latency.count()), 1));
+}
+
 ConnPoolImplBase::ConnectionResult ConnPoolImplBase::tryCreateNewConnections() {
   ASSERT(!is_draining_for_deletion_);
   ConnPoolImplBase::ConnectionResult result;
@@ -259,6 +331,7 @@ ConnectionPool::Cancellable* ConnPoolImplBase::newStreamImpl(AttachContext& cont
   ASSERT(static_cast<ssize_t>(connecting_stream_capacity_) ==
          connectingCapacity(connecting_clients_) +
              connectingCapacity(early_data_clients_)); // O(n) debug check.
+  recordStreamArrival();
   if (!ready_clients_.empty()) {
     ActiveClient& client = *ready_clients_.front();
     ENVOY_CONN_LOG(debug, "using existing fully connected connection", client);
@@ -563,6 +636,7 @@ void ConnPoolImplBase::onConnectionEvent(ActiveClient& client, absl::string_view
     ASSERT(connecting_stream_capacity_ >= client.currentUnusedCapacity());
     connecting_stream_capacity_ -= client.currentUnusedCapacity();
     client.has_handshake_completed_ = true;
+    recordConnectLatency(client.conn_connect_ms_->elapsed());
     client.conn_connect_ms_->complete();
     client.conn_connect_ms_.reset();
     if (client.state() == ActiveClient::State::Connecting ||
@@ -645,7 +719,11 @@ bool ConnPoolImplBase::connectingConnectionIsExcess(const ActiveClient& client)
   // If preconnect ratio is set, it also factors in the anticipated load based on both queued
   // streams and active streams, and makes sure the connecting capacity would still be sufficient to
   // serve that even with the most recent client removed.
-  return (pending_streams_.size() + num_active_streams_) * perUpstreamPreconnectRatio() <=
+  //
+  // With adaptive preconnect, the streams anticipated from the recent arrival rate are included,
+  // so connections preconnected for a burst are only closed once the burst has subsided.
+  return (pending_streams_.size() + adaptiveAnticipatedStreams() + num_active_streams_) *
+             perUpstreamPreconnectRatio() <=
          (connecting_stream_capacity_ - client.currentUnusedCapacity() + num_active_streams_);
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "envoy/common/conn_pool.h"
+#include "envoy/common/time.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/network/connection.h"
 #include "envoy/stats/timespan.h"
@@ -11,6 +12,7 @@
 #include "source/common/common/linked_object.h"
 
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 
 namespace Envoy {
 namespace ConnectionPool {
@@ -341,6 +343,11 @@ protected:
 
   float perUpstreamPreconnectRatio() const;
 
+  // Returns the number of streams expected to arrive while a new connection is established beyond
+  // the unused capacity of the ready connections, if the cluster uses adaptive preconnect, and
+  // zero otherwise.
+  uint32_t adaptiveAnticipatedStreams() const;
+
   ConnectionPool::Cancellable*
   addPendingStream(Envoy::ConnectionPool::PendingStreamPtr&& pending_stream) {
     LinkedList::moveIntoList(std::move(pending_stream), pending_streams_);
@@ -392,11 +399,21 @@ private:
   // Prerequisite: the given clients shouldn't be idle.
   void drainClients(std::list<ActiveClientPtr>& clients);
 
+  // Update the moving averages used by adaptive preconnect.
+  void recordStreamArrival();
+  void recordConnectLatency(std::chrono::milliseconds latency);
+
   std::list<PendingStreamPtr> pending_streams_;
 
   // The number of streams currently attached to clients.
   uint32_t num_active_streams_{0};
 
+  // Exponentially weighted moving averages of the interval between new streams and of the time
+  // taken to establish a connection, used by adaptive preconnect. Zero until sampled.
+  absl::optional<MonotonicTime> last_stream_arrival_;
+  double stream_interval_ms_average_{0};
+  double connect_latency_ms_average_{0};
+
   // Whether the connection pool is currently in the process of closing
   // all connections so that it can be gracefully deleted.
   bool is_draining_for_deletion_{false};
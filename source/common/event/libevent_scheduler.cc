@@ -30,13 +30,14 @@ LibeventScheduler::LibeventScheduler() {
 #endif
   RELEASE_ASSERT(event_base != nullptr, "Failed to initialize libevent event_base");
   libevent_ = Libevent::BasePtr(event_base);
+  common_timeouts_ = std::make_unique<CommonTimeouts>(*event_base);
 
   // The dispatcher won't work as expected if libevent hasn't been configured to use threads.
   RELEASE_ASSERT(Libevent::Global::initialized(), "");
 }
 
 TimerPtr LibeventScheduler::createTimer(const TimerCb& cb, Dispatcher& dispatcher) {
-  return std::make_unique<TimerImpl>(libevent_, cb, dispatcher);
+  return std::make_unique<TimerImpl>(libevent_, cb, dispatcher, common_timeouts_.get());
 };
 
 SchedulableCallbackPtr
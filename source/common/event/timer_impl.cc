@@ -9,8 +9,28 @@
 namespace Envoy {
 namespace Event {
 
-TimerImpl::TimerImpl(Libevent::BasePtr& libevent, TimerCb cb, Dispatcher& dispatcher)
-    : cb_(cb), dispatcher_(dispatcher) {
+const timeval& CommonTimeouts::get(const timeval& tv) {
+  if (tv.tv_usec != 0 || tv.tv_sec == 0) {
+    return tv;
+  }
+  auto it = common_timeouts_.find(tv.tv_sec);
+  if (it == common_timeouts_.end()) {
+    if (common_timeouts_.size() >= MaxCommonTimeouts) {
+      return tv;
+    }
+    // The returned timeval is owned by the event base and stays valid for its lifetime.
+    const timeval* common_timeout = event_base_init_common_timeout(&base_, &tv);
+    if (common_timeout == nullptr) {
+      return tv;
+    }
+    it = common_timeouts_.emplace(tv.tv_sec, common_timeout).first;
+  }
+  return *it->second;
+}
+
+TimerImpl::TimerImpl(Libevent::BasePtr& libevent, TimerCb cb, Dispatcher& dispatcher,
+                     CommonTimeouts* common_timeouts)
+    : cb_(cb), dispatcher_(dispatcher), common_timeouts_(common_timeouts) {
   ASSERT(cb_);
   evtimer_assign(
       &raw_event_, libevent.get(),
@@ -35,7 +55,7 @@ void TimerImpl::disableTimer() {
 void TimerImpl::enableTimer(const std::chrono::milliseconds d, const ScopeTrackedObject* object) {
   timeval tv;
   TimerUtils::durationToTimeval(d, tv);
-  internalEnableTimer(tv, object);
+  internalEnableTimer(common_timeouts_ != nullptr ? common_timeouts_->get(tv) : tv, object);
 }
 
 void TimerImpl::enableHRTimer(const std::chrono::microseconds d,
@@ -9,6 +9,8 @@
 #include "source/common/event/event_impl_base.h"
 #include "source/common/event/libevent.h"
 
+#include "absl/container/flat_hash_map.h"
+
 namespace Envoy {
 namespace Event {
 
@@ -47,12 +49,42 @@ public:
   }
 };
 
+/**
+ * Maps timer durations to libevent common timeouts. libevent keeps all the timers which share a
+ * common timeout in a FIFO queue that occupies a single entry of its timer min-heap, so arming and
+ * cancelling them is O(1) instead of O(log n) in the number of pending timers. This suits the many
+ * per-connection and per-stream timeouts which are re-armed with the same configured duration.
+ *
+ * Only whole-second durations use common timeouts, since configured timeouts are typically whole
+ * seconds while computed ones (e.g. remaining deadlines or jittered backoffs) are not, and
+ * libevent supports a limited number of common timeouts per event base. Other durations, and any
+ * durations beyond MaxCommonTimeouts, use the heap as before.
+ */
+class CommonTimeouts {
+public:
+  static constexpr size_t MaxCommonTimeouts = 64;
+
+  explicit CommonTimeouts(event_base& base) : base_(base) {}
+
+  /**
+   * @param tv the timeout duration.
+   * @return the timeval to pass to event_add(), either a common timeout equivalent to tv or tv
+   * itself.
+   */
+  const timeval& get(const timeval& tv);
+
+private:
+  event_base& base_;
+  absl::flat_hash_map<time_t, const timeval*> common_timeouts_;
+};
+
 /**
  * libevent implementation of Timer.
  */
 class TimerImpl : public Timer, ImplBase {
 public:
-  TimerImpl(Libevent::BasePtr& libevent, TimerCb cb, Event::Dispatcher& dispatcher);
+  TimerImpl(Libevent::BasePtr& libevent, TimerCb cb, Event::Dispatcher& dispatcher,
+            CommonTimeouts* common_timeouts = nullptr);
 
   // Timer
   void disableTimer() override;
@@ -66,6 +98,7 @@ private:
   void internalEnableTimer(const timeval& tv, const ScopeTrackedObject* scope);
   TimerCb cb_;
   Dispatcher& dispatcher_;
+  CommonTimeouts* const common_timeouts_;
   // This has to be atomic for alarms which are handled out of thread, for
   // example if the DispatcherImpl::post is called by two threads, they race to
   // both set this to null.
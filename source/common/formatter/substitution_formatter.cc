@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <climits>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
@@ -23,11 +24,13 @@
 #include "source/common/grpc/common.h"
 #include "source/common/grpc/status.h"
 #include "source/common/http/utility.h"
+#include "source/common/json/json_sanitizer.h"
 #include "source/common/protobuf/message_validator_impl.h"
 #include "source/common/protobuf/utility.h"
 #include "source/common/runtime/runtime_features.h"
 #include "source/common/stream_info/utility.h"
 
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "fmt/format.h"
 
@@ -50,6 +53,14 @@ void truncate(std::string& str, absl::optional<uint32_t> max_length) {
   str = str.substr(0, max_length.value());
 }
 
+absl::string_view truncate(absl::string_view str, absl::optional<uint32_t> max_length) {
+  if (!max_length) {
+    return str;
+  }
+
+  return str.substr(0, max_length.value());
+}
+
 // Matches newline pattern in a system time format string (e.g. start time)
 const std::regex& getSystemTimeFormatNewlinePattern() {
   CONSTRUCT_ON_FIRST_USE(std::regex, "%[-_0^#]*[1-9]*(E|O)?n");
@@ -132,9 +143,10 @@ std::string FormatterImpl::format(const Http::RequestHeaderMap& request_headers,
   log_line.reserve(256);
 
   for (const FormatterProviderPtr& provider : providers_) {
-    const auto bit = provider->format(request_headers, response_headers, response_trailers,
-                                      stream_info, local_reply_body);
-    log_line += bit.value_or(empty_value_string_);
+    if (!provider->formatTo(request_headers, response_headers, response_trailers, stream_info,
+                            local_reply_body, log_line)) {
+      log_line += empty_value_string_;
+    }
   }
 
   return log_line;
@@ -145,12 +157,198 @@ std::string JsonFormatterImpl::format(const Http::RequestHeaderMap& request_head
                                       const Http::ResponseTrailerMap& response_trailers,
                                       const StreamInfo::StreamInfo& stream_info,
                                       absl::string_view local_reply_body) const {
-  const ProtobufWkt::Struct output_struct = struct_formatter_.format(
-      request_headers, response_headers, response_trailers, stream_info, local_reply_body);
+  std::string log_line;
+  log_line.reserve(256);
+  struct_formatter_.formatJson(request_headers, response_headers, response_trailers, stream_info,
+                               local_reply_body, log_line);
+  log_line.push_back('\n');
+  return log_line;
+}
+
+namespace {
+
+void appendJsonString(absl::string_view str, std::string& output) {
+  std::string buffer;
+  output.push_back('"');
+  output.append(Json::sanitize(buffer, str));
+  output.push_back('"');
+}
+
+// Escapes and closes the JSON string whose unescaped value was appended to output from value_start
+// on, after its opening quote. The value is only copied if it needs escaping, which is rare for
+// header values and stream info fields.
+void closeJsonString(size_t value_start, std::string& output) {
+  std::string buffer;
+  const absl::string_view value = absl::string_view(output).substr(value_start);
+  const absl::string_view sanitized = Json::sanitize(buffer, value);
+  if (sanitized.data() != value.data()) {
+    output.resize(value_start);
+    output.append(sanitized);
+  }
+  output.push_back('"');
+}
+
+// Appends a value produced by a type preserving provider. Returns false if the value is null and
+// omitted.
+bool appendJsonValue(const ProtobufWkt::Value& value, bool omit_empty_values,
+                     std::string& output) {
+  // Integral numbers below this are printed as plain integers by the protobuf JSON printer.
+  static constexpr double MaxPlainIntegerJsonValue = 1e15;
+
+  switch (value.kind_case()) {
+  case ProtobufWkt::Value::kNullValue:
+    if (omit_empty_values) {
+      return false;
+    }
+    FALLTHRU;
+  case ProtobufWkt::Value::KIND_NOT_SET:
+    output.append("null");
+    return true;
+  case ProtobufWkt::Value::kStringValue:
+    appendJsonString(value.string_value(), output);
+    return true;
+  case ProtobufWkt::Value::kBoolValue:
+    output.append(value.bool_value() ? "true" : "false");
+    return true;
+  case ProtobufWkt::Value::kNumberValue: {
+    const double number = value.number_value();
+    if (std::abs(number) < MaxPlainIntegerJsonValue && number == std::trunc(number)) {
+      absl::StrAppend(&output, static_cast<int64_t>(number));
+      return true;
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  // Structs, lists and non-integral numbers are rare in access logs, so defer to the protobuf
+  // JSON printer for them.
+  output.append(MessageUtil::getJsonStringFromMessageOrDie(value, false, true));
+  return true;
+}
+
+} // namespace
+
+void StructFormatter::formatJson(const Http::RequestHeaderMap& request_headers,
+                                 const Http::ResponseHeaderMap& response_headers,
+                                 const Http::ResponseTrailerMap& response_trailers,
+                                 const StreamInfo::StreamInfo& stream_info,
+                                 absl::string_view local_reply_body, std::string& output) const {
+  structFormatMapJson(struct_output_format_, request_headers, response_headers, response_trailers,
+                      stream_info, local_reply_body, output);
+}
+
+bool StructFormatter::providersJson(const std::vector<FormatterProviderPtr>& providers,
+                                    const Http::RequestHeaderMap& request_headers,
+                                    const Http::ResponseHeaderMap& response_headers,
+                                    const Http::ResponseTrailerMap& response_trailers,
+                                    const StreamInfo::StreamInfo& stream_info,
+                                    absl::string_view local_reply_body,
+                                    std::string& output) const {
+  ASSERT(!providers.empty());
+  if (providers.size() == 1) {
+    const auto& provider = providers.front();
+    if (preserve_types_) {
+      return appendJsonValue(provider->formatValue(request_headers, response_headers,
+                                                   response_trailers, stream_info,
+                                                   local_reply_body),
+                             omit_empty_values_, output);
+    }
+
+    output.push_back('"');
+    const size_t value_start = output.size();
+    if (!provider->formatTo(request_headers, response_headers, response_trailers, stream_info,
+                            local_reply_body, output)) {
+      if (omit_empty_values_) {
+        output.pop_back();
+        return false;
+      }
+      output.append(DefaultUnspecifiedValueString);
+    }
+    closeJsonString(value_start, output);
+    return true;
+  }
+  // Multiple providers forces string output.
+  output.push_back('"');
+  const size_t value_start = output.size();
+  for (const auto& provider : providers) {
+    if (!provider->formatTo(request_headers, response_headers, response_trailers, stream_info,
+                            local_reply_body, output)) {
+      output.append(empty_value_);
+    }
+  }
+  closeJsonString(value_start, output);
+  return true;
+}
+
+bool StructFormatter::valueJson(const StructFormatValue& value,
+                                const Http::RequestHeaderMap& request_headers,
+                                const Http::ResponseHeaderMap& response_headers,
+                                const Http::ResponseTrailerMap& response_trailers,
+                                const StreamInfo::StreamInfo& stream_info,
+                                absl::string_view local_reply_body, std::string& output) const {
+  if (const auto* providers = absl::get_if<const std::vector<FormatterProviderPtr>>(&value)) {
+    return providersJson(*providers, request_headers, response_headers, response_trailers,
+                         stream_info, local_reply_body, output);
+  }
+  if (const auto* format_map = absl::get_if<const StructFormatMapWrapper>(&value)) {
+    structFormatMapJson(*format_map, request_headers, response_headers, response_trailers,
+                        stream_info, local_reply_body, output);
+    return true;
+  }
+  structFormatListJson(absl::get<const StructFormatListWrapper>(value), request_headers,
+                       response_headers, response_trailers, stream_info, local_reply_body,
+                       output);
+  return true;
+}
 
-  const std::string log_line =
-      MessageUtil::getJsonStringFromMessageOrDie(output_struct, false, true);
-  return absl::StrCat(log_line, "\n");
+void StructFormatter::structFormatMapJson(const StructFormatter::StructFormatMapWrapper& format_map,
+                                          const Http::RequestHeaderMap& request_headers,
+                                          const Http::ResponseHeaderMap& response_headers,
+                                          const Http::ResponseTrailerMap& response_trailers,
+                                          const StreamInfo::StreamInfo& stream_info,
+                                          absl::string_view local_reply_body,
+                                          std::string& output) const {
+  output.push_back('{');
+  bool first = true;
+  for (const auto& pair : *format_map.value_) {
+    const size_t field_start = output.size();
+    if (!first) {
+      output.push_back(',');
+    }
+    appendJsonString(pair.first, output);
+    output.push_back(':');
+    if (!valueJson(pair.second, request_headers, response_headers, response_trailers, stream_info,
+                   local_reply_body, output)) {
+      // The value is omitted, so drop the key as well.
+      output.resize(field_start);
+      continue;
+    }
+    first = false;
+  }
+  output.push_back('}');
+}
+
+void StructFormatter::structFormatListJson(
+    const StructFormatter::StructFormatListWrapper& format_list,
+    const Http::RequestHeaderMap& request_headers, const Http::ResponseHeaderMap& response_headers,
+    const Http::ResponseTrailerMap& response_trailers, const StreamInfo::StreamInfo& stream_info,
+    absl::string_view local_reply_body, std::string& output) const {
+  output.push_back('[');
+  bool first = true;
+  for (const auto& value : *format_list.value_) {
+    const size_t element_start = output.size();
+    if (!first) {
+      output.push_back(',');
+    }
+    if (!valueJson(value, request_headers, response_headers, response_trailers, stream_info,
+                   local_reply_body, output)) {
+      output.resize(element_start);
+      continue;
+    }
+    first = false;
+  }
+  output.push_back(']');
 }
 
 StructFormatter::StructFormatter(const ProtobufWkt::Struct& format_mapping, bool preserve_types,
@@ -663,6 +861,15 @@ public:
 
     return fmt::format_int(millis.value()).str();
   }
+  bool extractTo(const StreamInfo::StreamInfo& stream_info, std::string& output) const override {
+    const auto millis = extractMillis(stream_info);
+    if (!millis) {
+      return false;
+    }
+
+    absl::StrAppend(&output, millis.value());
+    return true;
+  }
   ProtobufWkt::Value extractValue(const StreamInfo::StreamInfo& stream_info) const override {
     const auto millis = extractMillis(stream_info);
     if (!millis) {
@@ -695,6 +902,10 @@ public:
   absl::optional<std::string> extract(const StreamInfo::StreamInfo& stream_info) const override {
     return fmt::format_int(field_extractor_(stream_info)).str();
   }
+  bool extractTo(const StreamInfo::StreamInfo& stream_info, std::string& output) const override {
+    absl::StrAppend(&output, field_extractor_(stream_info));
+    return true;
+  }
   ProtobufWkt::Value extractValue(const StreamInfo::StreamInfo& stream_info) const override {
     return ValueUtil::numberValue(field_extractor_(stream_info));
   }
@@ -737,6 +948,19 @@ public:
 
     return toString(*address);
   }
+  bool extractTo(const StreamInfo::StreamInfo& stream_info, std::string& output) const override {
+    Network::Address::InstanceConstSharedPtr address = field_extractor_(stream_info);
+    if (!address) {
+      return false;
+    }
+
+    if (extraction_type_ == StreamInfoFormatter::StreamInfoAddressFieldExtractionType::WithPort) {
+      output.append(address->asStringView());
+    } else {
+      output.append(toString(*address));
+    }
+    return true;
+  }
   ProtobufWkt::Value extractValue(const StreamInfo::StreamInfo& stream_info) const override {
     Network::Address::InstanceConstSharedPtr address = field_extractor_(stream_info);
     if (!address) {
@@ -1515,6 +1739,13 @@ absl::optional<std::string> StreamInfoFormatter::format(const Http::RequestHeade
   return field_extractor_->extract(stream_info);
 }
 
+bool StreamInfoFormatter::formatTo(const Http::RequestHeaderMap&, const Http::ResponseHeaderMap&,
+                                   const Http::ResponseTrailerMap&,
+                                   const StreamInfo::StreamInfo& stream_info, absl::string_view,
+                                   std::string& output) const {
+  return field_extractor_->extractTo(stream_info, output);
+}
+
 ProtobufWkt::Value StreamInfoFormatter::formatValue(const Http::RequestHeaderMap&,
                                                     const Http::ResponseHeaderMap&,
                                                     const Http::ResponseTrailerMap&,
@@ -1533,6 +1764,13 @@ absl::optional<std::string> PlainStringFormatter::format(const Http::RequestHead
   return str_.string_value();
 }
 
+bool PlainStringFormatter::formatTo(const Http::RequestHeaderMap&, const Http::ResponseHeaderMap&,
+                                    const Http::ResponseTrailerMap&, const StreamInfo::StreamInfo&,
+                                    absl::string_view, std::string& output) const {
+  output.append(str_.string_value());
+  return true;
+}
+
 ProtobufWkt::Value PlainStringFormatter::formatValue(const Http::RequestHeaderMap&,
                                                      const Http::ResponseHeaderMap&,
                                                      const Http::ResponseTrailerMap&,
@@ -1548,6 +1786,16 @@ LocalReplyBodyFormatter::format(const Http::RequestHeaderMap&, const Http::Respo
   return std::string(local_reply_body);
 }
 
+bool LocalReplyBodyFormatter::formatTo(const Http::RequestHeaderMap&,
+                                       const Http::ResponseHeaderMap&,
+                                       const Http::ResponseTrailerMap&,
+                                       const StreamInfo::StreamInfo&,
+                                       absl::string_view local_reply_body,
+                                       std::string& output) const {
+  output.append(local_reply_body);
+  return true;
+}
+
 ProtobufWkt::Value LocalReplyBodyFormatter::formatValue(const Http::RequestHeaderMap&,
                                                         const Http::ResponseHeaderMap&,
                                                         const Http::ResponseTrailerMap&,
@@ -1584,6 +1832,16 @@ absl::optional<std::string> HeaderFormatter::format(const Http::HeaderMap& heade
   return val;
 }
 
+bool HeaderFormatter::formatTo(const Http::HeaderMap& headers, std::string& output) const {
+  const Http::HeaderEntry* header = findHeader(headers);
+  if (!header) {
+    return false;
+  }
+
+  output.append(truncate(header->value().getStringView(), max_length_));
+  return true;
+}
+
 ProtobufWkt::Value HeaderFormatter::formatValue(const Http::HeaderMap& headers) const {
   const Http::HeaderEntry* header = findHeader(headers);
   if (!header) {
@@ -1606,6 +1864,14 @@ absl::optional<std::string> ResponseHeaderFormatter::format(
   return HeaderFormatter::format(response_headers);
 }
 
+bool ResponseHeaderFormatter::formatTo(const Http::RequestHeaderMap&,
+                                       const Http::ResponseHeaderMap& response_headers,
+                                       const Http::ResponseTrailerMap&,
+                                       const StreamInfo::StreamInfo&, absl::string_view,
+                                       std::string& output) const {
+  return HeaderFormatter::formatTo(response_headers, output);
+}
+
 ProtobufWkt::Value ResponseHeaderFormatter::formatValue(
     const Http::RequestHeaderMap&, const Http::ResponseHeaderMap& response_headers,
     const Http::ResponseTrailerMap&, const StreamInfo::StreamInfo&, absl::string_view) const {
@@ -1624,6 +1890,14 @@ RequestHeaderFormatter::format(const Http::RequestHeaderMap& request_headers,
   return HeaderFormatter::format(request_headers);
 }
 
+bool RequestHeaderFormatter::formatTo(const Http::RequestHeaderMap& request_headers,
+                                      const Http::ResponseHeaderMap&,
+                                      const Http::ResponseTrailerMap&,
+                                      const StreamInfo::StreamInfo&, absl::string_view,
+                                      std::string& output) const {
+  return HeaderFormatter::formatTo(request_headers, output);
+}
+
 ProtobufWkt::Value
 RequestHeaderFormatter::formatValue(const Http::RequestHeaderMap& request_headers,
                                     const Http::ResponseHeaderMap&, const Http::ResponseTrailerMap&,
@@ -1643,6 +1917,14 @@ ResponseTrailerFormatter::format(const Http::RequestHeaderMap&, const Http::Resp
   return HeaderFormatter::format(response_trailers);
 }
 
+bool ResponseTrailerFormatter::formatTo(const Http::RequestHeaderMap&,
+                                        const Http::ResponseHeaderMap&,
+                                        const Http::ResponseTrailerMap& response_trailers,
+                                        const StreamInfo::StreamInfo&, absl::string_view,
+                                        std::string& output) const {
+  return HeaderFormatter::formatTo(response_trailers, output);
+}
+
 ProtobufWkt::Value
 ResponseTrailerFormatter::formatValue(const Http::RequestHeaderMap&, const Http::ResponseHeaderMap&,
                                       const Http::ResponseTrailerMap& response_trailers,
@@ -14,6 +14,7 @@
 #include "source/common/local_reply/local_reply.h"
 #include "source/common/network/utility.h"
 #include "source/common/stats/symbol_table.h"
+#include "source/common/tracing/tail_sampler_impl.h"
 
 namespace Envoy {
 namespace Http {
@@ -133,6 +134,8 @@ struct TracingConnectionManagerConfig {
   envoy::type::v3::FractionalPercent overall_sampling_;
   bool verbose_;
   uint32_t max_path_tag_length_;
+  // Exports the spans of requests not sampled up front that turn out slow or failing, if set.
+  Tracing::TailSamplerSharedPtr tail_sampler_;
 };
 
 using TracingConnectionManagerConfigPtr = std::unique_ptr<TracingConnectionManagerConfig>;
@@ -1145,6 +1145,19 @@ void ConnectionManagerImpl::ActiveStream::traceRequest() {
     return;
   }
 
+  // Requests not sampled up front may still be exported by tail sampling if they turn out slow or
+  // failing. Health checks are left out of it.
+  const auto& tail_sampler = connection_manager_.config_.tracingConfig()->tail_sampler_;
+  if (tail_sampler != nullptr && !tracing_decision.traced &&
+      tracing_decision.reason != Tracing::Reason::HealthCheck) {
+    active_span_ = tail_sampler->wrap(
+        std::move(active_span_),
+        Tracing::HttpTracerUtility::toString(
+            connection_manager_.config_.tracingConfig()->operation_name_),
+        filter_manager_.streamInfo().startTime(),
+        filter_manager_.streamInfo().startTimeMonotonic());
+  }
+
   // TODO: Need to investigate the following code based on the cached route, as may
   // be broken in the case a filter changes the route.
 
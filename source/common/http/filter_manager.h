@@ -26,6 +26,8 @@
 #include "source/common/protobuf/utility.h"
 #include "source/common/stream_info/stream_info_impl.h"
 
+#include "absl/container/inlined_vector.h"
+
 namespace Envoy {
 namespace Http {
 
@@ -966,8 +968,11 @@ private:
 
   std::list<ActiveStreamDecoderFilterPtr> decoder_filters_;
   std::list<ActiveStreamEncoderFilterPtr> encoder_filters_;
-  std::list<StreamFilterBase*> filters_;
-  std::list<AccessLog::InstanceSharedPtr> access_log_handlers_;
+  // These are only appended to while the filter chain is created and then iterated, so they are
+  // kept inline in the FilterManager to avoid a heap allocation per filter and per handler for
+  // typical chain lengths.
+  absl::InlinedVector<StreamFilterBase*, 8> filters_;
+  absl::InlinedVector<AccessLog::InstanceSharedPtr, 2> access_log_handlers_;
 
   // Stores metadata added in the decoding filter that is being processed. Will be cleared before
   // processing the next filter. The storage is created on demand. We need to store metadata
@@ -34,5 +34,37 @@ ExactConnectionBalancerImpl::pickTargetHandler(BalancedConnectionHandler&) {
   return *min_connection_handler;
 }
 
+void PowerOfTwoChoicesConnectionBalancerImpl::registerHandler(BalancedConnectionHandler& handler) {
+  absl::MutexLock lock(&lock_);
+  handlers_.push_back(&handler);
+}
+
+void PowerOfTwoChoicesConnectionBalancerImpl::unregisterHandler(
+    BalancedConnectionHandler& handler) {
+  absl::MutexLock lock(&lock_);
+  handlers_.erase(std::find(handlers_.begin(), handlers_.end(), &handler));
+}
+
+BalancedConnectionHandler&
+PowerOfTwoChoicesConnectionBalancerImpl::pickTargetHandler(
+    BalancedConnectionHandler& current_handler) {
+  BalancedConnectionHandler* target_handler = &current_handler;
+  {
+    // The reader lock is held until the connection count is incremented, so that the handler
+    // picked can't be unregistered and destroyed in between.
+    absl::ReaderMutexLock lock(&lock_);
+    if (!handlers_.empty()) {
+      // The candidate may be the current handler itself, in which case the connection stays put.
+      BalancedConnectionHandler* candidate = handlers_[random_.random() % handlers_.size()];
+      if (candidate->numConnections() < current_handler.numConnections()) {
+        target_handler = candidate;
+      }
+    }
+    target_handler->incNumConnections();
+  }
+
+  return *target_handler;
+}
+
 } // namespace Network
 } // namespace Envoy
@@ -5,6 +5,7 @@
 #include "envoy/registry/registry.h"
 #include "envoy/server/filter_config.h"
 
+#include "source/common/common/random_generator.h"
 #include "source/common/protobuf/protobuf.h"
 
 #include "absl/synchronization/mutex.h"
@@ -44,6 +45,30 @@ private:
   std::vector<BalancedConnectionHandler*> handlers_ ABSL_GUARDED_BY(lock_);
 };
 
+/**
+ * Implementation of connection balancer that uses the "power of two choices". For each accepted
+ * connection the accepting handler is compared with one other handler chosen at random, and the
+ * connection goes to whichever has fewer connections, preferring the accepting handler on ties to
+ * avoid a cross-thread hand off. This keeps connection counts close to balanced without scanning
+ * every handler or serializing accepts: pickers only share a reader lock on the handler list, which
+ * is written only when listeners are added to or removed from workers. The connection count of the
+ * chosen handler is incremented under the reader lock, so a handler is not picked once
+ * unregisterHandler() returns. It should be preferred over exact balancing for listeners with high
+ * accept rates.
+ */
+class PowerOfTwoChoicesConnectionBalancerImpl : public ConnectionBalancer {
+public:
+  // ConnectionBalancer
+  void registerHandler(BalancedConnectionHandler& handler) override;
+  void unregisterHandler(BalancedConnectionHandler& handler) override;
+  BalancedConnectionHandler& pickTargetHandler(BalancedConnectionHandler& current_handler) override;
+
+private:
+  Random::RandomGeneratorImpl random_;
+  absl::Mutex lock_;
+  std::vector<BalancedConnectionHandler*> handlers_ ABSL_GUARDED_BY(lock_);
+};
+
 /**
  * A NOP connection balancer implementation that always continues execution after incrementing
  * the handler's connection count.
@@ -67,7 +67,7 @@ void ThreadLocalStoreImpl::setStatsMatcher(StatsMatcherPtr&& stats_matcher) {
   // constructed prior to the stat-matcher, and those add stats
   // in the default_scope. There should be no requests, so there will
   // be no copies in TLS caches.
-  Thread::LockGuard lock(lock_);
+  absl::MutexLock lock(&lock_);
   const uint32_t first_histogram_index = deleted_histograms_.size();
   iterateScopesLockHeld([this](const ScopeImplSharedPtr& scope) ABSL_EXCLUSIVE_LOCKS_REQUIRED(
                             lock_) -> bool {
@@ -154,7 +154,7 @@ ScopeSharedPtr ThreadLocalStoreImpl::createScope(const std::string& name) {
 
 ScopeSharedPtr ThreadLocalStoreImpl::scopeFromStatName(StatName name) {
   auto new_scope = std::make_shared<ScopeImpl>(*this, name);
-  Thread::LockGuard lock(lock_);
+  absl::MutexLock lock(&lock_);
   scopes_[new_scope.get()] = std::weak_ptr<ScopeImpl>(new_scope);
   return new_scope;
 }
@@ -208,7 +208,7 @@ void ThreadLocalStoreImpl::shutdownThreading() {
   // to simply clear the scopes and central cache entries here as they will be cleaned up during
   // thread local data cleanup in InstanceImpl::shutdownThread().
   {
-    Thread::LockGuard lock(lock_);
+    absl::MutexLock lock(&lock_);
     scopes_to_cleanup_.clear();
     central_cache_entries_to_cleanup_.clear();
   }
@@ -256,7 +256,7 @@ ThreadLocalStoreImpl::CentralCacheEntry::~CentralCacheEntry() {
 }
 
 void ThreadLocalStoreImpl::releaseScopeCrossThread(ScopeImpl* scope) {
-  Thread::ReleasableLockGuard lock(lock_);
+  absl::ReleasableMutexLock lock(&lock_);
   ASSERT(scopes_.count(scope) == 1);
   scopes_.erase(scope);
 
@@ -288,7 +288,7 @@ void ThreadLocalStoreImpl::releaseScopeCrossThread(ScopeImpl* scope) {
     bool need_post = scopes_to_cleanup_.empty();
     scopes_to_cleanup_.push_back(scope->scope_id_);
     central_cache_entries_to_cleanup_.push_back(scope->centralCacheLockHeld());
-    lock.release();
+    lock.Release();
 
     if (need_post) {
       main_thread_dispatcher_->post([this]() {
@@ -354,7 +354,7 @@ void ThreadLocalStoreImpl::clearScopesFromCaches() {
     // all threads have completed.
     auto central_caches = std::make_shared<std::vector<CentralCacheEntrySharedPtr>>();
     {
-      Thread::LockGuard lock(lock_);
+      absl::MutexLock lock(&lock_);
       *scope_ids = std::move(scopes_to_cleanup_);
       scopes_to_cleanup_.clear();
       *central_caches = std::move(central_cache_entries_to_cleanup_);
@@ -529,9 +529,25 @@ StatType& ThreadLocalStoreImpl::ScopeImpl::safeMakeStat(
     }
   }
 
+  // Most TLS misses are for stats that another worker has already created, e.g. when a
+  // dynamically named stat is first hit on each of the workers. Those only need to read the
+  // central store, so try that under a shared lock before serializing on the exclusive one.
+  {
+    absl::ReaderMutexLock lock(&parent_.lock_);
+    auto iter = central_cache_map.find(full_stat_name);
+    if (iter != central_cache_map.end()) {
+      StatType& ret = *iter->second;
+      if (tls_cache) {
+        tls_cache->insert(std::make_pair(ret.statName(), std::reference_wrapper<StatType>(ret)));
+      }
+      return ret;
+    }
+  }
+
   // We must now look in the central store so we must be locked. We grab a reference to the
-  // central store location. It might contain nothing. In this case, we allocate a new stat.
-  Thread::LockGuard lock(parent_.lock_);
+  // central store location. It might contain nothing, or another thread may have added the stat
+  // since we dropped the shared lock above. In the former case, we allocate a new stat.
+  absl::MutexLock lock(&parent_.lock_);
   auto iter = central_cache_map.find(full_stat_name);
   RefcountPtr<StatType>* central_ref = nullptr;
   if (iter != central_cache_map.end()) {
@@ -682,8 +698,21 @@ Histogram& ThreadLocalStoreImpl::ScopeImpl::histogramFromStatNameWithTags(
     }
   }
 
-  Thread::LockGuard lock(parent_.lock_);
   const CentralCacheEntrySharedPtr& central_cache = centralCacheNoThreadAnalysis();
+
+  // See the comment in safeMakeStat about looking up the central store under a shared lock first.
+  {
+    absl::ReaderMutexLock lock(&parent_.lock_);
+    auto iter = central_cache->histograms_.find(final_stat_name);
+    if (iter != central_cache->histograms_.end()) {
+      if (tls_cache != nullptr) {
+        tls_cache->insert(std::make_pair(iter->second->statName(), iter->second));
+      }
+      return *iter->second;
+    }
+  }
+
+  absl::MutexLock lock(&parent_.lock_);
   auto iter = central_cache->histograms_.find(final_stat_name);
   ParentHistogramImplSharedPtr* central_ref = nullptr;
   if (iter != central_cache->histograms_.end()) {
@@ -761,17 +790,17 @@ TextReadout& ThreadLocalStoreImpl::ScopeImpl::textReadoutFromStatNameWithTags(
 }
 
 CounterOptConstRef ThreadLocalStoreImpl::ScopeImpl::findCounter(StatName name) const {
-  Thread::LockGuard lock(parent_.lock_);
+  absl::MutexLock lock(&parent_.lock_);
   return findStatLockHeld<Counter>(name, central_cache_->counters_);
 }
 
 GaugeOptConstRef ThreadLocalStoreImpl::ScopeImpl::findGauge(StatName name) const {
-  Thread::LockGuard lock(parent_.lock_);
+  absl::MutexLock lock(&parent_.lock_);
   return findStatLockHeld<Gauge>(name, central_cache_->gauges_);
 }
 
 HistogramOptConstRef ThreadLocalStoreImpl::ScopeImpl::findHistogram(StatName name) const {
-  Thread::LockGuard lock(parent_.lock_);
+  absl::MutexLock lock(&parent_.lock_);
   return findHistogramLockHeld(name);
 }
 
@@ -787,7 +816,7 @@ HistogramOptConstRef ThreadLocalStoreImpl::ScopeImpl::findHistogramLockHeld(Stat
 }
 
 TextReadoutOptConstRef ThreadLocalStoreImpl::ScopeImpl::findTextReadout(StatName name) const {
-  Thread::LockGuard lock(parent_.lock_);
+  absl::MutexLock lock(&parent_.lock_);
   return findStatLockHeld<TextReadout>(name, central_cache_->text_readouts_);
 }
 
@@ -844,10 +873,14 @@ void ThreadLocalHistogramImpl::recordValue(uint64_t value) {
   used_ = true;
 }
 
-void ThreadLocalHistogramImpl::merge(histogram_t* target) {
+bool ThreadLocalHistogramImpl::merge(histogram_t* target) {
   histogram_t** other_histogram = &histograms_[otherHistogramIndex()];
+  if (hist_sample_count(*other_histogram) == 0) {
+    return false;
+  }
   hist_accumulate(target, other_histogram, 1);
   hist_clear(*other_histogram);
+  return true;
 }
 
 ParentHistogramImpl::ParentHistogramImpl(StatName name, Histogram::Unit unit,
@@ -938,14 +971,23 @@ void ParentHistogramImpl::merge() {
     // then release the lock before we do the actual merge. However it is not a big deal
     // because the tls_histogram merge is not that expensive as it is a single histogram
     // merge and adding TLS histograms is rare.
+    bool recorded = false;
     for (const TlsHistogramSharedPtr& tls_histogram : tls_histograms_) {
-      tls_histogram->merge(interval_histogram_);
+      recorded |= tls_histogram->merge(interval_histogram_);
     }
     // Since TLS merge is done, we can release the lock here.
     lock.release();
-    hist_accumulate(cumulative_histogram_, &interval_histogram_, 1);
-    cumulative_statistics_.refresh(cumulative_histogram_);
-    interval_statistics_.refresh(interval_histogram_);
+    // Computing quantiles and buckets dominates the cost of a merge. When nothing was recorded
+    // during the interval the cumulative statistics are unchanged, and the interval statistics
+    // only need to be recomputed if the previous interval was not already empty. This keeps
+    // idle histograms cheap to flush.
+    if (recorded) {
+      hist_accumulate(cumulative_histogram_, &interval_histogram_, 1);
+      cumulative_statistics_.refresh(cumulative_histogram_);
+      interval_statistics_.refresh(interval_histogram_);
+    } else if (interval_statistics_.sampleCount() != 0) {
+      interval_statistics_.refresh(interval_histogram_);
+    }
     merged_ = true;
   }
 }
@@ -21,6 +21,7 @@
 #include "source/common/stats/utility.h"
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "circllhist.h"
 
 namespace Envoy {
@@ -37,7 +38,12 @@ public:
                            const StatNameTagVector& stat_name_tags, SymbolTable& symbol_table);
   ~ThreadLocalHistogramImpl() override;
 
-  void merge(histogram_t* target);
+  /**
+   * Accumulates the values recorded into the inactive histogram since the previous merge into
+   * target, and clears them.
+   * @return bool true if any values were recorded during the interval.
+   */
+  bool merge(histogram_t* target);
 
   /**
    * Called in the beginning of merge process. Swaps the histogram used for collection so that we do
@@ -348,19 +354,19 @@ private:
     }
 
     bool iterate(const IterateFn<Counter>& fn) const override {
-      Thread::LockGuard lock(parent_.lock_);
+      absl::MutexLock lock(&parent_.lock_);
       return iterateLockHeld(fn);
     }
     bool iterate(const IterateFn<Gauge>& fn) const override {
-      Thread::LockGuard lock(parent_.lock_);
+      absl::MutexLock lock(&parent_.lock_);
       return iterateLockHeld(fn);
     }
     bool iterate(const IterateFn<Histogram>& fn) const override {
-      Thread::LockGuard lock(parent_.lock_);
+      absl::MutexLock lock(&parent_.lock_);
       return iterateLockHeld(fn);
     }
     bool iterate(const IterateFn<TextReadout>& fn) const override {
-      Thread::LockGuard lock(parent_.lock_);
+      absl::MutexLock lock(&parent_.lock_);
       return iterateLockHeld(fn);
     }
 
@@ -495,7 +501,7 @@ private:
    * @return true if the iteration completed with fn_lock_held never returning false.
    */
   bool iterateScopes(const std::function<bool(const ScopeImplSharedPtr&)> fn_lock_held) const {
-    Thread::LockGuard lock(lock_);
+    absl::MutexLock lock(&lock_);
     return iterateScopesLockHeld(fn_lock_held);
   }
 
@@ -534,7 +540,7 @@ private:
   Event::Dispatcher* main_thread_dispatcher_{};
   using TlsCacheSlot = ThreadLocal::TypedSlotPtr<TlsCache>;
   ThreadLocal::TypedSlotPtr<TlsCache> tls_cache_;
-  mutable Thread::MutexBasicLockable lock_;
+  mutable absl::Mutex lock_;
   absl::flat_hash_map<ScopeImpl*, std::weak_ptr<ScopeImpl>> scopes_ ABSL_GUARDED_BY(lock_);
   ScopeSharedPtr default_scope_;
   std::list<std::reference_wrapper<Sink>> timer_sinks_;
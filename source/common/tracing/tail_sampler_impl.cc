@@ -0,0 +1,186 @@
+#include "source/common/tracing/tail_sampler_impl.h"
+
+#include "source/common/common/assert.h"
+#include "source/common/common/fmt.h"
+#include "source/common/tracing/common_values.h"
+
+namespace Envoy {
+namespace Tracing {
+
+bool TailSamplingRing::push(TailSamplingRecord&& record) {
+  ASSERT(!record.trace_id_.empty());
+  // The records are kept contiguous, so the slot at next_ is either free or the oldest record.
+  const bool overwritten = size_ == records_.size();
+  if (!overwritten) {
+    ++size_;
+  }
+  records_[next_] = std::move(record);
+  next_ = (next_ + 1) % records_.size();
+  return overwritten;
+}
+
+std::vector<TailSamplingRecord> TailSamplingRing::take(absl::string_view trace_id) {
+  std::vector<TailSamplingRecord> taken;
+  const uint32_t capacity = records_.size();
+  const uint32_t oldest = (next_ + capacity - size_) % capacity;
+  // Move the records that are kept over the taken ones, so that the free slots follow the newest
+  // record and are reused by the next pushes.
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < size_; ++i) {
+    TailSamplingRecord& record = records_[(oldest + i) % capacity];
+    if (record.trace_id_ == trace_id) {
+      taken.push_back(std::move(record));
+    } else {
+      if (kept != i) {
+        records_[(oldest + kept) % capacity] = std::move(record);
+      }
+      ++kept;
+    }
+  }
+  size_ = kept;
+  next_ = (oldest + kept) % capacity;
+  return taken;
+}
+
+void TailSamplingExportedTraces::insert(absl::string_view trace_id) {
+  ASSERT(!trace_id.empty());
+  if (set_.contains(trace_id)) {
+    return;
+  }
+  std::string& slot = ids_[next_];
+  if (!slot.empty()) {
+    set_.erase(slot);
+  }
+  slot = std::string(trace_id);
+  set_.insert(slot);
+  next_ = (next_ + 1) % ids_.size();
+}
+
+/**
+ * Span of a request that was not sampled up front, exported when it finishes if it turns out slow
+ * or failing.
+ */
+class TailSampler::SampledSpan : public Span {
+public:
+  SampledSpan(TailSampler& sampler, SpanPtr&& span, absl::string_view operation,
+              SystemTime start_time, MonotonicTime monotonic_start_time, TraceStateSharedPtr trace)
+      : sampler_(sampler), span_(std::move(span)), operation_(operation), start_time_(start_time),
+        monotonic_start_time_(monotonic_start_time), trace_(std::move(trace)) {}
+
+  // Tracing::Span
+  void setOperation(absl::string_view operation) override {
+    operation_ = std::string(operation);
+    span_->setOperation(operation);
+  }
+  void setTag(absl::string_view name, absl::string_view value) override {
+    if (name == Tags::get().Error && value == Tags::get().True) {
+      error_ = true;
+    }
+    span_->setTag(name, value);
+  }
+  void log(SystemTime timestamp, const std::string& event) override {
+    span_->log(timestamp, event);
+  }
+  void finishSpan() override { sampler_.finishSpan(*this); }
+  void injectContext(TraceContext& trace_context,
+                     const Upstream::HostDescriptionConstSharedPtr& upstream) override {
+    span_->injectContext(trace_context, upstream);
+  }
+  SpanPtr spawnChild(const Config& config, const std::string& name,
+                     SystemTime start_time) override {
+    return std::make_unique<SampledSpan>(sampler_, span_->spawnChild(config, name, start_time),
+                                         name, start_time, sampler_.time_source_.monotonicTime(),
+                                         trace_);
+  }
+  void setSampled(bool sampled) override {
+    sampled_ = sampled;
+    span_->setSampled(sampled);
+  }
+  std::string getBaggage(absl::string_view key) override { return span_->getBaggage(key); }
+  void setBaggage(absl::string_view key, absl::string_view value) override {
+    span_->setBaggage(key, value);
+  }
+  std::string getTraceIdAsHex() const override { return span_->getTraceIdAsHex(); }
+
+private:
+  friend class TailSampler;
+
+  TailSampler& sampler_;
+  const SpanPtr span_;
+  std::string operation_;
+  const SystemTime start_time_;
+  const MonotonicTime monotonic_start_time_;
+  const TraceStateSharedPtr trace_;
+  bool error_{false};
+  // The sampling decision made explicitly for the span, if any.
+  absl::optional<bool> sampled_;
+};
+
+TailSampler::TailSampler(absl::optional<std::chrono::milliseconds> latency_threshold,
+                         bool export_errors, uint32_t max_records_per_worker,
+                         ThreadLocal::SlotAllocator& tls, TimeSource& time_source,
+                         const std::string& stats_prefix, Stats::Scope& scope)
+    : latency_threshold_(latency_threshold), export_errors_(export_errors),
+      time_source_(time_source),
+      stats_{ALL_TAIL_SAMPLING_STATS(POOL_COUNTER_PREFIX(scope, stats_prefix))},
+      worker_(ThreadLocal::TypedSlot<WorkerState>::makeUnique(tls)) {
+  worker_->set([max_records_per_worker](Event::Dispatcher&) {
+    return std::make_shared<WorkerState>(max_records_per_worker);
+  });
+}
+
+SpanPtr TailSampler::wrap(SpanPtr&& span, absl::string_view operation, SystemTime start_time,
+                          MonotonicTime monotonic_start_time) {
+  return std::make_unique<SampledSpan>(*this, std::move(span), operation, start_time,
+                                       monotonic_start_time, std::make_shared<TraceState>());
+}
+
+void TailSampler::finishSpan(SampledSpan& span) {
+  if (span.sampled_.has_value() && !span.sampled_.value()) {
+    // The span was explicitly left out of tracing, e.g. by the health check filter.
+    span.span_->finishSpan();
+    return;
+  }
+
+  WorkerState& worker = **worker_;
+  const std::string trace_id = span.span_->getTraceIdAsHex();
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_source_.monotonicTime() - span.monotonic_start_time_);
+  const bool exported =
+      span.sampled_.has_value() || span.trace_->exported_ ||
+      (!trace_id.empty() && worker.exported_traces_.contains(trace_id)) ||
+      (export_errors_ && span.error_) ||
+      (latency_threshold_.has_value() && duration >= latency_threshold_.value());
+
+  if (!exported) {
+    span.span_->finishSpan();
+    if (!trace_id.empty()) {
+      stats_.recorded_.inc();
+      if (worker.records_.push({trace_id, std::move(span.operation_), span.start_time_, duration,
+                                span.error_})) {
+        stats_.records_overwritten_.inc();
+      }
+    }
+    return;
+  }
+
+  // The spans of the trace finishing later on this worker, whether of this request or of later
+  // ones, are exported too, and the ones that finished earlier are attached as log events.
+  span.trace_->exported_ = true;
+  stats_.exported_.inc();
+  if (!trace_id.empty()) {
+    worker.exported_traces_.insert(trace_id);
+    for (const TailSamplingRecord& record : worker.records_.take(trace_id)) {
+      span.span_->log(record.start_time_ + record.duration_,
+                      fmt::format("tail_sampling.unexported_span operation={} duration_us={}{}",
+                                  record.operation_, record.duration_.count(),
+                                  record.error_ ? " error=true" : ""));
+      stats_.records_attached_.inc();
+    }
+  }
+  span.span_->setSampled(true);
+  span.span_->finishSpan();
+}
+
+} // namespace Tracing
+} // namespace Envoy
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+#include "envoy/thread_local/thread_local_object.h"
+#include "envoy/tracing/trace_driver.h"
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace Envoy {
+namespace Tracing {
+
+/**
+ * All tail sampling stats. @see stats_macros.h
+ */
+#define ALL_TAIL_SAMPLING_STATS(COUNTER)                                                           \
+  COUNTER(exported)                                                                                \
+  COUNTER(recorded)                                                                                \
+  COUNTER(records_attached)                                                                        \
+  COUNTER(records_overwritten)
+
+/**
+ * Struct definition for all tail sampling stats. @see stats_macros.h
+ */
+struct TailSamplingStats {
+  ALL_TAIL_SAMPLING_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Compact record of a span that was not exported, kept in case another span of the same trace is.
+ */
+struct TailSamplingRecord {
+  std::string trace_id_;
+  std::string operation_;
+  SystemTime start_time_;
+  std::chrono::microseconds duration_;
+  bool error_;
+};
+
+/**
+ * Fixed capacity ring of the records of the spans finished on a worker that were not exported.
+ * The oldest records are overwritten first, once the ring is full.
+ */
+class TailSamplingRing {
+public:
+  explicit TailSamplingRing(uint32_t capacity) : records_(capacity) {}
+
+  /**
+   * Adds a record.
+   * @return whether an older record was overwritten to make room for it.
+   */
+  bool push(TailSamplingRecord&& record);
+
+  /**
+   * Removes the records of a trace.
+   * @param trace_id the id of the trace.
+   * @return the records of the trace, oldest first.
+   */
+  std::vector<TailSamplingRecord> take(absl::string_view trace_id);
+
+  // Number of records in the ring.
+  uint32_t size() const { return size_; }
+
+private:
+  // The records are the size_ slots preceding next_, oldest first.
+  std::vector<TailSamplingRecord> records_;
+  uint32_t next_{0};
+  uint32_t size_{0};
+};
+
+/**
+ * Fixed capacity set of the ids of the traces of which a span was exported on a worker. The ids
+ * inserted first are forgotten first.
+ */
+class TailSamplingExportedTraces {
+public:
+  explicit TailSamplingExportedTraces(uint32_t capacity) : ids_(capacity) {}
+
+  /**
+   * Adds the id of a trace, if it isn't in the set already.
+   * @param trace_id the id of the trace.
+   */
+  void insert(absl::string_view trace_id);
+
+  /**
+   * @param trace_id the id of a trace.
+   * @return whether the set holds the id of the trace.
+   */
+  bool contains(absl::string_view trace_id) const { return set_.contains(trace_id); }
+
+private:
+  // The ids in the order they were inserted, overwritten from the oldest one.
+  std::vector<std::string> ids_;
+  absl::flat_hash_set<std::string> set_;
+  uint32_t next_{0};
+};
+
+/**
+ * Exports the spans of requests that were not sampled up front when they turn out slow or failing.
+ *
+ * The spans of such requests are started as not sampled by the tracing driver, which leaves them
+ * out of export, and are wrapped to be timed and to see their error tag. When a span finishes, it
+ * is marked as sampled, and thus exported by the driver, if it lasted at least the latency
+ * threshold, was tagged with an error or belongs to a trace of which another span was exported,
+ * either by the same request or earlier on the same worker. Otherwise a compact record of it is
+ * kept in a bounded ring of the worker, and attached to the span of the same trace exported later,
+ * if any, as a log event.
+ *
+ * This works with any tracing driver that honors Span::setSampled() up to finishing the span.
+ */
+class TailSampler {
+public:
+  /**
+   * @param latency_threshold the duration from which spans are exported, if any.
+   * @param export_errors whether spans tagged with an error are exported.
+   * @param max_records_per_worker the capacity of the ring of each worker, which also bounds the
+   *        number of exported trace ids each worker remembers.
+   */
+  TailSampler(absl::optional<std::chrono::milliseconds> latency_threshold, bool export_errors,
+              uint32_t max_records_per_worker, ThreadLocal::SlotAllocator& tls,
+              TimeSource& time_source, const std::string& stats_prefix, Stats::Scope& scope);
+
+  /**
+   * Wraps the span of a request that was not sampled up front.
+   * @param span the span started by the tracing driver.
+   * @param operation the operation name of the span.
+   * @param start_time the start time of the request.
+   * @param monotonic_start_time the monotonic start time of the request.
+   * @return the span to use in place of the one started by the driver.
+   */
+  SpanPtr wrap(SpanPtr&& span, absl::string_view operation, SystemTime start_time,
+               MonotonicTime monotonic_start_time);
+
+  const TailSamplingStats& stats() const { return stats_; }
+
+private:
+  class SampledSpan;
+  // Whether the spans of a request are exported. It is shared by the spans of the request as
+  // drivers may not give them a trace id.
+  struct TraceState {
+    bool exported_{false};
+  };
+  using TraceStateSharedPtr = std::shared_ptr<TraceState>;
+  // The records and the exported traces of a worker.
+  struct WorkerState : public ThreadLocal::ThreadLocalObject {
+    explicit WorkerState(uint32_t capacity) : records_(capacity), exported_traces_(capacity) {}
+
+    TailSamplingRing records_;
+    TailSamplingExportedTraces exported_traces_;
+  };
+
+  void finishSpan(SampledSpan& span);
+
+  const absl::optional<std::chrono::milliseconds> latency_threshold_;
+  const bool export_errors_;
+  TimeSource& time_source_;
+  const TailSamplingStats stats_;
+  ThreadLocal::TypedSlotPtr<WorkerState> worker_;
+};
+
+using TailSamplerSharedPtr = std::shared_ptr<TailSampler>;
+
+} // namespace Tracing
+} // namespace Envoy
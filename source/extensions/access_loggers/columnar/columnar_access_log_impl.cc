@@ -0,0 +1,182 @@
+#include "source/extensions/access_loggers/columnar/columnar_access_log_impl.h"
+
+#include <cmath>
+
+#include "envoy/common/exception.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/common/fmt.h"
+#include "source/common/formatter/substitution_formatter.h"
+#include "source/common/protobuf/utility.h"
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+
+namespace {
+
+constexpr uint32_t DefaultBlockRows = 4096;
+constexpr uint64_t DefaultBlockFlushIntervalMs = 1000;
+constexpr uint32_t DefaultCompressionLevel = 3;
+constexpr uint32_t CompressorChunkSize = 4096;
+
+using ColumnConfig = envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog::Column;
+
+ColumnEncoding toColumnEncoding(ColumnConfig::Encoding encoding) {
+  switch (encoding) {
+  case ColumnConfig::DICTIONARY:
+    return ColumnEncoding::Dictionary;
+  case ColumnConfig::INTEGER:
+    return ColumnEncoding::Integer;
+  default:
+    return ColumnEncoding::Plain;
+  }
+}
+
+std::vector<std::pair<std::string, ColumnEncoding>>
+blockColumns(const std::vector<Column>& columns) {
+  std::vector<std::pair<std::string, ColumnEncoding>> result;
+  result.reserve(columns.size());
+  for (const Column& column : columns) {
+    result.emplace_back(column.name_, column.encoding_);
+  }
+  return result;
+}
+
+absl::optional<int64_t> integerValue(const ProtobufWkt::Value& value) {
+  switch (value.kind_case()) {
+  case ProtobufWkt::Value::kNumberValue: {
+    const double number = value.number_value();
+    // Outside of this range the conversion is undefined.
+    if (!std::isfinite(number) || std::abs(number) >= 9.2e18) {
+      return absl::nullopt;
+    }
+    return static_cast<int64_t>(number);
+  }
+  case ProtobufWkt::Value::kStringValue: {
+    int64_t result;
+    if (absl::SimpleAtoi(value.string_value(), &result)) {
+      return result;
+    }
+    return absl::nullopt;
+  }
+  default:
+    return absl::nullopt;
+  }
+}
+
+} // namespace
+
+ColumnarAccessLogConfigConstSharedPtr createColumnarAccessLogConfig(
+    const envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog& config,
+    ColumnarFileWriterSharedPtr writer) {
+  auto result = std::make_shared<ColumnarAccessLogConfig>();
+  result->columns_.reserve(config.columns_size());
+  for (const auto& column_config : config.columns()) {
+    Column column{column_config.name(), toColumnEncoding(column_config.encoding()),
+                  Formatter::SubstitutionFormatParser::parse(column_config.format())};
+    if (column.encoding_ == ColumnEncoding::Integer && column.providers_.size() != 1) {
+      throw EnvoyException(fmt::format(
+          "columnar access log: integer column '{}' must have a format of a single command",
+          column.name_));
+    }
+    result->columns_.push_back(std::move(column));
+  }
+  result->block_rows_ = PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, block_rows, DefaultBlockRows);
+  result->block_flush_interval_ = std::chrono::milliseconds(
+      PROTOBUF_GET_MS_OR_DEFAULT(config, block_flush_interval, DefaultBlockFlushIntervalMs));
+  result->compression_level_ =
+      PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, compression_level, DefaultCompressionLevel);
+  result->writer_ = std::move(writer);
+  return result;
+}
+
+ColumnarAccessLog::ThreadLocalBlock::ThreadLocalBlock(ColumnarAccessLogConfigConstSharedPtr config,
+                                                      Event::Dispatcher& dispatcher)
+    : config_(std::move(config)), builder_(blockColumns(config_->columns_)),
+      compressor_(config_->compression_level_, false, 0, cdict_manager_, CompressorChunkSize),
+      flush_timer_(dispatcher.createTimer([this]() -> void { flush(); })) {}
+
+ColumnarAccessLog::ThreadLocalBlock::~ThreadLocalBlock() { flush(); }
+
+void ColumnarAccessLog::ThreadLocalBlock::addRow(const Http::RequestHeaderMap& request_headers,
+                                                 const Http::ResponseHeaderMap& response_headers,
+                                                 const Http::ResponseTrailerMap& response_trailers,
+                                                 const StreamInfo::StreamInfo& stream_info) {
+  for (size_t i = 0; i < config_->columns_.size(); i++) {
+    const Column& column = config_->columns_[i];
+    ColumnBuilder& builder = builder_.column(i);
+
+    if (column.encoding_ == ColumnEncoding::Integer) {
+      builder.addInteger(integerValue(column.providers_[0]->formatValue(
+          request_headers, response_headers, response_trailers, stream_info, absl::string_view())));
+      continue;
+    }
+
+    if (column.providers_.size() == 1) {
+      const absl::optional<std::string> value = column.providers_[0]->format(
+          request_headers, response_headers, response_trailers, stream_info, absl::string_view());
+      builder.addString(value);
+      continue;
+    }
+
+    // Same as the text formatter, missing parts of a composite value are replaced with "-".
+    std::string value;
+    for (const Formatter::FormatterProviderPtr& provider : column.providers_) {
+      const absl::optional<std::string> part = provider->format(
+          request_headers, response_headers, response_trailers, stream_info, absl::string_view());
+      absl::StrAppend(&value, part.has_value() ? part.value() : "-");
+    }
+    builder.addString(value);
+  }
+  builder_.finishRow();
+
+  if (builder_.rows() >= config_->block_rows_) {
+    flush();
+  } else if (builder_.rows() == 1) {
+    flush_timer_->enableTimer(config_->block_flush_interval_);
+  }
+}
+
+void ColumnarAccessLog::ThreadLocalBlock::flush() {
+  flush_timer_->disableTimer();
+  if (builder_.rows() == 0) {
+    return;
+  }
+
+  payload_.clear();
+  builder_.encodePayload(payload_);
+  Buffer::OwnedImpl compressed(payload_);
+  compressor_.compress(compressed, Envoy::Compression::Compressor::State::Finish);
+
+  auto block = std::make_unique<Buffer::OwnedImpl>();
+  block->add(BlockMagic);
+  block->writeLEInt<uint32_t>(compressed.length());
+  block->move(compressed);
+  config_->writer_->write(std::move(block));
+}
+
+ColumnarAccessLog::ColumnarAccessLog(AccessLog::FilterPtr&& filter,
+                                     ColumnarAccessLogConfigConstSharedPtr config,
+                                     ThreadLocal::SlotAllocator& tls)
+    : ImplBase(std::move(filter)), tls_slot_(tls) {
+  tls_slot_.set([config](Event::Dispatcher& dispatcher) {
+    return std::make_shared<ThreadLocalBlock>(config, dispatcher);
+  });
+}
+
+void ColumnarAccessLog::emitLog(const Http::RequestHeaderMap& request_headers,
+                                const Http::ResponseHeaderMap& response_headers,
+                                const Http::ResponseTrailerMap& response_trailers,
+                                const StreamInfo::StreamInfo& stream_info) {
+  tls_slot_->addRow(request_headers, response_headers, response_trailers, stream_info);
+}
+
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
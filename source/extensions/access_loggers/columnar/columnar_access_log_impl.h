@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/extensions/access_loggers/columnar/v3/columnar.pb.h"
+#include "envoy/formatter/substitution_formatter.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "source/extensions/access_loggers/columnar/columnar_format.h"
+#include "source/extensions/access_loggers/columnar/file_writer.h"
+#include "source/extensions/access_loggers/common/access_log_base.h"
+#include "source/extensions/compression/zstd/compressor/zstd_compressor_impl.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+
+/**
+ * A column of the log, and the providers producing its value.
+ */
+struct Column {
+  std::string name_;
+  ColumnEncoding encoding_;
+  std::vector<Formatter::FormatterProviderPtr> providers_;
+};
+
+/**
+ * Configuration shared by the thread local state of a columnar access log.
+ */
+struct ColumnarAccessLogConfig {
+  std::vector<Column> columns_;
+  uint32_t block_rows_;
+  std::chrono::milliseconds block_flush_interval_;
+  uint32_t compression_level_;
+  ColumnarFileWriterSharedPtr writer_;
+};
+
+using ColumnarAccessLogConfigConstSharedPtr = std::shared_ptr<const ColumnarAccessLogConfig>;
+
+/**
+ * Access log Instance that writes logs in the columnar format. Each worker collects rows into its
+ * own block, and compresses and hands off the block to the file writer once it is full or the
+ * flush interval has elapsed.
+ */
+class ColumnarAccessLog : public Common::ImplBase {
+public:
+  ColumnarAccessLog(AccessLog::FilterPtr&& filter, ColumnarAccessLogConfigConstSharedPtr config,
+                    ThreadLocal::SlotAllocator& tls);
+
+private:
+  /**
+   * Per worker block under construction.
+   */
+  class ThreadLocalBlock : public ThreadLocal::ThreadLocalObject {
+  public:
+    ThreadLocalBlock(ColumnarAccessLogConfigConstSharedPtr config, Event::Dispatcher& dispatcher);
+    ~ThreadLocalBlock() override;
+
+    void addRow(const Http::RequestHeaderMap& request_headers,
+                const Http::ResponseHeaderMap& response_headers,
+                const Http::ResponseTrailerMap& response_trailers,
+                const StreamInfo::StreamInfo& stream_info);
+
+  private:
+    void flush();
+
+    const ColumnarAccessLogConfigConstSharedPtr config_;
+    BlockBuilder builder_;
+    // Always null, the compressor keeps a reference to it.
+    const Compression::Zstd::Compressor::ZstdCDictManagerPtr cdict_manager_;
+    Compression::Zstd::Compressor::ZstdCompressorImpl compressor_;
+    // Reused for the uncompressed payload of every block.
+    std::string payload_;
+    Event::TimerPtr flush_timer_;
+  };
+
+  // Common::ImplBase
+  void emitLog(const Http::RequestHeaderMap& request_headers,
+               const Http::ResponseHeaderMap& response_headers,
+               const Http::ResponseTrailerMap& response_trailers,
+               const StreamInfo::StreamInfo& stream_info) override;
+
+  ThreadLocal::TypedSlot<ThreadLocalBlock> tls_slot_;
+};
+
+/**
+ * Builds the configuration of a columnar access log from its proto. Throws EnvoyException if the
+ * configuration is invalid.
+ */
+ColumnarAccessLogConfigConstSharedPtr createColumnarAccessLogConfig(
+    const envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog& config,
+    ColumnarFileWriterSharedPtr writer);
+
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
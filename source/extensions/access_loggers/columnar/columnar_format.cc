@@ -0,0 +1,101 @@
+#include "source/extensions/access_loggers/columnar/columnar_format.h"
+
+#include "source/common/common/assert.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+
+void appendVarint(uint64_t value, std::string& output) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+ColumnBuilder::ColumnBuilder(absl::string_view name, ColumnEncoding encoding)
+    : name_(name), encoding_(encoding) {}
+
+void ColumnBuilder::addPresence(bool present) {
+  if (rows_ % 8 == 0) {
+    presence_.push_back(0);
+  }
+  if (present) {
+    presence_.back() = static_cast<char>(presence_.back() | (1 << (rows_ % 8)));
+  }
+  rows_++;
+}
+
+void ColumnBuilder::addString(absl::optional<absl::string_view> value) {
+  ASSERT(encoding_ != ColumnEncoding::Integer);
+  addPresence(value.has_value());
+  if (!value.has_value()) {
+    return;
+  }
+
+  if (encoding_ == ColumnEncoding::Plain) {
+    appendVarint(value->size(), values_);
+    values_.append(value->data(), value->size());
+    return;
+  }
+
+  auto it = dictionary_.find(*value);
+  if (it == dictionary_.end()) {
+    it = dictionary_.emplace(std::string(*value), dictionary_.size()).first;
+    appendVarint(value->size(), dictionary_entries_);
+    dictionary_entries_.append(value->data(), value->size());
+  }
+  appendVarint(it->second, values_);
+}
+
+void ColumnBuilder::addInteger(absl::optional<int64_t> value) {
+  ASSERT(encoding_ == ColumnEncoding::Integer);
+  addPresence(value.has_value());
+  if (value.has_value()) {
+    // Zigzag encoding keeps small negative values small.
+    const uint64_t zigzag =
+        (static_cast<uint64_t>(*value) << 1) ^ static_cast<uint64_t>(*value >> 63);
+    appendVarint(zigzag, values_);
+  }
+}
+
+void ColumnBuilder::encode(std::string& output) {
+  appendVarint(name_.size(), output);
+  output.append(name_);
+  output.push_back(static_cast<char>(encoding_));
+  output.append(presence_);
+  if (encoding_ == ColumnEncoding::Dictionary) {
+    appendVarint(dictionary_.size(), output);
+    output.append(dictionary_entries_);
+  }
+  output.append(values_);
+
+  rows_ = 0;
+  presence_.clear();
+  values_.clear();
+  dictionary_.clear();
+  dictionary_entries_.clear();
+}
+
+BlockBuilder::BlockBuilder(const std::vector<std::pair<std::string, ColumnEncoding>>& columns) {
+  columns_.reserve(columns.size());
+  for (const auto& [name, encoding] : columns) {
+    columns_.emplace_back(name, encoding);
+  }
+}
+
+void BlockBuilder::encodePayload(std::string& output) {
+  appendVarint(rows_, output);
+  appendVarint(columns_.size(), output);
+  for (ColumnBuilder& column : columns_) {
+    column.encode(output);
+  }
+  rows_ = 0;
+}
+
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
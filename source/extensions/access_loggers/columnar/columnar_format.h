@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+
+// Magic at the start of every block. See columnar.proto for the layout of a block.
+constexpr absl::string_view BlockMagic = "ECL1";
+
+/**
+ * How the values of a column are stored. Matches ColumnarAccessLog.Column.Encoding.
+ */
+enum class ColumnEncoding : uint8_t {
+  Plain = 0,
+  Dictionary = 1,
+  Integer = 2,
+};
+
+/**
+ * Accumulates the values of one column of a block.
+ */
+class ColumnBuilder {
+public:
+  ColumnBuilder(absl::string_view name, ColumnEncoding encoding);
+
+  /**
+   * Adds the value of the next row to a Plain or Dictionary column.
+   */
+  void addString(absl::optional<absl::string_view> value);
+
+  /**
+   * Adds the value of the next row to an Integer column.
+   */
+  void addInteger(absl::optional<int64_t> value);
+
+  /**
+   * Appends the encoding of the column to output and clears the column for the next block.
+   */
+  void encode(std::string& output);
+
+  ColumnEncoding encoding() const { return encoding_; }
+
+private:
+  void addPresence(bool present);
+
+  const std::string name_;
+  const ColumnEncoding encoding_;
+  uint64_t rows_{};
+  // Bitmap with a bit per row, set if the row has a value.
+  std::string presence_;
+  // The encoded values of the rows which have one: the values themselves for Plain columns, the
+  // dictionary indices for Dictionary columns and zigzag encoded integers for Integer columns.
+  std::string values_;
+  // Index of each distinct value of a Dictionary column, and the encoded entries in index order.
+  absl::flat_hash_map<std::string, uint64_t> dictionary_;
+  std::string dictionary_entries_;
+};
+
+/**
+ * Accumulates the rows of a block and produces its uncompressed payload.
+ */
+class BlockBuilder {
+public:
+  explicit BlockBuilder(const std::vector<std::pair<std::string, ColumnEncoding>>& columns);
+
+  ColumnBuilder& column(size_t index) { return columns_[index]; }
+  size_t columnCount() const { return columns_.size(); }
+
+  /**
+   * Must be called after adding a value to each column.
+   */
+  void finishRow() { rows_++; }
+  uint64_t rows() const { return rows_; }
+
+  /**
+   * Appends the uncompressed payload of the block to output and starts a new block.
+   */
+  void encodePayload(std::string& output);
+
+private:
+  std::vector<ColumnBuilder> columns_;
+  uint64_t rows_{};
+};
+
+/**
+ * Appends value to output as an unsigned LEB128 varint.
+ */
+void appendVarint(uint64_t value, std::string& output);
+
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,55 @@
+#include "source/extensions/access_loggers/columnar/config.h"
+
+#include <memory>
+
+#include "envoy/extensions/access_loggers/columnar/v3/columnar.pb.h"
+#include "envoy/extensions/access_loggers/columnar/v3/columnar.pb.validate.h"
+#include "envoy/registry/registry.h"
+
+#include "source/common/protobuf/utility.h"
+#include "source/extensions/access_loggers/columnar/columnar_access_log_impl.h"
+#include "source/extensions/access_loggers/columnar/file_writer.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+
+SINGLETON_MANAGER_REGISTRATION(columnar_file_writer_registry);
+
+AccessLog::InstanceSharedPtr ColumnarAccessLogFactory::createAccessLogInstance(
+    const Protobuf::Message& config, AccessLog::FilterPtr&& filter,
+    Server::Configuration::CommonFactoryContext& context) {
+  const auto& proto_config = MessageUtil::downcastAndValidate<
+      const envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog&>(
+      config, context.messageValidationVisitor());
+
+  ColumnarFileWriterRegistrySharedPtr registry =
+      context.singletonManager().getTyped<ColumnarFileWriterRegistry>(
+          SINGLETON_MANAGER_REGISTERED_NAME(columnar_file_writer_registry),
+          [] { return std::make_shared<ColumnarFileWriterRegistry>(); });
+  ColumnarFileWriterSharedPtr writer = registry->getOrCreate(
+      proto_config.path(), proto_config.max_file_bytes(),
+      std::chrono::milliseconds(PROTOBUF_GET_MS_OR_DEFAULT(proto_config, max_file_age, 0)),
+      context.api(), context.serverScope());
+
+  return std::make_shared<ColumnarAccessLog>(
+      std::move(filter), createColumnarAccessLogConfig(proto_config, std::move(writer)),
+      context.threadLocal());
+}
+
+ProtobufTypes::MessagePtr ColumnarAccessLogFactory::createEmptyConfigProto() {
+  return std::make_unique<envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog>();
+}
+
+std::string ColumnarAccessLogFactory::name() const { return "envoy.access_loggers.columnar"; }
+
+/**
+ * Static registration for the columnar access log. @see RegisterFactory.
+ */
+REGISTER_FACTORY(ColumnarAccessLogFactory, Server::Configuration::AccessLogInstanceFactory);
+
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,159 @@
+#include "source/extensions/access_loggers/columnar/file_writer.h"
+
+#include "envoy/common/exception.h"
+
+#include "source/common/common/assert.h"
+#include "source/common/common/fmt.h"
+#include "source/common/common/lock_guard.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+
+ColumnarFileWriter::ColumnarFileWriter(const std::string& path, uint64_t max_file_bytes,
+                                       std::chrono::milliseconds max_file_age, Api::Api& api,
+                                       Stats::Scope& scope)
+    : path_(path), max_file_bytes_(max_file_bytes), max_file_age_(max_file_age), api_(api),
+      stats_{ALL_COLUMNAR_FILE_WRITER_STATS(POOL_COUNTER_PREFIX(scope, "access_logs.columnar."))},
+      thread_(api.threadFactory().createThread([this]() -> void { threadRoutine(); },
+                                               Thread::Options{"ColumnarLog"})) {}
+
+ColumnarFileWriter::~ColumnarFileWriter() {
+  {
+    Thread::LockGuard lock(lock_);
+    exit_ = true;
+    queue_event_.notifyOne();
+  }
+  thread_->join();
+  closeFile();
+}
+
+void ColumnarFileWriter::write(Buffer::InstancePtr&& block) {
+  Thread::LockGuard lock(lock_);
+  if (queued_bytes_ + block->length() > MAX_QUEUED_BYTES) {
+    stats_.blocks_dropped_.inc();
+    stats_.bytes_dropped_.add(block->length());
+    ENVOY_LOG_EVERY_POW_2(warn, "columnar access log {}: dropping block, writes are falling behind",
+                          path_);
+    return;
+  }
+  queued_bytes_ += block->length();
+  queue_.push_back(std::move(block));
+  queue_event_.notifyOne();
+}
+
+void ColumnarFileWriter::threadRoutine() {
+  std::vector<Buffer::InstancePtr> blocks;
+  uint64_t written_bytes = 0;
+  while (true) {
+    {
+      Thread::LockGuard lock(lock_);
+      // Blocks count against the limit until they have been written.
+      queued_bytes_ -= written_bytes;
+      while (queue_.empty() && !exit_) {
+        // CondVar::wait() does not throw, so it's safe to pass the mutex rather than the guard.
+        queue_event_.wait(lock_);
+      }
+      if (queue_.empty() && exit_) {
+        return;
+      }
+      blocks.swap(queue_);
+    }
+
+    written_bytes = 0;
+    for (Buffer::InstancePtr& block : blocks) {
+      written_bytes += block->length();
+      writeBlock(*block);
+    }
+    blocks.clear();
+  }
+}
+
+bool ColumnarFileWriter::shouldRotate() const {
+  if (max_file_bytes_ > 0 && file_bytes_ >= max_file_bytes_) {
+    return true;
+  }
+  return max_file_age_.count() > 0 &&
+         api_.timeSource().monotonicTime() - file_opened_ >= max_file_age_;
+}
+
+void ColumnarFileWriter::writeBlock(Buffer::Instance& block) {
+  if (file_ == nullptr || shouldRotate()) {
+    openNextFile();
+  }
+  if (file_ == nullptr) {
+    return;
+  }
+
+  for (const Buffer::RawSlice& slice : block.getRawSlices()) {
+    const Api::IoCallSizeResult result =
+        file_->write(absl::string_view(static_cast<const char*>(slice.mem_), slice.len_));
+    if (!result.ok() || result.return_value_ != static_cast<ssize_t>(slice.len_)) {
+      ENVOY_LOG_EVERY_POW_2(warn, "columnar access log {}: write failed: {}", file_->path(),
+                            result.ok() ? "short write" : result.err_->getErrorDetails());
+      // Start a new file rather than appending the rest of the block to a partial one.
+      closeFile();
+      return;
+    }
+    file_bytes_ += slice.len_;
+  }
+}
+
+void ColumnarFileWriter::openNextFile() {
+  closeFile();
+
+  const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+      api_.timeSource().systemTime().time_since_epoch());
+  Filesystem::FilePtr file = api_.fileSystem().createFile(
+      Filesystem::FilePathAndType{Filesystem::DestinationType::File,
+                                  fmt::format("{}.{}.{}", path_, now.count(), file_sequence_++)});
+  static constexpr Filesystem::FlagSet flags{1 << Filesystem::File::Operation::Write |
+                                             1 << Filesystem::File::Operation::Create |
+                                             1 << Filesystem::File::Operation::Append};
+  const Api::IoCallBoolResult result = file->open(flags);
+  if (!result.return_value_) {
+    ENVOY_LOG_EVERY_POW_2(warn, "columnar access log: unable to open file '{}': {}", file->path(),
+                          result.err_->getErrorDetails());
+    return;
+  }
+  file_ = std::move(file);
+  file_bytes_ = 0;
+  file_opened_ = api_.timeSource().monotonicTime();
+}
+
+void ColumnarFileWriter::closeFile() {
+  if (file_ == nullptr) {
+    return;
+  }
+  const Api::IoCallBoolResult result = file_->close();
+  if (!result.return_value_) {
+    ENVOY_LOG(warn, "columnar access log: unable to close file '{}': {}", file_->path(),
+              result.err_->getErrorDetails());
+  }
+  file_.reset();
+}
+
+ColumnarFileWriterSharedPtr
+ColumnarFileWriterRegistry::getOrCreate(const std::string& path, uint64_t max_file_bytes,
+                                        std::chrono::milliseconds max_file_age, Api::Api& api,
+                                        Stats::Scope& scope) {
+  ColumnarFileWriterSharedPtr writer = writers_[path].lock();
+  if (writer != nullptr && (writer->maxFileBytes() != max_file_bytes ||
+                            writer->maxFileAge() != max_file_age)) {
+    throw EnvoyException(fmt::format(
+        "columnar access log path '{}' is already in use with different max_file_bytes or "
+        "max_file_age",
+        path));
+  }
+  if (writer == nullptr) {
+    writer = std::make_shared<ColumnarFileWriter>(path, max_file_bytes, max_file_age, api, scope);
+    writers_[path] = writer;
+  }
+  return writer;
+}
+
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
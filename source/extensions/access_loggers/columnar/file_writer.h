@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/api/api.h"
+#include "envoy/filesystem/filesystem.h"
+#include "envoy/singleton/instance.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/common/logger.h"
+#include "source/common/common/thread.h"
+
+#include "absl/container/flat_hash_map.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+
+/**
+ * All columnar access log writer stats. @see stats_macros.h
+ */
+#define ALL_COLUMNAR_FILE_WRITER_STATS(COUNTER)                                                    \
+  COUNTER(blocks_dropped)                                                                          \
+  COUNTER(bytes_dropped)
+
+/**
+ * Struct definition for all columnar access log writer stats. @see stats_macros.h
+ */
+struct ColumnarFileWriterStats {
+  ALL_COLUMNAR_FILE_WRITER_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Writes the encoded blocks of columnar access logs to rotating files. Workers hand over complete
+ * blocks, which a dedicated thread writes out, so that workers never block on the disk. A new file
+ * is only started between blocks, so every file holds whole blocks.
+ */
+class ColumnarFileWriter : Logger::Loggable<Logger::Id::misc> {
+public:
+  ColumnarFileWriter(const std::string& path, uint64_t max_file_bytes,
+                     std::chrono::milliseconds max_file_age, Api::Api& api, Stats::Scope& scope);
+  ~ColumnarFileWriter();
+
+  /**
+   * Queues an encoded block for writing. Thread safe.
+   */
+  void write(Buffer::InstancePtr&& block);
+
+  uint64_t maxFileBytes() const { return max_file_bytes_; }
+  std::chrono::milliseconds maxFileAge() const { return max_file_age_; }
+
+  // Maximum number of bytes waiting to be written. Blocks beyond that are dropped and counted,
+  // rather than letting memory grow when the disk cannot keep up.
+  static constexpr uint64_t MAX_QUEUED_BYTES = 64 * 1024 * 1024;
+
+private:
+  void threadRoutine();
+  void writeBlock(Buffer::Instance& block);
+  bool shouldRotate() const;
+  void openNextFile();
+  void closeFile();
+
+  const std::string path_;
+  const uint64_t max_file_bytes_;
+  const std::chrono::milliseconds max_file_age_;
+  Api::Api& api_;
+  ColumnarFileWriterStats stats_;
+
+  Thread::MutexBasicLockable lock_;
+  Thread::CondVar queue_event_;
+  std::vector<Buffer::InstancePtr> queue_ ABSL_GUARDED_BY(lock_);
+  uint64_t queued_bytes_ ABSL_GUARDED_BY(lock_){};
+  bool exit_ ABSL_GUARDED_BY(lock_){};
+
+  // Only used by the writer thread.
+  Filesystem::FilePtr file_;
+  uint64_t file_bytes_{};
+  MonotonicTime file_opened_;
+  uint64_t file_sequence_{};
+
+  Thread::ThreadPtr thread_;
+};
+
+using ColumnarFileWriterSharedPtr = std::shared_ptr<ColumnarFileWriter>;
+
+/**
+ * Hands out a single writer per path, so that loggers configured with the same path, for example
+ * in several listeners, share the files rather than overwriting each other. Loggers sharing a path
+ * must agree on the rotation settings. Writers outlive the listener that created them, so their
+ * stats must be created in a server wide scope. Only used on the main thread.
+ */
+class ColumnarFileWriterRegistry : public Singleton::Instance {
+public:
+  /**
+   * @return the writer for the path, creating it if no logger uses the path yet.
+   * @throw EnvoyException if the path is in use with different rotation settings.
+   */
+  ColumnarFileWriterSharedPtr getOrCreate(const std::string& path, uint64_t max_file_bytes,
+                                          std::chrono::milliseconds max_file_age, Api::Api& api,
+                                          Stats::Scope& scope);
+
+private:
+  absl::flat_hash_map<std::string, std::weak_ptr<ColumnarFileWriter>> writers_;
+};
+
+using ColumnarFileWriterRegistrySharedPtr = std::shared_ptr<ColumnarFileWriterRegistry>;
+
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
 
 #include "envoy/config/core/v3/config_source.pb.h"
@@ -153,7 +154,8 @@ public:
  */
 #define ALL_GRPC_ACCESS_LOGGER_STATS(COUNTER)                                                      \
   COUNTER(logs_written)                                                                            \
-  COUNTER(logs_dropped)
+  COUNTER(logs_dropped)                                                                            \
+  COUNTER(logs_sampled_out)
 
 /**
  * Wrapper struct for the access log stats. @see stats_macros.h
@@ -186,12 +188,15 @@ public:
           flush_timer_->enableTimer(buffer_flush_interval_msec_);
         })),
         max_buffer_size_bytes_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, buffer_size_bytes, 16384)),
+        buffer_limit_bytes_(std::max<uint64_t>(
+            PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, buffer_limit_bytes, max_buffer_size_bytes_),
+            max_buffer_size_bytes_)),
         stats_({ALL_GRPC_ACCESS_LOGGER_STATS(POOL_COUNTER_PREFIX(scope, access_log_prefix))}) {
     flush_timer_->enableTimer(buffer_flush_interval_msec_);
   }
 
   void log(HttpLogProto&& entry) override {
-    if (!canLogMore()) {
+    if (!canLogMore(isHighPriority(entry))) {
       return;
     }
     approximate_message_size_bytes_ += entry.ByteSizeLong();
@@ -219,6 +224,8 @@ private:
   virtual void addEntry(HttpLogProto&& entry) PURE;
   virtual void addEntry(TcpLogProto&& entry) PURE;
   virtual void clearMessage() { message_.Clear(); }
+  // Entries of high priority are kept rather than sampled while the stream is backed up.
+  virtual bool isHighPriority(const HttpLogProto&) const { return false; }
 
   void flush() {
     if (isEmpty()) {
@@ -237,7 +244,7 @@ private:
     }
   }
 
-  bool canLogMore() {
+  bool canLogMore(bool high_priority) {
     if (max_buffer_size_bytes_ == 0 || approximate_message_size_bytes_ < max_buffer_size_bytes_) {
       stats_.logs_written_.inc();
       return true;
@@ -247,14 +254,37 @@ private:
       stats_.logs_written_.inc();
       return true;
     }
-    stats_.logs_dropped_.inc();
-    return false;
+    // The stream is backed up. The batch keeps growing up to the hard limit, with low priority
+    // entries sampled on the way. There is no callback when the stream drains, so the batch goes
+    // out as a single message from the first flush() which finds the stream below its watermark,
+    // on the next entry or flush interval. The hard limit is capped in the API, so that the
+    // message stays below the default gRPC message size limit.
+    if (approximate_message_size_bytes_ >= buffer_limit_bytes_) {
+      stats_.logs_dropped_.inc();
+      return false;
+    }
+    if (!high_priority && low_priority_entries_++ % samplingStride() != 0) {
+      stats_.logs_sampled_out_.inc();
+      return false;
+    }
+    stats_.logs_written_.inc();
+    return true;
+  }
+
+  // Keeps one in 2, 4 and then 8 low priority entries as the buffer fills up between the soft and
+  // the hard limit.
+  uint64_t samplingStride() const {
+    const uint64_t quarter = (approximate_message_size_bytes_ - max_buffer_size_bytes_) * 4 /
+                             (buffer_limit_bytes_ - max_buffer_size_bytes_);
+    return uint64_t(2) << std::min<uint64_t>(quarter, 2);
   }
 
   const std::chrono::milliseconds buffer_flush_interval_msec_;
   const Event::TimerPtr flush_timer_;
   const uint64_t max_buffer_size_bytes_;
+  const uint64_t buffer_limit_bytes_;
   uint64_t approximate_message_size_bytes_ = 0;
+  uint64_t low_priority_entries_ = 0;
   GrpcAccessLoggerStats stats_;
 };
 
@@ -42,6 +42,13 @@ void GrpcAccessLoggerImpl::initMessage() {
   identifier->set_log_name(log_name_);
 }
 
+bool GrpcAccessLoggerImpl::isHighPriority(
+    const envoy::data::accesslog::v3::HTTPAccessLogEntry& entry) const {
+  // Failed requests are the ones most worth keeping when entries have to be shed.
+  return entry.response().response_code().value() >= 500 ||
+         entry.common_properties().has_response_flags();
+}
+
 GrpcAccessLoggerCacheImpl::GrpcAccessLoggerCacheImpl(Grpc::AsyncClientManager& async_client_manager,
                                                      Stats::Scope& scope,
                                                      ThreadLocal::SlotAllocator& tls,
@@ -4,6 +4,7 @@ EXTENSIONS = {
     # Access loggers
     #
 
+    "envoy.access_loggers.columnar":                    "//source/extensions/access_loggers/columnar:config",
     "envoy.access_loggers.file":                        "//source/extensions/access_loggers/file:config",
     "envoy.access_loggers.extension_filters.cel":       "//source/extensions/access_loggers/filters/cel:config",
     "envoy.access_loggers.http_grpc":                   "//source/extensions/access_loggers/grpc:http_config",
@@ -230,6 +231,8 @@ EXTENSIONS = {
     #
     # CacheFilter plugins
     #
+    "envoy.extensions.http.cache.file_system_http_cache": "//source/extensions/filters/http/cache/file_system_http_cache:config",
+    "envoy.extensions.http.cache.memory":               "//source/extensions/filters/http/cache/memory_http_cache:config",
     "envoy.extensions.http.cache.simple":               "//source/extensions/filters/http/cache/simple_http_cache:config",
 
     #
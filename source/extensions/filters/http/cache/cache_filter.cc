@@ -27,18 +27,24 @@ inline bool isResponseNotModified(const Http::ResponseHeaderMap& response_header
 
 struct CacheResponseCodeDetailValues {
   const absl::string_view ResponseFromCacheFilter = "cache.response_from_cache_filter";
+  const absl::string_view ResponseFromCoalescedRequest = "cache.response_from_coalesced_request";
 };
 
 using CacheResponseCodeDetails = ConstSingleton<CacheResponseCodeDetailValues>;
 
 CacheFilter::CacheFilter(const envoy::extensions::filters::http::cache::v3::CacheConfig& config,
                          const std::string&, Stats::Scope&, TimeSource& time_source,
-                         HttpCache& http_cache)
+                         HttpCache& http_cache, RequestCoalescerSharedPtr coalescer)
     : time_source_(time_source), cache_(http_cache),
-      vary_allow_list_(config.allowed_vary_headers()) {}
+      vary_allow_list_(config.allowed_vary_headers()), coalescer_(std::move(coalescer)) {}
 
 void CacheFilter::onDestroy() {
   filter_state_ = FilterState::Destroyed;
+  if (leading_coalesced_response_) {
+    stopLeading(/*abort=*/true);
+  } else if (coalesced_response_) {
+    stopFollowing();
+  }
   if (lookup_) {
     lookup_->onDestroy();
   }
@@ -79,6 +85,12 @@ Http::FilterHeadersStatus CacheFilter::decodeHeaders(Http::RequestHeaderMap& hea
   LookupRequest lookup_request(headers, time_source_.systemTime(), vary_allow_list_);
   request_allows_inserts_ = !lookup_request.requestCacheControl().no_store_;
   is_head_request_ = headers.getMethodValue() == Http::Headers::get().MethodValues.Head;
+  // A follower is served the whole response of its leader, so only requests for a whole response
+  // which may be inserted are collapsed.
+  if (coalescer_ && request_allows_inserts_ && !is_head_request_ &&
+      headers.get(Http::Headers::get().Range).empty()) {
+    coalescing_key_ = lookup_request.key();
+  }
   lookup_ = cache_.makeLookupContext(std::move(lookup_request), *decoder_callbacks_);
 
   ASSERT(lookup_);
@@ -97,6 +109,11 @@ Http::FilterHeadersStatus CacheFilter::encodeHeaders(Http::ResponseHeaderMap& he
     return Http::FilterHeadersStatus::Continue;
   }
 
+  if (filter_state_ == FilterState::WaitingForCoalescedResponse) {
+    // A local reply is being sent while waiting for a coalesced response, e.g. on a timeout.
+    stopFollowing();
+  }
+
   // If lookup_ is null, the request wasn't cacheable, so the response isn't either.
   if (!lookup_) {
     return Http::FilterHeadersStatus::Continue;
@@ -134,6 +151,17 @@ Http::FilterHeadersStatus CacheFilter::encodeHeaders(Http::ResponseHeaderMap& he
   } else {
     insert_status_ = InsertStatus::NoInsertResponseNotCacheable;
   }
+  if (leading_coalesced_response_) {
+    // A response varying on request headers may not be the one the followers would get.
+    if (insert_ && !VaryHeaderUtils::hasVary(headers) &&
+        coalesced_response_->publishHeaders(headers, end_stream)) {
+      if (end_stream) {
+        stopLeading(/*abort=*/false);
+      }
+    } else {
+      stopLeading(/*abort=*/true);
+    }
+  }
   filter_state_ = FilterState::NotServingFromCache;
   return Http::FilterHeadersStatus::Continue;
 }
@@ -159,6 +187,15 @@ Http::FilterDataStatus CacheFilter::encodeData(Buffer::Instance& data, bool end_
     // insert_status_ remains absl::nullopt if end_stream == false, as we have not completed the
     // insertion yet.
   }
+  if (leading_coalesced_response_) {
+    if (!coalesced_response_->publishData(data, end_stream)) {
+      ENVOY_STREAM_LOG(debug, "CacheFilter::encodeData response too large to share",
+                       *encoder_callbacks_);
+      stopLeading(/*abort=*/true);
+    } else if (end_stream) {
+      stopLeading(/*abort=*/false);
+    }
+  }
   return Http::FilterDataStatus::Continue;
 }
 
@@ -178,6 +215,10 @@ Http::FilterTrailersStatus CacheFilter::encodeTrailers(Http::ResponseTrailerMap&
     insert_->insertTrailers(trailers);
   }
   insert_status_ = InsertStatus::InsertSucceeded;
+  if (leading_coalesced_response_) {
+    coalesced_response_->publishTrailers(trailers);
+    stopLeading(/*abort=*/false);
+  }
 
   return Http::FilterTrailersStatus::Continue;
 }
@@ -211,6 +252,8 @@ CacheFilter::resolveLookupStatus(absl::optional<CacheEntryStatus> cache_entry_st
         ABSL_FALLTHROUGH_INTENDED;
       case FilterState::DecodeServingFromCache:
         ABSL_FALLTHROUGH_INTENDED;
+      case FilterState::WaitingForCoalescedResponse:
+        ABSL_FALLTHROUGH_INTENDED;
       case FilterState::Destroyed:
         // TODO (capoferro): ENVOY_BUG prevents code coverage from working. When we fix that, we
         // should convert this to an ENVOY_BUG.
@@ -252,6 +295,8 @@ CacheFilter::resolveLookupStatus(absl::optional<CacheEntryStatus> cache_entry_st
     ABSL_FALLTHROUGH_INTENDED;
   case FilterState::ResponseServedFromCache:
     ABSL_FALLTHROUGH_INTENDED;
+  case FilterState::WaitingForCoalescedResponse:
+    ABSL_FALLTHROUGH_INTENDED;
   case FilterState::Destroyed:
     ENVOY_LOG(error, absl::StrCat("Unexpected filter state in requestCacheStatus: "
                                   "lookup_result_ is empty but filter state is ",
@@ -384,6 +429,9 @@ void CacheFilter::onHeaders(LookupResult&& result, Http::RequestHeaderMap& reque
     handleCacheHit();
     return;
   case CacheEntryStatus::Unusable:
+    if (coalescing_key_.has_value() && coalesceMiss()) {
+      return;
+    }
     decoder_callbacks_->continueDecoding();
     return;
   case CacheEntryStatus::LookupError:
@@ -409,7 +457,14 @@ void CacheFilter::onBody(Buffer::InstancePtr&& body) {
   ASSERT(!remaining_ranges_.empty(),
          "CacheFilter doesn't call getBody unless there's more body to get, so this is a "
          "bogus callback.");
-  ASSERT(body, "Cache said it had a body, but isn't giving it to us.");
+  if (body == nullptr) {
+    // The cache failed to read the body, and the response headers may already have been sent.
+    ENVOY_STREAM_LOG(debug, "CacheFilter::onBody cache failed to read the body, aborting",
+                     *decoder_callbacks_);
+    filter_state_ == FilterState::DecodeServingFromCache ? decoder_callbacks_->resetStream()
+                                                         : encoder_callbacks_->resetStream();
+    return;
+  }
 
   const uint64_t bytes_from_cache = body->length();
   if (bytes_from_cache < remaining_ranges_[0].length()) {
@@ -660,7 +715,123 @@ void CacheFilter::finalizeEncodingCachedResponse() {
   filter_state_ = FilterState::ResponseServedFromCache;
 }
 
+bool CacheFilter::coalesceMiss() {
+  auto [response, leader] = coalescer_->join(coalescing_key_.value());
+  coalesced_response_ = std::move(response);
+  if (leader) {
+    ENVOY_STREAM_LOG(debug, "CacheFilter::coalesceMiss leading a coalesced response",
+                     *decoder_callbacks_);
+    leading_coalesced_response_ = true;
+    return false;
+  }
+
+  ENVOY_STREAM_LOG(debug, "CacheFilter::coalesceMiss waiting for a coalesced response",
+                   *decoder_callbacks_);
+  filter_state_ = FilterState::WaitingForCoalescedResponse;
+  coalescing_timer_ =
+      decoder_callbacks_->dispatcher().createTimer([this]() { onCoalescingTimeout(); });
+  coalescing_timer_->enableTimer(coalescer_->waitTimeout());
+  decoder_callbacks_->addDownstreamWatermarkCallbacks(*this);
+  // Updates are posted to this worker's dispatcher, and may still run after the filter is
+  // destroyed.
+  CacheFilterWeakPtr self = weak_from_this();
+  follower_id_ = coalesced_response_->addFollower(decoder_callbacks_->dispatcher(), [self]() {
+    if (CacheFilterSharedPtr cache_filter = self.lock()) {
+      cache_filter->onCoalescedResponseUpdate();
+    }
+  });
+  return true;
+}
+
+void CacheFilter::onCoalescedResponseUpdate() {
+  if (filter_state_ == FilterState::Destroyed || !coalesced_response_) {
+    return;
+  }
+  if (downstream_high_watermarks_ > 0) {
+    // The rest of the response is read once the downstream has drained.
+    return;
+  }
+  CoalescedResponse::Update update = coalesced_response_->read(coalesced_response_cursor_);
+  if (update.aborted_) {
+    stopFollowing();
+    if (filter_state_ == FilterState::WaitingForCoalescedResponse) {
+      // Nothing was served yet, so the request can still be sent upstream.
+      ENVOY_STREAM_LOG(debug, "CacheFilter coalesced response aborted, sending request upstream",
+                       *decoder_callbacks_);
+      filter_state_ = FilterState::Initial;
+      decoder_callbacks_->continueDecoding();
+    } else {
+      decoder_callbacks_->resetStream();
+    }
+    return;
+  }
+
+  if (update.headers_) {
+    coalescing_timer_->disableTimer();
+    filter_state_ = FilterState::DecodeServingFromCache;
+    insert_status_ = InsertStatus::NoInsertCacheHit;
+    served_coalesced_response_ = true;
+    decoder_callbacks_->streamInfo().setResponseFlag(
+        StreamInfo::ResponseFlag::ResponseFromCacheFilter);
+    decoder_callbacks_->streamInfo().setResponseCodeDetails(
+        CacheResponseCodeDetails::get().ResponseFromCoalescedRequest);
+    const bool end_stream = update.end_stream_ && !update.body_ && !update.trailers_;
+    decoder_callbacks_->encodeHeaders(std::move(update.headers_), end_stream,
+                                      CacheResponseCodeDetails::get().ResponseFromCoalescedRequest);
+  }
+  if (update.body_ && filter_state_ != FilterState::Destroyed) {
+    decoder_callbacks_->encodeData(*update.body_, update.end_stream_ && !update.trailers_);
+  }
+  if (update.trailers_ && filter_state_ != FilterState::Destroyed) {
+    decoder_callbacks_->encodeTrailers(std::move(update.trailers_));
+  }
+  if (update.end_stream_ && filter_state_ != FilterState::Destroyed) {
+    stopFollowing();
+    filter_state_ = FilterState::ResponseServedFromCache;
+  }
+}
+
+void CacheFilter::onCoalescingTimeout() {
+  ASSERT(filter_state_ == FilterState::WaitingForCoalescedResponse);
+  ENVOY_STREAM_LOG(debug, "CacheFilter timed out waiting for a coalesced response",
+                   *decoder_callbacks_);
+  stopFollowing();
+  filter_state_ = FilterState::Initial;
+  decoder_callbacks_->continueDecoding();
+}
+
+void CacheFilter::stopFollowing() {
+  if (coalescing_timer_) {
+    coalescing_timer_->disableTimer();
+  }
+  decoder_callbacks_->removeDownstreamWatermarkCallbacks(*this);
+  coalesced_response_->removeFollower(follower_id_);
+  coalesced_response_.reset();
+}
+
+void CacheFilter::onAboveWriteBufferHighWatermark() { downstream_high_watermarks_++; }
+
+void CacheFilter::onBelowWriteBufferLowWatermark() {
+  ASSERT(downstream_high_watermarks_ > 0);
+  downstream_high_watermarks_--;
+  if (downstream_high_watermarks_ == 0 && coalesced_response_ && !leading_coalesced_response_) {
+    onCoalescedResponseUpdate();
+  }
+}
+
+void CacheFilter::stopLeading(bool abort) {
+  if (abort) {
+    coalesced_response_->abort();
+  }
+  coalescer_->release(coalescing_key_.value(), *coalesced_response_);
+  coalesced_response_.reset();
+  leading_coalesced_response_ = false;
+}
+
 LookupStatus CacheFilter::lookupStatus() const {
+  if (served_coalesced_response_) {
+    return LookupStatus::CoalescedHit;
+  }
   if (lookup_result_ == nullptr && lookup_ != nullptr) {
     return LookupStatus::RequestIncomplete;
   }
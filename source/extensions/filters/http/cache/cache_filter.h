@@ -11,6 +11,7 @@
 #include "source/extensions/filters/http/cache/cache_filter_logging_info.h"
 #include "source/extensions/filters/http/cache/cache_headers_utils.h"
 #include "source/extensions/filters/http/cache/http_cache.h"
+#include "source/extensions/filters/http/cache/request_coalescer.h"
 #include "source/extensions/filters/http/common/pass_through_filter.h"
 
 namespace Envoy {
@@ -39,6 +40,10 @@ enum class FilterState {
   // in cache couldn't be served. This may be set during decoding or encoding.
   NotServingFromCache,
 
+  // Cache lookup found no response, and the request was collapsed into a request for the same key
+  // being sent upstream. Waiting for its response headers.
+  WaitingForCoalescedResponse,
+
   // CacheFilter::onDestroy has been called, the filter will be destroyed soon. Any triggered
   // callbacks should be ignored.
   Destroyed
@@ -48,12 +53,13 @@ enum class FilterState {
  * A filter that caches responses and attempts to satisfy requests from cache.
  */
 class CacheFilter : public Http::PassThroughFilter,
+                    public Http::DownstreamWatermarkCallbacks,
                     public Logger::Loggable<Logger::Id::cache_filter>,
                     public std::enable_shared_from_this<CacheFilter> {
 public:
   CacheFilter(const envoy::extensions::filters::http::cache::v3::CacheConfig& config,
               const std::string& stats_prefix, Stats::Scope& scope, TimeSource& time_source,
-              HttpCache& http_cache);
+              HttpCache& http_cache, RequestCoalescerSharedPtr coalescer = nullptr);
   // Http::StreamFilterBase
   void onDestroy() override;
   void onStreamComplete() override;
@@ -65,6 +71,9 @@ public:
                                           bool end_stream) override;
   Http::FilterDataStatus encodeData(Buffer::Instance& buffer, bool end_stream) override;
   Http::FilterTrailersStatus encodeTrailers(Http::ResponseTrailerMap& trailers) override;
+  // Http::DownstreamWatermarkCallbacks, registered while following a coalesced response.
+  void onAboveWriteBufferHighWatermark() override;
+  void onBelowWriteBufferLowWatermark() override;
 
   static LookupStatus resolveLookupStatus(absl::optional<CacheEntryStatus> cache_entry_status,
                                           FilterState filter_state);
@@ -117,6 +126,24 @@ private:
   // Updates filter_state_ and continues the encoding stream if necessary.
   void finalizeEncodingCachedResponse();
 
+  // Called on a cache miss if request coalescing is enabled. Returns true if the request was
+  // collapsed into a request for the same key that is already being sent upstream, in which case
+  // it waits for its response. Otherwise this request becomes the leader sharing its response.
+  bool coalesceMiss();
+
+  // Serves the part of the coalesced response that is available and not yet served.
+  void onCoalescedResponseUpdate();
+
+  // Sends the request upstream after giving up on waiting for a coalesced response.
+  void onCoalescingTimeout();
+
+  // Stops following a coalesced response.
+  void stopFollowing();
+
+  // Stops sharing this request's response, either because it was fully published, or because it
+  // can't be shared.
+  void stopLeading(bool abort);
+
   // The result of this request's cache lookup.
   LookupStatus lookupStatus() const;
 
@@ -156,6 +183,22 @@ private:
   // The status of the insert operation or header update, or decision not to insert or update.
   // If it's too early to determine the final status, this is empty.
   absl::optional<InsertStatus> insert_status_;
+
+  // Request coalescing state. coalescer_ is null if coalescing is disabled, and coalescing_key_ is
+  // empty if this request can't be coalesced.
+  const RequestCoalescerSharedPtr coalescer_;
+  absl::optional<Key> coalescing_key_;
+  // The response this request leads or follows, while it does.
+  CoalescedResponseSharedPtr coalesced_response_;
+  bool leading_coalesced_response_ = false;
+  CoalescedResponse::Cursor coalesced_response_cursor_;
+  uint64_t follower_id_ = 0;
+  // The number of downstream high watermarks not yet followed by a low one, while following. The
+  // coalesced response isn't read while there are any.
+  uint32_t downstream_high_watermarks_ = 0;
+  Event::TimerPtr coalescing_timer_;
+  // True if this request was served the response of the request it was collapsed into.
+  bool served_coalesced_response_ = false;
 };
 
 using CacheFilterSharedPtr = std::shared_ptr<CacheFilter>;
@@ -27,6 +27,8 @@ absl::string_view lookupStatusToString(LookupStatus status) {
     return "RequestIncomplete";
   case LookupStatus::LookupError:
     return "LookupError";
+  case LookupStatus::CoalescedHit:
+    return "CoalescedHit";
   }
   IS_ENVOY_BUG(absl::StrCat("Unexpected LookupStatus: ", status));
   return "UnexpectedLookupStatus";
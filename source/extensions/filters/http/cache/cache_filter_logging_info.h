@@ -37,6 +37,9 @@ enum class LookupStatus {
   // The CacheFilter couldn't determine whether there was a response in cache,
   // e.g. because the cache was unreachable or the lookup RPC timed out.
   LookupError,
+  // The CacheFilter didn't find a response in cache, and served the response
+  // of a concurrent request for the same key that it was collapsed into.
+  CoalescedHit,
 };
 
 absl::string_view lookupStatusToString(LookupStatus status);
@@ -118,6 +118,11 @@ void getAllMatchingHeaderNames(const Http::HeaderMap& headers,
 // Parses the values of a comma-delimited list as defined per
 // https://tools.ietf.org/html/rfc7230#section-7.
 std::vector<absl::string_view> parseCommaDelimitedHeader(const Http::HeaderMap::GetResult& entry);
+
+// Replaces the headers of a cached response with the ones of a response validating it, except for
+// the headers which must not change upon validation.
+void updateCachedResponseHeaders(Http::ResponseHeaderMap& cached_headers,
+                                 const Http::ResponseHeaderMap& response_headers);
 } // namespace CacheHeadersUtils
 
 class VaryAllowList {
@@ -19,11 +19,16 @@ Http::FilterFactoryCb CacheFilterFactory::createFilterFactoryFromProtoTyped(
   }
 
   auto cache = http_cache_factory->getCache(config, context);
+  // Shared by the filters of all workers, so that requests are collapsed across workers.
+  RequestCoalescerSharedPtr coalescer =
+      config.has_request_coalescing()
+          ? std::make_shared<RequestCoalescer>(config.request_coalescing())
+          : nullptr;
 
-  return [config, stats_prefix, &context,
-          cache](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-    callbacks.addStreamFilter(std::make_shared<CacheFilter>(config, stats_prefix, context.scope(),
-                                                            context.timeSource(), *cache));
+  return [config, stats_prefix, &context, cache,
+          coalescer](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamFilter(std::make_shared<CacheFilter>(
+        config, stats_prefix, context.scope(), context.timeSource(), *cache, coalescer));
   };
 }
 
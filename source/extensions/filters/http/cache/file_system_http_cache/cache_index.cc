@@ -0,0 +1,292 @@
+#include "source/extensions/filters/http/cache/file_system_http_cache/cache_index.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "envoy/api/os_sys_calls.h"
+
+#include "source/common/api/os_sys_calls_impl.h"
+#include "source/common/common/assert.h"
+#include "source/common/common/fmt.h"
+#include "source/common/common/hash.h"
+#include "source/common/common/utility.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+namespace FileSystemHttpCache {
+
+// "ENVOYIDX"
+constexpr uint64_t IndexMagic = 0x584449594f564e45ULL;
+constexpr uint32_t IndexVersion = 2;
+
+struct CacheIndex::FileHeader {
+  uint64_t magic_;
+  uint32_t version_;
+  uint32_t capacity_;
+  uint32_t oldest_segment_;
+  uint32_t newest_segment_;
+  uint64_t size_;
+  uint8_t reserved_[32];
+};
+
+struct CacheIndex::Slot {
+  enum State : uint32_t { Free = 0, Live = 1 };
+
+  uint64_t key_hash_;
+  uint32_t state_;
+  uint32_t header_segment_;
+  uint64_t header_offset_;
+  uint32_t header_size_;
+  uint32_t body_segment_;
+  uint64_t body_offset_;
+  uint64_t body_size_;
+  uint32_t trailers_size_;
+  uint32_t reserved_;
+  // Checksum of the fields above.
+  uint64_t checksum_;
+
+  uint64_t computeChecksum() const {
+    return HashUtil::xxHash64(
+        absl::string_view(reinterpret_cast<const char*>(this), offsetof(Slot, checksum_)));
+  }
+  bool valid() const { return checksum_ == computeChecksum(); }
+  void set(uint64_t key_hash, const IndexEntry& entry) {
+    key_hash_ = key_hash;
+    state_ = Live;
+    header_segment_ = entry.header_segment_;
+    header_offset_ = entry.header_offset_;
+    header_size_ = entry.header_size_;
+    body_segment_ = entry.body_segment_;
+    body_offset_ = entry.body_offset_;
+    body_size_ = entry.body_size_;
+    trailers_size_ = entry.trailers_size_;
+    reserved_ = 0;
+    checksum_ = computeChecksum();
+  }
+  IndexEntry entry() const {
+    return {header_segment_, header_size_, header_offset_, body_segment_,
+            trailers_size_,  body_offset_, body_size_};
+  }
+};
+
+absl::StatusOr<std::unique_ptr<CacheIndex>> CacheIndex::open(const std::string& path,
+                                                             uint32_t capacity) {
+  Api::OsSysCalls& os_sys_calls = Api::OsSysCallsSingleton::get();
+  const size_t mapping_size = sizeof(FileHeader) + static_cast<size_t>(capacity) * sizeof(Slot);
+
+  const Api::SysCallIntResult fd = os_sys_calls.open(path.c_str(), O_RDWR | O_CREAT, 0600);
+  if (fd.return_value_ == -1) {
+    return absl::UnavailableError(
+        fmt::format("failed to open cache index {}: {}", path, errorDetails(fd.errno_)));
+  }
+  const bool locked = ::flock(fd.return_value_, LOCK_EX | LOCK_NB) == 0;
+  auto fail = [&os_sys_calls, &fd](absl::Status status) {
+    os_sys_calls.close(fd.return_value_);
+    return status;
+  };
+
+  struct stat file_stat;
+  if (os_sys_calls.stat(path.c_str(), &file_stat).return_value_ == -1) {
+    return fail(absl::UnavailableError(fmt::format("failed to stat cache index {}", path)));
+  }
+  if (static_cast<size_t>(file_stat.st_size) != mapping_size) {
+    if (!locked) {
+      return fail(absl::FailedPreconditionError(
+          fmt::format("cache index {} is in use with another capacity", path)));
+    }
+    // Truncating first zeroes all the slots.
+    if (os_sys_calls.ftruncate(fd.return_value_, 0).return_value_ == -1 ||
+        os_sys_calls.ftruncate(fd.return_value_, mapping_size).return_value_ == -1) {
+      return fail(absl::UnavailableError(fmt::format("failed to resize cache index {}", path)));
+    }
+  }
+
+  const Api::SysCallPtrResult mapping = os_sys_calls.mmap(
+      nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.return_value_, 0);
+  if (mapping.return_value_ == MAP_FAILED) {
+    return fail(absl::UnavailableError(
+        fmt::format("failed to map cache index {}: {}", path, errorDetails(mapping.errno_))));
+  }
+
+  std::unique_ptr<CacheIndex> index(
+      new CacheIndex(fd.return_value_, mapping.return_value_, mapping_size, locked));
+  const FileHeader& header = *index->header_;
+  if (header.magic_ != IndexMagic || header.version_ != IndexVersion ||
+      header.capacity_ != capacity) {
+    if (!locked) {
+      return absl::FailedPreconditionError(
+          fmt::format("cache index {} is in use with another format", path));
+    }
+    index->clear();
+    index->header_->capacity_ = capacity;
+  }
+  return index;
+}
+
+CacheIndex::CacheIndex(int fd, void* mapping, size_t mapping_size, bool locked)
+    : fd_(fd), mapping_(mapping), mapping_size_(mapping_size),
+      header_(static_cast<FileHeader*>(mapping)), locked_(locked) {
+  static_assert(sizeof(FileHeader) == 64, "index header should be one cache line");
+  static_assert(sizeof(Slot) == 64, "index slots should be one cache line");
+}
+
+CacheIndex::~CacheIndex() {
+  ::munmap(mapping_, mapping_size_);
+  // Closing the file also releases the lock.
+  Api::OsSysCallsSingleton::get().close(fd_);
+}
+
+bool CacheIndex::tryLock() {
+  if (!locked_) {
+    locked_ = ::flock(fd_, LOCK_EX | LOCK_NB) == 0;
+  }
+  return locked_;
+}
+
+CacheIndex::Slot* CacheIndex::slots() const {
+  return reinterpret_cast<Slot*>(static_cast<char*>(mapping_) + sizeof(FileHeader));
+}
+
+uint32_t CacheIndex::next(uint32_t index) const {
+  return index + 1 == header_->capacity_ ? 0 : index + 1;
+}
+
+CacheIndex::Slot* CacheIndex::probe(uint64_t key_hash) const {
+  const uint32_t capacity = header_->capacity_;
+  Slot* const slots = this->slots();
+  for (uint32_t i = 0, index = key_hash % capacity; i < capacity; i++, index = next(index)) {
+    // Checked on a copy, as another process may be writing the slot.
+    const Slot slot = slots[index];
+    if (slot.state_ == Slot::Free) {
+      return &slots[index];
+    }
+    if (!slot.valid()) {
+      // Being written by another process.
+      return nullptr;
+    }
+    if (slot.key_hash_ == key_hash) {
+      return &slots[index];
+    }
+  }
+  return nullptr;
+}
+
+absl::optional<IndexEntry> CacheIndex::find(uint64_t key_hash) const {
+  const Slot* found = probe(key_hash);
+  if (found == nullptr) {
+    return absl::nullopt;
+  }
+  // The slot may have changed since probe() checked it.
+  const Slot slot = *found;
+  if (slot.state_ != Slot::Live || !slot.valid() || slot.key_hash_ != key_hash) {
+    return absl::nullopt;
+  }
+  // Entries of evicted segments are only removed gradually.
+  const uint32_t oldest_segment = header_->oldest_segment_;
+  if (slot.header_segment_ < oldest_segment || slot.body_segment_ < oldest_segment) {
+    return absl::nullopt;
+  }
+  return slot.entry();
+}
+
+bool CacheIndex::insert(uint64_t key_hash, const IndexEntry& entry) {
+  ASSERT(locked_);
+  Slot* slot = probe(key_hash);
+  if (slot == nullptr) {
+    // Torn by a process which crashed while writing it, until removeIf() clears it.
+    return false;
+  }
+  if (slot->state_ == Slot::Live) {
+    slot->set(key_hash, entry);
+    return true;
+  }
+  // Keep a quarter of the slots free so that probe sequences stay short.
+  if (header_->size_ >= header_->capacity_ / 4 * 3) {
+    return false;
+  }
+  slot->set(key_hash, entry);
+  header_->size_++;
+  return true;
+}
+
+void CacheIndex::remove(uint64_t key_hash) {
+  ASSERT(locked_);
+  Slot* slot = probe(key_hash);
+  if (slot != nullptr && slot->state_ == Slot::Live) {
+    removeAt(slot - slots());
+  }
+}
+
+uint32_t CacheIndex::removeIf(const std::function<bool(const IndexEntry&)>& predicate,
+                              uint32_t begin, uint32_t count) {
+  ASSERT(locked_);
+  const uint32_t end = std::min<uint64_t>(static_cast<uint64_t>(begin) + count, capacity());
+  Slot* const slots = this->slots();
+  for (uint32_t i = begin; i < end;) {
+    const Slot& slot = slots[i];
+    if (slot.state_ == Slot::Live && (!slot.valid() || predicate(slot.entry()))) {
+      // Another entry may have moved into the slot.
+      removeAt(i);
+    } else {
+      i++;
+    }
+  }
+  return end;
+}
+
+void CacheIndex::removeAt(uint32_t index) {
+  const uint32_t capacity = header_->capacity_;
+  Slot* const slots = this->slots();
+  auto distance = [capacity](uint32_t from, uint32_t to) {
+    return to >= from ? to - from : to + capacity - from;
+  };
+  // Moves back the following entries of the run which probe through the freed slot, so that no
+  // probe sequence crosses a free slot and removed slots needn't be kept as tombstones.
+  uint32_t hole = index;
+  for (uint32_t i = next(hole); slots[i].state_ != Slot::Free; i = next(i)) {
+    const uint32_t home = slots[i].key_hash_ % capacity;
+    if (distance(home, i) >= distance(hole, i)) {
+      slots[hole] = slots[i];
+      hole = i;
+    }
+  }
+  memset(static_cast<void*>(&slots[hole]), 0, sizeof(Slot));
+  header_->size_--;
+}
+
+void CacheIndex::clear() {
+  memset(mapping_, 0, mapping_size_);
+  header_->magic_ = IndexMagic;
+  header_->version_ = IndexVersion;
+  header_->oldest_segment_ = 1;
+  header_->newest_segment_ = 0;
+}
+
+uint64_t CacheIndex::size() const { return header_->size_; }
+uint32_t CacheIndex::capacity() const { return header_->capacity_; }
+uint32_t CacheIndex::oldestSegment() const { return header_->oldest_segment_; }
+uint32_t CacheIndex::newestSegment() const { return header_->newest_segment_; }
+
+void CacheIndex::setOldestSegment(uint32_t segment) {
+  ASSERT(locked_);
+  header_->oldest_segment_ = segment;
+}
+
+void CacheIndex::setNewestSegment(uint32_t segment) {
+  ASSERT(locked_);
+  header_->newest_segment_ = segment;
+}
+
+} // namespace FileSystemHttpCache
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+namespace FileSystemHttpCache {
+
+// Location of a cached response in the segment files. The trailers, if any, directly follow the
+// body.
+struct IndexEntry {
+  uint32_t header_segment_;
+  // Size of the serialized CacheFileHeader.
+  uint32_t header_size_;
+  uint64_t header_offset_;
+  uint32_t body_segment_;
+  // Size of the serialized CacheFileTrailer, or 0 if the response has no trailers.
+  uint32_t trailers_size_;
+  uint64_t body_offset_;
+  uint64_t body_size_;
+};
+
+/**
+ * Hash table from the hashes of cache keys to the location of the responses, stored in a memory
+ * mapped file so that it persists across restarts. Uses open addressing with linear probing, so
+ * that looking up a key touches a single page in the common case, and removes entries by moving
+ * back the following ones, so that it never needs to be rebuilt.
+ *
+ * The file can be mapped by several processes, e.g. during a hot restart, but only the one
+ * holding the lock on it may modify it. Slots are checksummed, so that a process reading a slot
+ * while another one writes it doesn't use a torn entry.
+ *
+ * Not thread safe: callers must synchronize accesses within a process.
+ */
+class CacheIndex {
+public:
+  /**
+   * Maps the index file at the given path, creating it if it doesn't exist. If the process gets
+   * the lock on the file, an index of another format or capacity is discarded.
+   * @param path the path to the index file.
+   * @param capacity the number of slots of the index.
+   * @return the index, or an error if the file can't be mapped, or is locked by another process
+   *         and has another format.
+   */
+  static absl::StatusOr<std::unique_ptr<CacheIndex>> open(const std::string& path,
+                                                          uint32_t capacity);
+  ~CacheIndex();
+
+  /**
+   * @return whether this process holds the lock on the index file, trying to get it first if
+   *         not. Only the holder of the lock may modify the index.
+   */
+  bool tryLock();
+
+  /**
+   * @return the entry of the key, unless it references a segment older than oldestSegment().
+   */
+  absl::optional<IndexEntry> find(uint64_t key_hash) const;
+
+  /**
+   * Adds or replaces the entry of the key.
+   * @return false if the index is full, or the probe sequence of the key has a torn slot.
+   */
+  bool insert(uint64_t key_hash, const IndexEntry& entry);
+
+  void remove(uint64_t key_hash);
+
+  /**
+   * Removes the entries of a range of slots for which the predicate returns true, as well as
+   * torn ones, so that a large index can be swept a batch at a time. An entry moved back from
+   * after the range into it by a removal is looked at too.
+   * @param begin the first slot to look at.
+   * @param count the number of slots to look at.
+   * @return the slot following the range, which is capacity() at the end of the index.
+   */
+  uint32_t removeIf(const std::function<bool(const IndexEntry&)>& predicate, uint32_t begin,
+                    uint32_t count);
+
+  /**
+   * @return the number of entries.
+   */
+  uint64_t size() const;
+
+  /**
+   * @return the number of slots.
+   */
+  uint32_t capacity() const;
+
+  // The range of segments which may be referenced by the index. Segments are numbered in the order
+  // they are created. oldestSegment() > newestSegment() when no segment has been created yet.
+  uint32_t oldestSegment() const;
+  uint32_t newestSegment() const;
+  void setOldestSegment(uint32_t segment);
+  void setNewestSegment(uint32_t segment);
+
+private:
+  struct FileHeader;
+  struct Slot;
+
+  CacheIndex(int fd, void* mapping, size_t mapping_size, bool locked);
+
+  Slot* slots() const;
+  uint32_t next(uint32_t index) const;
+  // Returns the slot of the key, or the free slot ending its probe sequence if absent. Returns
+  // nullptr on reaching a torn slot.
+  Slot* probe(uint64_t key_hash) const;
+  void removeAt(uint32_t index);
+  void clear();
+
+  const int fd_;
+  void* const mapping_;
+  const size_t mapping_size_;
+  FileHeader* const header_;
+  bool locked_;
+};
+
+} // namespace FileSystemHttpCache
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
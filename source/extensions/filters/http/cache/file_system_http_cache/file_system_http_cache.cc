@@ -0,0 +1,814 @@
+#include "source/extensions/filters/http/cache/file_system_http_cache/file_system_http_cache.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "envoy/extensions/cache/file_system_http_cache/v3/config.pb.h"
+#include "envoy/extensions/cache/file_system_http_cache/v3/config.pb.validate.h"
+#include "envoy/registry/registry.h"
+
+#include "source/common/api/os_sys_calls_impl.h"
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/common/fmt.h"
+#include "source/common/common/logger.h"
+#include "source/common/http/header_map_impl.h"
+#include "source/common/http/headers.h"
+#include "source/common/protobuf/utility.h"
+#include "source/extensions/filters/http/cache/cache_headers_utils.h"
+#include "source/extensions/filters/http/cache/file_system_http_cache/cache_file_header.pb.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_join.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+namespace FileSystemHttpCache {
+
+using Common::AsyncFiles::AsyncFileHandle;
+using Common::AsyncFiles::AsyncFileManager;
+using Common::AsyncFiles::AsyncFileManagerFactory;
+using Common::AsyncFiles::CancelFunction;
+
+namespace {
+
+constexpr uint64_t DefaultMaxCacheSizeBytes = 1024 * 1024 * 1024;
+constexpr uint64_t DefaultSegmentSizeBytes = 64 * 1024 * 1024;
+constexpr uint32_t DefaultMaxEntries = 1024 * 1024;
+constexpr uint64_t DefaultMaxEntrySizeBytes = 16 * 1024 * 1024;
+// Largest chunk of body read at once, so that large bodies are streamed.
+constexpr uint64_t MaxReadSizeBytes = 1024 * 1024;
+// Index slots swept for entries of evicted segments per write, so that lookups are only held up
+// for a bounded time.
+constexpr uint32_t SweepBatchSlots = 4096;
+
+constexpr absl::string_view Name = "envoy.extensions.http.cache.file_system_http_cache";
+
+void headersToProto(const Http::HeaderMap& headers,
+                    Protobuf::RepeatedPtrField<CacheFileHeaderEntry>& entries) {
+  headers.iterate([&entries](const Http::HeaderEntry& header) -> Http::HeaderMap::Iterate {
+    CacheFileHeaderEntry& entry = *entries.Add();
+    entry.set_key(std::string(header.key().getStringView()));
+    entry.set_value(std::string(header.value().getStringView()));
+    return Http::HeaderMap::Iterate::Continue;
+  });
+}
+
+template <class HeaderMapImpl>
+std::unique_ptr<HeaderMapImpl>
+headersFromProto(const Protobuf::RepeatedPtrField<CacheFileHeaderEntry>& entries) {
+  std::unique_ptr<HeaderMapImpl> headers = HeaderMapImpl::create();
+  for (const CacheFileHeaderEntry& entry : entries) {
+    headers->addCopy(Http::LowerCaseString(entry.key()), entry.value());
+  }
+  return headers;
+}
+
+SystemTime timestampToSystemTime(const ProtobufWkt::Timestamp& timestamp) {
+  return SystemTime(std::chrono::duration_cast<SystemTime::duration>(
+      std::chrono::seconds(timestamp.seconds()) + std::chrono::nanoseconds(timestamp.nanos())));
+}
+
+// Returns a write of the headers of a response. The body and trailers of a new response are to be
+// appended to it.
+SegmentWrite makeHeadersWrite(const Key& key, const Http::ResponseHeaderMap& response_headers,
+                              const ResponseMetadata& metadata) {
+  CacheFileHeader header;
+  *header.mutable_key() = key;
+  TimestampUtil::systemClockToTimestamp(metadata.response_time_, *header.mutable_response_time());
+  headersToProto(response_headers, *header.mutable_headers());
+  const std::string serialized = header.SerializeAsString();
+
+  SegmentWrite write;
+  write.key_hash_ = stableHashKey(key);
+  write.data_ = std::make_unique<Buffer::OwnedImpl>(serialized);
+  write.entry_ = {};
+  write.entry_.header_size_ = serialized.size();
+  write.headers_only_ = true;
+  return write;
+}
+
+class FileLookupContext : public LookupContext {
+public:
+  FileLookupContext(FileSystemHttpCache& cache, LookupRequest&& request)
+      : cache_(cache), request_(std::move(request)) {}
+
+  void getHeaders(LookupHeadersCallback&& cb) override {
+    lookup(request_.key(), /*varied=*/false, std::move(cb));
+  }
+
+  void getBody(const AdjustedByteRange& range, LookupBodyCallback&& cb) override {
+    ASSERT(entry_.has_value());
+    ASSERT(range.end() <= entry_->body_size_, "Attempt to read past end of body.");
+    // getHeaders() opened the segment of the body, so that only an I/O error fails this, and
+    // aborts the response.
+    read(entry_->body_segment_, entry_->body_offset_ + range.begin(),
+         std::min(range.length(), MaxReadSizeBytes),
+         [this, cb = std::move(cb)](absl::StatusOr<Buffer::InstancePtr> data) {
+           if (!data.ok() || data.value()->length() == 0) {
+             cache_.stats().read_errors_.inc();
+             cb(nullptr);
+             return;
+           }
+           cb(std::move(data.value()));
+         });
+  }
+
+  void getTrailers(LookupTrailersCallback&& cb) override {
+    ASSERT(entry_.has_value() && entry_->trailers_size_ > 0);
+    read(entry_->body_segment_, entry_->body_offset_ + entry_->body_size_, entry_->trailers_size_,
+         [this, cb = std::move(cb)](absl::StatusOr<Buffer::InstancePtr> data) {
+           CacheFileTrailer trailer;
+           if (!data.ok() || !trailer.ParseFromString(data.value()->toString())) {
+             cache_.stats().read_errors_.inc();
+             cb(Http::ResponseTrailerMapImpl::create());
+             return;
+           }
+           cb(headersFromProto<Http::ResponseTrailerMapImpl>(trailer.trailers()));
+         });
+  }
+
+  void onDestroy() override {
+    CancelFunction cancel;
+    {
+      absl::MutexLock lock(&mutex_);
+      destroyed_ = true;
+      cancel = std::exchange(cancel_in_flight_, nullptr);
+    }
+    // A callback running during the first cancellation may have queued another action, which
+    // doesn't queue any more since destroyed_ is set.
+    while (cancel) {
+      cancel();
+      absl::MutexLock lock(&mutex_);
+      cancel = std::exchange(cancel_in_flight_, nullptr);
+    }
+    absl::MutexLock lock(&mutex_);
+    if (handle_ != nullptr) {
+      handle_->close([](absl::Status) {}).IgnoreError();
+      handle_ = nullptr;
+    }
+  }
+
+  const LookupRequest& request() const { return request_; }
+  // The cached response found by getHeaders, if any.
+  const absl::optional<IndexEntry>& entry() const { return entry_; }
+  const CacheFileHeader& header() const { return header_; }
+
+private:
+  // Finds the response for the key. For a response with a Vary header, the response found under
+  // the key of the request records the headers it varies on, and the actual response is then
+  // looked up under the key varied by the request's values of these headers.
+  void lookup(const Key& key, bool varied, LookupHeadersCallback&& cb) {
+    const absl::optional<IndexEntry> entry = cache_.find(stableHashKey(key));
+    if (!entry.has_value()) {
+      cache_.stats().misses_.inc();
+      cb(LookupResult{});
+      return;
+    }
+    read(entry->header_segment_, entry->header_offset_, entry->header_size_,
+         [this, key, varied, entry = entry.value(),
+          cb = std::move(cb)](absl::StatusOr<Buffer::InstancePtr> data) mutable {
+           onHeadersRead(key, varied, entry, std::move(data), std::move(cb));
+         });
+  }
+
+  void onHeadersRead(const Key& key, bool varied, const IndexEntry& entry,
+                     absl::StatusOr<Buffer::InstancePtr> data, LookupHeadersCallback&& cb) {
+    CacheFileHeader header;
+    if (!data.ok() || data.value()->length() != entry.header_size_ ||
+        !header.ParseFromString(data.value()->toString())) {
+      cache_.stats().read_errors_.inc();
+      cache_.stats().misses_.inc();
+      cb(LookupResult{});
+      return;
+    }
+    if (!Protobuf::util::MessageDifferencer::Equals(header.key(), key)) {
+      // Another key with the same hash.
+      cache_.stats().misses_.inc();
+      cb(LookupResult{});
+      return;
+    }
+    Http::ResponseHeaderMapPtr response_headers =
+        headersFromProto<Http::ResponseHeaderMapImpl>(header.headers());
+    if (!varied && VaryHeaderUtils::hasVary(*response_headers)) {
+      const absl::optional<std::string> vary_identifier = VaryHeaderUtils::createVaryIdentifier(
+          request_.varyAllowList(), VaryHeaderUtils::getVaryValues(*response_headers),
+          request_.requestHeaders());
+      if (!vary_identifier.has_value()) {
+        // The vary allow list has changed and has made the vary header of this
+        // cached value not cacheable.
+        cache_.stats().misses_.inc();
+        cb(LookupResult{});
+        return;
+      }
+      Key varied_key = key;
+      varied_key.add_custom_fields(vary_identifier.value());
+      lookup(varied_key, /*varied=*/true, std::move(cb));
+      return;
+    }
+
+    if (entry.body_size_ == 0 && entry.trailers_size_ == 0) {
+      onHit(entry, std::move(header), std::move(cb));
+      return;
+    }
+    // A headers update leaves the body in an older segment, which may be evicted before getBody()
+    // is called. Opening it now keeps it readable.
+    openSegment(entry.body_segment_, [this, entry, header = std::move(header),
+                                      cb = std::move(cb)](absl::Status status) mutable {
+      if (!status.ok()) {
+        // The segment has already been evicted.
+        cache_.stats().misses_.inc();
+        cb(LookupResult{});
+        return;
+      }
+      onHit(entry, std::move(header), std::move(cb));
+    });
+  }
+
+  void onHit(const IndexEntry& entry, CacheFileHeader&& header, LookupHeadersCallback&& cb) {
+    cache_.stats().hits_.inc();
+    entry_ = entry;
+    header_ = std::move(header);
+    cb(request_.makeLookupResult(headersFromProto<Http::ResponseHeaderMapImpl>(header_.headers()),
+                                 ResponseMetadata{timestampToSystemTime(header_.response_time())},
+                                 entry.body_size_, entry.trailers_size_ > 0));
+  }
+
+  // Makes the segment the open one, which stays readable once evicted, then calls on_open with
+  // the result. on_open is called from a thread of the AsyncFileManager, or directly if the
+  // segment is already open, unless the context has been destroyed.
+  void openSegment(uint32_t segment, std::function<void(absl::Status)> on_open) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (destroyed_) {
+        return;
+      }
+      if (handle_ == nullptr || handle_segment_ != segment) {
+        if (handle_ != nullptr) {
+          handle_->close([](absl::Status) {}).IgnoreError();
+          handle_ = nullptr;
+        }
+        // Callbacks leave cancel_in_flight_ set, so that onDestroy() waits for them to return.
+        cancel_in_flight_ = cache_.asyncFileManager().openExistingFile(
+            cache_.segmentPath(segment), AsyncFileManager::Mode::ReadOnly,
+            [this, segment, on_open = std::move(on_open)](absl::StatusOr<AsyncFileHandle> handle) {
+              {
+                absl::MutexLock lock(&mutex_);
+                if (destroyed_) {
+                  if (handle.ok()) {
+                    handle.value()->close([](absl::Status) {}).IgnoreError();
+                  }
+                  return;
+                }
+                if (handle.ok()) {
+                  handle_ = std::move(handle.value());
+                  handle_segment_ = segment;
+                }
+              }
+              // The segment may have been evicted since the index was consulted.
+              on_open(handle.status());
+            });
+        return;
+      }
+    }
+    on_open(absl::OkStatus());
+  }
+
+  // Reads from a segment, keeping it open for the next reads. on_read is called from a thread of
+  // the AsyncFileManager, unless the context has been destroyed.
+  void read(uint32_t segment, uint64_t offset, uint64_t length,
+            std::function<void(absl::StatusOr<Buffer::InstancePtr>)> on_read) {
+    openSegment(segment, [this, offset, length, on_read = std::move(on_read)](absl::Status status) {
+      if (!status.ok()) {
+        on_read(status);
+        return;
+      }
+      auto on_read_done = [this, on_read](absl::StatusOr<Buffer::InstancePtr> result) {
+        {
+          absl::MutexLock lock(&mutex_);
+          if (destroyed_) {
+            return;
+          }
+        }
+        on_read(std::move(result));
+      };
+      absl::MutexLock lock(&mutex_);
+      if (destroyed_) {
+        return;
+      }
+      auto queued = handle_->read(offset, length, std::move(on_read_done));
+      ASSERT(queued.ok());
+      cancel_in_flight_ = queued.value();
+    });
+  }
+
+  FileSystemHttpCache& cache_;
+  const LookupRequest request_;
+  absl::optional<IndexEntry> entry_;
+  CacheFileHeader header_;
+
+  absl::Mutex mutex_;
+  AsyncFileHandle handle_ ABSL_GUARDED_BY(mutex_);
+  uint32_t handle_segment_ ABSL_GUARDED_BY(mutex_) = 0;
+  CancelFunction cancel_in_flight_ ABSL_GUARDED_BY(mutex_);
+  bool destroyed_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// Buffers the response, and hands it to the cache to be written once complete.
+class FileInsertContext : public InsertContext {
+public:
+  FileInsertContext(FileSystemHttpCache& cache, LookupContextPtr&& lookup_context)
+      : cache_(cache), lookup_context_(std::move(lookup_context)),
+        max_entry_size_bytes_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(
+            cache.config(), max_entry_size_bytes, DefaultMaxEntrySizeBytes)) {}
+
+  void insertHeaders(const Http::ResponseHeaderMap& response_headers,
+                     const ResponseMetadata& metadata, bool end_stream) override {
+    ASSERT(!committed_);
+    response_headers_ = Http::createHeaderMap<Http::ResponseHeaderMapImpl>(response_headers);
+    metadata_ = metadata;
+    if (end_stream) {
+      commit();
+    }
+  }
+
+  void insertBody(const Buffer::Instance& chunk, InsertCallback ready_for_next_chunk,
+                  bool end_stream) override {
+    ASSERT(!committed_);
+    ASSERT(ready_for_next_chunk || end_stream);
+    if (!aborted_ && body_.length() + chunk.length() > max_entry_size_bytes_) {
+      cache_.stats().insert_rejected_.inc();
+      aborted_ = true;
+      body_.drain(body_.length());
+    }
+    if (aborted_) {
+      if (ready_for_next_chunk) {
+        ready_for_next_chunk(false);
+      }
+      return;
+    }
+
+    body_.add(chunk);
+    if (end_stream) {
+      commit();
+    } else {
+      ready_for_next_chunk(true);
+    }
+  }
+
+  void insertTrailers(const Http::ResponseTrailerMap& trailers) override {
+    ASSERT(!committed_);
+    trailers_ = Http::createHeaderMap<Http::ResponseTrailerMapImpl>(trailers);
+    commit();
+  }
+
+  void onDestroy() override { lookup_context_->onDestroy(); }
+
+private:
+  void commit() {
+    committed_ = true;
+    if (aborted_) {
+      return;
+    }
+    const LookupRequest& request = static_cast<FileLookupContext&>(*lookup_context_).request();
+    Key key = request.key();
+    if (VaryHeaderUtils::hasVary(*response_headers_)) {
+      const absl::btree_set<absl::string_view> vary_header_values =
+          VaryHeaderUtils::getVaryValues(*response_headers_);
+      const absl::optional<std::string> vary_identifier = VaryHeaderUtils::createVaryIdentifier(
+          request.varyAllowList(), vary_header_values, request.requestHeaders());
+      if (!vary_identifier.has_value()) {
+        // Skip the insert if we are unable to create a vary key.
+        return;
+      }
+      // Record under the request's key which headers the response varies on.
+      Http::ResponseHeaderMapPtr vary_only_map =
+          Http::createHeaderMap<Http::ResponseHeaderMapImpl>({});
+      vary_only_map->setCopy(Http::CustomHeaders::get().Vary,
+                             absl::StrJoin(vary_header_values, ","));
+      SegmentWrite vary_write = makeHeadersWrite(key, *vary_only_map, metadata_);
+      vary_write.entry_.body_size_ = 0;
+      vary_write.headers_only_ = false;
+      cache_.write(std::move(vary_write));
+      key.add_custom_fields(vary_identifier.value());
+    }
+
+    SegmentWrite write = makeHeadersWrite(key, *response_headers_, metadata_);
+    write.headers_only_ = false;
+    write.entry_.body_size_ = body_.length();
+    write.data_->move(body_);
+    if (trailers_ != nullptr) {
+      CacheFileTrailer trailer;
+      headersToProto(*trailers_, *trailer.mutable_trailers());
+      const std::string serialized = trailer.SerializeAsString();
+      write.entry_.trailers_size_ = serialized.size();
+      write.data_->add(serialized);
+    }
+    cache_.write(std::move(write));
+  }
+
+  FileSystemHttpCache& cache_;
+  // Owns the request being answered.
+  const LookupContextPtr lookup_context_;
+  const uint64_t max_entry_size_bytes_;
+  Http::ResponseHeaderMapPtr response_headers_;
+  ResponseMetadata metadata_;
+  Buffer::OwnedImpl body_;
+  Http::ResponseTrailerMapPtr trailers_;
+  bool aborted_ = false;
+  bool committed_ = false;
+};
+
+} // namespace
+
+FileSystemHttpCache::FileSystemHttpCache(std::shared_ptr<AsyncFileManagerFactory> factory,
+                                         std::shared_ptr<AsyncFileManager> async_file_manager,
+                                         const ConfigProto& config,
+                                         std::unique_ptr<CacheIndex> index, Stats::Scope& scope)
+    : factory_(std::move(factory)), async_file_manager_(std::move(async_file_manager)),
+      config_(config), segment_size_bytes_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(
+                           config, segment_size_bytes, DefaultSegmentSizeBytes)),
+      max_segments_(std::clamp<uint64_t>(
+          PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_cache_size_bytes, DefaultMaxCacheSizeBytes) /
+              segment_size_bytes_,
+          2, std::numeric_limits<uint32_t>::max())),
+      max_queued_bytes_(4 * PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_entry_size_bytes,
+                                                            DefaultMaxEntrySizeBytes)),
+      stats_({ALL_FILE_SYSTEM_HTTP_CACHE_STATS(
+          POOL_COUNTER_PREFIX(scope, "cache.file_system_http_cache."))}),
+      index_(std::move(index)) {
+  absl::MutexLock lock(&mutex_);
+  if (!index_->tryLock()) {
+    // The previous Envoy of a hot restart still owns the index, and keeps it consistent.
+    return;
+  }
+  // Forget the responses of segment files which have been removed behind our back.
+  Api::OsSysCalls& os_sys_calls = Api::OsSysCallsSingleton::get();
+  absl::flat_hash_set<uint32_t> missing_segments;
+  for (uint32_t segment = index_->oldestSegment(); segment <= index_->newestSegment();
+       segment++) {
+    struct stat segment_stat;
+    if (os_sys_calls.stat(segmentPath(segment).c_str(), &segment_stat).return_value_ == -1) {
+      missing_segments.insert(segment);
+    }
+  }
+  if (!missing_segments.empty()) {
+    // Nothing looks up the cache yet, so it is swept at once.
+    index_->removeIf(
+        [&missing_segments](const IndexEntry& entry) {
+          return missing_segments.contains(entry.header_segment_) ||
+                 missing_segments.contains(entry.body_segment_);
+        },
+        0, index_->capacity());
+  }
+}
+
+FileSystemHttpCache::~FileSystemHttpCache() {
+  CancelFunction cancel;
+  {
+    absl::MutexLock lock(&mutex_);
+    destroying_ = true;
+    cancel = std::exchange(cancel_in_flight_, nullptr);
+  }
+  // A callback running during the first cancellation may have queued another action, which
+  // doesn't queue any more since destroying_ is set.
+  while (cancel) {
+    cancel();
+    absl::MutexLock lock(&mutex_);
+    cancel = std::exchange(cancel_in_flight_, nullptr);
+  }
+  absl::MutexLock lock(&mutex_);
+  if (segment_handle_ != nullptr) {
+    segment_handle_->close([](absl::Status) {}).IgnoreError();
+  }
+}
+
+LookupContextPtr FileSystemHttpCache::makeLookupContext(LookupRequest&& request,
+                                                        Http::StreamDecoderFilterCallbacks&) {
+  return std::make_unique<FileLookupContext>(*this, std::move(request));
+}
+
+InsertContextPtr FileSystemHttpCache::makeInsertContext(LookupContextPtr&& lookup_context,
+                                                        Http::StreamEncoderFilterCallbacks&) {
+  ASSERT(lookup_context != nullptr);
+  return std::make_unique<FileInsertContext>(*this, std::move(lookup_context));
+}
+
+void FileSystemHttpCache::updateHeaders(const LookupContext& lookup_context,
+                                        const Http::ResponseHeaderMap& response_headers,
+                                        const ResponseMetadata& metadata) {
+  const auto& context = static_cast<const FileLookupContext&>(lookup_context);
+  if (!context.entry().has_value()) {
+    return;
+  }
+  // For a varied response, the key of the looked up response is the request key extended with
+  // the values of the headers it varies on.
+  const Key& key = context.header().key();
+  const IndexEntry& entry = context.entry().value();
+  Http::ResponseHeaderMapPtr cached_headers =
+      headersFromProto<Http::ResponseHeaderMapImpl>(context.header().headers());
+  // The vary header isn't updated: a validation changing the headers the response varies on
+  // makes its key wrong, so the response is dropped instead.
+  if (VaryHeaderUtils::hasVary(response_headers) &&
+      VaryHeaderUtils::getVaryValues(response_headers) !=
+          VaryHeaderUtils::getVaryValues(*cached_headers)) {
+    remove(stableHashKey(key), entry);
+    return;
+  }
+  CacheHeadersUtils::updateCachedResponseHeaders(*cached_headers, response_headers);
+
+  // The body stays where it is; only the headers are appended.
+  SegmentWrite write = makeHeadersWrite(key, *cached_headers, metadata);
+  write.entry_.body_segment_ = entry.body_segment_;
+  write.entry_.body_offset_ = entry.body_offset_;
+  write.entry_.body_size_ = entry.body_size_;
+  write.entry_.trailers_size_ = entry.trailers_size_;
+  this->write(std::move(write));
+}
+
+CacheInfo FileSystemHttpCache::cacheInfo() const {
+  CacheInfo cache_info;
+  cache_info.name_ = Name;
+  cache_info.supports_range_requests_ = true;
+  return cache_info;
+}
+
+absl::optional<IndexEntry> FileSystemHttpCache::find(uint64_t key_hash) {
+  absl::ReaderMutexLock lock(&mutex_);
+  return index_->find(key_hash);
+}
+
+void FileSystemHttpCache::remove(uint64_t key_hash, const IndexEntry& entry) {
+  absl::MutexLock lock(&mutex_);
+  if (destroying_ || !index_->tryLock()) {
+    return;
+  }
+  // Leave alone a newer response written since the lookup.
+  const absl::optional<IndexEntry> current = index_->find(key_hash);
+  if (current.has_value() && current->header_segment_ == entry.header_segment_ &&
+      current->header_offset_ == entry.header_offset_) {
+    index_->remove(key_hash);
+  }
+}
+
+std::string FileSystemHttpCache::segmentPath(uint32_t segment) const {
+  return fmt::format("{}/segment-{:08}", config_.cache_path(), segment);
+}
+
+void FileSystemHttpCache::write(SegmentWrite&& write) {
+  absl::MutexLock lock(&mutex_);
+  const uint64_t size = write.data_->length();
+  if (destroying_ || queued_bytes_ + size > max_queued_bytes_ || !index_->tryLock()) {
+    stats_.insert_rejected_.inc();
+    return;
+  }
+  queued_writes_.push_back(std::move(write));
+  queued_bytes_ += size;
+  if (!writing_) {
+    writing_ = true;
+    startNextWrite();
+  }
+}
+
+void FileSystemHttpCache::startNextWrite() {
+  if (destroying_ || queued_writes_.empty()) {
+    writing_ = false;
+    return;
+  }
+  if (segment_handle_ == nullptr || segment_offset_ >= segment_size_bytes_) {
+    startSegment();
+    return;
+  }
+  SegmentWrite& write = queued_writes_.front();
+  write_size_ = write.data_->length();
+  auto queued = segment_handle_->write(
+      *write.data_, segment_offset_,
+      [this](absl::StatusOr<size_t> result) { onWriteComplete(std::move(result)); });
+  ASSERT(queued.ok());
+  cancel_in_flight_ = queued.value();
+}
+
+void FileSystemHttpCache::onWriteComplete(absl::StatusOr<size_t> result) {
+  absl::MutexLock lock(&mutex_);
+  cancel_in_flight_ = nullptr;
+  if (destroying_) {
+    return;
+  }
+  SegmentWrite write = std::move(queued_writes_.front());
+  queued_writes_.pop_front();
+  queued_bytes_ -= write_size_;
+
+  if (!result.ok() || result.value() != write_size_) {
+    stats_.write_errors_.inc();
+    // Don't append after a partial write.
+    segment_offset_ = segment_size_bytes_;
+  } else {
+    const uint32_t segment = index_->newestSegment();
+    write.entry_.header_segment_ = segment;
+    write.entry_.header_offset_ = segment_offset_;
+    if (!write.headers_only_) {
+      write.entry_.body_segment_ = segment;
+      write.entry_.body_offset_ = segment_offset_ + write.entry_.header_size_;
+    }
+    segment_offset_ += write_size_;
+    // The body of a headers update may have been evicted while it was queued.
+    if (write.entry_.body_segment_ >= index_->oldestSegment() &&
+        index_->insert(write.key_hash_, write.entry_)) {
+      stats_.inserts_.inc();
+    } else {
+      stats_.insert_rejected_.inc();
+    }
+  }
+  sweepEvictedEntries();
+  startNextWrite();
+}
+
+void FileSystemHttpCache::startSegment() {
+  if (segment_handle_ != nullptr) {
+    segment_handle_->close([](absl::Status) {}).IgnoreError();
+    segment_handle_ = nullptr;
+  }
+  const uint32_t segment = index_->newestSegment() + 1;
+  // A file left over by a process which stopped before recording it in the index would keep the
+  // new segment from being linked.
+  cancel_in_flight_ =
+      async_file_manager_->unlink(segmentPath(segment), [this, segment](absl::Status) {
+        absl::MutexLock lock(&mutex_);
+        cancel_in_flight_ = nullptr;
+        if (destroying_) {
+          return;
+        }
+        cancel_in_flight_ = async_file_manager_->createAnonymousFile(
+            config_.cache_path(), [this, segment](absl::StatusOr<AsyncFileHandle> handle) {
+              onSegmentCreated(segment, std::move(handle));
+            });
+      });
+}
+
+void FileSystemHttpCache::onSegmentCreated(uint32_t segment,
+                                           absl::StatusOr<AsyncFileHandle> handle) {
+  absl::MutexLock lock(&mutex_);
+  cancel_in_flight_ = nullptr;
+  if (destroying_) {
+    if (handle.ok()) {
+      handle.value()->close([](absl::Status) {}).IgnoreError();
+    }
+    return;
+  }
+  if (!handle.ok()) {
+    stats_.write_errors_.inc();
+    failQueuedWrites();
+    return;
+  }
+  // Owned by the cache until linked, so that it is closed if the cache is destroyed meanwhile.
+  // segment_offset_ keeps it from being written to.
+  segment_handle_ = std::move(handle.value());
+  segment_offset_ = segment_size_bytes_;
+  auto queued = segment_handle_->createHardLink(
+      segmentPath(segment),
+      [this, segment](absl::Status status) { onSegmentLinked(segment, status); });
+  ASSERT(queued.ok());
+  cancel_in_flight_ = queued.value();
+}
+
+void FileSystemHttpCache::onSegmentLinked(uint32_t segment, absl::Status status) {
+  absl::MutexLock lock(&mutex_);
+  cancel_in_flight_ = nullptr;
+  if (destroying_) {
+    return;
+  }
+  if (!status.ok()) {
+    segment_handle_->close([](absl::Status) {}).IgnoreError();
+    segment_handle_ = nullptr;
+    stats_.write_errors_.inc();
+    failQueuedWrites();
+    return;
+  }
+  segment_offset_ = 0;
+  index_->setNewestSegment(segment);
+  evictSegments();
+  sweepEvictedEntries();
+  startNextWrite();
+}
+
+void FileSystemHttpCache::failQueuedWrites() {
+  queued_writes_.clear();
+  queued_bytes_ = 0;
+  writing_ = false;
+}
+
+void FileSystemHttpCache::evictSegments() {
+  while (index_->newestSegment() - index_->oldestSegment() + 1 > max_segments_) {
+    const uint32_t segment = index_->oldestSegment();
+    // Lookups stop finding the entries of the segment at once; sweepEvictedEntries() then frees
+    // their slots.
+    index_->setOldestSegment(segment + 1);
+    sweep_position_ = 0;
+    // Lookups which already opened the segment can still read it.
+    async_file_manager_->unlink(segmentPath(segment), [](absl::Status) {});
+    stats_.evicted_segments_.inc();
+  }
+}
+
+void FileSystemHttpCache::sweepEvictedEntries() {
+  if (sweep_position_ >= index_->capacity()) {
+    return;
+  }
+  const uint32_t oldest_segment = index_->oldestSegment();
+  sweep_position_ = index_->removeIf(
+      [oldest_segment](const IndexEntry& entry) {
+        return entry.header_segment_ < oldest_segment || entry.body_segment_ < oldest_segment;
+      },
+      sweep_position_, SweepBatchSlots);
+}
+
+// Shares a cache between all the filters configured with the same settings. When the settings of
+// a cache_path change, e.g. through a listener update while the previous listener drains, a new
+// cache is created next to the one still in use. The two hand the directory over the way the
+// Envoys of a hot restart do: the new cache serves lookups from the shared index, and starts
+// inserting once the old one is destroyed and it gets the lock on the index file.
+class FileSystemHttpCacheRegistry {
+public:
+  std::shared_ptr<FileSystemHttpCache> get(const ConfigProto& config,
+                                           Server::Configuration::FactoryContext& context) {
+    absl::MutexLock lock(&mutex_);
+    std::vector<CacheEntry>& entries = caches_[config.cache_path()];
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const CacheEntry& entry) { return entry.cache_.expired(); }),
+                  entries.end());
+    uint32_t max_entries = PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_entries, DefaultMaxEntries);
+    for (const CacheEntry& entry : entries) {
+      if (Protobuf::util::MessageDifferencer::Equivalent(entry.config_, config)) {
+        if (std::shared_ptr<FileSystemHttpCache> existing = entry.cache_.lock()) {
+          return existing;
+        }
+      }
+    }
+    // The index file can't be resized while another cache maps it, so keep its capacity.
+    if (!entries.empty() && entries.back().max_entries_ != max_entries) {
+      ENVOY_LOG_MISC(warn,
+                     "file system http cache at {} keeps max_entries {} until Envoy restarts, as "
+                     "the index file is still in use",
+                     config.cache_path(), entries.back().max_entries_);
+      max_entries = entries.back().max_entries_;
+    }
+    auto factory = AsyncFileManagerFactory::singleton(&context.singletonManager());
+    auto manager = factory->getAsyncFileManager(config.manager_config());
+    absl::StatusOr<std::unique_ptr<CacheIndex>> index =
+        CacheIndex::open(absl::StrCat(config.cache_path(), "/index"), max_entries);
+    if (!index.ok()) {
+      throw EnvoyException(std::string(index.status().message()));
+    }
+    auto created = std::make_shared<FileSystemHttpCache>(
+        std::move(factory), std::move(manager), config, std::move(index.value()),
+        context.getServerFactoryContext().scope());
+    entries.push_back({created, config, max_entries});
+    return created;
+  }
+
+private:
+  struct CacheEntry {
+    std::weak_ptr<FileSystemHttpCache> cache_;
+    ConfigProto config_;
+    // Capacity of the index, which differs from the configured one if it was already mapped.
+    uint32_t max_entries_;
+  };
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, std::vector<CacheEntry>> caches_ ABSL_GUARDED_BY(mutex_);
+};
+
+class FileSystemHttpCacheFactory : public HttpCacheFactory {
+public:
+  // From UntypedFactory
+  std::string name() const override { return std::string(Name); }
+  // From TypedFactory
+  ProtobufTypes::MessagePtr createEmptyConfigProto() override {
+    return std::make_unique<ConfigProto>();
+  }
+  // From HttpCacheFactory
+  std::shared_ptr<HttpCache>
+  getCache(const envoy::extensions::filters::http::cache::v3::CacheConfig& filter_config,
+           Server::Configuration::FactoryContext& context) override {
+    ConfigProto config;
+    MessageUtil::anyConvertAndValidate(filter_config.typed_config(), config,
+                                       context.messageValidationVisitor());
+    return registry_.get(config, context);
+  }
+
+private:
+  FileSystemHttpCacheRegistry registry_;
+};
+
+static Registry::RegisterFactory<FileSystemHttpCacheFactory, HttpCacheFactory> register_;
+
+} // namespace FileSystemHttpCache
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
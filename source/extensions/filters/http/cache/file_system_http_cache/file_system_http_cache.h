@@ -0,0 +1,143 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "envoy/buffer/buffer.h"
+#include "envoy/extensions/cache/file_system_http_cache/v3/config.pb.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "source/extensions/common/async_files/async_file_manager.h"
+#include "source/extensions/common/async_files/async_file_manager_factory.h"
+#include "source/extensions/filters/http/cache/file_system_http_cache/cache_index.h"
+#include "source/extensions/filters/http/cache/http_cache.h"
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+namespace FileSystemHttpCache {
+
+/**
+ * All stats for the file system http cache. @see stats_macros.h
+ */
+#define ALL_FILE_SYSTEM_HTTP_CACHE_STATS(COUNTER)                                                  \
+  COUNTER(evicted_segments)                                                                        \
+  COUNTER(hits)                                                                                    \
+  COUNTER(insert_rejected)                                                                         \
+  COUNTER(inserts)                                                                                 \
+  COUNTER(misses)                                                                                  \
+  COUNTER(read_errors)                                                                             \
+  COUNTER(write_errors)
+
+/**
+ * Struct definition for all file system http cache stats. @see stats_macros.h
+ */
+struct FileSystemHttpCacheStats {
+  ALL_FILE_SYSTEM_HTTP_CACHE_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+using ConfigProto = envoy::extensions::cache::file_system_http_cache::v3::FileSystemHttpCacheConfig;
+
+// A record to append to the current segment: the serialized CacheFileHeader, followed for a new
+// response by its body and serialized CacheFileTrailer.
+struct SegmentWrite {
+  uint64_t key_hash_;
+  Buffer::InstancePtr data_;
+  // Sizes and, for a headers update, location of the response. The location of the headers, and
+  // of the body for a new response, is filled in once the record is written.
+  IndexEntry entry_;
+  bool headers_only_;
+};
+
+// HttpCache storing responses in append-only segment files, located through a memory mapped
+// CacheIndex. Lookups only take a shared lock to consult the index; all file operations are done
+// by an AsyncFileManager.
+//
+// Records are appended one at a time to the newest segment, and only become visible to lookups
+// once written. When a segment reaches segment_size_bytes a new one is started, and once there
+// are more segments than fit in max_cache_size_bytes, the oldest one is deleted. The index entries
+// referencing it are no longer found, and are removed a batch of slots per write.
+class FileSystemHttpCache : public HttpCache {
+public:
+  FileSystemHttpCache(std::shared_ptr<Common::AsyncFiles::AsyncFileManagerFactory> factory,
+                      std::shared_ptr<Common::AsyncFiles::AsyncFileManager> async_file_manager,
+                      const ConfigProto& config, std::unique_ptr<CacheIndex> index,
+                      Stats::Scope& scope);
+  // Cancels the write in flight, if any, and drops the queued ones.
+  ~FileSystemHttpCache() override;
+
+  // HttpCache
+  LookupContextPtr makeLookupContext(LookupRequest&& request,
+                                     Http::StreamDecoderFilterCallbacks& callbacks) override;
+  InsertContextPtr makeInsertContext(LookupContextPtr&& lookup_context,
+                                     Http::StreamEncoderFilterCallbacks& callbacks) override;
+  void updateHeaders(const LookupContext& lookup_context,
+                     const Http::ResponseHeaderMap& response_headers,
+                     const ResponseMetadata& metadata) override;
+  CacheInfo cacheInfo() const override;
+
+  absl::optional<IndexEntry> find(uint64_t key_hash);
+  // Queues a record to be appended to the newest segment. Dropped if another process, e.g. the
+  // previous Envoy of a hot restart, still owns the index.
+  void write(SegmentWrite&& write);
+  // Removes the entry of the key, unless it has been replaced by another one since it was found.
+  void remove(uint64_t key_hash, const IndexEntry& entry);
+
+  std::string segmentPath(uint32_t segment) const;
+  const ConfigProto& config() const { return config_; }
+  Common::AsyncFiles::AsyncFileManager& asyncFileManager() { return *async_file_manager_; }
+  FileSystemHttpCacheStats& stats() { return stats_; }
+
+private:
+  void startNextWrite() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void onWriteComplete(absl::StatusOr<size_t> result);
+  // Starts a new segment, replacing any leftover file of the same name, then resumes writing.
+  void startSegment() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void onSegmentCreated(uint32_t segment,
+                        absl::StatusOr<Common::AsyncFiles::AsyncFileHandle> handle);
+  void onSegmentLinked(uint32_t segment, absl::Status status);
+  void failQueuedWrites() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void evictSegments() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Removes the index entries of evicted segments from the next batch of slots, if any.
+  void sweepEvictedEntries() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // The factory must outlive the manager it created.
+  const std::shared_ptr<Common::AsyncFiles::AsyncFileManagerFactory> factory_;
+  const std::shared_ptr<Common::AsyncFiles::AsyncFileManager> async_file_manager_;
+  const ConfigProto config_;
+  const uint64_t segment_size_bytes_;
+  const uint32_t max_segments_;
+  const uint64_t max_queued_bytes_;
+  FileSystemHttpCacheStats stats_;
+
+  absl::Mutex mutex_;
+  const std::unique_ptr<CacheIndex> index_ ABSL_PT_GUARDED_BY(mutex_);
+  std::deque<SegmentWrite> queued_writes_ ABSL_GUARDED_BY(mutex_);
+  // Whether the front of queued_writes_ is being written, or a segment being started for it.
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  uint64_t write_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Bytes of queued_writes_, bounded to keep a slow disk from using unbounded memory.
+  uint64_t queued_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  Common::AsyncFiles::CancelFunction cancel_in_flight_ ABSL_GUARDED_BY(mutex_);
+  bool destroying_ ABSL_GUARDED_BY(mutex_) = false;
+  // The newest segment, which is appended to, or nullptr if it isn't open yet. Also owns a new
+  // segment until it is linked into the cache directory.
+  Common::AsyncFiles::AsyncFileHandle segment_handle_ ABSL_GUARDED_BY(mutex_);
+  uint64_t segment_offset_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The next index slot to sweep for entries of evicted segments, or the capacity of the index
+  // once swept. The index is swept once on start, in case a previous process was stopped while
+  // sweeping.
+  uint32_t sweep_position_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+} // namespace FileSystemHttpCache
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -181,7 +181,6 @@ public:
   virtual void getHeaders(LookupHeadersCallback&& cb) PURE;
 
   // Reads the next chunk from the cache, calling cb when the chunk is ready.
-  // The Buffer::InstancePtr passed to cb must not be null.
   //
   // The cache must call cb with a range of bytes starting at range.start() and
   // ending at or before range.end(). Caller is responsible for tracking what
@@ -0,0 +1,72 @@
+#include "source/extensions/filters/http/cache/memory_http_cache/frequency_sketch.h"
+
+#include <algorithm>
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+namespace {
+
+uint64_t roundUpToPowerOfTwo(uint64_t value) {
+  uint64_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+// Seeds giving each row an independent index for the same hash.
+constexpr uint64_t RowSeeds[] = {0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+                                 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+
+} // namespace
+
+FrequencySketch::FrequencySketch(uint64_t width)
+    : mask_(roundUpToPowerOfTwo(std::max<uint64_t>(width, 16)) - 1),
+      sample_size_(10 * (mask_ + 1)),
+      counters_(new std::atomic<uint8_t>[Depth * (mask_ + 1)]) {
+  for (uint64_t i = 0; i < Depth * (mask_ + 1); i++) {
+    counters_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+std::atomic<uint8_t>& FrequencySketch::counter(uint32_t row, uint64_t hash) const {
+  uint64_t index = (hash ^ RowSeeds[row]) * 0x9e3779b97f4a7c15ULL;
+  index ^= index >> 32;
+  return counters_[row * (mask_ + 1) + (index & mask_)];
+}
+
+void FrequencySketch::increment(uint64_t hash) {
+  for (uint32_t row = 0; row < Depth; row++) {
+    std::atomic<uint8_t>& count = counter(row, hash);
+    if (count.load(std::memory_order_relaxed) < MaxCount) {
+      count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  // Exactly one caller sees the count reach the sample size.
+  if (additions_.fetch_add(1, std::memory_order_relaxed) + 1 == sample_size_) {
+    halve();
+    additions_.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint32_t FrequencySketch::estimate(uint64_t hash) const {
+  uint32_t result = MaxCount;
+  for (uint32_t row = 0; row < Depth; row++) {
+    result = std::min<uint32_t>(result, counter(row, hash).load(std::memory_order_relaxed));
+  }
+  return result;
+}
+
+void FrequencySketch::halve() {
+  for (uint64_t i = 0; i < Depth * (mask_ + 1); i++) {
+    counters_[i].store(counters_[i].load(std::memory_order_relaxed) / 2,
+                       std::memory_order_relaxed);
+  }
+}
+
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+
+/**
+ * Count-min sketch of 4 rows of small saturating counters, estimating how often keys have been
+ * seen recently, as used by TinyLFU admission. Counters are halved once the number of increments
+ * reaches ten times the width of the sketch, so that old popularity fades away.
+ *
+ * increment() and estimate() may be called concurrently. Concurrent increments of the same
+ * counter may be lost, which only makes the estimates slightly less accurate.
+ */
+class FrequencySketch {
+public:
+  /**
+   * @param width the number of counters per row, rounded up to a power of two. It should be in the
+   *        order of the number of entries of the cache.
+   */
+  explicit FrequencySketch(uint64_t width);
+
+  /**
+   * Records an occurrence of the key with the given hash.
+   */
+  void increment(uint64_t hash);
+
+  /**
+   * @return the estimated number of recent occurrences of the key with the given hash, at most
+   *         MaxCount.
+   */
+  uint32_t estimate(uint64_t hash) const;
+
+  static constexpr uint32_t MaxCount = 15;
+
+private:
+  static constexpr uint32_t Depth = 4;
+
+  std::atomic<uint8_t>& counter(uint32_t row, uint64_t hash) const;
+  void halve();
+
+  const uint64_t mask_;
+  const uint64_t sample_size_;
+  const std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+  std::atomic<uint64_t> additions_{0};
+};
+
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
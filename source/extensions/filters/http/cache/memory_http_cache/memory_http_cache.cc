@@ -0,0 +1,445 @@
+#include "source/extensions/filters/http/cache/memory_http_cache/memory_http_cache.h"
+
+#include <algorithm>
+
+#include "envoy/buffer/buffer.h"
+#include "envoy/extensions/cache/memory_http_cache/v3/config.pb.h"
+#include "envoy/extensions/cache/memory_http_cache/v3/config.pb.validate.h"
+#include "envoy/registry/registry.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/http/header_map_impl.h"
+#include "source/common/http/headers.h"
+
+#include "absl/container/btree_set.h"
+#include "absl/strings/str_join.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+namespace {
+
+constexpr uint64_t DefaultMaxSizeBytes = 64 * 1024 * 1024;
+constexpr uint32_t DefaultShards = 16;
+// Expected average size of an entry, used to size the frequency sketch of each shard.
+constexpr uint64_t ExpectedEntrySizeBytes = 4096;
+constexpr uint64_t MaxSketchWidth = 1 << 20;
+
+// Exposes part of a cached body to a buffer without copying it. The body stays alive until the
+// buffer is done with the fragment, even if the entry is evicted in the meantime.
+class BodyFragment : public Buffer::BufferFragment {
+public:
+  BodyFragment(std::shared_ptr<const std::string> body, absl::string_view data)
+      : body_(std::move(body)), data_(data) {}
+
+  // Buffer::BufferFragment
+  const void* data() const override { return data_.data(); }
+  size_t size() const override { return data_.size(); }
+  void done() override { delete this; }
+
+private:
+  const std::shared_ptr<const std::string> body_;
+  const absl::string_view data_;
+};
+
+class MemoryLookupContext : public LookupContext {
+public:
+  MemoryLookupContext(MemoryHttpCache& cache, LookupRequest&& request)
+      : cache_(cache), request_(std::move(request)) {}
+
+  void getHeaders(LookupHeadersCallback&& cb) override {
+    entry_ = cache_.lookup(request_);
+    if (entry_ == nullptr) {
+      cb(LookupResult{});
+      return;
+    }
+    cb(request_.makeLookupResult(
+        Http::createHeaderMap<Http::ResponseHeaderMapImpl>(*entry_->response_headers_),
+        ResponseMetadata(entry_->metadata_), entry_->body_->size(), entry_->trailers_ != nullptr));
+  }
+
+  void getBody(const AdjustedByteRange& range, LookupBodyCallback&& cb) override {
+    ASSERT(entry_ != nullptr);
+    ASSERT(range.end() <= entry_->body_->size(), "Attempt to read past end of body.");
+    auto buffer = std::make_unique<Buffer::OwnedImpl>();
+    if (range.length() > 0) {
+      buffer->addBufferFragment(*new BodyFragment(
+          entry_->body_, absl::string_view(*entry_->body_).substr(range.begin(), range.length())));
+    }
+    cb(std::move(buffer));
+  }
+
+  void getTrailers(LookupTrailersCallback&& cb) override {
+    ASSERT(entry_ != nullptr && entry_->trailers_ != nullptr);
+    cb(Http::createHeaderMap<Http::ResponseTrailerMapImpl>(*entry_->trailers_));
+  }
+
+  const LookupRequest& request() const { return request_; }
+  // The entry found by getHeaders(), if any.
+  const MemoryHttpCache::EntrySharedPtr& entry() const { return entry_; }
+  void onDestroy() override {}
+
+private:
+  MemoryHttpCache& cache_;
+  const LookupRequest request_;
+  MemoryHttpCache::EntrySharedPtr entry_;
+};
+
+class MemoryInsertContext : public InsertContext {
+public:
+  MemoryInsertContext(LookupContext& lookup_context, MemoryHttpCache& cache)
+      : key_(dynamic_cast<MemoryLookupContext&>(lookup_context).request().key()),
+        request_headers_(
+            dynamic_cast<MemoryLookupContext&>(lookup_context).request().requestHeaders()),
+        vary_allow_list_(
+            dynamic_cast<MemoryLookupContext&>(lookup_context).request().varyAllowList()),
+        cache_(cache) {}
+
+  void insertHeaders(const Http::ResponseHeaderMap& response_headers,
+                     const ResponseMetadata& metadata, bool end_stream) override {
+    ASSERT(!committed_);
+    response_headers_ = Http::createHeaderMap<Http::ResponseHeaderMapImpl>(response_headers);
+    metadata_ = metadata;
+    if (end_stream) {
+      commit();
+    }
+  }
+
+  void insertBody(const Buffer::Instance& chunk, InsertCallback ready_for_next_chunk,
+                  bool end_stream) override {
+    ASSERT(!committed_);
+    ASSERT(ready_for_next_chunk || end_stream);
+
+    body_.add(chunk);
+    if (end_stream) {
+      commit();
+    } else {
+      ready_for_next_chunk(true);
+    }
+  }
+
+  void insertTrailers(const Http::ResponseTrailerMap& trailers) override {
+    ASSERT(!committed_);
+    trailers_ = Http::createHeaderMap<Http::ResponseTrailerMapImpl>(trailers);
+    commit();
+  }
+
+  void onDestroy() override {}
+
+private:
+  void commit() {
+    committed_ = true;
+    if (VaryHeaderUtils::hasVary(*response_headers_)) {
+      cache_.varyInsert(key_, std::move(response_headers_), std::move(metadata_), body_.toString(),
+                        request_headers_, vary_allow_list_, std::move(trailers_));
+    } else {
+      cache_.insert(key_, std::move(response_headers_), std::move(metadata_), body_.toString(),
+                    std::move(trailers_));
+    }
+  }
+
+  Key key_;
+  const Http::RequestHeaderMap& request_headers_;
+  const VaryAllowList& vary_allow_list_;
+  Http::ResponseHeaderMapPtr response_headers_;
+  ResponseMetadata metadata_;
+  MemoryHttpCache& cache_;
+  Buffer::OwnedImpl body_;
+  bool committed_ = false;
+  Http::ResponseTrailerMapPtr trailers_;
+};
+
+} // namespace
+
+MemoryHttpCache::MemoryHttpCache(
+    const envoy::extensions::cache::memory_http_cache::v3::MemoryHttpCacheConfig& config,
+    Stats::Scope& scope)
+    : shard_size_bytes_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_size_bytes,
+                                                        DefaultMaxSizeBytes) /
+                        PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, shards, DefaultShards)),
+      stats_({ALL_MEMORY_HTTP_CACHE_STATS(POOL_COUNTER_PREFIX(scope, "cache.memory_http_cache."),
+                                          POOL_GAUGE_PREFIX(scope, "cache.memory_http_cache."))}) {
+  const uint32_t shards = PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, shards, DefaultShards);
+  const uint64_t sketch_width =
+      std::min(std::max<uint64_t>(shard_size_bytes_ / ExpectedEntrySizeBytes, 1), MaxSketchWidth);
+  shards_.reserve(shards);
+  for (uint32_t i = 0; i < shards; i++) {
+    shards_.push_back(std::make_unique<Shard>(sketch_width));
+  }
+}
+
+LookupContextPtr MemoryHttpCache::makeLookupContext(LookupRequest&& request,
+                                                    Http::StreamDecoderFilterCallbacks&) {
+  return std::make_unique<MemoryLookupContext>(*this, std::move(request));
+}
+
+InsertContextPtr MemoryHttpCache::makeInsertContext(LookupContextPtr&& lookup_context,
+                                                    Http::StreamEncoderFilterCallbacks&) {
+  ASSERT(lookup_context != nullptr);
+  return std::make_unique<MemoryInsertContext>(*lookup_context, *this);
+}
+
+MemoryHttpCache::EntrySharedPtr MemoryHttpCache::find(const Key& key, uint64_t hash) {
+  Shard& shard = shardFor(hash);
+  // Misses count too: a response which keeps being requested becomes worth admitting.
+  shard.sketch_.increment(hash);
+  absl::ReaderMutexLock lock(&shard.mutex_);
+  auto iter = shard.map_.find(key);
+  if (iter == shard.map_.end()) {
+    return nullptr;
+  }
+  const EntrySharedPtr& entry = *iter->second;
+  entry->referenced_.store(true, std::memory_order_relaxed);
+  return entry;
+}
+
+MemoryHttpCache::EntrySharedPtr MemoryHttpCache::lookup(const LookupRequest& request) {
+  EntrySharedPtr entry = find(request.key(), stableHashKey(request.key()));
+  if (entry != nullptr && VaryHeaderUtils::hasVary(*entry->response_headers_)) {
+    Key varied_request_key = request.key();
+    const absl::optional<std::string> vary_identifier = VaryHeaderUtils::createVaryIdentifier(
+        request.varyAllowList(), VaryHeaderUtils::getVaryValues(*entry->response_headers_),
+        request.requestHeaders());
+    if (!vary_identifier.has_value()) {
+      // The vary allow list has changed and has made the vary header of this
+      // cached value not cacheable.
+      entry = nullptr;
+    } else {
+      varied_request_key.add_custom_fields(vary_identifier.value());
+      entry = find(varied_request_key, stableHashKey(varied_request_key));
+    }
+  }
+
+  if (entry == nullptr) {
+    stats_.misses_.inc();
+  } else {
+    stats_.hits_.inc();
+  }
+  return entry;
+}
+
+void MemoryHttpCache::insert(const Key& key, Http::ResponseHeaderMapPtr&& response_headers,
+                             ResponseMetadata&& metadata, std::string&& body,
+                             Http::ResponseTrailerMapPtr&& trailers) {
+  auto entry = std::make_shared<Entry>();
+  entry->key_ = key;
+  entry->hash_ = stableHashKey(key);
+  entry->response_headers_ = std::move(response_headers);
+  entry->metadata_ = std::move(metadata);
+  entry->body_ = std::make_shared<const std::string>(std::move(body));
+  entry->trailers_ = std::move(trailers);
+  insertEntry(std::move(entry));
+}
+
+void MemoryHttpCache::varyInsert(const Key& request_key,
+                                 Http::ResponseHeaderMapPtr&& response_headers,
+                                 ResponseMetadata&& metadata, std::string&& body,
+                                 const Http::RequestHeaderMap& request_headers,
+                                 const VaryAllowList& vary_allow_list,
+                                 Http::ResponseTrailerMapPtr&& trailers) {
+  absl::btree_set<absl::string_view> vary_header_values =
+      VaryHeaderUtils::getVaryValues(*response_headers);
+  ASSERT(!vary_header_values.empty());
+
+  Key varied_request_key = request_key;
+  const absl::optional<std::string> vary_identifier =
+      VaryHeaderUtils::createVaryIdentifier(vary_allow_list, vary_header_values, request_headers);
+  if (!vary_identifier.has_value()) {
+    // Skip the insert if we are unable to create a vary key.
+    return;
+  }
+  varied_request_key.add_custom_fields(vary_identifier.value());
+
+  // Add a special entry to flag that this request generates varied responses. It is replaced on
+  // every insert, so that it carries the latest set of vary headers.
+  Http::ResponseHeaderMapPtr vary_only_map =
+      Http::createHeaderMap<Http::ResponseHeaderMapImpl>({});
+  vary_only_map->setCopy(Http::CustomHeaders::get().Vary, absl::StrJoin(vary_header_values, ","));
+  insert(request_key, std::move(vary_only_map), {}, std::string(), nullptr);
+
+  // Insert the varied response.
+  insert(varied_request_key, std::move(response_headers), std::move(metadata), std::move(body),
+         std::move(trailers));
+}
+
+void MemoryHttpCache::insertEntry(std::shared_ptr<Entry>&& entry) {
+  entry->size_bytes_ = sizeof(Entry) + entry->key_.ByteSizeLong() +
+                       entry->response_headers_->byteSize() + entry->body_->size() +
+                       (entry->trailers_ != nullptr ? entry->trailers_->byteSize() : 0);
+  Shard& shard = shardFor(entry->hash_);
+  absl::WriterMutexLock lock(&shard.mutex_);
+
+  auto existing = shard.map_.find(entry->key_);
+  const bool replacing = existing != shard.map_.end();
+  if (replacing) {
+    // A newer response always replaces the cached one.
+    eraseEntry(shard, existing->second);
+  }
+
+  if (shard.size_bytes_ + entry->size_bytes_ > shard_size_bytes_) {
+    Victims victims;
+    if (!selectVictims(shard, shard.size_bytes_ + entry->size_bytes_ - shard_size_bytes_,
+                       victims)) {
+      stats_.insert_rejected_.inc();
+      return;
+    }
+    // TinyLFU admission: don't evict entries which have been more popular than the new one.
+    const uint32_t frequency = shard.sketch_.estimate(entry->hash_);
+    for (const EntryList::iterator& victim : victims.evicted_) {
+      if (!replacing && shard.sketch_.estimate((*victim)->hash_) > frequency) {
+        stats_.insert_rejected_.inc();
+        return;
+      }
+    }
+    evictVictims(shard, victims);
+  }
+
+  shard.size_bytes_ += entry->size_bytes_;
+  stats_.size_bytes_.add(entry->size_bytes_);
+  stats_.entries_.inc();
+  stats_.inserts_.inc();
+  shard.entries_.push_front(std::move(entry));
+  shard.map_.emplace(shard.entries_.front()->key_, shard.entries_.begin());
+}
+
+bool MemoryHttpCache::selectVictims(Shard& shard, uint64_t needed_bytes, Victims& victims) {
+  if (needed_bytes > shard.size_bytes_) {
+    return false;
+  }
+  uint64_t freed_bytes = 0;
+  for (auto it = shard.entries_.rbegin();
+       it != shard.entries_.rend() && freed_bytes < needed_bytes; ++it) {
+    const EntryList::iterator current = std::prev(it.base());
+    if ((*current)->referenced_.load(std::memory_order_relaxed)) {
+      victims.spared_.push_back(current);
+      continue;
+    }
+    victims.evicted_.push_back(current);
+    freed_bytes += (*current)->size_bytes_;
+  }
+
+  // Once every other entry is picked, the spared entries have had their second chance and go
+  // too, oldest first, as they would have been moved to the front in that order.
+  size_t spared_evicted = 0;
+  while (freed_bytes < needed_bytes && spared_evicted < victims.spared_.size()) {
+    const EntryList::iterator spared = victims.spared_[spared_evicted++];
+    victims.evicted_.push_back(spared);
+    freed_bytes += (*spared)->size_bytes_;
+  }
+  victims.spared_.erase(victims.spared_.begin(), victims.spared_.begin() + spared_evicted);
+  return freed_bytes >= needed_bytes;
+}
+
+void MemoryHttpCache::evictVictims(Shard& shard, const Victims& victims) {
+  for (const EntryList::iterator& spared : victims.spared_) {
+    (*spared)->referenced_.store(false, std::memory_order_relaxed);
+    shard.entries_.splice(shard.entries_.begin(), shard.entries_, spared);
+  }
+  for (const EntryList::iterator& victim : victims.evicted_) {
+    eraseEntry(shard, victim);
+    stats_.evictions_.inc();
+  }
+}
+
+void MemoryHttpCache::eraseEntry(Shard& shard, EntryList::iterator it) {
+  shard.size_bytes_ -= (*it)->size_bytes_;
+  stats_.size_bytes_.sub((*it)->size_bytes_);
+  stats_.entries_.dec();
+  shard.map_.erase((*it)->key_);
+  shard.entries_.erase(it);
+}
+
+void MemoryHttpCache::updateHeaders(const LookupContext& lookup_context,
+                                    const Http::ResponseHeaderMap& response_headers,
+                                    const ResponseMetadata& metadata) {
+  // The looked up entry is the one being validated. For a varied response, it is stored under
+  // the request key extended with the values of the headers it varies on, rather than under the
+  // request key itself.
+  const EntrySharedPtr& looked_up = static_cast<const MemoryLookupContext&>(lookup_context).entry();
+  if (looked_up == nullptr) {
+    return;
+  }
+  Shard& shard = shardFor(looked_up->hash_);
+  absl::WriterMutexLock lock(&shard.mutex_);
+
+  auto iter = shard.map_.find(looked_up->key_);
+  // Leave alone a newer response inserted since the lookup.
+  if (iter == shard.map_.end() || *iter->second != looked_up) {
+    return;
+  }
+  const EntrySharedPtr& entry = *iter->second;
+
+  // The vary header isn't updated: the key of a varied response depends on the headers it varies
+  // on, and a response without a vary header must not have one, so a validation changing them
+  // makes the entry unusable.
+  if (VaryHeaderUtils::hasVary(response_headers) &&
+      VaryHeaderUtils::getVaryValues(response_headers) !=
+          VaryHeaderUtils::getVaryValues(*entry->response_headers_)) {
+    eraseEntry(shard, iter->second);
+    return;
+  }
+
+  // Entries are shared with ongoing lookups, so the update goes into a copy. The body is shared
+  // with the previous version of the entry.
+  auto updated = std::make_shared<Entry>();
+  updated->key_ = entry->key_;
+  updated->hash_ = entry->hash_;
+  updated->response_headers_ =
+      Http::createHeaderMap<Http::ResponseHeaderMapImpl>(*entry->response_headers_);
+  CacheHeadersUtils::updateCachedResponseHeaders(*updated->response_headers_, response_headers);
+  updated->metadata_ = metadata;
+  updated->body_ = entry->body_;
+  if (entry->trailers_ != nullptr) {
+    updated->trailers_ = Http::createHeaderMap<Http::ResponseTrailerMapImpl>(*entry->trailers_);
+  }
+  updated->size_bytes_ = entry->size_bytes_ - entry->response_headers_->byteSize() +
+                         updated->response_headers_->byteSize();
+  updated->referenced_.store(entry->referenced_.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+
+  shard.size_bytes_ += updated->size_bytes_ - entry->size_bytes_;
+  stats_.size_bytes_.add(updated->size_bytes_ - entry->size_bytes_);
+  *iter->second = std::move(updated);
+}
+
+constexpr absl::string_view Name = "envoy.extensions.http.cache.memory";
+
+CacheInfo MemoryHttpCache::cacheInfo() const {
+  CacheInfo cache_info;
+  cache_info.name_ = Name;
+  return cache_info;
+}
+
+SINGLETON_MANAGER_REGISTRATION(memory_http_cache_singleton);
+
+class MemoryHttpCacheFactory : public HttpCacheFactory {
+public:
+  // From UntypedFactory
+  std::string name() const override { return std::string(Name); }
+  // From TypedFactory
+  ProtobufTypes::MessagePtr createEmptyConfigProto() override {
+    return std::make_unique<
+        envoy::extensions::cache::memory_http_cache::v3::MemoryHttpCacheConfig>();
+  }
+  // From HttpCacheFactory
+  std::shared_ptr<HttpCache>
+  getCache(const envoy::extensions::filters::http::cache::v3::CacheConfig& filter_config,
+           Server::Configuration::FactoryContext& context) override {
+    envoy::extensions::cache::memory_http_cache::v3::MemoryHttpCacheConfig config;
+    MessageUtil::anyConvertAndValidate(filter_config.typed_config(), config,
+                                       context.messageValidationVisitor());
+    // The cache outlives listeners, so its stats are rooted in the server scope.
+    Stats::Scope& scope = context.getServerFactoryContext().scope();
+    return context.singletonManager().getTyped<MemoryHttpCache>(
+        SINGLETON_MANAGER_REGISTERED_NAME(memory_http_cache_singleton),
+        [&config, &scope] { return std::make_shared<MemoryHttpCache>(config, scope); });
+  }
+};
+
+static Registry::RegisterFactory<MemoryHttpCacheFactory, HttpCacheFactory> register_;
+
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/extensions/cache/memory_http_cache/v3/config.pb.h"
+#include "envoy/singleton/instance.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "source/common/protobuf/utility.h"
+#include "source/extensions/filters/http/cache/http_cache.h"
+#include "source/extensions/filters/http/cache/memory_http_cache/frequency_sketch.h"
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+
+/**
+ * All stats for the memory http cache. @see stats_macros.h
+ */
+#define ALL_MEMORY_HTTP_CACHE_STATS(COUNTER, GAUGE)                                                \
+  COUNTER(evictions)                                                                               \
+  COUNTER(hits)                                                                                    \
+  COUNTER(insert_rejected)                                                                         \
+  COUNTER(inserts)                                                                                 \
+  COUNTER(misses)                                                                                  \
+  GAUGE(entries, NeverImport)                                                                      \
+  GAUGE(size_bytes, NeverImport)
+
+/**
+ * Struct definition for all memory http cache stats. @see stats_macros.h
+ */
+struct MemoryHttpCacheStats {
+  ALL_MEMORY_HTTP_CACHE_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+// In memory cache backend bounded in size. Entries are spread over shards by the hash of their
+// key. Lookups only take a shard's lock in shared mode, and full shards evict in approximate LRU
+// order, after checking with a TinyLFU sketch that the evicted entries are not more popular than
+// the new one. Bodies are immutable once inserted and are served without being copied.
+class MemoryHttpCache : public HttpCache, public Singleton::Instance {
+public:
+  // A cached response. Immutable once inserted, except for the reference bit.
+  struct Entry {
+    Key key_;
+    uint64_t hash_;
+    Http::ResponseHeaderMapPtr response_headers_;
+    ResponseMetadata metadata_;
+    std::shared_ptr<const std::string> body_;
+    Http::ResponseTrailerMapPtr trailers_;
+    // Approximate memory used by the entry, counted against the size budget.
+    uint64_t size_bytes_;
+    // Set when the entry is looked up, giving it a second chance when it's next up for eviction.
+    mutable std::atomic<bool> referenced_{false};
+  };
+  using EntrySharedPtr = std::shared_ptr<const Entry>;
+
+  MemoryHttpCache(const envoy::extensions::cache::memory_http_cache::v3::MemoryHttpCacheConfig&
+                      config,
+                  Stats::Scope& scope);
+
+  // HttpCache
+  LookupContextPtr makeLookupContext(LookupRequest&& request,
+                                     Http::StreamDecoderFilterCallbacks& callbacks) override;
+  InsertContextPtr makeInsertContext(LookupContextPtr&& lookup_context,
+                                     Http::StreamEncoderFilterCallbacks& callbacks) override;
+  void updateHeaders(const LookupContext& lookup_context,
+                     const Http::ResponseHeaderMap& response_headers,
+                     const ResponseMetadata& metadata) override;
+  CacheInfo cacheInfo() const override;
+
+  // Returns the entry to serve for the request, or nullptr if there is none.
+  EntrySharedPtr lookup(const LookupRequest& request);
+  void insert(const Key& key, Http::ResponseHeaderMapPtr&& response_headers,
+              ResponseMetadata&& metadata, std::string&& body,
+              Http::ResponseTrailerMapPtr&& trailers);
+
+  // Inserts a response that has been varied on certain headers.
+  void varyInsert(const Key& request_key, Http::ResponseHeaderMapPtr&& response_headers,
+                  ResponseMetadata&& metadata, std::string&& body,
+                  const Http::RequestHeaderMap& request_headers,
+                  const VaryAllowList& vary_allow_list, Http::ResponseTrailerMapPtr&& trailers);
+
+  const MemoryHttpCacheStats& stats() const { return stats_; }
+
+private:
+  using EntryList = std::list<EntrySharedPtr>;
+
+  struct Shard {
+    explicit Shard(uint64_t sketch_width) : sketch_(sketch_width) {}
+
+    absl::Mutex mutex_;
+    // Most recently inserted entries first.
+    EntryList entries_ ABSL_GUARDED_BY(mutex_);
+    absl::flat_hash_map<Key, EntryList::iterator, MessageUtil, MessageUtil>
+        map_ ABSL_GUARDED_BY(mutex_);
+    uint64_t size_bytes_ ABSL_GUARDED_BY(mutex_){};
+    FrequencySketch sketch_;
+  };
+
+  // The entries picked by selectVictims().
+  struct Victims {
+    // Entries to evict.
+    std::vector<EntryList::iterator> evicted_;
+    // Entries given a second chance, oldest first.
+    std::vector<EntryList::iterator> spared_;
+  };
+
+  Shard& shardFor(uint64_t hash) { return *shards_[hash % shards_.size()]; }
+  EntrySharedPtr find(const Key& key, uint64_t hash);
+  void insertEntry(std::shared_ptr<Entry>&& entry);
+  // Picks the entries to evict to make room for needed_bytes, giving a second chance to the
+  // entries which were looked up since they were last considered. Doesn't change the shard, so
+  // that nothing happens to it if the insert is then rejected. Returns false if there are not
+  // enough entries to evict.
+  bool selectVictims(Shard& shard, uint64_t needed_bytes, Victims& victims)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mutex_);
+  // Evicts the victims, and moves the spared entries to the front with their reference bit
+  // cleared.
+  void evictVictims(Shard& shard, const Victims& victims)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mutex_);
+  void eraseEntry(Shard& shard, EntryList::iterator it) ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mutex_);
+
+  const uint64_t shard_size_bytes_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  MemoryHttpCacheStats stats_;
+};
+
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,158 @@
+#include "source/extensions/filters/http/cache/request_coalescer.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/http/header_map_impl.h"
+
+#include "absl/strings/numbers.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+
+namespace {
+
+constexpr uint64_t DefaultMaxCoalescedBodyBytes = 1024 * 1024;
+
+} // namespace
+
+bool CoalescedResponse::publishHeaders(const Http::ResponseHeaderMap& headers, bool end_stream) {
+  uint64_t content_length;
+  if (!end_stream && headers.ContentLength() != nullptr &&
+      absl::SimpleAtoi(headers.getContentLengthValue(), &content_length) &&
+      content_length > max_body_bytes_) {
+    return false;
+  }
+  absl::MutexLock lock(&mutex_);
+  ASSERT(headers_ == nullptr && !aborted_);
+  headers_ = Http::createHeaderMap<Http::ResponseHeaderMapImpl>(headers);
+  complete_ = end_stream;
+  notifyFollowers();
+  return true;
+}
+
+bool CoalescedResponse::publishData(const Buffer::Instance& data, bool end_stream) {
+  absl::MutexLock lock(&mutex_);
+  ASSERT(headers_ != nullptr && !complete_ && !aborted_);
+  if (body_bytes_ + data.length() > max_body_bytes_) {
+    return false;
+  }
+  if (data.length() > 0) {
+    body_chunks_.push_back(std::make_shared<const std::string>(data.toString()));
+    body_bytes_ += data.length();
+  }
+  complete_ = end_stream;
+  notifyFollowers();
+  return true;
+}
+
+void CoalescedResponse::publishTrailers(const Http::ResponseTrailerMap& trailers) {
+  absl::MutexLock lock(&mutex_);
+  ASSERT(headers_ != nullptr && !complete_ && !aborted_);
+  trailers_ = Http::createHeaderMap<Http::ResponseTrailerMapImpl>(trailers);
+  complete_ = true;
+  notifyFollowers();
+}
+
+void CoalescedResponse::abort() {
+  absl::MutexLock lock(&mutex_);
+  if (complete_ || aborted_) {
+    return;
+  }
+  aborted_ = true;
+  notifyFollowers();
+}
+
+uint64_t CoalescedResponse::addFollower(Event::Dispatcher& dispatcher,
+                                        std::function<void()> on_update) {
+  absl::MutexLock lock(&mutex_);
+  if (headers_ != nullptr || aborted_) {
+    dispatcher.post(on_update);
+  }
+  const uint64_t id = next_follower_id_++;
+  followers_.emplace(id, Follower{dispatcher, std::move(on_update)});
+  return id;
+}
+
+void CoalescedResponse::removeFollower(uint64_t id) {
+  absl::MutexLock lock(&mutex_);
+  followers_.erase(id);
+}
+
+CoalescedResponse::Update CoalescedResponse::read(Cursor& cursor) {
+  absl::MutexLock lock(&mutex_);
+  Update update;
+  if (cursor.done_) {
+    return update;
+  }
+  if (aborted_) {
+    cursor.done_ = true;
+    update.aborted_ = true;
+    return update;
+  }
+  if (headers_ == nullptr) {
+    return update;
+  }
+  if (!cursor.headers_read_) {
+    update.headers_ = Http::createHeaderMap<Http::ResponseHeaderMapImpl>(*headers_);
+    cursor.headers_read_ = true;
+  }
+  if (cursor.chunks_read_ < body_chunks_.size()) {
+    update.body_ = std::make_unique<Buffer::OwnedImpl>();
+    for (; cursor.chunks_read_ < body_chunks_.size(); cursor.chunks_read_++) {
+      // The fragment keeps the chunk alive until the follower's buffer is done with it.
+      std::shared_ptr<const std::string> chunk = body_chunks_[cursor.chunks_read_];
+      auto* fragment = new Buffer::BufferFragmentImpl(
+          chunk->data(), chunk->size(),
+          [chunk](const void*, size_t, const Buffer::BufferFragmentImpl* this_fragment) {
+            delete this_fragment;
+          });
+      update.body_->addBufferFragment(*fragment);
+    }
+  }
+  if (complete_) {
+    if (trailers_ != nullptr) {
+      update.trailers_ = Http::createHeaderMap<Http::ResponseTrailerMapImpl>(*trailers_);
+    } else if (update.headers_ == nullptr && update.body_ == nullptr) {
+      // The end of the response was published with an empty body chunk.
+      update.body_ = std::make_unique<Buffer::OwnedImpl>();
+    }
+    update.end_stream_ = true;
+    cursor.done_ = true;
+  }
+  return update;
+}
+
+void CoalescedResponse::notifyFollowers() {
+  for (const auto& [id, follower] : followers_) {
+    follower.dispatcher_.post(follower.on_update_);
+  }
+}
+
+RequestCoalescer::RequestCoalescer(
+    const envoy::extensions::filters::http::cache::v3::CacheConfig::RequestCoalescing& config)
+    : wait_timeout_(PROTOBUF_GET_MS_OR_DEFAULT(config, wait_timeout, 5000)),
+      max_body_bytes_(
+          PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_body_bytes, DefaultMaxCoalescedBodyBytes)) {}
+
+std::pair<CoalescedResponseSharedPtr, bool> RequestCoalescer::join(const Key& key) {
+  absl::MutexLock lock(&mutex_);
+  auto [it, inserted] = in_flight_.try_emplace(key);
+  if (inserted) {
+    it->second = std::make_shared<CoalescedResponse>(max_body_bytes_);
+  }
+  return {it->second, inserted};
+}
+
+void RequestCoalescer::release(const Key& key, const CoalescedResponse& response) {
+  absl::MutexLock lock(&mutex_);
+  auto it = in_flight_.find(key);
+  if (it != in_flight_.end() && it->second.get() == &response) {
+    in_flight_.erase(it);
+  }
+}
+
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "envoy/buffer/buffer.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/extensions/filters/http/cache/v3/cache.pb.h"
+#include "envoy/http/header_map.h"
+
+#include "source/common/protobuf/utility.h"
+#include "source/extensions/filters/http/cache/key.pb.h"
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+
+/**
+ * The response to a request sent upstream after a cache miss, shared with the concurrent requests
+ * for the same key that were collapsed into it.
+ *
+ * The request that went upstream, the leader, publishes its response as it is encoded. The other
+ * requests, the followers, are notified on their own dispatcher, and each reads the part of the
+ * response it hasn't sent yet. The response is kept until the last follower is done with it, so
+ * that a follower joining late is served it from the start. The body is kept as the chunks it
+ * was published in, which the followers reference rather than copy.
+ */
+class CoalescedResponse {
+public:
+  // @param max_body_bytes the size of body beyond which the response isn't shared.
+  explicit CoalescedResponse(uint64_t max_body_bytes) : max_body_bytes_(max_body_bytes) {}
+
+  // The part of the response a follower hasn't read yet.
+  struct Update {
+    Http::ResponseHeaderMapPtr headers_;
+    Buffer::InstancePtr body_;
+    Http::ResponseTrailerMapPtr trailers_;
+    // Whether this update completes the response.
+    bool end_stream_ = false;
+    // Whether the leader gave up on the response, in which case the update has no data.
+    bool aborted_ = false;
+  };
+
+  // How far a follower has read the response.
+  struct Cursor {
+    bool headers_read_ = false;
+    // The number of body chunks read.
+    uint64_t chunks_read_ = 0;
+    bool done_ = false;
+  };
+
+  // Called by the leader as it encodes the response. publishHeaders() and publishData() return
+  // false, without publishing anything, if the body is larger than max_body_bytes, in which case
+  // the leader aborts the response.
+  bool publishHeaders(const Http::ResponseHeaderMap& headers, bool end_stream);
+  bool publishData(const Buffer::Instance& data, bool end_stream);
+  void publishTrailers(const Http::ResponseTrailerMap& trailers);
+  // Called by the leader if it can't share the response, or its stream was reset.
+  void abort();
+
+  /**
+   * Registers a follower.
+   * @param dispatcher the dispatcher of the follower's worker.
+   * @param on_update posted to the dispatcher whenever more of the response is available, or the
+   *        response is aborted. It may be posted once more after the follower is removed, and for
+   *        updates the follower has already read.
+   * @return an id to remove the follower with.
+   */
+  uint64_t addFollower(Event::Dispatcher& dispatcher, std::function<void()> on_update);
+  void removeFollower(uint64_t id);
+
+  // Returns the part of the response the follower hasn't read yet, and advances its cursor. The
+  // body references the published chunks.
+  Update read(Cursor& cursor);
+
+private:
+  struct Follower {
+    Event::Dispatcher& dispatcher_;
+    std::function<void()> on_update_;
+  };
+
+  void notifyFollowers() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const uint64_t max_body_bytes_;
+  absl::Mutex mutex_;
+  Http::ResponseHeaderMapPtr headers_ ABSL_GUARDED_BY(mutex_);
+  // Shared with the buffers of the followers which read them, which may outlive the response.
+  std::vector<std::shared_ptr<const std::string>> body_chunks_ ABSL_GUARDED_BY(mutex_);
+  uint64_t body_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  Http::ResponseTrailerMapPtr trailers_ ABSL_GUARDED_BY(mutex_);
+  bool complete_ ABSL_GUARDED_BY(mutex_) = false;
+  bool aborted_ ABSL_GUARDED_BY(mutex_) = false;
+  absl::flat_hash_map<uint64_t, Follower> followers_ ABSL_GUARDED_BY(mutex_);
+  uint64_t next_follower_id_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+/**
+ * Tracks the responses being fetched from the upstream after a cache miss, so that concurrent
+ * misses for the same key are collapsed into a single upstream request. Shared by the filters of
+ * all workers created from the same CacheConfig.
+ */
+class RequestCoalescer {
+public:
+  explicit RequestCoalescer(
+      const envoy::extensions::filters::http::cache::v3::CacheConfig::RequestCoalescing& config);
+
+  /**
+   * Collapses a request that missed the cache into the response being fetched for its key.
+   * @return the response being fetched for the key, and false; or, if there is none, a new
+   *         response for the caller to fetch and publish, and true.
+   */
+  std::pair<std::shared_ptr<CoalescedResponse>, bool> join(const Key& key);
+
+  // Stops collapsing requests into the response, once the leader has published or aborted it.
+  void release(const Key& key, const CoalescedResponse& response);
+
+  std::chrono::milliseconds waitTimeout() const { return wait_timeout_; }
+
+private:
+  const std::chrono::milliseconds wait_timeout_;
+  const uint64_t max_body_bytes_;
+  absl::Mutex mutex_;
+  absl::flat_hash_map<Key, std::shared_ptr<CoalescedResponse>, MessageUtil, MessageUtil>
+      in_flight_ ABSL_GUARDED_BY(mutex_);
+};
+
+using RequestCoalescerSharedPtr = std::shared_ptr<RequestCoalescer>;
+using CoalescedResponseSharedPtr = std::shared_ptr<CoalescedResponse>;
+
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -118,24 +118,6 @@ LookupContextPtr SimpleHttpCache::makeLookupContext(LookupRequest&& request,
   return std::make_unique<SimpleLookupContext>(*this, std::move(request));
 }
 
-const absl::flat_hash_set<Http::LowerCaseString> SimpleHttpCache::headersNotToUpdate() {
-  CONSTRUCT_ON_FIRST_USE(
-      absl::flat_hash_set<Http::LowerCaseString>,
-      // Content range should not be changed upon validation
-      Http::Headers::get().ContentRange,
-
-      // Headers that describe the body content should never be updated.
-      Http::Headers::get().ContentLength,
-
-      // It does not make sense for this level of the code to be updating the ETag, when
-      // presumably the cached_response_headers reflect this specific ETag.
-      Http::CustomHeaders::get().Etag,
-
-      // We don't update the cached response on a Vary; we just delete it
-      // entirely. So don't bother copying over the Vary header.
-      Http::CustomHeaders::get().Vary);
-}
-
 void SimpleHttpCache::updateHeaders(const LookupContext& lookup_context,
                                     const Http::ResponseHeaderMap& response_headers,
                                     const ResponseMetadata& metadata) {
@@ -160,28 +142,7 @@ void SimpleHttpCache::updateHeaders(const LookupContext& lookup_context,
   // 2. No key collision for etag. Therefore, if etag matches it's the same resource.
   // 3. Backend is correct. etag is being used as a unique identifier to the resource
 
-  // use other header fields provided in the new response to replace all instances
-  // of the corresponding header fields in the stored response
-
-  // `updatedHeaderFields` makes sure each field is only removed when we update the header
-  // field for the first time to handle the case where incoming headers have repeated values
-  absl::flat_hash_set<Http::LowerCaseString> updatedHeaderFields;
-  response_headers.iterate(
-      [&entry, &updatedHeaderFields](
-          const Http::HeaderEntry& incoming_response_header) -> Http::HeaderMap::Iterate {
-        Http::LowerCaseString lower_case_key{incoming_response_header.key().getStringView()};
-        absl::string_view incoming_value{incoming_response_header.value().getStringView()};
-        if (headersNotToUpdate().contains(lower_case_key)) {
-          return Http::HeaderMap::Iterate::Continue;
-        }
-        if (!updatedHeaderFields.contains(lower_case_key)) {
-          entry.response_headers_->setCopy(lower_case_key, incoming_value);
-          updatedHeaderFields.insert(lower_case_key);
-        } else {
-          entry.response_headers_->addCopy(lower_case_key, incoming_value);
-        }
-        return Http::HeaderMap::Iterate::Continue;
-      });
+  CacheHeadersUtils::updateCachedResponseHeaders(*entry.response_headers_, response_headers);
   entry.metadata_ = metadata;
 }
 
@@ -0,0 +1,74 @@
+#include "source/extensions/filters/http/compressor/compressed_response_cache.h"
+
+#include "source/common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Compressor {
+
+namespace {
+
+// Default maximum total size of the compressed bodies kept.
+constexpr uint64_t DefaultMaxCacheSize = 64 * 1024 * 1024;
+
+// Default maximum size of an uncompressed body that is kept compressed.
+constexpr uint64_t DefaultMaxBodySize = 1024 * 1024;
+
+} // namespace
+
+CompressedResponseCache::CompressedResponseCache(
+    const envoy::extensions::filters::http::compressor::v3::Compressor::CompressedResponseCache&
+        config)
+    : max_size_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_cache_size_bytes, DefaultMaxCacheSize)),
+      max_body_size_(
+          PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_body_size_bytes, DefaultMaxBodySize)),
+      key_by_content_hash_(config.key_by_content_hash()) {}
+
+CompressedResponseCache::Body CompressedResponseCache::lookup(absl::string_view key) {
+  absl::MutexLock lock(&mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->body_;
+}
+
+uint64_t CompressedResponseCache::insert(absl::string_view key, std::string&& body) {
+  absl::MutexLock lock(&mutex_);
+  if (auto it = index_.find(key); it != index_.end()) {
+    erase(it->second);
+  }
+  Entry entry{std::string(key), std::make_shared<const std::string>(std::move(body))};
+  const uint64_t entry_size = entrySize(entry);
+  if (entry_size > max_size_) {
+    return 0;
+  }
+  uint64_t evicted = 0;
+  while (size_ + entry_size > max_size_) {
+    erase(std::prev(entries_.end()));
+    ++evicted;
+  }
+  entries_.push_front(std::move(entry));
+  // The index refers to the key owned by the entry, which doesn't move within the list.
+  index_.emplace(entries_.front().key_, entries_.begin());
+  size_ += entry_size;
+  return evicted;
+}
+
+uint64_t CompressedResponseCache::size() {
+  absl::MutexLock lock(&mutex_);
+  return size_;
+}
+
+void CompressedResponseCache::erase(EntryList::iterator it) {
+  size_ -= entrySize(*it);
+  index_.erase(it->key_);
+  entries_.erase(it);
+}
+
+} // namespace Compressor
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "envoy/extensions/filters/http/compressor/v3/compressor.pb.h"
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Compressor {
+
+/**
+ * Compressed response bodies kept by the compressor filter, so that a body served many times is
+ * compressed once. The bodies are bounded by their total size and the least recently used ones
+ * are evicted first. Shared by the filters of all workers created from the same filter config.
+ */
+class CompressedResponseCache {
+public:
+  using Body = std::shared_ptr<const std::string>;
+
+  explicit CompressedResponseCache(
+      const envoy::extensions::filters::http::compressor::v3::Compressor::CompressedResponseCache&
+          config);
+
+  /**
+   * @param key the key the body was inserted with.
+   * @return the compressed body kept for the key, or nullptr if there is none.
+   */
+  Body lookup(absl::string_view key);
+
+  /**
+   * Keeps a compressed body, replacing the one kept for the same key, if any.
+   * @param key the key to look the body up with.
+   * @param body the compressed body.
+   * @return the number of bodies evicted to make room for the new one.
+   */
+  uint64_t insert(absl::string_view key, std::string&& body);
+
+  // Maximum size of an uncompressed body that is kept compressed.
+  uint64_t maxBodySize() const { return max_body_size_; }
+  bool keyByContentHash() const { return key_by_content_hash_; }
+
+  // Total size of the keys and bodies kept.
+  uint64_t size();
+
+private:
+  struct Entry {
+    std::string key_;
+    Body body_;
+  };
+  using EntryList = std::list<Entry>;
+
+  static uint64_t entrySize(const Entry& entry) { return entry.key_.size() + entry.body_->size(); }
+  void erase(EntryList::iterator it) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const uint64_t max_size_;
+  const uint64_t max_body_size_;
+  const bool key_by_content_hash_;
+
+  absl::Mutex mutex_;
+  // Most recently used entries first.
+  EntryList entries_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<absl::string_view, EntryList::iterator> index_ ABSL_GUARDED_BY(mutex_);
+  uint64_t size_ ABSL_GUARDED_BY(mutex_){0};
+};
+
+using CompressedResponseCachePtr = std::unique_ptr<CompressedResponseCache>;
+
+} // namespace Compressor
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
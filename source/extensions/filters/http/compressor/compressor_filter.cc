@@ -1,6 +1,11 @@
 #include "source/extensions/filters/http/compressor/compressor_filter.h"
 
+#include "envoy/http/codes.h"
+
 #include "source/common/buffer/buffer_impl.h"
+#include "source/common/common/enum_to_int.h"
+#include "source/common/common/hex.h"
+#include "source/common/crypto/utility.h"
 #include "source/common/http/header_map_impl.h"
 #include "source/common/http/utility.h"
 
@@ -69,6 +74,12 @@ void compressAndUpdateStats(const Compression::Compressor::CompressorPtr& compre
   stats.total_compressed_bytes_.add(data.length());
 }
 
+// Weak entity tags only promise semantically equivalent bodies, so only strong ones identify the
+// bytes of a body.
+bool isStrongEtag(absl::string_view value) {
+  return value.length() > 2 && !((value[0] == 'w' || value[0] == 'W') && value[1] == '/');
+}
+
 } // namespace
 
 CompressorFilterConfig::DirectionConfig::DirectionConfig(
@@ -127,7 +138,12 @@ CompressorFilterConfig::ResponseDirectionConfig::ResponseDirectionConfig(
           proto_config.has_response_direction_config()
               ? proto_config.response_direction_config().remove_accept_encoding_header()
               : proto_config.remove_accept_encoding_header()),
-      response_stats_{generateResponseStats(stats_prefix, scope)} {}
+      response_stats_{generateResponseStats(stats_prefix, scope)},
+      compressed_response_cache_(
+          proto_config.response_direction_config().has_compressed_response_cache()
+              ? std::make_unique<CompressedResponseCache>(
+                    proto_config.response_direction_config().compressed_response_cache())
+              : nullptr) {}
 
 const envoy::extensions::filters::http::compressor::v3::Compressor::CommonDirectionConfig
 CompressorFilterConfig::ResponseDirectionConfig::commonConfig(
@@ -176,6 +192,10 @@ Http::FilterHeadersStatus CompressorFilter::decodeHeaders(Http::RequestHeaderMap
   if (response_config.compressionEnabled() && response_config.removeAcceptEncodingHeader()) {
     headers.removeInline(accept_encoding_handle.handle());
   }
+  if (response_config.compressedResponseCache() != nullptr) {
+    request_cache_key_ = std::make_unique<std::string>(
+        absl::StrCat(headers.getHostValue(), "\n", headers.getPathValue()));
+  }
 
   const auto& request_config = config_->requestDirectionConfig();
 
@@ -252,12 +272,16 @@ Http::FilterHeadersStatus CompressorFilter::encodeHeaders(Http::ResponseHeaderMa
       isEtagAllowed(headers) && !headers.getInline(response_content_encoding_handle.handle());
   if (!end_stream && isAcceptEncodingAllowed(isEnabledAndContentLengthBigEnough, headers) &&
       isCompressible && isTransferEncodingAllowed(headers)) {
+    // The entity tag is looked up before it gets sanitized.
+    lookUpCompressedResponse(headers);
     sanitizeEtagHeader(headers);
     headers.removeContentLength();
     headers.setInline(response_content_encoding_handle.handle(), config_->contentEncoding());
     config.stats().compressed_.inc();
-    // Finally instantiate the compressor.
-    response_compressor_ = config_->makeCompressor();
+    // Finally instantiate the compressor, unless the compressed body is already at hand.
+    if (cache_state_ != CacheState::Hit) {
+      response_compressor_ = config_->makeCompressor();
+    }
   } else {
     config.stats().not_compressed_.inc();
   }
@@ -273,6 +297,9 @@ Http::FilterHeadersStatus CompressorFilter::encodeHeaders(Http::ResponseHeaderMa
 }
 
 Http::FilterDataStatus CompressorFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (cache_state_ != CacheState::None) {
+    return encodeDataWithCache(data, end_stream);
+  }
   if (response_compressor_ != nullptr) {
     compressAndUpdateStats(response_compressor_, config_->responseDirectionConfig().stats(), data,
                            end_stream);
@@ -281,6 +308,16 @@ Http::FilterDataStatus CompressorFilter::encodeData(Buffer::Instance& data, bool
 }
 
 Http::FilterTrailersStatus CompressorFilter::encodeTrailers(Http::ResponseTrailerMap&) {
+  if (cache_state_ != CacheState::None) {
+    // The presence of trailers means the stream is ended, thus finish the body the same way
+    // encodeData() does when it is called with end_stream=true.
+    Buffer::OwnedImpl empty_buffer;
+    encodeDataWithCache(empty_buffer, true);
+    if (empty_buffer.length() > 0) {
+      encoder_callbacks_->addEncodedData(empty_buffer, true);
+    }
+    return Http::FilterTrailersStatus::Continue;
+  }
   if (response_compressor_ != nullptr) {
     Buffer::OwnedImpl empty_buffer;
     // The presence of trailers means the stream is ended, but encodeData()
@@ -293,6 +330,134 @@ Http::FilterTrailersStatus CompressorFilter::encodeTrailers(Http::ResponseTraile
   return Http::FilterTrailersStatus::Continue;
 }
 
+void CompressorFilter::lookUpCompressedResponse(const Http::ResponseHeaderMap& headers) {
+  CompressedResponseCache* cache = config_->responseDirectionConfig().compressedResponseCache();
+  // Only complete bodies are kept, so partial content sharing the entity tag of a resource must
+  // not be.
+  if (cache == nullptr || request_cache_key_ == nullptr ||
+      Http::Utility::getResponseStatusOrNullopt(headers) != enumToInt(Http::Code::OK)) {
+    return;
+  }
+  uint64_t content_length;
+  if (headers.ContentLength() != nullptr &&
+      absl::SimpleAtoi(headers.getContentLengthValue(), &content_length) &&
+      content_length > cache->maxBodySize()) {
+    return;
+  }
+
+  const ResponseCompressorStats& stats = config_->responseDirectionConfig().responseStats();
+  const Http::HeaderEntry* etag = headers.getInline(etag_handle.handle());
+  if (etag != nullptr && isStrongEtag(etag->value().getStringView())) {
+    // The same entity tag may be used by different resources, so it identifies a body only
+    // together with the request target.
+    cache_key_ = absl::StrCat("etag\n", *request_cache_key_, "\n", etag->value().getStringView());
+    cached_body_ = cache->lookup(cache_key_);
+    if (cached_body_ != nullptr) {
+      stats.compressed_cache_hit_.inc();
+      cache_state_ = CacheState::Hit;
+    } else {
+      stats.compressed_cache_miss_.inc();
+      cache_state_ = CacheState::Filling;
+    }
+  } else if (cache->keyByContentHash()) {
+    cache_state_ = CacheState::Hashing;
+  }
+}
+
+Http::FilterDataStatus CompressorFilter::encodeDataWithCache(Buffer::Instance& data,
+                                                             bool end_stream) {
+  const CompressorStats& stats = config_->responseDirectionConfig().stats();
+  const CompressedResponseCache& cache =
+      *config_->responseDirectionConfig().compressedResponseCache();
+
+  switch (cache_state_) {
+  case CacheState::Hit:
+    // The upstream body is the same as the one compressed before, so it is discarded in favor of
+    // the cached one.
+    stats.total_uncompressed_bytes_.add(data.length());
+    data.drain(data.length());
+    addCachedBody(data);
+    break;
+  case CacheState::Filling:
+    filled_uncompressed_size_ += data.length();
+    compressAndUpdateStats(response_compressor_, stats, data, end_stream);
+    if (filled_uncompressed_size_ > cache.maxBodySize()) {
+      cache_state_ = CacheState::None;
+      filled_body_.clear();
+      break;
+    }
+    filled_body_.append(data.toString());
+    if (end_stream) {
+      insertCompressedResponse();
+    }
+    break;
+  case CacheState::Hashing:
+    hashed_body_.move(data);
+    if (hashed_body_.length() > cache.maxBodySize()) {
+      // The body is too large to be kept, so compress what has been buffered so far and carry on
+      // as usual.
+      cache_state_ = CacheState::None;
+      compressAndUpdateStats(response_compressor_, stats, hashed_body_, end_stream);
+      data.move(hashed_body_);
+      break;
+    }
+    if (!end_stream) {
+      return Http::FilterDataStatus::StopIterationNoBuffer;
+    }
+    finishHashing(data);
+    break;
+  case CacheState::None:
+    PANIC("not reached");
+  }
+  return Http::FilterDataStatus::Continue;
+}
+
+void CompressorFilter::finishHashing(Buffer::Instance& data) {
+  const ResponseCompressorStats& response_stats =
+      config_->responseDirectionConfig().responseStats();
+  const CompressorStats& stats = config_->responseDirectionConfig().stats();
+  CompressedResponseCache& cache = *config_->responseDirectionConfig().compressedResponseCache();
+
+  const uint64_t length = hashed_body_.length();
+  // The body is scoped to the request target and hashed with a cryptographic hash, so that an
+  // upstream can't get its body served in place of another one by colliding with its hash.
+  const std::vector<uint8_t> digest =
+      Common::Crypto::UtilitySingleton::get().getSha256Digest(hashed_body_);
+  cache_key_ = absl::StrCat("hash\n", *request_cache_key_, "\n", Hex::encode(digest));
+  cached_body_ = cache.lookup(cache_key_);
+  if (cached_body_ != nullptr) {
+    response_stats.compressed_cache_hit_.inc();
+    cache_state_ = CacheState::Hit;
+    stats.total_uncompressed_bytes_.add(length);
+    hashed_body_.drain(length);
+    addCachedBody(data);
+    return;
+  }
+
+  response_stats.compressed_cache_miss_.inc();
+  cache_state_ = CacheState::Filling;
+  compressAndUpdateStats(response_compressor_, stats, hashed_body_, true);
+  filled_body_ = hashed_body_.toString();
+  data.move(hashed_body_);
+  insertCompressedResponse();
+}
+
+void CompressorFilter::addCachedBody(Buffer::Instance& data) {
+  if (cached_body_ != nullptr) {
+    config_->responseDirectionConfig().stats().total_compressed_bytes_.add(cached_body_->size());
+    data.add(*cached_body_);
+    cached_body_ = nullptr;
+  }
+}
+
+void CompressorFilter::insertCompressedResponse() {
+  const uint64_t evicted =
+      config_->responseDirectionConfig().compressedResponseCache()->insert(
+          cache_key_, std::move(filled_body_));
+  config_->responseDirectionConfig().responseStats().compressed_cache_evicted_.add(evicted);
+  cache_state_ = CacheState::None;
+}
+
 bool CompressorFilter::hasCacheControlNoTransform(Http::ResponseHeaderMap& headers) const {
   const Http::HeaderEntry* cache_control = headers.getInline(cache_control_handle.handle());
   if (cache_control) {
@@ -589,11 +754,8 @@ void CompressorFilter::insertVaryHeader(Http::ResponseHeaderMap& headers) {
 // the strong ones when disable_on_etag_header is false. Envoy does NOT re-write entity tags.
 void CompressorFilter::sanitizeEtagHeader(Http::ResponseHeaderMap& headers) {
   const Http::HeaderEntry* etag = headers.getInline(etag_handle.handle());
-  if (etag != nullptr) {
-    absl::string_view value(etag->value().getStringView());
-    if (value.length() > 2 && !((value[0] == 'w' || value[0] == 'W') && value[1] == '/')) {
-      headers.removeInline(etag_handle.handle());
-    }
+  if (etag != nullptr && isStrongEtag(etag->value().getStringView())) {
+    headers.removeInline(etag_handle.handle());
   }
 }
 
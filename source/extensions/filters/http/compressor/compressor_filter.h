@@ -4,9 +4,11 @@
 #include "envoy/extensions/filters/http/compressor/v3/compressor.pb.h"
 #include "envoy/stats/stats_macros.h"
 
+#include "source/common/buffer/buffer_impl.h"
 #include "source/common/protobuf/protobuf.h"
 #include "source/common/runtime/runtime_protos.h"
 #include "source/extensions/filters/http/common/pass_through_filter.h"
+#include "source/extensions/filters/http/compressor/compressed_response_cache.h"
 
 namespace Envoy {
 namespace Extensions {
@@ -37,6 +39,10 @@ namespace Compressor {
  *
  * "header_gzip" is specific to the gzip filter and is deprecated since it duplicates
  * "header_compressor_used".
+ *
+ * "compressed_cache_hit" and "compressed_cache_miss" count the compressed responses whose body was
+ * looked up in the compressed response cache, and "compressed_cache_evicted" counts the bodies
+ * evicted from it.
  */
 #define RESPONSE_COMPRESSOR_STATS(COUNTER)                                                         \
   COUNTER(no_accept_header)                                                                        \
@@ -45,7 +51,10 @@ namespace Compressor {
   COUNTER(header_compressor_overshadowed)                                                          \
   COUNTER(header_wildcard)                                                                         \
   COUNTER(header_not_valid)                                                                        \
-  COUNTER(not_compressed_etag)
+  COUNTER(not_compressed_etag)                                                                     \
+  COUNTER(compressed_cache_hit)                                                                    \
+  COUNTER(compressed_cache_miss)                                                                   \
+  COUNTER(compressed_cache_evicted)
 
 /**
  * Struct definitions for compressor stats. @see stats_macros.h
@@ -119,6 +128,10 @@ public:
     const ResponseCompressorStats& responseStats() const { return response_stats_; }
     bool disableOnEtagHeader() const { return disable_on_etag_header_; }
     bool removeAcceptEncodingHeader() const { return remove_accept_encoding_header_; }
+    // @return the compressed response cache, or nullptr if it isn't configured.
+    CompressedResponseCache* compressedResponseCache() const {
+      return compressed_response_cache_.get();
+    }
 
   private:
     static ResponseCompressorStats generateResponseStats(const std::string& prefix,
@@ -134,6 +147,7 @@ public:
     const bool disable_on_etag_header_;
     const bool remove_accept_encoding_header_;
     const ResponseCompressorStats response_stats_;
+    const CompressedResponseCachePtr compressed_response_cache_;
   };
 
   CompressorFilterConfig() = delete;
@@ -187,6 +201,24 @@ private:
   void sanitizeEtagHeader(Http::ResponseHeaderMap& headers);
   void insertVaryHeader(Http::ResponseHeaderMap& headers);
 
+  // How the response body is served from, or kept in, the compressed response cache.
+  enum class CacheState {
+    // The cache isn't used for the response.
+    None,
+    // The body is served from the cache and the one from the upstream is discarded.
+    Hit,
+    // The body is compressed as usual and kept in the cache once complete.
+    Filling,
+    // The body is buffered until complete to be looked up by its hash.
+    Hashing,
+  };
+
+  void lookUpCompressedResponse(const Http::ResponseHeaderMap& headers);
+  Http::FilterDataStatus encodeDataWithCache(Buffer::Instance& data, bool end_stream);
+  void finishHashing(Buffer::Instance& data);
+  void addCachedBody(Buffer::Instance& data);
+  void insertCompressedResponse();
+
   class EncodingDecision : public StreamInfo::FilterState::Object {
   public:
     enum class HeaderStat { NotValid, Identity, Wildcard, ValidCompressor };
@@ -207,6 +239,17 @@ private:
   Envoy::Compression::Compressor::CompressorPtr request_compressor_;
   const CompressorFilterConfigSharedPtr config_;
   std::unique_ptr<std::string> accept_encoding_;
+
+  // The :authority and :path of the request, captured if the compressed response cache is used.
+  std::unique_ptr<std::string> request_cache_key_;
+  CacheState cache_state_{CacheState::None};
+  std::string cache_key_;
+  // The body served on a hit, until it is added to the response.
+  CompressedResponseCache::Body cached_body_;
+  // The compressed body kept in the cache once the response is complete.
+  std::string filled_body_;
+  uint64_t filled_uncompressed_size_{0};
+  Buffer::OwnedImpl hashed_body_;
 };
 
 } // namespace Compressor
@@ -144,6 +144,23 @@ envoy::extensions::filters::network::http_connection_manager::v3::HttpConnection
       KEEP_UNCHANGED;
 }
 
+// Tail sampling exports spans started as not sampled by calling setSampled(true) on them as they
+// finish. Only tracers known to decide whether to report a span when it finishes support that.
+// Others record the call as an annotation, ignore it or, like the Datadog tracer, lock the
+// sampling decision once the context is propagated upstream.
+bool tracerSupportsTailSampling(const envoy::config::trace::v3::Tracing_Http& provider) {
+  const absl::string_view type =
+      TypeUtil::typeUrlToDescriptorFullName(provider.typed_config().type_url());
+  if (!type.empty()) {
+    return type == "envoy.config.trace.v3.ZipkinConfig" ||
+           type == "envoy.config.trace.v3.OpenTelemetryConfig" ||
+           type == "envoy.config.trace.v3.XRayConfig";
+  }
+  return provider.name() == "envoy.tracers.zipkin" ||
+         provider.name() == "envoy.tracers.opentelemetry" ||
+         provider.name() == "envoy.tracers.xray";
+}
+
 } // namespace
 
 // Singleton registration via macro defined in envoy/singleton/manager.h
@@ -526,10 +543,30 @@ HttpConnectionManagerConfig::HttpConnectionManagerConfig(
     const uint32_t max_path_tag_length = PROTOBUF_GET_WRAPPED_OR_DEFAULT(
         tracing_config, max_path_tag_length, Tracing::DefaultMaxPathTagLength);
 
+    Tracing::TailSamplerSharedPtr tail_sampler;
+    if (tracing_config.has_tail_sampling()) {
+      const envoy::config::trace::v3::Tracing_Http* provider = getPerFilterTracerConfig(config);
+      if (provider != nullptr && !tracerSupportsTailSampling(*provider)) {
+        throw EnvoyException(fmt::format("tail_sampling is not supported by the tracer '{}'",
+                                         provider->name()));
+      }
+      const auto& tail_sampling = tracing_config.tail_sampling();
+      absl::optional<std::chrono::milliseconds> latency_threshold;
+      if (tail_sampling.has_latency_threshold()) {
+        latency_threshold = std::chrono::milliseconds(
+            DurationUtil::durationToMilliseconds(tail_sampling.latency_threshold()));
+      }
+      tail_sampler = std::make_shared<Tracing::TailSampler>(
+          latency_threshold, PROTOBUF_GET_WRAPPED_OR_DEFAULT(tail_sampling, export_errors, true),
+          PROTOBUF_GET_WRAPPED_OR_DEFAULT(tail_sampling, max_records_per_worker, 1024),
+          context_.threadLocal(), context_.mainThreadDispatcher().timeSource(),
+          stats_prefix_ + "tracing.tail_sampling.", context_.scope());
+    }
+
     tracing_config_ =
         std::make_unique<Http::TracingConnectionManagerConfig>(Http::TracingConnectionManagerConfig{
             tracing_operation_name, custom_tags, client_sampling, random_sampling, overall_sampling,
-            tracing_config.verbose(), max_path_tag_length});
+            tracing_config.verbose(), max_path_tag_length, std::move(tail_sampler)});
   }
 
   for (const auto& access_log : config.access_log()) {
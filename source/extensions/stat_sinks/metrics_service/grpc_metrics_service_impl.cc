@@ -42,7 +42,7 @@ void GrpcMetricsStreamerImpl::send(MetricsPtr&& metrics) {
   }
 }
 
-MetricsPtr MetricsFlusher::flush(Stats::MetricSnapshot& snapshot) const {
+MetricsPtr MetricsFlusher::flush(Stats::MetricSnapshot& snapshot) {
   auto metrics =
       std::make_unique<Envoy::Protobuf::RepeatedPtrField<io::prometheus::client::MetricFamily>>();
 
@@ -55,18 +55,42 @@ MetricsPtr MetricsFlusher::flush(Stats::MetricSnapshot& snapshot) const {
                                  snapshot.snapshotTime().time_since_epoch())
                                  .count();
   for (const auto& counter : snapshot.counters()) {
+    if (report_only_changed_metrics_ && counter.delta_ == 0) {
+      continue;
+    }
     if (predicate_(counter.counter_.get())) {
       flushCounter(*metrics->Add(), counter, snapshot_time_ms);
     }
   }
 
+  GaugeValueMap gauge_values;
+  if (report_only_changed_metrics_) {
+    gauge_values.reserve(last_gauge_values_.size());
+  }
   for (const auto& gauge : snapshot.gauges()) {
-    if (predicate_(gauge)) {
-      flushGauge(*metrics->Add(), gauge.get(), snapshot_time_ms);
+    if (!predicate_(gauge)) {
+      continue;
+    }
+    if (report_only_changed_metrics_) {
+      const GaugeValue current{gauge.get().statName().hash(), gauge.get().value()};
+      gauge_values.emplace(&gauge.get(), current);
+      const auto it = last_gauge_values_.find(&gauge.get());
+      if (it != last_gauge_values_.end() && it->second.name_hash_ == current.name_hash_ &&
+          it->second.value_ == current.value_) {
+        continue;
+      }
     }
+    flushGauge(*metrics->Add(), gauge.get(), snapshot_time_ms);
+  }
+  if (report_only_changed_metrics_) {
+    last_gauge_values_.swap(gauge_values);
   }
 
   for (const auto& histogram : snapshot.histograms()) {
+    if (report_only_changed_metrics_ &&
+        histogram.get().intervalStatistics().sampleCount() == 0) {
+      continue;
+    }
     if (predicate_(histogram.get())) {
       flushHistogram(*metrics->Add(), *metrics->Add(), histogram.get(), snapshot_time_ms);
     }
@@ -15,6 +15,8 @@
 #include "source/common/buffer/buffer_impl.h"
 #include "source/common/grpc/typed_async_client.h"
 
+#include "absl/container/flat_hash_map.h"
+
 namespace Envoy {
 namespace Extensions {
 namespace StatSinks {
@@ -81,14 +83,21 @@ using GrpcMetricsStreamerImplPtr = std::unique_ptr<GrpcMetricsStreamerImpl>;
 
 class MetricsFlusher {
 public:
+  struct GaugeValue {
+    uint64_t name_hash_;
+    uint64_t value_;
+  };
+  using GaugeValueMap = absl::flat_hash_map<const Stats::Gauge*, GaugeValue>;
+
   MetricsFlusher(
       bool report_counters_as_deltas, bool emit_labels,
       std::function<bool(const Stats::Metric&)> predicate =
-          [](const auto& metric) { return metric.used(); })
+          [](const auto& metric) { return metric.used(); },
+      bool report_only_changed_metrics = false)
       : report_counters_as_deltas_(report_counters_as_deltas), emit_labels_(emit_labels),
-        predicate_(predicate) {}
+        report_only_changed_metrics_(report_only_changed_metrics), predicate_(predicate) {}
 
-  MetricsPtr flush(Stats::MetricSnapshot& snapshot) const;
+  MetricsPtr flush(Stats::MetricSnapshot& snapshot);
 
 private:
   void flushCounter(io::prometheus::client::MetricFamily& metrics_family,
@@ -108,7 +117,14 @@ private:
 
   const bool report_counters_as_deltas_;
   const bool emit_labels_;
+  const bool report_only_changed_metrics_;
   const std::function<bool(const Stats::Metric&)> predicate_;
+
+  // The value of each gauge as of the previous flush, used to skip unchanged gauges when
+  // report_only_changed_metrics_ is set. The map is rebuilt on every flush so that gauges which
+  // have been freed do not accumulate. Entries are keyed by address, so the stat name hash is kept
+  // as well to detect a new gauge allocated at the address of a freed one.
+  GaugeValueMap last_gauge_values_;
 };
 
 /**
@@ -118,9 +134,12 @@ template <class RequestProto, class ResponseProto> class MetricsServiceSink : pu
 public:
   MetricsServiceSink(
       const GrpcMetricsStreamerSharedPtr<RequestProto, ResponseProto>& grpc_metrics_streamer,
-      bool report_counters_as_deltas, bool emit_labels)
-      : MetricsServiceSink(grpc_metrics_streamer,
-                           MetricsFlusher(report_counters_as_deltas, emit_labels)) {}
+      bool report_counters_as_deltas, bool emit_labels, bool report_only_changed_metrics = false)
+      : MetricsServiceSink(
+            grpc_metrics_streamer,
+            MetricsFlusher(
+                report_counters_as_deltas, emit_labels,
+                [](const auto& metric) { return metric.used(); }, report_only_changed_metrics)) {}
 
   MetricsServiceSink(
       const GrpcMetricsStreamerSharedPtr<RequestProto, ResponseProto>& grpc_metrics_streamer,
@@ -134,7 +153,7 @@ public:
   void onHistogramComplete(const Stats::Histogram&, uint64_t) override {}
 
 private:
-  const MetricsFlusher flusher_;
+  MetricsFlusher flusher_;
   GrpcMetricsStreamerSharedPtr<RequestProto, ResponseProto> grpc_metrics_streamer_;
 };
 
@@ -584,7 +584,7 @@ ClientContextImpl::ClientContextImpl(Stats::Scope& scope,
               static_cast<ContextImpl*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
           ClientContextImpl* client_context_impl = dynamic_cast<ClientContextImpl*>(context_impl);
           RELEASE_ASSERT(client_context_impl != nullptr, ""); // for Coverity
-          return client_context_impl->newSessionKey(session);
+          return client_context_impl->newSessionKey(ssl, session);
         });
   }
 }
@@ -642,50 +642,101 @@ ClientContextImpl::newSsl(const Network::TransportSocketOptionsConstSharedPtr& o
   }
 
   if (max_session_keys_ > 0) {
+    bool session_set = false;
     if (session_keys_single_use_) {
       // Stored single-use session keys, use write/write locks.
       absl::WriterMutexLock l(&session_keys_mu_);
-      if (!session_keys_.empty()) {
-        // Use the most recently stored session key, since it has the highest
-        // probability of still being recognized/accepted by the server.
-        SSL_SESSION* session = session_keys_.front().get();
-        SSL_set_session(ssl_con.get(), session);
-        // Remove single-use session key (TLS 1.3) after first use.
-        if (SSL_SESSION_should_be_single_use(session)) {
-          session_keys_.pop_front();
+      auto it = session_keys_.find(server_name_indication);
+      if (it != session_keys_.end()) {
+        SessionKeys& session_keys = it->second;
+        evictExpiredSessionKeys(session_keys);
+        if (!session_keys.empty()) {
+          // Use the most recently stored session key, since it has the highest
+          // probability of still being recognized/accepted by the server.
+          SSL_SESSION* session = session_keys.front().get();
+          SSL_set_session(ssl_con.get(), session);
+          session_set = true;
+          // Remove single-use session key (TLS 1.3) after first use.
+          if (SSL_SESSION_should_be_single_use(session)) {
+            session_keys.pop_front();
+          }
+        }
+        if (session_keys.empty()) {
+          session_keys_.erase(it);
         }
       }
     } else {
-      // Never stored single-use session keys, use read/write locks.
+      // Never stored single-use session keys, use read/write locks. Expired session keys are
+      // skipped here and evicted the next time a session key is stored.
       absl::ReaderMutexLock l(&session_keys_mu_);
-      if (!session_keys_.empty()) {
+      auto it = session_keys_.find(server_name_indication);
+      if (it != session_keys_.end() && !it->second.empty() &&
+          !sessionExpired(*it->second.front())) {
         // Use the most recently stored session key, since it has the highest
         // probability of still being recognized/accepted by the server.
-        SSL_SESSION* session = session_keys_.front().get();
-        SSL_set_session(ssl_con.get(), session);
+        SSL_set_session(ssl_con.get(), it->second.front().get());
+        session_set = true;
       }
     }
+    if (session_set) {
+      stats_.session_cache_offered_.inc();
+    } else {
+      stats_.session_cache_miss_.inc();
+    }
   }
 
   return ssl_con;
 }
 
-int ClientContextImpl::newSessionKey(SSL_SESSION* session) {
+int ClientContextImpl::newSessionKey(SSL* ssl, SSL_SESSION* session) {
+  // Bounds the number of server names with stored session keys, so that upstreams selected by
+  // per-request server names (e.g. auto_sni) can't grow the cache without limit.
+  static constexpr size_t MaxSessionKeysServerNames = 1024;
+
   // In case we ever store single-use session key (TLS 1.3),
   // we need to switch to using write/write locks.
   if (SSL_SESSION_should_be_single_use(session)) {
     session_keys_single_use_ = true;
   }
+  const char* server_name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  absl::string_view server_name_view = server_name != nullptr ? server_name : "";
+
   absl::WriterMutexLock l(&session_keys_mu_);
+  auto it = session_keys_.find(server_name_view);
+  if (it == session_keys_.end()) {
+    if (session_keys_.size() >= MaxSessionKeysServerNames) {
+      // Make room by dropping the session keys of an arbitrary server name.
+      session_keys_.erase(session_keys_.begin());
+    }
+    it = session_keys_.emplace(std::string(server_name_view), SessionKeys()).first;
+  }
+  SessionKeys& session_keys = it->second;
+  evictExpiredSessionKeys(session_keys);
   // Evict oldest entries.
-  while (session_keys_.size() >= max_session_keys_) {
-    session_keys_.pop_back();
+  while (session_keys.size() >= max_session_keys_) {
+    session_keys.pop_back();
   }
   // Add new session key at the front of the queue, so that it's used first.
-  session_keys_.push_front(bssl::UniquePtr<SSL_SESSION>(session));
+  session_keys.push_front(bssl::UniquePtr<SSL_SESSION>(session));
   return 1; // Tell BoringSSL that we took ownership of the session.
 }
 
+bool ClientContextImpl::sessionExpired(const SSL_SESSION& session) const {
+  const uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                           time_source_.systemTime().time_since_epoch())
+                           .count();
+  return static_cast<uint64_t>(SSL_SESSION_get_time(&session)) +
+             static_cast<uint64_t>(SSL_SESSION_get_timeout(&session)) <=
+         now;
+}
+
+void ClientContextImpl::evictExpiredSessionKeys(SessionKeys& session_keys) const {
+  // Session keys are stored newest first, so expired ones accumulate at the back.
+  while (!session_keys.empty() && sessionExpired(*session_keys.back())) {
+    session_keys.pop_back();
+  }
+}
+
 uint16_t ClientContextImpl::parseSigningAlgorithmsForTest(const std::string& sigalgs) {
   // This is used only when testing RSA/ECDSA certificate selection, so only the signing algorithms
   // used in tests are supported here.
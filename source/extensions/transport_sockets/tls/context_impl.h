@@ -21,6 +21,7 @@
 #include "source/extensions/transport_sockets/tls/ocsp/ocsp.h"
 #include "source/extensions/transport_sockets/tls/stats.h"
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 #include "openssl/ssl.h"
 #include "openssl/x509v3.h"
@@ -150,14 +151,21 @@ public:
   newSsl(const Network::TransportSocketOptionsConstSharedPtr& options) override;
 
 private:
-  int newSessionKey(SSL_SESSION* session);
+  // Session keys stored for a single server name, most recently stored first.
+  using SessionKeys = std::deque<bssl::UniquePtr<SSL_SESSION>>;
+
+  int newSessionKey(SSL* ssl, SSL_SESSION* session);
+  bool sessionExpired(const SSL_SESSION& session) const;
+  void evictExpiredSessionKeys(SessionKeys& session_keys) const;
   uint16_t parseSigningAlgorithmsForTest(const std::string& sigalgs);
 
   const std::string server_name_indication_;
   const bool allow_renegotiation_;
   const size_t max_session_keys_;
   absl::Mutex session_keys_mu_;
-  std::deque<bssl::UniquePtr<SSL_SESSION>> session_keys_ ABSL_GUARDED_BY(session_keys_mu_);
+  // Keyed by server name indication, since a session can only be resumed with the server which
+  // issued it. The context is shared by all workers, so sessions are resumed across workers.
+  absl::flat_hash_map<std::string, SessionKeys> session_keys_ ABSL_GUARDED_BY(session_keys_mu_);
   bool session_keys_single_use_{false};
 };
 
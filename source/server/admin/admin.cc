@@ -133,8 +133,11 @@ AdminImpl::AdminImpl(const std::string& profile_path, Server::Instance& server,
           makeHandler("/ready", "print server state, return 200 if LIVE, otherwise return 503",
                       MAKE_ADMIN_HANDLER(server_info_handler_.handlerReady), false, false),
           makeStreamingHandler("/stats", "print server stats", stats_handler_, false, false),
-          makeHandler("/stats/prometheus", "print server stats in prometheus format",
-                      MAKE_ADMIN_HANDLER(stats_handler_.handlerPrometheusStats), false, false),
+          {"/stats/prometheus", "print server stats in prometheus format",
+           [this](absl::string_view path, AdminStream& admin_stream) -> Admin::RequestPtr {
+             return stats_handler_.makePrometheusRequest(path, admin_stream);
+           },
+           false, false},
           makeHandler("/stats/recentlookups", "Show recent stat-name lookups",
                       MAKE_ADMIN_HANDLER(stats_handler_.handlerStatsRecentLookups), false, false),
           makeHandler("/stats/recentlookups/clear", "clear list of stat-name lookups and counter",
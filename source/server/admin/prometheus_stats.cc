@@ -77,26 +77,105 @@ struct MetricLessThan {
   }
 };
 
+template <class StatType>
+using GenerateOutputFn = std::function<std::string(const StatType& metric,
+                                                   const std::string& prefixed_tag_extracted_name)>;
+
+/**
+ * Collects the metrics of one stat type (counter, gauge, histogram) into groups keyed by
+ * tag-extracted metric name, which can then be rendered one group at a time in sorted order.
+ *
+ * This holds dumb-pointers to the metrics (no need to increment then decrement every refcount);
+ * ownership must be held by the caller for the lifetime of this object.
+ */
+template <class StatType> class MetricGroups {
+public:
+  /**
+   * @param symbol_table the symbol table shared by all the metrics.
+   * @param params the request parameters, used to filter the metrics.
+   * @param metrics The metrics to output stats for. This must contain all stats of the given type
+   *        to be included in the same output.
+   */
+  MetricGroups(const Stats::SymbolTable& symbol_table, const StatsParams& params,
+               const std::vector<Stats::RefcountPtr<StatType>>& metrics)
+      : symbol_table_(symbol_table), groups_(symbol_table) {
+    for (const auto& metric : metrics) {
+      ASSERT(&symbol_table_ == &metric->constSymbolTable());
+      if (!shouldShowMetric(*metric, params)) {
+        continue;
+      }
+      groups_[metric->tagExtractedStatName()].push_back(metric.get());
+    }
+  }
+
+  bool empty() const { return groups_.empty(); }
+
+  /**
+   * Renders the group with the lowest tag-extracted name into response, and removes it.
+   *
+   * @param response The buffer to put the output into.
+   * @param generate_output A function which returns the output text for this metric.
+   * @param type The name of the prometheus metric type for used in TYPE annotations.
+   * @param custom_namespaces namespace mappings used for the metric name.
+   * @return uint64_t 1 if the metric family was rendered, 0 if its name is not valid in prometheus.
+   */
+  uint64_t renderNextGroup(Buffer::Instance& response,
+                           const GenerateOutputFn<StatType>& generate_output,
+                           absl::string_view type,
+                           const Stats::CustomStatNamespaces& custom_namespaces) {
+    ASSERT(!groups_.empty());
+    auto group = groups_.begin();
+    uint64_t result = 0;
+    const absl::optional<std::string> prefixed_tag_extracted_name =
+        PrometheusStatsFormatter::metricName(symbol_table_.toString(group->first),
+                                             custom_namespaces);
+    if (prefixed_tag_extracted_name.has_value()) {
+      response.add(fmt::format("# TYPE {0} {1}\n", prefixed_tag_extracted_name.value(), type));
+
+      // Sort before producing the final output to satisfy the "preferred" ordering from the
+      // prometheus spec: metrics will be sorted by their tags' textual representation, which will
+      // be consistent across calls.
+      std::sort(group->second.begin(), group->second.end(), MetricLessThan());
+
+      for (const auto& metric : group->second) {
+        response.add(generate_output(*metric, prefixed_tag_extracted_name.value()));
+      }
+      response.add("\n");
+      result = 1;
+    }
+    groups_.erase(group);
+    return result;
+  }
+
+private:
+  // This is an unsorted collection of dumb-pointers. It is unsorted for efficiency, but will
+  // be sorted before producing the final output.
+  using StatTypeUnsortedCollection = std::vector<const StatType*>;
+
+  const Stats::SymbolTable& symbol_table_;
+
+  // Sorted collection of metrics sorted by their tagExtractedName, to satisfy the requirements
+  // of the exposition format.
+  std::map<Stats::StatName, StatTypeUnsortedCollection, Stats::StatNameLessThan> groups_;
+};
+
 /**
  * Processes a stat type (counter, gauge, histogram) by generating all output lines, sorting
  * them by tag-extracted metric name, and then outputting them in the correct sorted order into
  * response.
  *
  * @param response The buffer to put the output into.
- * @param used_only Whether to only output stats that are used.
- * @param regex A filter on which stats to output.
+ * @param params The request parameters, used to filter the metrics.
  * @param metrics The metrics to output stats for. This must contain all stats of the given type
  *        to be included in the same output.
  * @param generate_output A function which returns the output text for this metric.
  * @param type The name of the prometheus metric type for used in TYPE annotations.
  */
 template <class StatType>
-uint64_t outputStatType(
-    Buffer::Instance& response, const StatsParams& params,
-    const std::vector<Stats::RefcountPtr<StatType>>& metrics,
-    const std::function<std::string(
-        const StatType& metric, const std::string& prefixed_tag_extracted_name)>& generate_output,
-    absl::string_view type, const Stats::CustomStatNamespaces& custom_namespaces) {
+uint64_t outputStatType(Buffer::Instance& response, const StatsParams& params,
+                        const std::vector<Stats::RefcountPtr<StatType>>& metrics,
+                        const GenerateOutputFn<StatType>& generate_output, absl::string_view type,
+                        const Stats::CustomStatNamespaces& custom_namespaces) {
 
   /*
    * From
@@ -108,13 +187,6 @@ uint64_t outputStatType(
    * prohibitive.
    */
 
-  // This is an unsorted collection of dumb-pointers (no need to increment then decrement every
-  // refcount; ownership is held throughout by `metrics`). It is unsorted for efficiency, but will
-  // be sorted before producing the final output to satisfy the "preferred" ordering from the
-  // prometheus spec: metrics will be sorted by their tags' textual representation, which will be
-  // consistent across calls.
-  using StatTypeUnsortedCollection = std::vector<const StatType*>;
-
   // Return early to avoid crashing when getting the symbol table from the first metric.
   if (metrics.empty()) {
     return 0;
@@ -124,41 +196,10 @@ uint64_t outputStatType(
   // interface. If this assumption changes, the name comparisons in this function
   // will have to change to compare to convert all StatNames to strings before
   // comparison.
-  const Stats::SymbolTable& global_symbol_table = metrics.front()->constSymbolTable();
-
-  // Sorted collection of metrics sorted by their tagExtractedName, to satisfy the requirements
-  // of the exposition format.
-  std::map<Stats::StatName, StatTypeUnsortedCollection, Stats::StatNameLessThan> groups(
-      global_symbol_table);
-
-  for (const auto& metric : metrics) {
-    ASSERT(&global_symbol_table == &metric->constSymbolTable());
-    if (!shouldShowMetric(*metric, params)) {
-      continue;
-    }
-    groups[metric->tagExtractedStatName()].push_back(metric.get());
-  }
-
-  auto result = groups.size();
-  for (auto& group : groups) {
-    const absl::optional<std::string> prefixed_tag_extracted_name =
-        PrometheusStatsFormatter::metricName(global_symbol_table.toString(group.first),
-                                             custom_namespaces);
-    if (!prefixed_tag_extracted_name.has_value()) {
-      --result;
-      continue;
-    }
-    response.add(fmt::format("# TYPE {0} {1}\n", prefixed_tag_extracted_name.value(), type));
-
-    // Sort before producing the final output to satisfy the "preferred" ordering from the
-    // prometheus spec: metrics will be sorted by their tags' textual representation, which will
-    // be consistent across calls.
-    std::sort(group.second.begin(), group.second.end(), MetricLessThan());
-
-    for (const auto& metric : group.second) {
-      response.add(generate_output(*metric, prefixed_tag_extracted_name.value()));
-    }
-    response.add("\n");
+  MetricGroups<StatType> groups(metrics.front()->constSymbolTable(), params, metrics);
+  uint64_t result = 0;
+  while (!groups.empty()) {
+    result += groups.renderNextGroup(response, generate_output, type, custom_namespaces);
   }
   return result;
 }
@@ -286,5 +327,109 @@ uint64_t PrometheusStatsFormatter::statsAsPrometheus(
   return metric_name_count;
 }
 
+namespace {
+
+/**
+ * Renders the metric groups of one stat type, holding a reference to each of
+ * the metrics until the renderer is destroyed.
+ */
+template <class StatType>
+class StatTypeRendererImpl : public PrometheusStatsRequest::StatTypeRenderer {
+public:
+  StatTypeRendererImpl(std::vector<Stats::RefcountPtr<StatType>>&& metrics,
+                       const Stats::SymbolTable& symbol_table, const StatsParams& params,
+                       GenerateOutputFn<StatType> generate_output, absl::string_view type,
+                       const Stats::CustomStatNamespaces& custom_namespaces)
+      : metrics_(std::move(metrics)), groups_(symbol_table, params, metrics_),
+        generate_output_(generate_output), type_(type), custom_namespaces_(custom_namespaces) {}
+
+  // PrometheusStatsRequest::StatTypeRenderer
+  bool renderNextGroup(Buffer::Instance& response) override {
+    if (groups_.empty()) {
+      return false;
+    }
+    groups_.renderNextGroup(response, generate_output_, type_, custom_namespaces_);
+    return true;
+  }
+
+private:
+  const std::vector<Stats::RefcountPtr<StatType>> metrics_;
+  MetricGroups<StatType> groups_;
+  const GenerateOutputFn<StatType> generate_output_;
+  const absl::string_view type_;
+  const Stats::CustomStatNamespaces& custom_namespaces_;
+};
+
+} // namespace
+
+PrometheusStatsRequest::PrometheusStatsRequest(Stats::Store& stats,
+                                               const Stats::CustomStatNamespaces& custom_namespaces,
+                                               const StatsParams& params)
+    : stats_(stats), custom_namespaces_(custom_namespaces), params_(params) {}
+
+PrometheusStatsRequest::~PrometheusStatsRequest() = default;
+
+Http::Code PrometheusStatsRequest::start(Http::ResponseHeaderMap&) {
+  phase_ = Phase::Counters;
+  renderer_ = makeRenderer(phase_);
+  return Http::Code::OK;
+}
+
+bool PrometheusStatsRequest::nextChunk(Buffer::Instance& response) {
+  // nextChunk's contract is to add up to chunk_size_ additional bytes. The
+  // caller is not required to drain the bytes after each call to nextChunk.
+  const uint64_t starting_response_length = response.length();
+  while (response.length() - starting_response_length < chunk_size_) {
+    if (renderer_->renderNextGroup(response)) {
+      continue;
+    }
+
+    // Release the references to the stats of the completed type before
+    // collecting the next one, so we only hold one type at a time.
+    renderer_.reset();
+    switch (phase_) {
+    case Phase::Counters:
+      phase_ = Phase::Gauges;
+      break;
+    case Phase::Gauges:
+      phase_ = Phase::TextReadouts;
+      break;
+    case Phase::TextReadouts:
+      phase_ = Phase::Histograms;
+      break;
+    case Phase::Histograms:
+      return false;
+    }
+    renderer_ = makeRenderer(phase_);
+  }
+  return true;
+}
+
+std::unique_ptr<PrometheusStatsRequest::StatTypeRenderer>
+PrometheusStatsRequest::makeRenderer(Phase phase) {
+  const Stats::SymbolTable& symbol_table = stats_.constSymbolTable();
+  switch (phase) {
+  case Phase::Counters:
+    return std::make_unique<StatTypeRendererImpl<Stats::Counter>>(
+        stats_.counters(), symbol_table, params_, generateNumericOutput<Stats::Counter>, "counter",
+        custom_namespaces_);
+  case Phase::Gauges:
+    return std::make_unique<StatTypeRendererImpl<Stats::Gauge>>(
+        stats_.gauges(), symbol_table, params_, generateNumericOutput<Stats::Gauge>, "gauge",
+        custom_namespaces_);
+  case Phase::TextReadouts:
+    // TextReadout stats are returned in gauge format, so "gauge" type is set intentionally.
+    return std::make_unique<StatTypeRendererImpl<Stats::TextReadout>>(
+        params_.prometheus_text_readouts_ ? stats_.textReadouts()
+                                          : std::vector<Stats::TextReadoutSharedPtr>(),
+        symbol_table, params_, generateTextReadoutOutput, "gauge", custom_namespaces_);
+  case Phase::Histograms:
+    return std::make_unique<StatTypeRendererImpl<Stats::ParentHistogram>>(
+        stats_.histograms(), symbol_table, params_, generateHistogramOutput, "histogram",
+        custom_namespaces_);
+  }
+  PANIC_DUE_TO_CORRUPT_ENUM;
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -4,9 +4,11 @@
 #include <string>
 
 #include "envoy/buffer/buffer.h"
+#include "envoy/server/admin.h"
 #include "envoy/stats/custom_stat_namespaces.h"
 #include "envoy/stats/histogram.h"
 #include "envoy/stats/stats.h"
+#include "envoy/stats/store.h"
 
 #include "source/server/admin/stats_params.h"
 
@@ -47,5 +49,63 @@ public:
              const Stats::CustomStatNamespaces& custom_namespace_factory);
 };
 
+/**
+ * Streams the Prometheus exposition of a stats store in chunks, implementing
+ * the Admin::Request interface.
+ *
+ * The exposition format requires all the metrics sharing a tag-extracted name
+ * to be emitted as one group, so the stats of each type are still collected and
+ * grouped up front. However only one stat type is held at a time, and rendered
+ * text is produced one group at a time until the chunk size is reached, rather
+ * than formatting the entire response in memory before sending any of it.
+ */
+class PrometheusStatsRequest : public Admin::Request {
+public:
+  static constexpr uint64_t DefaultChunkSize = 2 * 1000 * 1000;
+
+  /**
+   * Renders the tag-extracted-name groups of a single stat type.
+   */
+  class StatTypeRenderer {
+  public:
+    virtual ~StatTypeRenderer() = default;
+
+    /**
+     * Renders the next group, if any, into response.
+     * @return bool false if there were no more groups to render.
+     */
+    virtual bool renderNextGroup(Buffer::Instance& response) PURE;
+  };
+
+  PrometheusStatsRequest(Stats::Store& stats, const Stats::CustomStatNamespaces& custom_namespaces,
+                         const StatsParams& params);
+  ~PrometheusStatsRequest() override;
+
+  // Admin::Request
+  Http::Code start(Http::ResponseHeaderMap& response_headers) override;
+  bool nextChunk(Buffer::Instance& response) override;
+
+  // Sets the chunk size.
+  void setChunkSize(uint64_t chunk_size) { chunk_size_ = chunk_size; }
+
+private:
+  // Ordered to match the output of PrometheusStatsFormatter::statsAsPrometheus.
+  enum class Phase {
+    Counters,
+    Gauges,
+    TextReadouts,
+    Histograms,
+  };
+
+  std::unique_ptr<StatTypeRenderer> makeRenderer(Phase phase);
+
+  Stats::Store& stats_;
+  const Stats::CustomStatNamespaces& custom_namespaces_;
+  const StatsParams params_;
+  Phase phase_{Phase::Counters};
+  std::unique_ptr<StatTypeRenderer> renderer_;
+  uint64_t chunk_size_{DefaultChunkSize};
+};
+
 } // namespace Server
 } // namespace Envoy
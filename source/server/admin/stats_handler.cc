@@ -78,23 +78,14 @@ Admin::RequestPtr StatsHandler::makeRequest(absl::string_view path, AdminStream&
     return Admin::makeStaticTextRequest(response, code);
   }
 
-  if (params.format_ == StatsFormat::Prometheus) {
-    // TODO(#16139): modify streaming algorithm to cover Prometheus.
-    //
-    // This may be easiest to accomplish by populating the set
-    // with tagExtractedName(), and allowing for vectors of
-    // stats as multiples will have the same tag-extracted names.
-    // Ideally we'd find a way to do this without slowing down
-    // the non-Prometheus implementations.
-    Buffer::OwnedImpl response;
-    prometheusFlushAndRender(params, response);
-    return Admin::makeStaticTextRequest(response, code);
-  }
-
   if (server_.statsConfig().flushOnAdmin()) {
     server_.flushStats();
   }
 
+  if (params.format_ == StatsFormat::Prometheus) {
+    return makePrometheusRequest(server_.stats(), server_.api().customStatNamespaces(), params);
+  }
+
   return makeRequest(server_.stats(), params);
 }
 
@@ -102,28 +93,28 @@ Admin::RequestPtr StatsHandler::makeRequest(Stats::Store& stats, const StatsPara
   return std::make_unique<StatsRequest>(stats, params);
 }
 
-Http::Code StatsHandler::handlerPrometheusStats(absl::string_view path_and_query,
-                                                Http::ResponseHeaderMap&,
-                                                Buffer::Instance& response, AdminStream&) {
-  return prometheusStats(path_and_query, response);
-}
-
-Http::Code StatsHandler::prometheusStats(absl::string_view path_and_query,
-                                         Buffer::Instance& response) {
+Admin::RequestPtr StatsHandler::makePrometheusRequest(absl::string_view path,
+                                                      AdminStream& /*admin_stream*/) {
   StatsParams params;
-  Http::Code code = params.parse(path_and_query, response);
+  Buffer::OwnedImpl response;
+  Http::Code code = params.parse(path, response);
   if (code != Http::Code::OK) {
-    return code;
+    return Admin::makeStaticTextRequest(response, code);
   }
-  prometheusFlushAndRender(params, response);
-  return Http::Code::OK;
-}
+  params.format_ = StatsFormat::Prometheus;
 
-void StatsHandler::prometheusFlushAndRender(const StatsParams& params, Buffer::Instance& response) {
   if (server_.statsConfig().flushOnAdmin()) {
     server_.flushStats();
   }
-  prometheusRender(server_.stats(), server_.api().customStatNamespaces(), params, response);
+
+  return makePrometheusRequest(server_.stats(), server_.api().customStatNamespaces(), params);
+}
+
+Admin::RequestPtr
+StatsHandler::makePrometheusRequest(Stats::Store& stats,
+                                    const Stats::CustomStatNamespaces& custom_namespaces,
+                                    const StatsParams& params) {
+  return std::make_unique<PrometheusStatsRequest>(stats, custom_namespaces, params);
 }
 
 void StatsHandler::prometheusRender(Stats::Store& stats,
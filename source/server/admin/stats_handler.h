@@ -38,30 +38,38 @@ public:
   Http::Code handlerStatsRecentLookupsEnable(absl::string_view path_and_query,
                                              Http::ResponseHeaderMap& response_headers,
                                              Buffer::Instance& response, AdminStream&);
-  Http::Code handlerPrometheusStats(absl::string_view path_and_query,
-                                    Http::ResponseHeaderMap& response_headers,
-                                    Buffer::Instance& response, AdminStream&);
-
   /**
-   * Parses and executes a prometheus stats request.
+   * Renders the stats as prometheus into a single buffer. This is retained
+   * to facilitate the benchmark (test/server/admin/stats_handler_speed_test.cc),
+   * which compares it against the streaming implementation.
    *
-   * @param path_and_query the URL path and query
+   * @params stats the stats store to read
+   * @param custom_namespaces namespace mappings used for prometheus
+   * @params params the already-parsed parameters.
    * @param response buffer into which to write response
-   * @return http response code
    */
-  Http::Code prometheusStats(absl::string_view path_and_query, Buffer::Instance& response);
+  static void prometheusRender(Stats::Store& stats,
+                               const Stats::CustomStatNamespaces& custom_namespaces,
+                               const StatsParams& params, Buffer::Instance& response);
+
+  Http::Code handlerContention(absl::string_view path_and_query,
+                               Http::ResponseHeaderMap& response_headers,
+                               Buffer::Instance& response, AdminStream&);
+  Admin::RequestPtr makeRequest(absl::string_view path, AdminStream& admin_stream);
+  static Admin::RequestPtr makeRequest(Stats::Store& stats, const StatsParams& params);
 
   /**
-   * Checks the server_ to see if a flush is needed, and then renders the
-   * prometheus stats request.
+   * Creates a streaming request for /stats/prometheus, which renders in
+   * prometheus format irrespective of the format query parameter.
    *
-   * @params params the already-parsed parameters.
-   * @param response buffer into which to write response
+   * @param path the URL path and query
+   * @param admin_stream the admin stream
+   * @return the request
    */
-  void prometheusFlushAndRender(const StatsParams& params, Buffer::Instance& response);
+  Admin::RequestPtr makePrometheusRequest(absl::string_view path, AdminStream& admin_stream);
 
   /**
-   * Renders the stats as prometheus. This is broken out as a separately
+   * Creates a streaming prometheus request. This is broken out as a separately
    * callable API to facilitate the benchmark
    * (test/server/admin/stats_handler_speed_test.cc) which does not have a
    * server object.
@@ -69,17 +77,11 @@ public:
    * @params stats the stats store to read
    * @param custom_namespaces namespace mappings used for prometheus
    * @params params the already-parsed parameters.
-   * @param response buffer into which to write response
+   * @return the request
    */
-  static void prometheusRender(Stats::Store& stats,
-                               const Stats::CustomStatNamespaces& custom_namespaces,
-                               const StatsParams& params, Buffer::Instance& response);
-
-  Http::Code handlerContention(absl::string_view path_and_query,
-                               Http::ResponseHeaderMap& response_headers,
-                               Buffer::Instance& response, AdminStream&);
-  Admin::RequestPtr makeRequest(absl::string_view path, AdminStream& admin_stream);
-  static Admin::RequestPtr makeRequest(Stats::Store& stats, const StatsParams& params);
+  static Admin::RequestPtr
+  makePrometheusRequest(Stats::Store& stats, const Stats::CustomStatNamespaces& custom_namespaces,
+                        const StatsParams& params);
 
 private:
   friend class StatsHandlerTest;
@@ -1,5 +1,9 @@
 #include "source/server/listener_impl.h"
 
+#if defined(__linux__)
+#include <linux/filter.h>
+#endif
+
 #include "envoy/config/core/v3/base.pb.h"
 #include "envoy/config/listener/v3/listener.pb.h"
 #include "envoy/config/listener/v3/listener_components.pb.h"
@@ -32,6 +36,8 @@
 #include "source/server/listener_manager_impl.h"
 #include "source/server/transport_socket_config_impl.h"
 
+#include "absl/base/macros.h"
+
 #ifdef ENVOY_ENABLE_QUIC
 #include "source/common/quic/active_quic_listener.h"
 #include "source/common/quic/udp_gso_batch_writer.h"
@@ -68,6 +74,16 @@ bool shouldBindToPort(const envoy::config::listener::v3::Listener& config) {
   return PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, bind_to_port, true) &&
          PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.deprecated_v1(), bind_to_port, true);
 }
+
+// Whether listen() has already been called on the socket, which means it joined its reuse_port
+// group before the sockets created alongside it.
+bool isListening(const Network::Socket& socket) {
+  int listening = 0;
+  socklen_t len = sizeof(listening);
+  const Api::SysCallIntResult result =
+      socket.getSocketOption(SOL_SOCKET, SO_ACCEPTCONN, &listening, &len);
+  return result.return_value_ == 0 && listening != 0;
+}
 } // namespace
 
 ListenSocketFactoryImpl::ListenSocketFactoryImpl(
@@ -115,6 +131,14 @@ ListenSocketFactoryImpl::ListenSocketFactoryImpl(
     }
   }
   ASSERT(sockets_.size() == num_sockets);
+
+  if (socket_creation_options_.reuse_port_cpu_steering_ &&
+      bind_type_ == ListenerComponentFactory::BindType::ReusePort) {
+    reuse_port_group_in_worker_order_ =
+        std::all_of(sockets_.begin(), sockets_.end(), [](const Network::SocketSharedPtr& socket) {
+          return socket != nullptr && !isListening(*socket);
+        });
+  }
 }
 
 ListenSocketFactoryImpl::ListenSocketFactoryImpl(const ListenSocketFactoryImpl& factory_to_clone)
@@ -123,7 +147,8 @@ ListenSocketFactoryImpl::ListenSocketFactoryImpl(const ListenSocketFactoryImpl&
       listener_name_(factory_to_clone.listener_name_),
       tcp_backlog_size_(factory_to_clone.tcp_backlog_size_),
       bind_type_(factory_to_clone.bind_type_),
-      socket_creation_options_(factory_to_clone.socket_creation_options_) {
+      socket_creation_options_(factory_to_clone.socket_creation_options_),
+      reuse_port_group_in_worker_order_(factory_to_clone.reuse_port_group_in_worker_order_) {
   for (auto& socket : factory_to_clone.sockets_) {
     // In the cloning case we always duplicate() the socket. This makes sure that during listener
     // update/drain we don't lose any incoming connections when using reuse_port. Specifically on
@@ -211,6 +236,60 @@ void ListenSocketFactoryImpl::doFinalPreWorkerInit() {
     listen_and_apply_options(*iterator, tcp_backlog_size_);
   }
 #endif
+
+  if (socket_creation_options_.reuse_port_cpu_steering_ &&
+      bind_type_ == ListenerComponentFactory::BindType::ReusePort) {
+    if (reuse_port_group_in_worker_order_) {
+      attachReusePortCpuSteering();
+    } else {
+      // Some sockets joined the group earlier, possibly next to sockets of another process, so
+      // group indices are not worker indices. A program attached by whoever created the group
+      // would steer by the wrong indices, so fall back to the kernel's hash based selection.
+      ENVOY_LOG(warn,
+                "{}: not steering connections by CPU, as the reuse_port group was not created by "
+                "this listener in worker order",
+                listener_name_);
+      detachReusePortCpuSteering();
+    }
+  }
+}
+
+void ListenSocketFactoryImpl::attachReusePortCpuSteering() {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+  // Sockets join the reuse_port group when they start listening, and all of them were created by
+  // this factory and listened to in order, so the group index of each socket matches its worker
+  // index. The kernel only reorders the group when a socket leaves it, and the sockets are shared
+  // with clones of this factory rather than closed while a listener is updated. The program
+  // returns the index of the socket which should receive the connection: the CPU that received it
+  // modulo the number of sockets.
+  sock_filter code[] = {
+      {BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+      {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(sockets_.size())},
+      {BPF_RET | BPF_A, 0, 0, 0},
+  };
+  sock_fprog program = {static_cast<unsigned short>(ABSL_ARRAYSIZE(code)), code};
+  // The program applies to the whole group, so it only needs to be attached to one socket.
+  const Api::SysCallIntResult result = sockets_[0]->setSocketOption(
+      SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program));
+  if (result.return_value_ != 0) {
+    throw EnvoyException(
+        fmt::format("{}: cannot attach reuse_port CPU steering program errno={}", listener_name_,
+                    result.errno_));
+  }
+  ENVOY_LOG(debug, "{}: attached reuse_port CPU steering program for {} sockets", listener_name_,
+            sockets_.size());
+#else
+  throw EnvoyException(fmt::format(
+      "{}: reuse_port CPU steering is not supported by the operating system", listener_name_));
+#endif
+}
+
+void ListenSocketFactoryImpl::detachReusePortCpuSteering() {
+#if defined(__linux__) && defined(SO_DETACH_REUSEPORT_BPF)
+  // Fails with ENOENT when no program is attached, which is the common case.
+  int unused = 0;
+  sockets_[0]->setSocketOption(SOL_SOCKET, SO_DETACH_REUSEPORT_BPF, &unused, sizeof(unused));
+#endif
 }
 
 ListenerFactoryContextBaseImpl::ListenerFactoryContextBaseImpl(
@@ -484,6 +563,16 @@ void ListenerImpl::checkIpv4CompatAddress(const Network::Address::InstanceConstS
 }
 
 void ListenerImpl::validateConfig() {
+  if (config_.enable_reuse_port_cpu_steering()) {
+    if (socket_type_ != Network::Socket::Type::Stream) {
+      throw EnvoyException(fmt::format(
+          "listener {}: enable_reuse_port_cpu_steering can only be used with TCP listeners", name_));
+    }
+    if (!reuse_port_) {
+      throw EnvoyException(fmt::format(
+          "listener {}: enable_reuse_port_cpu_steering requires enable_reuse_port", name_));
+    }
+  }
   if (mptcp_enabled_) {
     if (socket_type_ != Network::Socket::Type::Stream) {
       throw EnvoyException(
@@ -735,6 +824,13 @@ void ListenerImpl::buildConnectionBalancer(const Network::Address::Instance& add
                                       std::make_shared<Network::ExactConnectionBalancerImpl>());
         break;
       }
+      case envoy::config::listener::v3::Listener_ConnectionBalanceConfig::
+          kPowerOfTwoChoicesBalance: {
+        connection_balancers_.emplace(
+            address.asString(),
+            std::make_shared<Network::PowerOfTwoChoicesConnectionBalancerImpl>());
+        break;
+      }
       case envoy::config::listener::v3::Listener_ConnectionBalanceConfig::kExtendBalance: {
         const std::string connection_balance_library_type{TypeUtil::typeUrlToDescriptorFullName(
             config_.connection_balance_config().extend_balance().typed_config().type_url())};
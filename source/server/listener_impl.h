@@ -85,6 +85,8 @@ private:
   Network::SocketSharedPtr createListenSocketAndApplyOptions(ListenerComponentFactory& factory,
                                                              Network::Socket::Type socket_type,
                                                              uint32_t worker_index);
+  void attachReusePortCpuSteering();
+  void detachReusePortCpuSteering();
 
   ListenerComponentFactory& factory_;
   // Initially, its port number might be 0. Once a socket is created, its port
@@ -105,6 +107,11 @@ private:
   // TODO(mattklein123): If a listener does not bind, it still has a socket. This is confusing
   // and not needed and can be cleaned up.
   std::vector<Network::SocketSharedPtr> sockets_;
+  // Whether the reuse_port group of the address is known to be exactly sockets_, joined in worker
+  // order. Only then does the index the CPU steering program returns select the worker's socket.
+  // This is the case when every socket was created here rather than handed over listening, for
+  // example by a hot restart parent, and for clones of such a factory, which share its sockets.
+  bool reuse_port_group_in_worker_order_{false};
 };
 
 // TODO(mattklein123): Consider getting rid of pre-worker start and post-worker start code by
@@ -330,6 +337,7 @@ public:
   }
   bool bindToPort() const override { return bind_to_port_; }
   bool mptcpEnabled() { return mptcp_enabled_; }
+  bool reusePortCpuSteering() const { return config_.enable_reuse_port_cpu_steering(); }
   bool handOffRestoredDestinationConnections() const override {
     return hand_off_restored_destination_connections_;
   }
@@ -1079,6 +1079,7 @@ void ListenerManagerImpl::createListenSocketFactory(ListenerImpl& listener) {
   TRY_ASSERT_MAIN_THREAD {
     Network::SocketCreationOptions creation_options;
     creation_options.mptcp_enabled_ = listener.mptcpEnabled();
+    creation_options.reuse_port_cpu_steering_ = listener.reusePortCpuSteering();
     for (auto& address : listener.addresses()) {
       listener.addSocketFactory(std::make_unique<ListenSocketFactoryImpl>(
           factory_, address, socket_type, listener.listenSocketOptions(), listener.name(),
@@ -120,6 +120,11 @@ OptionsImpl::OptionsImpl(std::vector<std::string> args,
   TCLAP::ValueArg<uint32_t> file_flush_interval_msec("", "file-flush-interval-msec",
                                                      "Interval for log flushing in msec", false,
                                                      10000, "uint32_t", cmd);
+  TCLAP::ValueArg<std::string> file_flush_overflow_policy(
+      "", "file-flush-overflow-policy",
+      "What to do with log writes when the log buffer is full, one of 'block' (default) or "
+      "'drop'.",
+      false, "block", "string", cmd);
   TCLAP::ValueArg<uint32_t> drain_time_s("", "drain-time-s",
                                          "Hot restart and LDS removal drain time in seconds", false,
                                          600, "uint32_t", cmd);
@@ -274,6 +279,15 @@ OptionsImpl::OptionsImpl(std::vector<std::string> args,
     socket_mode_ = socket_mode_helper;
   }
 
+  if (file_flush_overflow_policy.getValue() == "block") {
+    file_flush_overflow_policy_ = AccessLog::FileOverflowPolicy::Block;
+  } else if (file_flush_overflow_policy.getValue() == "drop") {
+    file_flush_overflow_policy_ = AccessLog::FileOverflowPolicy::Drop;
+  } else {
+    throw MalformedArgvException(fmt::format("error: unknown file-flush-overflow-policy '{}'",
+                                             file_flush_overflow_policy.getValue()));
+  }
+
   if (drain_strategy.getValue() == "immediate") {
     drain_strategy_ = Server::DrainStrategy::Immediate;
   } else if (drain_strategy.getValue() == "gradual") {
@@ -415,6 +429,10 @@ Server::CommandLineOptionsPtr OptionsImpl::toCommandLineOptions() const {
   }
   command_line_options->mutable_file_flush_interval()->MergeFrom(
       Protobuf::util::TimeUtil::MillisecondsToDuration(fileFlushIntervalMsec().count()));
+  command_line_options->set_file_flush_overflow_policy(
+      fileFlushOverflowPolicy() == AccessLog::FileOverflowPolicy::Drop
+          ? envoy::admin::v3::CommandLineOptions::Drop
+          : envoy::admin::v3::CommandLineOptions::Block);
 
   command_line_options->mutable_drain_time()->MergeFrom(
       Protobuf::util::TimeUtil::SecondsToDuration(drainTime().count()));
@@ -78,6 +78,9 @@ public:
   void setFileFlushIntervalMsec(std::chrono::milliseconds file_flush_interval_msec) {
     file_flush_interval_msec_ = file_flush_interval_msec;
   }
+  void setFileFlushOverflowPolicy(AccessLog::FileOverflowPolicy file_flush_overflow_policy) {
+    file_flush_overflow_policy_ = file_flush_overflow_policy;
+  }
   void setServiceClusterName(const std::string& service_cluster) {
     service_cluster_ = service_cluster;
   }
@@ -141,6 +144,9 @@ public:
   std::chrono::milliseconds fileFlushIntervalMsec() const override {
     return file_flush_interval_msec_;
   }
+  AccessLog::FileOverflowPolicy fileFlushOverflowPolicy() const override {
+    return file_flush_overflow_policy_;
+  }
   const std::string& serviceClusterName() const override { return service_cluster_; }
   const std::string& serviceNodeName() const override { return service_node_; }
   const std::string& serviceZone() const override { return service_zone_; }
@@ -200,6 +206,7 @@ private:
   std::string service_node_;
   std::string service_zone_;
   std::chrono::milliseconds file_flush_interval_msec_{10000};
+  AccessLog::FileOverflowPolicy file_flush_overflow_policy_{AccessLog::FileOverflowPolicy::Block};
   std::chrono::seconds drain_time_{600};
   std::chrono::seconds parent_shutdown_time_{900};
   Server::DrainStrategy drain_strategy_{Server::DrainStrategy::Gradual};
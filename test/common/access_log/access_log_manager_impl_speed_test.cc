@@ -0,0 +1,60 @@
+// Note: this should be run with --compilation_mode=opt, and would benefit from a
+// quiescent system with disabled cstate power management.
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "source/common/access_log/access_log_manager_impl.h"
+#include "source/common/common/macros.h"
+#include "source/common/stats/isolated_store_impl.h"
+
+#include "test/test_common/utility.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace AccessLog {
+namespace {
+
+// Everything needed to write to an access log file. It is shared by all benchmark threads, and
+// never destroyed so that the flush thread outlives the benchmarks.
+class BenchmarkContext {
+public:
+  BenchmarkContext()
+      : api_(Api::createApiForTest(store_)), dispatcher_(api_->allocateDispatcher("test_thread")),
+        manager_(std::chrono::milliseconds(1000), FileOverflowPolicy::Block, *api_, *dispatcher_,
+                 lock_, store_),
+        file_(manager_.createAccessLog(
+            Filesystem::FilePathAndType{Filesystem::DestinationType::File, "/dev/null"})) {}
+
+  AccessLogFile& file() { return *file_; }
+
+private:
+  Stats::IsolatedStoreImpl store_;
+  Api::ApiPtr api_;
+  Event::DispatcherPtr dispatcher_;
+  Thread::MutexBasicLockable lock_;
+  AccessLogManagerImpl manager_;
+  AccessLogFileSharedPtr file_;
+};
+
+BenchmarkContext& context() { MUTABLE_CONSTRUCT_ON_FIRST_USE(BenchmarkContext); }
+
+// Writes lines of state.range(0) bytes to a single file from a growing number of threads, to
+// measure how writers on different workers contend with each other.
+void accessLogWrite(benchmark::State& state) {
+  AccessLogFile& file = context().file();
+  const std::string line(state.range(0) - 1, 'x');
+  const std::string line_with_newline = line + "\n";
+  for (auto _ : state) {
+    UNREFERENCED_PARAMETER(_);
+    file.write(line_with_newline);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(accessLogWrite)->Arg(128)->Arg(1024)->ThreadRange(1, 16)->UseRealTime();
+
+} // namespace
+} // namespace AccessLog
+} // namespace Envoy
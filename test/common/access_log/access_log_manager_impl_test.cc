@@ -1,4 +1,7 @@
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "source/common/access_log/access_log_manager_impl.h"
 #include "source/common/filesystem/file_shared_impl.h"
@@ -11,6 +14,9 @@
 #include "test/test_common/test_time.h"
 #include "test/test_common/utility.h"
 
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/notification.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -31,7 +37,8 @@ class AccessLogManagerImplTest : public testing::Test {
 protected:
   AccessLogManagerImplTest()
       : file_(new NiceMock<Filesystem::MockFile>), thread_factory_(Thread::threadFactoryForTest()),
-        access_log_manager_(timeout_40ms_, api_, dispatcher_, lock_, store_) {
+        access_log_manager_(timeout_40ms_, FileOverflowPolicy::Block, api_, dispatcher_, lock_,
+                            store_) {
     EXPECT_CALL(file_system_,
                 createFile(testing::Matcher<const Envoy::Filesystem::FilePathAndType&>(
                     Filesystem::FilePathAndType{Filesystem::DestinationType::File, "foo"})))
@@ -170,9 +177,8 @@ TEST_F(AccessLogManagerImplTest, FlushToLogFileOnDemand) {
 
   EXPECT_EQ(0UL, store_.counter("filesystem.flushed_by_timer").value());
 
-  // The first write to a given file will start the flush thread. Because AccessManagerImpl::write
-  // holds the write_lock_ when the thread is started, the thread will flush on its first loop, once
-  // it obtains the write_lock_. Perform a write to get all that out of the way.
+  // The first write of a thread to a given file is flushed right away. Perform a write to get that
+  // out of the way.
   EXPECT_CALL(*file_, write_(_))
       .WillOnce(Invoke([](absl::string_view data) -> Api::IoCallSizeResult {
         return Filesystem::resultSuccess<ssize_t>(static_cast<ssize_t>(data.length()));
@@ -573,6 +579,219 @@ TEST_F(AccessLogManagerImplTest, ReopenAllFiles) {
       .WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
 }
 
+// Lines written concurrently by several threads all end up in the file, each in one piece.
+TEST_F(AccessLogManagerImplTest, WritesFromMultipleThreads) {
+  EXPECT_CALL(*file_, open_(_)).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+  AccessLogFileSharedPtr log_file = access_log_manager_.createAccessLog(
+      Filesystem::FilePathAndType{Filesystem::DestinationType::File, "foo"});
+
+  std::string written;
+  EXPECT_CALL(*file_, write_(_))
+      .WillRepeatedly(Invoke([&](absl::string_view data) -> Api::IoCallSizeResult {
+        written.append(data.data(), data.size());
+        return Filesystem::resultSuccess<ssize_t>(static_cast<ssize_t>(data.length()));
+      }));
+
+  constexpr int num_threads = 4;
+  constexpr int lines_per_thread = 5000;
+  std::vector<Thread::ThreadPtr> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread_factory_.createThread([&log_file, i]() {
+      const std::string line = absl::StrCat("thread", i, "-", std::string(100, 'x'), "\n");
+      for (int j = 0; j < lines_per_thread; ++j) {
+        log_file->write(line);
+      }
+    }));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  log_file->flush();
+
+  EXPECT_EQ(num_threads * lines_per_thread, store_.counter("filesystem.write_buffered").value());
+  EXPECT_EQ(0UL, store_.counter("filesystem.write_dropped").value());
+  waitForGaugeEq("filesystem.write_total_buffered", 0);
+  {
+    Thread::LockGuard lock(file_->write_mutex_);
+    std::vector<int> lines(num_threads);
+    for (absl::string_view line : absl::StrSplit(written, '\n', absl::SkipEmpty())) {
+      ASSERT_EQ(108, line.size());
+      lines[line[6] - '0']++;
+    }
+    for (int i = 0; i < num_threads; ++i) {
+      EXPECT_EQ(lines_per_thread, lines[i]);
+    }
+  }
+
+  EXPECT_CALL(*file_, close_()).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+}
+
+// With the drop policy, writes which fit neither in the ring of the writing thread nor in its
+// overflow buffer are dropped.
+TEST_F(AccessLogManagerImplTest, DropOnOverflow) {
+  AccessLogManagerImpl drop_manager(timeout_40ms_, FileOverflowPolicy::Drop, api_, dispatcher_,
+                                    lock_, store_);
+  EXPECT_CALL(*file_, open_(_)).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+  AccessLogFileSharedPtr log_file = drop_manager.createAccessLog(
+      Filesystem::FilePathAndType{Filesystem::DestinationType::File, "foo"});
+
+  // Hold up the flush thread while it writes out the first write.
+  absl::Notification flushing;
+  absl::Notification unblock;
+  std::string written;
+  EXPECT_CALL(*file_, write_(_))
+      .WillRepeatedly(Invoke([&](absl::string_view data) -> Api::IoCallSizeResult {
+        if (!flushing.HasBeenNotified()) {
+          flushing.Notify();
+          unblock.WaitForNotification();
+        }
+        written.append(data.data(), data.size());
+        return Filesystem::resultSuccess<ssize_t>(static_cast<ssize_t>(data.length()));
+      }));
+  log_file->write("a");
+  flushing.WaitForNotification();
+
+  const std::string fills_ring(AccessLogFileImpl::RING_CAPACITY, 'b');
+  const std::string fills_overflow(AccessLogFileImpl::MAX_OVERFLOW_BYTES, 'c');
+  log_file->write(fills_ring);
+  log_file->write(fills_overflow);
+  log_file->write("d");
+  log_file->write(fills_overflow + "e");
+  EXPECT_EQ(2UL, store_.counter("filesystem.write_dropped").value());
+  EXPECT_EQ(3UL, store_.counter("filesystem.write_buffered").value());
+
+  unblock.Notify();
+  log_file->flush();
+  waitForGaugeEq("filesystem.write_total_buffered", 0);
+  {
+    Thread::LockGuard lock(file_->write_mutex_);
+    EXPECT_EQ("a" + fills_ring + fills_overflow, written);
+  }
+
+  EXPECT_CALL(*file_, close_()).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+}
+
+// With the block policy, a write which fits neither in the ring of the writing thread nor in its
+// overflow buffer waits for the flush thread to make room.
+TEST_F(AccessLogManagerImplTest, BlockOnOverflow) {
+  EXPECT_CALL(*file_, open_(_)).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+  AccessLogFileSharedPtr log_file = access_log_manager_.createAccessLog(
+      Filesystem::FilePathAndType{Filesystem::DestinationType::File, "foo"});
+
+  absl::Notification flushing;
+  absl::Notification unblock;
+  std::string written;
+  EXPECT_CALL(*file_, write_(_))
+      .WillRepeatedly(Invoke([&](absl::string_view data) -> Api::IoCallSizeResult {
+        if (!flushing.HasBeenNotified()) {
+          flushing.Notify();
+          unblock.WaitForNotification();
+        }
+        written.append(data.data(), data.size());
+        return Filesystem::resultSuccess<ssize_t>(static_cast<ssize_t>(data.length()));
+      }));
+  log_file->write("a");
+  flushing.WaitForNotification();
+
+  const std::string fills_ring(AccessLogFileImpl::RING_CAPACITY, 'b');
+  const std::string fills_overflow(AccessLogFileImpl::MAX_OVERFLOW_BYTES, 'c');
+  Thread::ThreadPtr writer = thread_factory_.createThread([&]() {
+    log_file->write(fills_ring);
+    log_file->write(fills_overflow);
+    // Blocks until the flush thread has drained the buffers.
+    log_file->write("d");
+  });
+  waitForCounterEq("filesystem.write_buffered", 3);
+
+  unblock.Notify();
+  writer->join();
+  log_file->flush();
+  EXPECT_EQ(4UL, store_.counter("filesystem.write_buffered").value());
+  EXPECT_EQ(0UL, store_.counter("filesystem.write_dropped").value());
+  waitForGaugeEq("filesystem.write_total_buffered", 0);
+  {
+    Thread::LockGuard lock(file_->write_mutex_);
+    EXPECT_EQ("a" + fills_ring + fills_overflow + "d", written);
+  }
+
+  EXPECT_CALL(*file_, close_()).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+}
+
+// Writes larger than the ring of the writing thread are queued for the flush thread, in order with
+// the other writes of the thread, rather than written out by the writing thread.
+TEST_F(AccessLogManagerImplTest, OversizedWriteIsWrittenByTheFlushThread) {
+  AccessLogManagerImpl drop_manager(timeout_40ms_, FileOverflowPolicy::Drop, api_, dispatcher_,
+                                    lock_, store_);
+  EXPECT_CALL(*file_, open_(_)).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+  AccessLogFileSharedPtr log_file = drop_manager.createAccessLog(
+      Filesystem::FilePathAndType{Filesystem::DestinationType::File, "foo"});
+
+  const std::thread::id writer_id = std::this_thread::get_id();
+  std::string written;
+  EXPECT_CALL(*file_, write_(_))
+      .WillRepeatedly(Invoke([&](absl::string_view data) -> Api::IoCallSizeResult {
+        EXPECT_NE(writer_id, std::this_thread::get_id());
+        written.append(data.data(), data.size());
+        return Filesystem::resultSuccess<ssize_t>(static_cast<ssize_t>(data.length()));
+      }));
+
+  const std::string oversized(AccessLogFileImpl::RING_CAPACITY * 2, 'b');
+  log_file->write("a");
+  log_file->write(oversized);
+  log_file->write("c");
+  EXPECT_EQ(3UL, store_.counter("filesystem.write_buffered").value());
+  EXPECT_EQ(0UL, store_.counter("filesystem.write_dropped").value());
+
+  // The oversized write fills the buffers of the thread past the flush threshold.
+  waitForGaugeEq("filesystem.write_total_buffered", 0);
+  {
+    Thread::LockGuard lock(file_->write_mutex_);
+    EXPECT_EQ("a" + oversized + "c", written);
+  }
+
+  EXPECT_CALL(*file_, close_()).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+}
+
+// The ring of a thread is released once the thread has exited and the ring has been drained,
+// without losing what the thread wrote last.
+TEST_F(AccessLogManagerImplTest, RingOfExitedThreadIsReleased) {
+  EXPECT_CALL(*file_, open_(_)).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+  AccessLogFileSharedPtr log_file = access_log_manager_.createAccessLog(
+      Filesystem::FilePathAndType{Filesystem::DestinationType::File, "foo"});
+  auto& log_file_impl = dynamic_cast<AccessLogFileImpl&>(*log_file);
+
+  std::string written;
+  EXPECT_CALL(*file_, write_(_))
+      .WillRepeatedly(Invoke([&](absl::string_view data) -> Api::IoCallSizeResult {
+        written.append(data.data(), data.size());
+        return Filesystem::resultSuccess<ssize_t>(static_cast<ssize_t>(data.length()));
+      }));
+
+  absl::Notification wrote;
+  absl::Notification exit;
+  Thread::ThreadPtr writer = thread_factory_.createThread([&]() {
+    log_file->write("a");
+    wrote.Notify();
+    exit.WaitForNotification();
+    log_file->write("b");
+  });
+  wrote.WaitForNotification();
+  log_file->flush();
+  EXPECT_EQ(1, log_file_impl.numRingsForTest());
+
+  exit.Notify();
+  writer->join();
+  log_file->flush();
+  EXPECT_EQ(0, log_file_impl.numRingsForTest());
+  waitForGaugeEq("filesystem.write_total_buffered", 0);
+  {
+    Thread::LockGuard lock(file_->write_mutex_);
+    EXPECT_EQ("ab", written);
+  }
+
+  EXPECT_CALL(*file_, close_()).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+}
+
 } // namespace
 } // namespace AccessLog
 } // namespace Envoy
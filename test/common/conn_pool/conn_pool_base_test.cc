@@ -353,6 +353,74 @@ TEST_F(ConnPoolImplBaseTest, ExplicitPreconnectNotHealthy) {
   EXPECT_FALSE(pool_.maybePreconnectImpl(1));
 }
 
+// With adaptive preconnect, streams arriving faster than connections are established cause
+// additional connections to be preconnected, and the estimate decays once traffic stops.
+TEST_F(ConnPoolImplDispatcherBaseTest, AdaptivePreconnect) {
+  ON_CALL(*cluster_, adaptivePreconnect).WillByDefault(Return(true));
+
+  // Without a connection latency sample, only the connection needed for the stream is created.
+  newConnectingClient();
+  time_system_.advanceTimeWait(std::chrono::milliseconds(100));
+  EXPECT_CALL(pool_, onPoolReady);
+  clients_.back()->onEvent(Network::ConnectionEvent::Connected);
+  EXPECT_EQ(ActiveClient::State::Busy, clients_.back()->state());
+
+  // Connections take 100ms to establish and streams then arrive every 10ms. The average interval
+  // between streams goes 110, 90, 74, 61.2, 50.96 and 42.77ms, so 0, 1, 1, 1, 1 and 2 streams are
+  // anticipated on top of the pending ones. The pool is then provisioned for the 6 pending streams
+  // plus the 2 anticipated ones.
+  EXPECT_CALL(pool_, instantiateActiveClient).Times(8);
+  for (size_t i = 0; i < 6; ++i) {
+    time_system_.advanceTimeWait(std::chrono::milliseconds(10));
+    pool_.newStreamImpl(context_, /*can_send_early_data=*/false);
+  }
+  EXPECT_EQ(9, clients_.size());
+  testing::Mock::VerifyAndClearExpectations(&pool_);
+
+  // Tearing the pool down fails the pending streams, which may preconnect in between.
+  EXPECT_CALL(pool_, instantiateActiveClient).Times(AnyNumber());
+  EXPECT_CALL(pool_, onPoolFailure).Times(AnyNumber());
+  pool_.destructAllConnections();
+  testing::Mock::VerifyAndClearExpectations(&pool_);
+  clients_.clear();
+
+  // After a second without streams, a new stream only creates its own connection.
+  time_system_.advanceTimeWait(std::chrono::seconds(1));
+  EXPECT_CALL(pool_, instantiateActiveClient);
+  pool_.newStreamImpl(context_, /*can_send_early_data=*/false);
+  EXPECT_EQ(1, clients_.size());
+  testing::Mock::VerifyAndClearExpectations(&pool_);
+
+  EXPECT_CALL(pool_, instantiateActiveClient).Times(AnyNumber());
+  EXPECT_CALL(pool_, onPoolFailure).Times(AnyNumber());
+  pool_.destructAllConnections();
+}
+
+// Anticipated streams are served by the unused capacity of the connected connections first, so no
+// connection is preconnected while an idle connection can take them.
+TEST_F(ConnPoolImplDispatcherBaseTest, AdaptivePreconnectUsesIdleCapacity) {
+  ON_CALL(*cluster_, adaptivePreconnect).WillByDefault(Return(true));
+  concurrent_streams_ = 10;
+
+  newConnectingClient();
+  time_system_.advanceTimeWait(std::chrono::milliseconds(100));
+  EXPECT_CALL(pool_, onPoolReady);
+  clients_.back()->onEvent(Network::ConnectionEvent::Connected);
+  EXPECT_EQ(ActiveClient::State::Ready, clients_.back()->state());
+
+  // The same stream rate as above anticipates up to 2 streams, which the connection can still
+  // serve after taking each new stream.
+  EXPECT_CALL(pool_, instantiateActiveClient).Times(0);
+  EXPECT_CALL(pool_, onPoolReady).Times(6);
+  for (size_t i = 0; i < 6; ++i) {
+    time_system_.advanceTimeWait(std::chrono::milliseconds(10));
+    pool_.newStreamImpl(context_, /*can_send_early_data=*/false);
+  }
+  EXPECT_EQ(1, clients_.size());
+  EXPECT_EQ(3, clients_.back()->currentUnusedCapacity());
+  pool_.destructAllConnections();
+}
+
 TEST_F(ConnPoolImplDispatcherBaseTest, MaxConnectionDurationTimerNull) {
   // Force a null max connection duration optional.
   // newActiveClientAndStream() will expect the connection duration timer to remain null.
@@ -1045,6 +1045,35 @@ TEST_F(TimerImplTest, ChangeLargeTimerForwardToNonZeroBeforeRun) {
   });
 }
 
+// Whole-second timers are armed using libevent common timeouts. Verify that they fire in deadline
+// order relative to timers on the heap, and that they can be disabled.
+TEST_F(TimerImplTest, CommonTimeoutTimers) {
+  ReadyWatcher watcher1;
+  Event::TimerPtr timer1 = dispatcher_->createTimer([&] { watcher1.ready(); });
+
+  ReadyWatcher watcher2;
+  Event::TimerPtr timer2 = dispatcher_->createTimer([&] { watcher2.ready(); });
+
+  ReadyWatcher watcher3;
+  Event::TimerPtr timer3 = dispatcher_->createTimer([&] { watcher3.ready(); });
+
+  InSequence s;
+  EXPECT_CALL(prepare_watcher_, ready());
+  EXPECT_CALL(watcher2, ready());
+  EXPECT_CALL(watcher1, ready());
+  runInEventLoop([&]() {
+    timer1->enableTimer(std::chrono::seconds(1));
+    timer2->enableTimer(std::chrono::milliseconds(500));
+    timer3->enableTimer(std::chrono::seconds(1));
+    EXPECT_TRUE(timer3->enabled());
+    timer3->disableTimer();
+    EXPECT_FALSE(timer3->enabled());
+
+    // Advance time past all the deadlines so the timers above trigger in the same loop iteration.
+    advanceLibeventTime(absl::Milliseconds(1010));
+  });
+}
+
 // Timers scheduled at different times execute in order.
 TEST_F(TimerImplTest, TimerOrdering) {
   ReadyWatcher watcher1;
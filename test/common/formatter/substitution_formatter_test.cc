@@ -186,6 +186,31 @@ TEST(SubstitutionFormatterTest, plainStringFormatter) {
               ProtoEq(ValueUtil::stringValue("plain")));
 }
 
+// formatTo() appends what format() returns, and leaves the output unchanged if there is no value.
+TEST(SubstitutionFormatterTest, formatToMatchesFormat) {
+  NiceMock<StreamInfo::MockStreamInfo> stream_info;
+  Http::TestRequestHeaderMapImpl request_headers{{":method", "GET"}, {"long", "0123456789"}};
+  Http::TestResponseHeaderMapImpl response_headers{{"resp", "value"}};
+  Http::TestResponseTrailerMapImpl response_trailers{{"trailer", "value"}};
+  std::string body = "local reply";
+  stream_info.response_code_ = 200;
+
+  const std::vector<FormatterProviderPtr> providers = SubstitutionFormatParser::parse(
+      "plain %REQ(:METHOD)% %REQ(LONG):4% %REQ(MISSING)% %RESP(RESP)% %TRAILER(TRAILER)% "
+      "%RESPONSE_CODE% %BYTES_RECEIVED% %DURATION% %DOWNSTREAM_REMOTE_ADDRESS% "
+      "%DOWNSTREAM_REMOTE_ADDRESS_WITHOUT_PORT% %DOWNSTREAM_REMOTE_PORT% %PROTOCOL% "
+      "%LOCAL_REPLY_BODY%");
+  for (const auto& provider : providers) {
+    const absl::optional<std::string> expected =
+        provider->format(request_headers, response_headers, response_trailers, stream_info, body);
+    std::string output = "prefix";
+    EXPECT_EQ(expected.has_value(), provider->formatTo(request_headers, response_headers,
+                                                       response_trailers, stream_info, body,
+                                                       output));
+    EXPECT_EQ(absl::StrCat("prefix", expected.value_or("")), output);
+  }
+}
+
 TEST(SubstitutionFormatterTest, streamInfoFormatter) {
   EXPECT_THROW(StreamInfoFormatter formatter("unknown_field"), EnvoyException);
 
@@ -3333,6 +3358,57 @@ TEST(SubstitutionFormatterTest, JsonFormatterTest) {
   EXPECT_TRUE(TestUtility::jsonStringEqual(out_json, expected));
 }
 
+// The JSON written directly by StructFormatter::formatJson() matches the protobuf serialization
+// of the Struct built by StructFormatter::format().
+TEST(SubstitutionFormatterTest, StructFormatterJsonMatchesStruct) {
+  NiceMock<StreamInfo::MockStreamInfo> stream_info;
+  Http::TestRequestHeaderMapImpl request_header{{"quoted", "a \"quoted\"\tvalue\\"},
+                                                {"number", "42"}};
+  Http::TestResponseHeaderMapImpl response_header;
+  Http::TestResponseTrailerMapImpl response_trailer;
+  std::string body;
+
+  envoy::config::core::v3::Metadata metadata;
+  populateMetadataTestData(metadata);
+  EXPECT_CALL(stream_info, dynamicMetadata()).WillRepeatedly(ReturnRef(metadata));
+  EXPECT_CALL(Const(stream_info), dynamicMetadata()).WillRepeatedly(ReturnRef(metadata));
+  absl::optional<Http::Protocol> protocol = Http::Protocol::Http11;
+  EXPECT_CALL(stream_info, protocol()).WillRepeatedly(Return(protocol));
+  stream_info.response_code_ = 200;
+
+  ProtobufWkt::Struct key_mapping;
+  TestUtility::loadFromYaml(R"EOF(
+    "key with \"quotes\"": '%REQ(QUOTED)%'
+    missing: '%REQ(MISSING)%'
+    combined: '%REQ(MISSING)% %PROTOCOL%'
+    response_code: '%RESPONSE_CODE%'
+    metadata: '%DYNAMIC_METADATA(com.test)%'
+    nested:
+      number: '%REQ(NUMBER)%'
+      missing: '%RESP(MISSING)%'
+      list:
+        - '%REQ(MISSING)%'
+        - '%PROTOCOL%'
+        - plain
+  )EOF",
+                            key_mapping);
+
+  for (const bool preserve_types : {false, true}) {
+    for (const bool omit_empty_values : {false, true}) {
+      StructFormatter formatter(key_mapping, preserve_types, omit_empty_values);
+      const std::string expected = MessageUtil::getJsonStringFromMessageOrDie(
+          formatter.format(request_header, response_header, response_trailer, stream_info, body),
+          false, true);
+
+      std::string out_json;
+      formatter.formatJson(request_header, response_header, response_trailer, stream_info, body,
+                           out_json);
+      EXPECT_TRUE(TestUtility::jsonStringEqual(out_json, expected))
+          << out_json << " != " << expected;
+    }
+  }
+}
+
 TEST(SubstitutionFormatterTest, CompositeFormatterSuccess) {
   Http::TestRequestHeaderMapImpl request_header{{"first", "GET"}, {":path", "/"}};
   Http::TestResponseHeaderMapImpl response_header{{"second", "PUT"}, {"test", "test"}};
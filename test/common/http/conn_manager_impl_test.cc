@@ -1367,7 +1367,7 @@ TEST_F(HttpConnectionManagerImplTest, StartAndFinishSpanNormalFlow) {
   }
   tracing_config_ = std::make_unique<TracingConnectionManagerConfig>(
       TracingConnectionManagerConfig{Tracing::OperationName::Ingress, conn_tracing_tags, percent1,
-                                     percent2, percent1, false, 256});
+                                     percent2, percent1, false, 256, nullptr});
   NiceMock<Router::MockRouteTracing> route_tracing;
   ON_CALL(route_tracing, getClientSampling()).WillByDefault(ReturnRef(percent1));
   ON_CALL(route_tracing, getRandomSampling()).WillByDefault(ReturnRef(percent2));
@@ -1653,7 +1653,8 @@ TEST_F(HttpConnectionManagerImplTest, StartAndFinishSpanNormalFlowEgressDecorato
                                      percent2,
                                      percent1,
                                      false,
-                                     256});
+                                     256,
+                                     nullptr});
 
   auto* span = new NiceMock<Tracing::MockSpan>();
   EXPECT_CALL(*tracer_, startSpan_(_, _, _, _))
@@ -1736,7 +1737,8 @@ TEST_F(HttpConnectionManagerImplTest, StartAndFinishSpanNormalFlowEgressDecorato
                                      percent2,
                                      percent1,
                                      false,
-                                     256});
+                                     256,
+                                     nullptr});
 
   auto* span = new NiceMock<Tracing::MockSpan>();
   EXPECT_CALL(*tracer_, startSpan_(_, _, _, _))
@@ -1821,7 +1823,8 @@ TEST_F(HttpConnectionManagerImplTest, StartAndFinishSpanNormalFlowEgressDecorato
                                      percent2,
                                      percent1,
                                      false,
-                                     256});
+                                     256,
+                                     nullptr});
 
   auto* span = new NiceMock<Tracing::MockSpan>();
   EXPECT_CALL(*tracer_, startSpan_(_, _, _, _))
@@ -1898,7 +1901,8 @@ TEST_F(HttpConnectionManagerImplTest,
                                      percent2,
                                      percent1,
                                      false,
-                                     256});
+                                     256,
+                                     nullptr});
 
   EXPECT_CALL(
       runtime_.snapshot_,
@@ -2367,6 +2371,79 @@ TEST_F(HttpConnectionManagerImplTest, DoNotStartSpanIfTracingIsNotEnabled) {
   conn_manager_->onData(fake_input, false);
 }
 
+TEST_F(HttpConnectionManagerImplTest, TailSamplingWrapsSpansOfUnsampledRequests) {
+  setup(false, "");
+
+  tracing_config_->tail_sampler_ = std::make_shared<Tracing::TailSampler>(
+      std::chrono::milliseconds(100), true, 16, factory_context_.thread_local_,
+      test_time_.timeSystem(), "tracing.tail_sampling.", fake_stats_);
+
+  // Tracing isn't globally enabled, so neither request is sampled up front.
+  auto* span = new NiceMock<Tracing::MockSpan>();
+  ON_CALL(*span, getTraceIdAsHex()).WillByDefault(Return("abc"));
+  auto* health_check_span = new NiceMock<Tracing::MockSpan>();
+  ON_CALL(*health_check_span, getTraceIdAsHex()).WillByDefault(Return("def"));
+  EXPECT_CALL(*tracer_, startSpan_(_, _, _, _))
+      .WillOnce(Return(span))
+      .WillOnce(Return(health_check_span));
+
+  std::shared_ptr<MockStreamDecoderFilter> filter(new NiceMock<MockStreamDecoderFilter>());
+  EXPECT_CALL(*filter, decodeHeaders(_, true))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](RequestHeaderMap& headers, bool) -> FilterHeadersStatus {
+        // The span of the request is the one wrapped by the tail sampler.
+        EXPECT_NE(static_cast<Tracing::Span*>(span), &filter->callbacks_->activeSpan());
+        EXPECT_NE(static_cast<Tracing::Span*>(health_check_span),
+                  &filter->callbacks_->activeSpan());
+        if (headers.getPathValue() == "/healthcheck") {
+          // As done by the health check filter, which runs after the span is started.
+          filter->callbacks_->streamInfo().healthCheck(true);
+          filter->callbacks_->activeSpan().setSampled(false);
+        }
+        return FilterHeadersStatus::StopIteration;
+      }));
+
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](FilterChainManager& manager) -> void {
+        auto factory = createDecoderFilterFactoryCb(filter);
+        manager.applyFilterFactoryCb({}, factory);
+      }));
+
+  EXPECT_CALL(*codec_, dispatch(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](Buffer::Instance& data) -> Http::Status {
+        decoder_ = &conn_manager_->newStream(response_encoder_);
+
+        RequestHeaderMapPtr headers{new TestRequestHeaderMapImpl{
+            {":authority", "host"},
+            {":path", data.length() == 4 ? "/" : "/healthcheck"},
+            {":method", "GET"}}};
+        decoder_->decodeHeaders(std::move(headers), true);
+
+        ResponseHeaderMapPtr response_headers{new TestResponseHeaderMapImpl{{":status", "200"}}};
+        filter->callbacks_->streamInfo().setResponseCodeDetails("");
+        filter->callbacks_->encodeHeaders(std::move(response_headers), true, "details");
+
+        data.drain(2);
+        return Http::okStatus();
+      }));
+
+  // The fast request is recorded, and the health check is left out of tail sampling.
+  EXPECT_CALL(*span, setSampled(_)).Times(0);
+  EXPECT_CALL(*span, finishSpan());
+  EXPECT_CALL(*health_check_span, setSampled(false));
+  EXPECT_CALL(*health_check_span, setSampled(true)).Times(0);
+  EXPECT_CALL(*health_check_span, finishSpan());
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input, false);
+  conn_manager_->onData(fake_input, false);
+
+  EXPECT_EQ(1, fake_stats_.counterFromString("tracing.tail_sampling.recorded").value());
+  EXPECT_EQ(0, fake_stats_.counterFromString("tracing.tail_sampling.exported").value());
+}
+
 TEST_F(HttpConnectionManagerImplTest, NoPath) {
   setup(false, "");
 
@@ -92,7 +92,8 @@ void HttpConnectionManagerImplTest::setup(bool ssl, const std::string& server_na
                                        percent2,
                                        percent1,
                                        false,
-                                       256});
+                                       256,
+                                       nullptr});
   }
 }
 
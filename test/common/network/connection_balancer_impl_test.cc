@@ -0,0 +1,148 @@
+#include <atomic>
+#include <vector>
+
+#include "source/common/network/connection_balancer_impl.h"
+
+#include "test/test_common/thread_factory_for_test.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Network {
+namespace {
+
+class TestBalancedConnectionHandler : public BalancedConnectionHandler {
+public:
+  // BalancedConnectionHandler
+  uint64_t numConnections() const override { return num_connections_; }
+  void incNumConnections() override { ++num_connections_; }
+  void post(ConnectionSocketPtr&&) override {}
+  void onAcceptWorker(ConnectionSocketPtr&&, bool, bool) override {}
+
+  uint64_t num_connections_{};
+};
+
+// Handler that may be picked concurrently, and that records being picked while unregistered.
+class ConcurrentBalancedConnectionHandler : public BalancedConnectionHandler {
+public:
+  // BalancedConnectionHandler
+  uint64_t numConnections() const override { return num_connections_; }
+  void incNumConnections() override {
+    if (!registered_) {
+      picked_while_unregistered_ = true;
+    }
+    ++num_connections_;
+  }
+  void post(ConnectionSocketPtr&&) override {}
+  void onAcceptWorker(ConnectionSocketPtr&&, bool, bool) override {}
+
+  std::atomic<uint64_t> num_connections_{};
+  std::atomic<bool> registered_{};
+  std::atomic<bool> picked_while_unregistered_{};
+};
+
+TEST(PowerOfTwoChoicesConnectionBalancerImplTest, SingleHandler) {
+  PowerOfTwoChoicesConnectionBalancerImpl balancer;
+  TestBalancedConnectionHandler handler;
+  balancer.registerHandler(handler);
+
+  EXPECT_EQ(&handler, &balancer.pickTargetHandler(handler));
+  EXPECT_EQ(1, handler.numConnections());
+
+  balancer.unregisterHandler(handler);
+  EXPECT_EQ(&handler, &balancer.pickTargetHandler(handler));
+  EXPECT_EQ(2, handler.numConnections());
+}
+
+// Connections accepted by a single handler are spread out, since the accepting handler only keeps
+// a connection while no randomly chosen handler has fewer connections.
+TEST(PowerOfTwoChoicesConnectionBalancerImplTest, BalancesConnections) {
+  PowerOfTwoChoicesConnectionBalancerImpl balancer;
+  std::vector<TestBalancedConnectionHandler> handlers(4);
+  for (auto& handler : handlers) {
+    balancer.registerHandler(handler);
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    balancer.pickTargetHandler(handlers[0]);
+  }
+
+  uint64_t total = 0;
+  for (const auto& handler : handlers) {
+    total += handler.numConnections();
+    EXPECT_GT(handler.numConnections(), 0);
+  }
+  EXPECT_EQ(1000, total);
+  // The accepting handler only keeps a connection when it is not above the randomly chosen one.
+  EXPECT_LT(handlers[0].numConnections(), 500);
+
+  for (auto& handler : handlers) {
+    balancer.unregisterHandler(handler);
+  }
+}
+
+// A handler with more connections than the accepting handler is never chosen.
+TEST(PowerOfTwoChoicesConnectionBalancerImplTest, NeverPicksBusierHandler) {
+  PowerOfTwoChoicesConnectionBalancerImpl balancer;
+  TestBalancedConnectionHandler current;
+  TestBalancedConnectionHandler busy;
+  busy.num_connections_ = 100;
+  balancer.registerHandler(current);
+  balancer.registerHandler(busy);
+
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(&current, &balancer.pickTargetHandler(current));
+  }
+  EXPECT_EQ(50, current.numConnections());
+  EXPECT_EQ(100, busy.numConnections());
+
+  balancer.unregisterHandler(current);
+  balancer.unregisterHandler(busy);
+}
+
+// A handler is never picked once unregisterHandler() returns, even with picks running on other
+// threads, so that it can be destroyed right after being unregistered.
+TEST(PowerOfTwoChoicesConnectionBalancerImplTest, UnregisterWhilePicking) {
+  PowerOfTwoChoicesConnectionBalancerImpl balancer;
+  // The accepting handlers stay registered, each is busy so that the other handlers get picked.
+  std::vector<ConcurrentBalancedConnectionHandler> accepting(2);
+  for (auto& handler : accepting) {
+    handler.num_connections_ = 1000000;
+    handler.registered_ = true;
+    balancer.registerHandler(handler);
+  }
+  std::vector<ConcurrentBalancedConnectionHandler> cycled(4);
+
+  std::atomic<bool> done{false};
+  std::vector<Thread::ThreadPtr> threads;
+  for (auto& handler : accepting) {
+    threads.push_back(Thread::threadFactoryForTest().createThread([&balancer, &handler, &done]() {
+      while (!done) {
+        balancer.pickTargetHandler(handler);
+      }
+    }));
+  }
+
+  for (int i = 0; i < 2000; ++i) {
+    ConcurrentBalancedConnectionHandler& handler = cycled[i % cycled.size()];
+    handler.registered_ = true;
+    balancer.registerHandler(handler);
+    balancer.unregisterHandler(handler);
+    handler.registered_ = false;
+  }
+  done = true;
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  for (const auto& handler : cycled) {
+    EXPECT_FALSE(handler.picked_while_unregistered_);
+  }
+  for (auto& handler : accepting) {
+    balancer.unregisterHandler(handler);
+  }
+}
+
+} // namespace
+} // namespace Network
+} // namespace Envoy
@@ -3002,6 +3002,36 @@ TEST_P(TcpClientConnectionImplTest, BadConnectConnRefusedWithTransportError) {
   EXPECT_THAT(connection->transportFailureReason(), EndsWith("custom error"));
 }
 
+// Whole-second timeouts are armed using libevent common timeouts. Verify with a real dispatcher
+// that such a delayed close timeout still fires and closes the connection when the peer doesn't.
+TEST_P(TcpClientConnectionImplTest, WholeSecondDelayedCloseTimeoutCloses) {
+  // The listener never accepts, so the peer never closes the connection.
+  auto socket = std::make_shared<Network::Test::TcpListenSocketImmediateListen>(
+      Network::Test::getCanonicalLoopbackAddress(GetParam()));
+  ClientConnectionPtr connection = dispatcher_->createClientConnection(
+      socket->connectionInfoProvider().localAddress(), Network::Address::InstanceConstSharedPtr(),
+      Network::Test::createRawBufferSocket(), nullptr, nullptr);
+  NiceMock<MockConnectionCallbacks> callbacks;
+  connection->addConnectionCallbacks(callbacks);
+  connection->setDelayedCloseTimeout(std::chrono::seconds(1));
+
+  EXPECT_CALL(callbacks, onEvent(ConnectionEvent::Connected))
+      .WillOnce(Invoke([&](Network::ConnectionEvent) -> void { dispatcher_->exit(); }));
+  connection->connect();
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+
+  const MonotonicTime start = api_->timeSource().monotonicTime();
+  EXPECT_CALL(callbacks, onEvent(ConnectionEvent::LocalClose))
+      .WillOnce(Invoke([&](Network::ConnectionEvent) -> void { dispatcher_->exit(); }));
+  connection->close(ConnectionCloseType::FlushWriteAndDelay);
+  EXPECT_EQ(Connection::State::Closing, connection->state());
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+
+  EXPECT_EQ(Connection::State::Closed, connection->state());
+  // libevent computes the deadline from the time cached at the start of the loop iteration.
+  EXPECT_GE(api_->timeSource().monotonicTime() - start, std::chrono::milliseconds(900));
+}
+
 class PipeClientConnectionImplTest : public testing::Test {
 protected:
   PipeClientConnectionImplTest()
@@ -63,6 +63,18 @@ public:
     store_.initializeThreading(*dispatcher_, *tls_);
   }
 
+  // Creates one stat of the given type for each sample name, and returns the
+  // number of bytes consumed per stat, including the allocator, central-cache
+  // and (if threading is initialized) TLS-cache overhead. The names are encoded
+  // before measuring, so symbol-table growth is not attributed to the stats.
+  template <class CreateStatFn> double bytesPerStat(CreateStatFn create_stat) {
+    Stats::TestUtil::MemoryTest memory_test;
+    for (auto& stat_name_storage : stat_names_) {
+      create_stat(store_, stat_name_storage->statName());
+    }
+    return static_cast<double>(memory_test.consumedBytes()) / stat_names_.size();
+  }
+
   void initPrefixRejections(const std::string& prefix) {
     stats_config_.mutable_stats_matcher()->mutable_exclusion_list()->add_patterns()->set_prefix(
         prefix);
@@ -133,5 +145,56 @@ static void BM_StatsWithTlsAndRejectionsWithoutDot(benchmark::State& state) {
 }
 BENCHMARK(BM_StatsWithTlsAndRejectionsWithoutDot);
 
+// Measures the memory consumed per stat for counters, gauges and histograms,
+// reported as the "bytes_per_stat" counter. Each iteration builds a fresh
+// store, so the measurement covers first-time allocation of every stat.
+template <class CreateStatFn>
+static void statMemoryBenchmark(benchmark::State& state, bool with_tls, CreateStatFn create_stat) {
+  if (Envoy::Stats::TestUtil::MemoryTest::mode() ==
+      Envoy::Stats::TestUtil::MemoryTest::Mode::Disabled) {
+    state.SkipWithError("memory usage statistics are not available on this platform");
+    return;
+  }
+  double bytes_per_stat = 0;
+  for (auto _ : state) { // NOLINT
+    state.PauseTiming();
+    Envoy::ThreadLocalStorePerf context;
+    if (with_tls) {
+      context.initThreading();
+    }
+    state.ResumeTiming();
+    bytes_per_stat = context.bytesPerStat(create_stat);
+  }
+  state.counters["bytes_per_stat"] = bytes_per_stat;
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_CounterMemory(benchmark::State& state) {
+  statMemoryBenchmark(state, state.range(0) != 0,
+                      [](Envoy::Stats::Store& store, Envoy::Stats::StatName name) {
+                        store.counterFromStatName(name);
+                      });
+}
+BENCHMARK(BM_CounterMemory)->Arg(0)->Arg(1);
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_GaugeMemory(benchmark::State& state) {
+  statMemoryBenchmark(state, state.range(0) != 0,
+                      [](Envoy::Stats::Store& store, Envoy::Stats::StatName name) {
+                        store.gaugeFromStatName(name, Envoy::Stats::Gauge::ImportMode::Accumulate);
+                      });
+}
+BENCHMARK(BM_GaugeMemory)->Arg(0)->Arg(1);
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_HistogramMemory(benchmark::State& state) {
+  statMemoryBenchmark(state, state.range(0) != 0,
+                      [](Envoy::Stats::Store& store, Envoy::Stats::StatName name) {
+                        store.histogramFromStatName(name,
+                                                    Envoy::Stats::Histogram::Unit::Milliseconds);
+                      });
+}
+BENCHMARK(BM_HistogramMemory)->Arg(0)->Arg(1);
+
 // TODO(jmarantz): add multi-threaded variant of this test, that aggressively
 // looks up stats in multiple threads to try to trigger contention issues.
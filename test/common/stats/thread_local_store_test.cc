@@ -1522,6 +1522,24 @@ TEST_F(HistogramTest, MultiHistogramMultipleMerges) {
   EXPECT_EQ(2, validateMerge());
 }
 
+// Validates that statistics stay correct when merges with no new values, which skip recomputing
+// the cumulative statistics, are interleaved with merges that do record values.
+TEST_F(HistogramTest, IdleMergesBetweenRecordedValues) {
+  Histogram& h1 = store_->histogramFromString("h1", Histogram::Unit::Unspecified);
+
+  expectCallAndAccumulate(h1, 5);
+  EXPECT_EQ(1, validateMerge());
+
+  // Two idle merges: the first clears the interval statistics, the second has nothing to update.
+  EXPECT_EQ(1, validateMerge());
+  EXPECT_EQ(1, validateMerge());
+
+  expectCallAndAccumulate(h1, 7);
+  expectCallAndAccumulate(h1, 3);
+  EXPECT_EQ(1, validateMerge());
+  EXPECT_EQ(1, validateMerge());
+}
+
 TEST_F(HistogramTest, BasicScopeHistogramMerge) {
   ScopeSharedPtr scope1 = store_->createScope("scope1.");
 
@@ -1844,6 +1862,45 @@ TEST_F(ClusterShutdownCleanupStarvationTest, TwelveThreadsWithoutBlockade) {
   store_->sync().signal(ThreadLocalStoreImpl::MainDispatcherCleanupSync);
 }
 
+class ConcurrentLookupTest : public ThreadLocalRealThreadsTestBase {
+protected:
+  static constexpr uint32_t NumThreads = 8;
+
+  ConcurrentLookupTest() : ThreadLocalRealThreadsTestBase(NumThreads) {}
+};
+
+// Stats created on one thread are found by every worker through the shared
+// central-cache lookup, and resolve to the same underlying objects.
+TEST_F(ConcurrentLookupTest, ExistingStatsFoundFromAllWorkers) {
+  StatName counter_name = pool_.add("counter");
+  StatName gauge_name = pool_.add("gauge");
+  StatName histogram_name = pool_.add("histogram");
+  ScopeSharedPtr scope;
+  Counter* counter = nullptr;
+  Gauge* gauge = nullptr;
+  Histogram* histogram = nullptr;
+  runOnMainBlocking([&]() {
+    scope = store_->createScope("scope.");
+    counter = &scope->counterFromStatName(counter_name);
+    gauge = &scope->gaugeFromStatName(gauge_name, Gauge::ImportMode::Accumulate);
+    histogram = &scope->histogramFromStatName(histogram_name, Histogram::Unit::Unspecified);
+  });
+
+  runOnAllWorkersBlocking([&]() {
+    for (uint32_t i = 0; i < NumIters; ++i) {
+      Counter& worker_counter = scope->counterFromStatName(counter_name);
+      EXPECT_EQ(counter, &worker_counter);
+      worker_counter.inc();
+      EXPECT_EQ(gauge, &scope->gaugeFromStatName(gauge_name, Gauge::ImportMode::Accumulate));
+      EXPECT_EQ(histogram,
+                &scope->histogramFromStatName(histogram_name, Histogram::Unit::Unspecified));
+    }
+  });
+
+  EXPECT_EQ(NumThreads * NumIters, counter->value());
+  runOnMainBlocking([&scope]() { scope.reset(); });
+}
+
 class HistogramThreadTest : public ThreadLocalRealThreadsTestBase {
 protected:
   static constexpr uint32_t NumThreads = 10;
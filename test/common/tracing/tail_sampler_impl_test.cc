@@ -0,0 +1,276 @@
+#include "source/common/tracing/common_values.h"
+#include "source/common/tracing/tail_sampler_impl.h"
+
+#include "test/common/stats/stat_test_utility.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/mocks/tracing/mocks.h"
+#include "test/test_common/simulated_time_system.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::_;
+using testing::ElementsAre;
+using testing::Eq;
+using testing::HasSubstr;
+using testing::InSequence;
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Tracing {
+namespace {
+
+TailSamplingRecord record(const std::string& trace_id, const std::string& operation) {
+  return {trace_id, operation, SystemTime(), std::chrono::microseconds(1), false};
+}
+
+TEST(TailSamplingRingTest, TakeRemovesTheRecordsOfATrace) {
+  TailSamplingRing ring(4);
+  EXPECT_FALSE(ring.push(record("a", "1")));
+  EXPECT_FALSE(ring.push(record("b", "2")));
+  EXPECT_FALSE(ring.push(record("a", "3")));
+  EXPECT_EQ(3, ring.size());
+
+  std::vector<std::string> operations;
+  for (const auto& taken : ring.take("a")) {
+    operations.push_back(taken.operation_);
+  }
+  EXPECT_THAT(operations, ElementsAre("1", "3"));
+  EXPECT_EQ(1, ring.size());
+  EXPECT_TRUE(ring.take("a").empty());
+  EXPECT_EQ(1, ring.take("b").size());
+  EXPECT_EQ(0, ring.size());
+}
+
+TEST(TailSamplingRingTest, OverwritesTheOldestRecords) {
+  TailSamplingRing ring(2);
+  EXPECT_FALSE(ring.push(record("a", "1")));
+  EXPECT_FALSE(ring.push(record("b", "2")));
+  EXPECT_TRUE(ring.push(record("c", "3")));
+  EXPECT_EQ(2, ring.size());
+  EXPECT_TRUE(ring.take("a").empty());
+  EXPECT_EQ(1, ring.take("b").size());
+  EXPECT_EQ(1, ring.take("c").size());
+}
+
+TEST(TailSamplingRingTest, ReusesTheSlotsOfTakenRecords) {
+  TailSamplingRing ring(3);
+  EXPECT_FALSE(ring.push(record("a", "1")));
+  EXPECT_FALSE(ring.push(record("b", "2")));
+  EXPECT_FALSE(ring.push(record("c", "3")));
+
+  // Taking a record from the middle frees a slot, which the next push uses without overwriting
+  // the record in the slot after the newest one.
+  EXPECT_EQ(1, ring.take("b").size());
+  EXPECT_EQ(2, ring.size());
+  EXPECT_FALSE(ring.push(record("d", "4")));
+  EXPECT_EQ(3, ring.size());
+
+  // Once full again, the oldest record is overwritten first.
+  EXPECT_TRUE(ring.push(record("e", "5")));
+  EXPECT_TRUE(ring.take("a").empty());
+  EXPECT_EQ(1, ring.take("c").size());
+  EXPECT_EQ(1, ring.take("d").size());
+  EXPECT_EQ(1, ring.take("e").size());
+  EXPECT_EQ(0, ring.size());
+}
+
+TEST(TailSamplingExportedTracesTest, ForgetsTheOldestTraces) {
+  TailSamplingExportedTraces traces(2);
+  traces.insert("a");
+  traces.insert("b");
+  // Inserting a trace again doesn't take room.
+  traces.insert("a");
+  EXPECT_TRUE(traces.contains("a"));
+  EXPECT_TRUE(traces.contains("b"));
+
+  traces.insert("c");
+  EXPECT_FALSE(traces.contains("a"));
+  EXPECT_TRUE(traces.contains("b"));
+  EXPECT_TRUE(traces.contains("c"));
+}
+
+class TailSamplerTest : public testing::Test {
+public:
+  void initialize(absl::optional<std::chrono::milliseconds> latency_threshold,
+                  bool export_errors = true, uint32_t max_records_per_worker = 16) {
+    sampler_ = std::make_unique<TailSampler>(latency_threshold, export_errors,
+                                             max_records_per_worker, tls_, time_system_,
+                                             "tracing.tail_sampling.", store_);
+  }
+
+  // Starts a span of the trace, as the tracing driver would for a request not sampled up front.
+  SpanPtr startSpan(const std::string& trace_id, MockSpan*& driver_span) {
+    driver_span = new NiceMock<MockSpan>();
+    ON_CALL(*driver_span, getTraceIdAsHex()).WillByDefault(Return(trace_id));
+    return sampler_->wrap(SpanPtr{driver_span}, "ingress", time_system_.systemTime(),
+                          time_system_.monotonicTime());
+  }
+
+  uint64_t counter(const std::string& name) {
+    return store_.counter("tracing.tail_sampling." + name).value();
+  }
+
+  Event::SimulatedTimeSystem time_system_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  Stats::TestUtil::TestStore store_;
+  NiceMock<MockConfig> config_;
+  std::unique_ptr<TailSampler> sampler_;
+};
+
+TEST_F(TailSamplerTest, FastSpanIsNotExported) {
+  initialize(std::chrono::milliseconds(100));
+  MockSpan* driver_span;
+  SpanPtr span = startSpan("abc", driver_span);
+
+  time_system_.advanceTimeWait(std::chrono::milliseconds(10));
+  EXPECT_CALL(*driver_span, setSampled(_)).Times(0);
+  EXPECT_CALL(*driver_span, finishSpan());
+  span->finishSpan();
+
+  EXPECT_EQ(0, counter("exported"));
+  EXPECT_EQ(1, counter("recorded"));
+}
+
+TEST_F(TailSamplerTest, SlowSpanIsExported) {
+  initialize(std::chrono::milliseconds(100));
+  MockSpan* driver_span;
+  SpanPtr span = startSpan("abc", driver_span);
+
+  time_system_.advanceTimeWait(std::chrono::milliseconds(100));
+  {
+    InSequence s;
+    EXPECT_CALL(*driver_span, setSampled(true));
+    EXPECT_CALL(*driver_span, finishSpan());
+  }
+  span->finishSpan();
+
+  EXPECT_EQ(1, counter("exported"));
+  EXPECT_EQ(0, counter("recorded"));
+}
+
+TEST_F(TailSamplerTest, FailingSpanIsExported) {
+  initialize(absl::nullopt);
+  MockSpan* driver_span;
+  SpanPtr span = startSpan("abc", driver_span);
+
+  EXPECT_CALL(*driver_span, setTag(Eq(Tags::get().Error), Eq(Tags::get().True)));
+  span->setTag(Tags::get().Error, Tags::get().True);
+  {
+    InSequence s;
+    EXPECT_CALL(*driver_span, setSampled(true));
+    EXPECT_CALL(*driver_span, finishSpan());
+  }
+  span->finishSpan();
+
+  EXPECT_EQ(1, counter("exported"));
+}
+
+TEST_F(TailSamplerTest, FailingSpanIsNotExportedIfErrorsAreNot) {
+  initialize(std::chrono::milliseconds(100), false);
+  MockSpan* driver_span;
+  SpanPtr span = startSpan("abc", driver_span);
+
+  span->setTag(Tags::get().Error, Tags::get().True);
+  EXPECT_CALL(*driver_span, setSampled(_)).Times(0);
+  EXPECT_CALL(*driver_span, finishSpan());
+  span->finishSpan();
+
+  EXPECT_EQ(0, counter("exported"));
+  EXPECT_EQ(1, counter("recorded"));
+}
+
+TEST_F(TailSamplerTest, RecordsAreAttachedToTheExportedSpanOfTheTrace) {
+  initialize(std::chrono::milliseconds(100));
+  MockSpan* fast_span;
+  startSpan("abc", fast_span)->finishSpan();
+  MockSpan* other_span;
+  startSpan("def", other_span)->finishSpan();
+  EXPECT_EQ(2, counter("recorded"));
+
+  MockSpan* slow_span;
+  SpanPtr span = startSpan("abc", slow_span);
+  time_system_.advanceTimeWait(std::chrono::milliseconds(200));
+  {
+    InSequence s;
+    EXPECT_CALL(*slow_span, log(_, HasSubstr("operation=ingress")));
+    EXPECT_CALL(*slow_span, setSampled(true));
+    EXPECT_CALL(*slow_span, finishSpan());
+  }
+  span->finishSpan();
+
+  EXPECT_EQ(1, counter("records_attached"));
+}
+
+TEST_F(TailSamplerTest, ChildOfExportedSpanIsExported) {
+  initialize(std::chrono::milliseconds(100));
+  MockSpan* driver_span;
+  SpanPtr span = startSpan("abc", driver_span);
+
+  auto* driver_child = new NiceMock<MockSpan>();
+  ON_CALL(*driver_child, getTraceIdAsHex()).WillByDefault(Return("abc"));
+  EXPECT_CALL(*driver_span, spawnChild_(_, "child", _)).WillOnce(Return(driver_child));
+  SpanPtr child = span->spawnChild(config_, "child", time_system_.systemTime());
+
+  // The failing child is exported, and so is its parent finishing after it however fast.
+  EXPECT_CALL(*driver_child, setSampled(true));
+  child->setTag(Tags::get().Error, Tags::get().True);
+  child->finishSpan();
+  EXPECT_CALL(*driver_span, setSampled(true));
+  span->finishSpan();
+
+  EXPECT_EQ(2, counter("exported"));
+}
+
+TEST_F(TailSamplerTest, LaterRequestOfExportedTraceIsExported) {
+  initialize(std::chrono::milliseconds(100));
+  MockSpan* slow_span;
+  SpanPtr span = startSpan("abc", slow_span);
+  time_system_.advanceTimeWait(std::chrono::milliseconds(200));
+  span->finishSpan();
+
+  // A fast span of another request of the same trace is exported as well, unlike one of another
+  // trace.
+  MockSpan* fast_span;
+  span = startSpan("abc", fast_span);
+  EXPECT_CALL(*fast_span, setSampled(true));
+  span->finishSpan();
+  MockSpan* other_span;
+  span = startSpan("def", other_span);
+  EXPECT_CALL(*other_span, setSampled(_)).Times(0);
+  span->finishSpan();
+
+  EXPECT_EQ(2, counter("exported"));
+  EXPECT_EQ(1, counter("recorded"));
+}
+
+TEST_F(TailSamplerTest, SpanLeftOutOfTracingIsNeitherExportedNorRecorded) {
+  initialize(std::chrono::milliseconds(100));
+  MockSpan* driver_span;
+  SpanPtr span = startSpan("abc", driver_span);
+
+  EXPECT_CALL(*driver_span, setSampled(false));
+  span->setSampled(false);
+  time_system_.advanceTimeWait(std::chrono::milliseconds(200));
+  EXPECT_CALL(*driver_span, setSampled(true)).Times(0);
+  EXPECT_CALL(*driver_span, finishSpan());
+  span->finishSpan();
+
+  EXPECT_EQ(0, counter("exported"));
+  EXPECT_EQ(0, counter("recorded"));
+}
+
+TEST_F(TailSamplerTest, OverwrittenRecordsAreCounted) {
+  initialize(absl::nullopt, true, 1);
+  MockSpan* driver_span;
+  startSpan("abc", driver_span)->finishSpan();
+  startSpan("def", driver_span)->finishSpan();
+
+  EXPECT_EQ(2, counter("recorded"));
+  EXPECT_EQ(1, counter("records_overwritten"));
+}
+
+} // namespace
+} // namespace Tracing
+} // namespace Envoy
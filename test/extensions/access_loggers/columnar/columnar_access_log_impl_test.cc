@@ -0,0 +1,380 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/extensions/access_loggers/columnar/v3/columnar.pb.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/stats/isolated_store_impl.h"
+#include "source/extensions/access_loggers/columnar/columnar_access_log_impl.h"
+#include "source/extensions/access_loggers/columnar/columnar_format.h"
+#include "source/extensions/access_loggers/columnar/file_writer.h"
+#include "source/extensions/compression/zstd/decompressor/zstd_decompressor_impl.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/stream_info/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/environment.h"
+#include "test/test_common/simulated_time_system.h"
+#include "test/test_common/utility.h"
+
+#include "absl/time/clock.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+namespace {
+
+// A decoded column, with integers rendered in decimal.
+struct DecodedColumn {
+  std::string name_;
+  ColumnEncoding encoding_;
+  std::vector<absl::optional<std::string>> values_;
+};
+
+class PayloadReader {
+public:
+  explicit PayloadReader(absl::string_view data) : data_(data) {}
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      const uint8_t byte = static_cast<uint8_t>(data_[0]);
+      data_.remove_prefix(1);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+  }
+
+  std::string bytes(uint64_t length) {
+    std::string value(data_.substr(0, length));
+    data_.remove_prefix(length);
+    return value;
+  }
+
+  bool empty() const { return data_.empty(); }
+
+private:
+  absl::string_view data_;
+};
+
+std::vector<DecodedColumn> decodePayload(absl::string_view payload) {
+  PayloadReader reader(payload);
+  const uint64_t rows = reader.varint();
+  const uint64_t column_count = reader.varint();
+  std::vector<DecodedColumn> columns(column_count);
+  for (DecodedColumn& column : columns) {
+    column.name_ = reader.bytes(reader.varint());
+    column.encoding_ = static_cast<ColumnEncoding>(reader.bytes(1)[0]);
+    const std::string presence = reader.bytes((rows + 7) / 8);
+    std::vector<std::string> dictionary;
+    if (column.encoding_ == ColumnEncoding::Dictionary) {
+      const uint64_t entries = reader.varint();
+      for (uint64_t i = 0; i < entries; i++) {
+        dictionary.push_back(reader.bytes(reader.varint()));
+      }
+    }
+    for (uint64_t row = 0; row < rows; row++) {
+      if ((presence[row / 8] & (1 << (row % 8))) == 0) {
+        column.values_.push_back(absl::nullopt);
+        continue;
+      }
+      switch (column.encoding_) {
+      case ColumnEncoding::Plain:
+        column.values_.push_back(reader.bytes(reader.varint()));
+        break;
+      case ColumnEncoding::Dictionary:
+        column.values_.push_back(dictionary.at(reader.varint()));
+        break;
+      case ColumnEncoding::Integer: {
+        const uint64_t zigzag = reader.varint();
+        column.values_.push_back(
+            absl::StrCat(static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1)));
+        break;
+      }
+      }
+    }
+  }
+  EXPECT_TRUE(reader.empty());
+  return columns;
+}
+
+// Splits the content of a file into its blocks and returns their decoded payloads.
+std::vector<std::vector<DecodedColumn>> decodeFile(const std::string& content) {
+  Stats::IsolatedStoreImpl store;
+  const Compression::Zstd::Decompressor::ZstdDDictManagerPtr ddict_manager;
+  std::vector<std::vector<DecodedColumn>> blocks;
+
+  Buffer::OwnedImpl buffer(content);
+  while (buffer.length() > 0) {
+    EXPECT_EQ(BlockMagic, buffer.toString().substr(0, BlockMagic.size()));
+    buffer.drain(BlockMagic.size());
+    const uint32_t length = buffer.drainLEInt<uint32_t>();
+    Buffer::OwnedImpl compressed;
+    compressed.move(buffer, length);
+
+    Compression::Zstd::Decompressor::ZstdDecompressorImpl decompressor(store, "test.",
+                                                                      ddict_manager, 4096);
+    Buffer::OwnedImpl payload;
+    decompressor.decompress(compressed, payload);
+    blocks.push_back(decodePayload(payload.toString()));
+  }
+  return blocks;
+}
+
+TEST(ColumnarFormatTest, EncodesColumns) {
+  BlockBuilder builder({{"code", ColumnEncoding::Integer},
+                        {"cluster", ColumnEncoding::Dictionary},
+                        {"path", ColumnEncoding::Plain}});
+
+  const std::vector<absl::optional<int64_t>> codes{
+      200, absl::nullopt, -1, 503, 0, int64_t(1) << 40, 200, 200, 404};
+  const std::vector<absl::optional<std::string>> clusters{
+      "a", "b", "a", absl::nullopt, "a", "c", "b", "a", "a"};
+  for (size_t i = 0; i < codes.size(); i++) {
+    builder.column(0).addInteger(codes[i]);
+    builder.column(1).addString(clusters[i]);
+    builder.column(2).addString(absl::StrCat("/", i));
+    builder.finishRow();
+  }
+  EXPECT_EQ(codes.size(), builder.rows());
+
+  std::string payload;
+  builder.encodePayload(payload);
+  EXPECT_EQ(0, builder.rows());
+
+  const std::vector<DecodedColumn> columns = decodePayload(payload);
+  ASSERT_EQ(3, columns.size());
+  EXPECT_EQ("code", columns[0].name_);
+  EXPECT_EQ(ColumnEncoding::Integer, columns[0].encoding_);
+  EXPECT_EQ("cluster", columns[1].name_);
+  EXPECT_EQ(ColumnEncoding::Dictionary, columns[1].encoding_);
+  EXPECT_EQ("path", columns[2].name_);
+  EXPECT_EQ(ColumnEncoding::Plain, columns[2].encoding_);
+  for (size_t i = 0; i < codes.size(); i++) {
+    EXPECT_EQ(codes[i].has_value() ? absl::make_optional(absl::StrCat(*codes[i])) : absl::nullopt,
+              columns[0].values_[i]);
+    EXPECT_EQ(clusters[i], columns[1].values_[i]);
+    EXPECT_EQ(absl::StrCat("/", i), columns[2].values_[i]);
+  }
+
+  // The next block starts from scratch, including the dictionary.
+  builder.column(0).addInteger(absl::nullopt);
+  builder.column(1).addString("c");
+  builder.column(2).addString(absl::nullopt);
+  builder.finishRow();
+  payload.clear();
+  builder.encodePayload(payload);
+
+  const std::vector<DecodedColumn> next = decodePayload(payload);
+  ASSERT_EQ(3, next.size());
+  EXPECT_EQ(std::vector<absl::optional<std::string>>{absl::nullopt}, next[0].values_);
+  EXPECT_EQ(std::vector<absl::optional<std::string>>{"c"}, next[1].values_);
+  EXPECT_EQ(std::vector<absl::optional<std::string>>{absl::nullopt}, next[2].values_);
+}
+
+class ColumnarAccessLogTest : public testing::Test {
+public:
+  ColumnarAccessLogTest()
+      : api_(Api::createApiForTest(time_system_)),
+        path_(TestEnvironment::temporaryPath(absl::StrCat(
+            "columnar_", testing::UnitTest::GetInstance()->current_test_info()->name()))) {}
+
+  // Name of the sequence-th file opened by a writer for path_.
+  std::string fileName(uint64_t sequence) {
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        time_system_.systemTime().time_since_epoch());
+    return absl::StrCat(path_, ".", now.count(), ".", sequence);
+  }
+
+  void writeBlock(ColumnarFileWriter& writer, absl::string_view data) {
+    writer.write(std::make_unique<Buffer::OwnedImpl>(data));
+  }
+
+  // Waits for the writer thread to have written exactly content to the file.
+  void waitForFileContent(const std::string& name, absl::string_view content) {
+    while (!api_->fileSystem().fileExists(name) ||
+           api_->fileSystem().fileReadToEnd(name) != content) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+  }
+
+  Event::SimulatedTimeSystem time_system_;
+  Api::ApiPtr api_;
+  Stats::IsolatedStoreImpl store_;
+  const std::string path_;
+};
+
+TEST_F(ColumnarAccessLogTest, WriterAppendsBlocksToOneFile) {
+  {
+    ColumnarFileWriter writer(path_, 0, std::chrono::milliseconds(0), *api_, store_);
+    writeBlock(writer, "first");
+    writeBlock(writer, "second");
+  }
+  EXPECT_EQ("firstsecond", TestEnvironment::readFileToStringForTest(fileName(0)));
+}
+
+TEST_F(ColumnarAccessLogTest, WriterRotatesOnSizeBetweenBlocks) {
+  {
+    ColumnarFileWriter writer(path_, 8, std::chrono::milliseconds(0), *api_, store_);
+    writeBlock(writer, "first");
+    writeBlock(writer, "second");
+    writeBlock(writer, "third");
+  }
+  // Blocks are never split, so a file may exceed the limit by up to one block.
+  EXPECT_EQ("firstsecond", TestEnvironment::readFileToStringForTest(fileName(0)));
+  EXPECT_EQ("third", TestEnvironment::readFileToStringForTest(fileName(1)));
+}
+
+TEST_F(ColumnarAccessLogTest, WriterRotatesOnAgeBetweenBlocks) {
+  // Files are named after the time they were opened, so remember the name of the first one.
+  const std::string first_file = fileName(0);
+  {
+    ColumnarFileWriter writer(path_, 0, std::chrono::seconds(10), *api_, store_);
+    writeBlock(writer, "first");
+    waitForFileContent(first_file, "first");
+    time_system_.advanceTimeWait(std::chrono::seconds(9));
+    writeBlock(writer, "second");
+    waitForFileContent(first_file, "firstsecond");
+
+    time_system_.advanceTimeWait(std::chrono::seconds(1));
+    writeBlock(writer, "third");
+    waitForFileContent(fileName(1), "third");
+  }
+  EXPECT_EQ("firstsecond", TestEnvironment::readFileToStringForTest(first_file));
+  EXPECT_EQ("third", TestEnvironment::readFileToStringForTest(fileName(1)));
+}
+
+TEST_F(ColumnarAccessLogTest, WriterDropsBlocksBeyondQueueLimit) {
+  {
+    ColumnarFileWriter writer(path_, 0, std::chrono::milliseconds(0), *api_, store_);
+    // A block larger than the limit can never be queued, however fast the writer thread is.
+    writeBlock(writer, std::string(ColumnarFileWriter::MAX_QUEUED_BYTES + 1, 'x'));
+    writeBlock(writer, "kept");
+  }
+  EXPECT_EQ(1UL, store_.counter("access_logs.columnar.blocks_dropped").value());
+  EXPECT_EQ(ColumnarFileWriter::MAX_QUEUED_BYTES + 1,
+            store_.counter("access_logs.columnar.bytes_dropped").value());
+  EXPECT_EQ("kept", TestEnvironment::readFileToStringForTest(fileName(0)));
+}
+
+TEST_F(ColumnarAccessLogTest, WriterRegistrySharesWritersByPath) {
+  ColumnarFileWriterRegistry registry;
+  ColumnarFileWriterSharedPtr writer =
+      registry.getOrCreate(path_, 0, std::chrono::milliseconds(0), *api_, store_);
+  EXPECT_EQ(writer, registry.getOrCreate(path_, 0, std::chrono::milliseconds(0), *api_, store_));
+  EXPECT_NE(writer, registry.getOrCreate(path_ + "_other", 0, std::chrono::milliseconds(0),
+                                         *api_, store_));
+}
+
+TEST_F(ColumnarAccessLogTest, WriterRegistryRejectsConflictingRotationSettings) {
+  ColumnarFileWriterRegistry registry;
+  ColumnarFileWriterSharedPtr writer =
+      registry.getOrCreate(path_, 1024, std::chrono::milliseconds(1000), *api_, store_);
+  EXPECT_THROW_WITH_MESSAGE(
+      registry.getOrCreate(path_, 2048, std::chrono::milliseconds(1000), *api_, store_),
+      EnvoyException,
+      fmt::format("columnar access log path '{}' is already in use with different max_file_bytes "
+                  "or max_file_age",
+                  path_));
+  EXPECT_THROW(registry.getOrCreate(path_, 1024, std::chrono::milliseconds(0), *api_, store_),
+               EnvoyException);
+
+  // Once the last logger using the path is gone, the path can be configured anew.
+  writer.reset();
+  EXPECT_NE(nullptr,
+            registry.getOrCreate(path_, 2048, std::chrono::milliseconds(0), *api_, store_));
+}
+
+TEST_F(ColumnarAccessLogTest, IntegerColumnRequiresSingleCommand) {
+  envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog config;
+  TestUtility::loadFromYaml(R"EOF(
+path: /tmp/columnar
+columns:
+- name: code
+  format: "code=%RESPONSE_CODE%"
+  encoding: INTEGER
+)EOF",
+                            config);
+  EXPECT_THROW_WITH_MESSAGE(
+      createColumnarAccessLogConfig(config, nullptr), EnvoyException,
+      "columnar access log: integer column 'code' must have a format of a single command");
+}
+
+TEST_F(ColumnarAccessLogTest, LogsFullBlocksAndFlushesOnTimer) {
+  envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog config;
+  TestUtility::loadFromYaml(R"EOF(
+path: /unused
+columns:
+- name: code
+  format: "%RESPONSE_CODE%"
+  encoding: INTEGER
+- name: method
+  format: "%REQ(:METHOD)%"
+  encoding: DICTIONARY
+- name: path
+  format: "%REQ(:PATH)%?%REQ(x-missing)%"
+- name: upstream
+  format: "%UPSTREAM_HOST%"
+block_rows: 2
+block_flush_interval: 5s
+)EOF",
+                            config);
+
+  NiceMock<ThreadLocal::MockInstance> tls;
+  auto* flush_timer = new NiceMock<Event::MockTimer>(&tls.dispatcher_);
+  NiceMock<StreamInfo::MockStreamInfo> stream_info;
+  stream_info.upstreamInfo()->setUpstreamHost(nullptr);
+  Http::TestResponseHeaderMapImpl response_headers;
+  Http::TestResponseTrailerMapImpl response_trailers;
+
+  {
+    auto writer = std::make_shared<ColumnarFileWriter>(path_, 0, std::chrono::milliseconds(0),
+                                                       *api_, store_);
+    ColumnarAccessLog log(nullptr, createColumnarAccessLogConfig(config, writer), tls);
+    writer.reset();
+
+    const std::vector<std::pair<std::string, uint32_t>> requests{
+        {"GET", 200}, {"POST", 503}, {"GET", 404}};
+    for (size_t i = 0; i < requests.size(); i++) {
+      Http::TestRequestHeaderMapImpl request_headers{{":method", requests[i].first},
+                                                     {":path", absl::StrCat("/", i)}};
+      stream_info.response_code_ = requests[i].second;
+      if (i == 2) {
+        EXPECT_CALL(*flush_timer, enableTimer(std::chrono::milliseconds(5000), _));
+      }
+      log.log(&request_headers, &response_headers, &response_trailers, stream_info);
+    }
+
+    // The partial block is written out when the timer fires, and nothing is left on shutdown.
+    flush_timer->invokeCallback();
+  }
+
+  const std::vector<std::vector<DecodedColumn>> blocks =
+      decodeFile(TestEnvironment::readFileToStringForTest(fileName(0)));
+  ASSERT_EQ(2, blocks.size());
+
+  using Values = std::vector<absl::optional<std::string>>;
+  ASSERT_EQ(4, blocks[0].size());
+  EXPECT_EQ((Values{"200", "503"}), blocks[0][0].values_);
+  EXPECT_EQ((Values{"GET", "POST"}), blocks[0][1].values_);
+  EXPECT_EQ((Values{"/0?-", "/1?-"}), blocks[0][2].values_);
+  EXPECT_EQ((Values{absl::nullopt, absl::nullopt}), blocks[0][3].values_);
+
+  ASSERT_EQ(4, blocks[1].size());
+  EXPECT_EQ((Values{"404"}), blocks[1][0].values_);
+  EXPECT_EQ((Values{"GET"}), blocks[1][1].values_);
+  EXPECT_EQ((Values{"/2?-"}), blocks[1][2].values_);
+  EXPECT_EQ((Values{absl::nullopt}), blocks[1][3].values_);
+}
+
+} // namespace
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
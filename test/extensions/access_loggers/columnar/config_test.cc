@@ -0,0 +1,80 @@
+#include "envoy/extensions/access_loggers/columnar/v3/columnar.pb.h"
+#include "envoy/registry/registry.h"
+
+#include "source/extensions/access_loggers/columnar/config.h"
+
+#include "test/mocks/server/factory_context.h"
+#include "test/test_common/thread_factory_for_test.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::ReturnRef;
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace Columnar {
+namespace {
+
+TEST(ColumnarAccessLogConfigTest, ValidateFail) {
+  NiceMock<Server::Configuration::MockServerFactoryContext> context;
+
+  EXPECT_THROW(
+      ColumnarAccessLogFactory().createAccessLogInstance(
+          envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog(), nullptr, context),
+      ProtoValidationException);
+}
+
+TEST(ColumnarAccessLogConfigTest, CreatesLogger) {
+  auto* factory =
+      Registry::FactoryRegistry<Server::Configuration::AccessLogInstanceFactory>::getFactory(
+          "envoy.access_loggers.columnar");
+  ASSERT_NE(nullptr, factory);
+
+  envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog config;
+  TestUtility::loadFromYaml(R"EOF(
+path: /tmp/columnar
+columns:
+- name: code
+  format: "%RESPONSE_CODE%"
+  encoding: INTEGER
+max_file_bytes: 1048576
+max_file_age: 3600s
+)EOF",
+                            config);
+
+  NiceMock<Server::Configuration::MockServerFactoryContext> context;
+  ON_CALL(context.api_, threadFactory()).WillByDefault(ReturnRef(Thread::threadFactoryForTest()));
+  AccessLog::InstanceSharedPtr first = factory->createAccessLogInstance(config, nullptr, context);
+  AccessLog::InstanceSharedPtr second = factory->createAccessLogInstance(config, nullptr, context);
+  EXPECT_NE(nullptr, first);
+  EXPECT_NE(nullptr, second);
+}
+
+TEST(ColumnarAccessLogConfigTest, WriterStatsUseServerScope) {
+  envoy::extensions::access_loggers::columnar::v3::ColumnarAccessLog config;
+  TestUtility::loadFromYaml(R"EOF(
+path: /tmp/columnar_server_scope
+columns:
+- name: code
+  format: "%RESPONSE_CODE%"
+  encoding: INTEGER
+)EOF",
+                            config);
+
+  NiceMock<Server::Configuration::MockServerFactoryContext> context;
+  ON_CALL(context.api_, threadFactory()).WillByDefault(ReturnRef(Thread::threadFactoryForTest()));
+  // The writer outlives the listener whose logger created it, so it must not count into the
+  // listener scope.
+  EXPECT_CALL(context, scope()).Times(0);
+  EXPECT_CALL(context, serverScope());
+  EXPECT_NE(nullptr, ColumnarAccessLogFactory().createAccessLogInstance(config, nullptr, context));
+}
+
+} // namespace
+} // namespace Columnar
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
@@ -88,6 +88,10 @@ private:
 
   bool isEmpty() override { return message_.fields().empty(); }
 
+  bool isHighPriority(const ProtobufWkt::Struct& entry) const override {
+    return entry.fields().contains("high-key");
+  }
+
   void initMessage() override { ++num_inits_; }
 
   void clearMessage() override {
@@ -112,6 +116,13 @@ public:
     return entry;
   }
 
+  // Same size as mockHttpEntry(), but of high priority.
+  ProtobufWkt::Struct mockHighPriorityHttpEntry() {
+    ProtobufWkt::Struct entry;
+    entry.mutable_fields()->insert({"high-key", ProtobufWkt::Value()});
+    return entry;
+  }
+
   void initLogger(std::chrono::milliseconds buffer_flush_interval_msec, size_t buffer_size_bytes) {
     timer_ = new Event::MockTimer(&dispatcher_);
     EXPECT_CALL(*timer_, enableTimer(buffer_flush_interval_msec, _));
@@ -246,6 +257,56 @@ TEST_F(GrpcAccessLogTest, WatermarksOverrun) {
             TestUtility::findCounter(stats_store_, "mock_access_log_prefix.logs_dropped")->value());
 }
 
+// Test that entries keep accumulating up to the hard limit while the stream is backed up, with low
+// priority entries sampled, and go out in a single message once the stream drains.
+TEST_F(GrpcAccessLogTest, SamplingWhileBackedUp) {
+  const uint64_t entry_size = mockHttpEntry().ByteSizeLong();
+  ASSERT_EQ(entry_size, mockHighPriorityHttpEntry().ByteSizeLong());
+  config_.mutable_buffer_limit_bytes()->set_value(9 * entry_size);
+  initLogger(FlushInterval, entry_size);
+
+  MockAccessLogStream stream;
+  AccessLogCallbacks* callbacks;
+  expectStreamStart(stream, &callbacks);
+  EXPECT_CALL(stream, isAboveWriteBufferHighWatermark()).WillRepeatedly(Return(true));
+  EXPECT_CALL(stream, sendMessageRaw_(_, _)).Times(0);
+
+  // The first entry fills the batch, after that one in 2 and then one in 4 low priority entries
+  // are kept as the buffer fills up.
+  for (int i = 0; i < 9; i++) {
+    logger_->log(mockHttpEntry());
+  }
+  EXPECT_EQ(4,
+            TestUtility::findCounter(stats_store_, "mock_access_log_prefix.logs_written")->value());
+  EXPECT_EQ(
+      5, TestUtility::findCounter(stats_store_, "mock_access_log_prefix.logs_sampled_out")->value());
+
+  // High priority entries are all kept until the hard limit, and dropped after that.
+  for (int i = 0; i < 6; i++) {
+    logger_->log(mockHighPriorityHttpEntry());
+  }
+  EXPECT_EQ(9,
+            TestUtility::findCounter(stats_store_, "mock_access_log_prefix.logs_written")->value());
+  EXPECT_EQ(1,
+            TestUtility::findCounter(stats_store_, "mock_access_log_prefix.logs_dropped")->value());
+  EXPECT_EQ(0, logger_->numClears());
+
+  // Once the stream drains, the whole batch goes out as one message.
+  std::vector<int> sent_entries;
+  EXPECT_CALL(stream, isAboveWriteBufferHighWatermark()).WillRepeatedly(Return(false));
+  EXPECT_CALL(stream, sendMessageRaw_(_, false))
+      .WillRepeatedly(Invoke([&sent_entries](Buffer::InstancePtr& request, bool) {
+        ProtobufWkt::Struct message;
+        Buffer::ZeroCopyInputStreamImpl request_stream(std::move(request));
+        EXPECT_TRUE(message.ParseFromZeroCopyStream(&request_stream));
+        sent_entries.push_back(message.fields().at(MOCK_HTTP_LOG_FIELD_NAME).number_value());
+      }));
+  logger_->log(mockHttpEntry());
+  EXPECT_EQ((std::vector<int>{9, 1}), sent_entries);
+  EXPECT_EQ(10,
+            TestUtility::findCounter(stats_store_, "mock_access_log_prefix.logs_written")->value());
+}
+
 // Test that stream failure is handled correctly.
 TEST_F(GrpcAccessLogTest, StreamFailure) {
   initLogger(FlushInterval, 0);
@@ -67,6 +67,20 @@ public:
 // Normal OK configuration.
 TEST_F(HttpGrpcAccessLogConfigTest, Ok) { run("good_cluster"); }
 
+// The backlog is sent as a single message, so it must stay below the gRPC message size limit.
+TEST_F(HttpGrpcAccessLogConfigTest, BufferLimitAboveMessageSizeLimit) {
+  auto* common_config = http_grpc_access_log_.mutable_common_config();
+  common_config->set_log_name("foo");
+  common_config->mutable_grpc_service()->mutable_envoy_grpc()->set_cluster_name("good_cluster");
+  common_config->set_transport_api_version(envoy::config::core::v3::ApiVersion::V3);
+  common_config->mutable_buffer_limit_bytes()->set_value(4 * 1024 * 1024);
+  TestUtility::jsonConvert(http_grpc_access_log_, *message_);
+
+  EXPECT_THROW_WITH_REGEX(
+      factory_->createAccessLogInstance(*message_, std::move(filter_), context_),
+      ProtoValidationException, "BufferLimitBytes");
+}
+
 } // namespace
 } // namespace HttpGrpc
 } // namespace AccessLoggers
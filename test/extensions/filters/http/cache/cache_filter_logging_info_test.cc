@@ -22,6 +22,7 @@ TEST(Coverage, LookupStatusToString) {
   EXPECT_EQ(lookupStatusToString(LookupStatus::RequestNotCacheable), "RequestNotCacheable");
   EXPECT_EQ(lookupStatusToString(LookupStatus::RequestIncomplete), "RequestIncomplete");
   EXPECT_EQ(lookupStatusToString(LookupStatus::LookupError), "LookupError");
+  EXPECT_EQ(lookupStatusToString(LookupStatus::CoalescedHit), "CoalescedHit");
   EXPECT_ENVOY_BUG(lookupStatusToString(static_cast<LookupStatus>(99)), "Unexpected LookupStatus");
 }
 
@@ -762,6 +762,178 @@ TEST_F(CacheFilterTest, FilterDeletedBeforePostedCallbackExecuted) {
   }
 }
 
+class CacheFilterCoalescingTest : public CacheFilterTest {
+protected:
+  void SetUp() override {
+    CacheFilterTest::SetUp();
+    request_headers_.setHost("Coalescing");
+    ON_CALL(follower_decoder_callbacks_, dispatcher())
+        .WillByDefault(::testing::ReturnRef(*dispatcher_));
+    ON_CALL(follower_decoder_callbacks_.stream_info_, filterState())
+        .WillByDefault(::testing::ReturnRef(follower_filter_state_));
+  }
+
+  CacheFilterSharedPtr makeCoalescingFilter(Http::MockStreamDecoderFilterCallbacks& callbacks) {
+    auto filter =
+        std::make_shared<CacheFilter>(config_, /*stats_prefix=*/"", context_.scope(),
+                                      context_.timeSource(), simple_cache_, coalescer_);
+    filter->setDecoderFilterCallbacks(callbacks);
+    filter->setEncoderFilterCallbacks(encoder_callbacks_);
+    return filter;
+  }
+
+  // Starts the lookups of a leader and a follower, which both miss the cache.
+  void startLeaderAndFollower() {
+    leader_ = makeCoalescingFilter(decoder_callbacks_);
+    follower_ = makeCoalescingFilter(follower_decoder_callbacks_);
+    EXPECT_EQ(leader_->decodeHeaders(request_headers_, true),
+              Http::FilterHeadersStatus::StopAllIterationAndWatermark);
+    EXPECT_EQ(follower_->decodeHeaders(request_headers_, true),
+              Http::FilterHeadersStatus::StopAllIterationAndWatermark);
+
+    // Only the leader is sent upstream.
+    EXPECT_CALL(decoder_callbacks_, continueDecoding);
+    EXPECT_CALL(follower_decoder_callbacks_, continueDecoding).Times(0);
+    runPostedCallbacks();
+    ::testing::Mock::VerifyAndClearExpectations(&decoder_callbacks_);
+    ::testing::Mock::VerifyAndClearExpectations(&follower_decoder_callbacks_);
+  }
+
+  // Runs the callbacks posted to the dispatcher, without waiting for the coalescing timer.
+  void runPostedCallbacks() { dispatcher_->run(Event::Dispatcher::RunType::NonBlock); }
+
+  LookupStatus followerLookupStatus() {
+    follower_->onStreamComplete();
+    return follower_filter_state_
+        ->getDataReadOnly<CacheFilterLoggingInfo>(CacheFilterLoggingInfo::FilterStateKey)
+        ->lookupStatus();
+  }
+
+  void TearDown() override {
+    if (leader_) {
+      leader_->onDestroy();
+    }
+    follower_->onDestroy();
+  }
+
+  RequestCoalescerSharedPtr coalescer_ = std::make_shared<RequestCoalescer>(
+      envoy::extensions::filters::http::cache::v3::CacheConfig::RequestCoalescing());
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> follower_decoder_callbacks_;
+  std::shared_ptr<StreamInfo::FilterState> follower_filter_state_ =
+      std::make_shared<StreamInfo::FilterStateImpl>(StreamInfo::FilterState::LifeSpan::FilterChain);
+  CacheFilterSharedPtr leader_;
+  CacheFilterSharedPtr follower_;
+};
+
+TEST_F(CacheFilterCoalescingTest, FollowerServedLeaderResponse) {
+  startLeaderAndFollower();
+  const std::string body = "abc";
+  Buffer::OwnedImpl body_buffer(body);
+
+  EXPECT_CALL(follower_decoder_callbacks_,
+              encodeHeaders_(IsSupersetOfHeaders(response_headers_), false));
+  EXPECT_CALL(
+      follower_decoder_callbacks_,
+      encodeData(testing::Property(&Buffer::Instance::toString, testing::Eq(body)), true));
+  EXPECT_EQ(leader_->encodeHeaders(response_headers_, false), Http::FilterHeadersStatus::Continue);
+  EXPECT_EQ(leader_->encodeData(body_buffer, true), Http::FilterDataStatus::Continue);
+  runPostedCallbacks();
+
+  EXPECT_EQ(followerLookupStatus(), LookupStatus::CoalescedHit);
+  leader_->onStreamComplete();
+  EXPECT_THAT(lookupStatus(), IsOkAndHolds(LookupStatus::CacheMiss));
+  EXPECT_THAT(insertStatus(), IsOkAndHolds(InsertStatus::InsertSucceeded));
+}
+
+TEST_F(CacheFilterCoalescingTest, FollowerSentUpstreamIfResponseNotShareable) {
+  startLeaderAndFollower();
+  response_headers_.setCopy(Http::CustomHeaders::get().CacheControl, "no-store");
+
+  EXPECT_CALL(follower_decoder_callbacks_, continueDecoding);
+  EXPECT_CALL(follower_decoder_callbacks_, encodeHeaders_).Times(0);
+  EXPECT_EQ(leader_->encodeHeaders(response_headers_, true), Http::FilterHeadersStatus::Continue);
+  runPostedCallbacks();
+
+  EXPECT_EQ(followerLookupStatus(), LookupStatus::CacheMiss);
+}
+
+TEST_F(CacheFilterCoalescingTest, FollowerSentUpstreamOnTimeout) {
+  startLeaderAndFollower();
+
+  EXPECT_CALL(follower_decoder_callbacks_, continueDecoding);
+  time_source_.advanceTimeAsync(std::chrono::seconds(5));
+  runPostedCallbacks();
+  ::testing::Mock::VerifyAndClearExpectations(&follower_decoder_callbacks_);
+
+  // The leader's response isn't sent to the follower any more.
+  EXPECT_CALL(follower_decoder_callbacks_, encodeHeaders_).Times(0);
+  EXPECT_EQ(leader_->encodeHeaders(response_headers_, true), Http::FilterHeadersStatus::Continue);
+  runPostedCallbacks();
+}
+
+TEST_F(CacheFilterCoalescingTest, FollowerResetIfLeaderResetMidResponse) {
+  startLeaderAndFollower();
+
+  EXPECT_CALL(follower_decoder_callbacks_, encodeHeaders_(testing::_, false));
+  EXPECT_EQ(leader_->encodeHeaders(response_headers_, false), Http::FilterHeadersStatus::Continue);
+  runPostedCallbacks();
+
+  EXPECT_CALL(follower_decoder_callbacks_, resetStream);
+  leader_->onDestroy();
+  leader_.reset();
+  runPostedCallbacks();
+}
+
+TEST_F(CacheFilterCoalescingTest, FollowerSentUpstreamIfContentLengthTooLarge) {
+  envoy::extensions::filters::http::cache::v3::CacheConfig::RequestCoalescing config;
+  config.mutable_max_body_bytes()->set_value(2);
+  coalescer_ = std::make_shared<RequestCoalescer>(config);
+  startLeaderAndFollower();
+  response_headers_.setContentLength(3);
+
+  EXPECT_CALL(follower_decoder_callbacks_, continueDecoding);
+  EXPECT_CALL(follower_decoder_callbacks_, encodeHeaders_).Times(0);
+  EXPECT_EQ(leader_->encodeHeaders(response_headers_, false), Http::FilterHeadersStatus::Continue);
+  runPostedCallbacks();
+}
+
+TEST_F(CacheFilterCoalescingTest, FollowerResetIfBodyGrowsTooLarge) {
+  envoy::extensions::filters::http::cache::v3::CacheConfig::RequestCoalescing config;
+  config.mutable_max_body_bytes()->set_value(2);
+  coalescer_ = std::make_shared<RequestCoalescer>(config);
+  startLeaderAndFollower();
+
+  EXPECT_CALL(follower_decoder_callbacks_, encodeHeaders_(testing::_, false));
+  EXPECT_EQ(leader_->encodeHeaders(response_headers_, false), Http::FilterHeadersStatus::Continue);
+  runPostedCallbacks();
+
+  EXPECT_CALL(follower_decoder_callbacks_, encodeData).Times(0);
+  EXPECT_CALL(follower_decoder_callbacks_, resetStream);
+  Buffer::OwnedImpl body_buffer("abc");
+  EXPECT_EQ(leader_->encodeData(body_buffer, true), Http::FilterDataStatus::Continue);
+  runPostedCallbacks();
+}
+
+TEST_F(CacheFilterCoalescingTest, FollowerWaitsForDownstreamToDrain) {
+  startLeaderAndFollower();
+  EXPECT_CALL(follower_decoder_callbacks_, encodeHeaders_(testing::_, false));
+  EXPECT_EQ(leader_->encodeHeaders(response_headers_, false), Http::FilterHeadersStatus::Continue);
+  runPostedCallbacks();
+
+  follower_->onAboveWriteBufferHighWatermark();
+  EXPECT_CALL(follower_decoder_callbacks_, encodeData).Times(0);
+  Buffer::OwnedImpl body_buffer("abc");
+  EXPECT_EQ(leader_->encodeData(body_buffer, true), Http::FilterDataStatus::Continue);
+  runPostedCallbacks();
+  ::testing::Mock::VerifyAndClearExpectations(&follower_decoder_callbacks_);
+
+  EXPECT_CALL(
+      follower_decoder_callbacks_,
+      encodeData(testing::Property(&Buffer::Instance::toString, testing::Eq("abc")), true));
+  follower_->onBelowWriteBufferLowWatermark();
+  EXPECT_EQ(followerLookupStatus(), LookupStatus::CoalescedHit);
+}
+
 class LookupStatusTest
     : public ::testing::TestWithParam<std::tuple<absl::optional<CacheEntryStatus>, FilterState>> {
 protected:
@@ -780,9 +952,12 @@ INSTANTIATE_TEST_SUITE_P(
                     std::make_tuple(CacheEntryStatus::RequiresValidation,
                                     FilterState::DecodeServingFromCache),
                     std::make_tuple(CacheEntryStatus::RequiresValidation, FilterState::Destroyed),
+                    std::make_tuple(CacheEntryStatus::RequiresValidation,
+                                    FilterState::WaitingForCoalescedResponse),
                     std::make_tuple(absl::nullopt, FilterState::ValidatingCachedResponse),
                     std::make_tuple(absl::nullopt, FilterState::DecodeServingFromCache),
                     std::make_tuple(absl::nullopt, FilterState::EncodeServingFromCache),
+                    std::make_tuple(absl::nullopt, FilterState::WaitingForCoalescedResponse),
                     std::make_tuple(absl::nullopt, FilterState::Destroyed)));
 
 // A new type alias for a different type of tests that use the exact same class
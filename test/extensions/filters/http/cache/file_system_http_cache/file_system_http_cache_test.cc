@@ -0,0 +1,447 @@
+#include <memory>
+#include <string>
+
+#include "envoy/extensions/cache/file_system_http_cache/v3/config.pb.h"
+#include "envoy/registry/registry.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/singleton/manager_impl.h"
+#include "source/extensions/filters/http/cache/file_system_http_cache/cache_index.h"
+#include "source/extensions/filters/http/cache/file_system_http_cache/file_system_http_cache.h"
+
+#include "test/common/stats/stat_test_utility.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/server/factory_context.h"
+#include "test/test_common/environment.h"
+#include "test/test_common/file_system_for_test.h"
+#include "test/test_common/logging.h"
+#include "test/test_common/test_time.h"
+#include "test/test_common/utility.h"
+
+#include "absl/synchronization/notification.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+namespace FileSystemHttpCache {
+namespace {
+
+IndexEntry makeEntry(uint32_t segment) { return {segment, 10, 20, segment, 0, 30, 40}; }
+
+class CacheIndexTest : public testing::Test {
+protected:
+  CacheIndexTest() : path_(TestEnvironment::temporaryPath("cache_index_test")) {
+    TestEnvironment::removePath(path_);
+  }
+  ~CacheIndexTest() override { TestEnvironment::removePath(path_); }
+
+  std::unique_ptr<CacheIndex> open(uint32_t capacity = 16) {
+    absl::StatusOr<std::unique_ptr<CacheIndex>> index = CacheIndex::open(path_, capacity);
+    EXPECT_OK(index);
+    return std::move(index.value());
+  }
+
+  const std::string path_;
+};
+
+TEST_F(CacheIndexTest, InsertFindRemove) {
+  std::unique_ptr<CacheIndex> index = open();
+  ASSERT_TRUE(index->tryLock());
+  EXPECT_FALSE(index->find(1).has_value());
+  EXPECT_TRUE(index->insert(1, makeEntry(1)));
+  EXPECT_TRUE(index->insert(17, makeEntry(2)));
+  EXPECT_EQ(2, index->size());
+  EXPECT_EQ(1, index->find(1)->body_segment_);
+  EXPECT_EQ(2, index->find(17)->body_segment_);
+
+  // Replacing an entry doesn't change the size.
+  EXPECT_TRUE(index->insert(1, makeEntry(3)));
+  EXPECT_EQ(2, index->size());
+  EXPECT_EQ(3, index->find(1)->body_segment_);
+
+  // 17 probes past the removed slot of 1.
+  index->remove(1);
+  EXPECT_FALSE(index->find(1).has_value());
+  EXPECT_EQ(2, index->find(17)->body_segment_);
+  EXPECT_EQ(1, index->size());
+}
+
+TEST_F(CacheIndexTest, RejectsInsertsOnceThreeQuartersFull) {
+  std::unique_ptr<CacheIndex> index = open();
+  ASSERT_TRUE(index->tryLock());
+  for (uint64_t key = 0; key < 12; key++) {
+    EXPECT_TRUE(index->insert(key, makeEntry(1)));
+  }
+  EXPECT_FALSE(index->insert(12, makeEntry(1)));
+  EXPECT_EQ(16, index->removeIf([](const IndexEntry&) { return true; }, 0, 16));
+  EXPECT_EQ(0, index->size());
+
+  // Removed slots are reclaimed.
+  for (uint64_t key = 100; key < 112; key++) {
+    EXPECT_TRUE(index->insert(key, makeEntry(1)));
+  }
+  for (uint64_t key = 100; key < 112; key++) {
+    EXPECT_TRUE(index->find(key).has_value());
+  }
+}
+
+TEST_F(CacheIndexTest, RemovesInBatches) {
+  std::unique_ptr<CacheIndex> index = open();
+  ASSERT_TRUE(index->tryLock());
+  // 15, 31 and 47 share the last slot, so that 31 and 47 wrap around to the first slots, and
+  // removing 31 moves 47 back into the slot being looked at.
+  for (uint64_t key : {15, 31, 47, 2, 3}) {
+    EXPECT_TRUE(index->insert(key, makeEntry(key == 2 ? 2 : 1)));
+  }
+  auto in_segment_1 = [](const IndexEntry& entry) { return entry.body_segment_ == 1; };
+  EXPECT_EQ(8, index->removeIf(in_segment_1, 0, 8));
+  EXPECT_EQ(2, index->size());
+  EXPECT_TRUE(index->find(15).has_value());
+  EXPECT_FALSE(index->find(3).has_value());
+
+  EXPECT_EQ(16, index->removeIf(in_segment_1, 8, 100));
+  EXPECT_EQ(1, index->size());
+  EXPECT_FALSE(index->find(15).has_value());
+  EXPECT_EQ(2, index->find(2)->body_segment_);
+}
+
+TEST_F(CacheIndexTest, DoesNotFindEntriesOfEvictedSegments) {
+  std::unique_ptr<CacheIndex> index = open();
+  ASSERT_TRUE(index->tryLock());
+  EXPECT_TRUE(index->insert(1, makeEntry(1)));
+  EXPECT_TRUE(index->insert(2, makeEntry(2)));
+  index->setOldestSegment(2);
+  EXPECT_FALSE(index->find(1).has_value());
+  EXPECT_TRUE(index->find(2).has_value());
+  EXPECT_EQ(2, index->size());
+}
+
+TEST_F(CacheIndexTest, PersistsAcrossOpens) {
+  {
+    std::unique_ptr<CacheIndex> index = open();
+    ASSERT_TRUE(index->tryLock());
+    EXPECT_TRUE(index->insert(5, makeEntry(1)));
+    index->setNewestSegment(1);
+  }
+  std::unique_ptr<CacheIndex> index = open();
+  EXPECT_EQ(1, index->find(5)->body_segment_);
+  EXPECT_EQ(1, index->newestSegment());
+
+  // Another capacity discards the entries.
+  index.reset();
+  index = open(32);
+  EXPECT_FALSE(index->find(5).has_value());
+  EXPECT_EQ(0, index->size());
+}
+
+TEST_F(CacheIndexTest, OnlyLockHolderWrites) {
+  std::unique_ptr<CacheIndex> owner = open();
+  ASSERT_TRUE(owner->tryLock());
+  std::unique_ptr<CacheIndex> reader = open();
+  EXPECT_FALSE(reader->tryLock());
+
+  EXPECT_TRUE(owner->insert(5, makeEntry(1)));
+  EXPECT_EQ(1, reader->find(5)->body_segment_);
+
+  // A reader can't reformat an index in use.
+  EXPECT_FALSE(CacheIndex::open(path_, 32).ok());
+
+  owner.reset();
+  EXPECT_TRUE(reader->tryLock());
+}
+
+constexpr uint64_t BodySize = 1000;
+
+class FileSystemHttpCacheTest : public testing::Test {
+protected:
+  FileSystemHttpCacheTest()
+      : cache_path_(TestEnvironment::temporaryPath("file_system_http_cache_test")),
+        vary_allow_list_(Protobuf::RepeatedPtrField<envoy::type::matcher::v3::StringMatcher>()) {
+    TestEnvironment::removePath(cache_path_);
+    TestEnvironment::createPath(cache_path_);
+    config_.mutable_manager_config()->mutable_thread_pool()->set_thread_count(1);
+    config_.set_cache_path(cache_path_);
+    config_.mutable_max_entries()->set_value(64);
+    factory_ = Common::AsyncFiles::AsyncFileManagerFactory::singleton(&singleton_manager_);
+  }
+  ~FileSystemHttpCacheTest() override {
+    cache_.reset();
+    TestEnvironment::removePath(cache_path_);
+  }
+
+  std::unique_ptr<FileSystemHttpCache> makeCache() {
+    absl::StatusOr<std::unique_ptr<CacheIndex>> index =
+        CacheIndex::open(cache_path_ + "/index", config_.max_entries().value());
+    EXPECT_OK(index);
+    return std::make_unique<FileSystemHttpCache>(
+        factory_, factory_->getAsyncFileManager(config_.manager_config()), config_,
+        std::move(index.value()), store_);
+  }
+
+  LookupRequest makeLookupRequest(absl::string_view path) {
+    Http::TestRequestHeaderMapImpl request_headers{
+        {":method", "GET"}, {":scheme", "https"}, {":authority", "example.com"}, {":path", path}};
+    return LookupRequest(request_headers, time_system_.systemTime(), vary_allow_list_);
+  }
+
+  LookupResult getHeaders(LookupContext& context) {
+    LookupResult result;
+    absl::Notification done;
+    context.getHeaders([&result, &done](LookupResult&& r) {
+      result = std::move(r);
+      done.Notify();
+    });
+    done.WaitForNotification();
+    return result;
+  }
+
+  std::string getBody(LookupContext& context, uint64_t length) {
+    Buffer::InstancePtr data;
+    absl::Notification done;
+    context.getBody(AdjustedByteRange(0, length), [&data, &done](Buffer::InstancePtr&& chunk) {
+      data = std::move(chunk);
+      done.Notify();
+    });
+    done.WaitForNotification();
+    EXPECT_NE(nullptr, data);
+    return data != nullptr ? data->toString() : "";
+  }
+
+  // Returns the cached body of the path, or nullopt on a miss.
+  absl::optional<std::string> lookup(FileSystemHttpCache& cache, absl::string_view path) {
+    LookupContextPtr context = cache.makeLookupContext(makeLookupRequest(path), decoder_callbacks_);
+    LookupResult result = getHeaders(*context);
+    absl::optional<std::string> body;
+    if (result.cache_entry_status_ != CacheEntryStatus::Unusable) {
+      body = getBody(*context, result.content_length_);
+    }
+    context->onDestroy();
+    return body;
+  }
+
+  // Waits for the writes queued since writesDone() returned the given count.
+  void waitForWrites(FileSystemHttpCache& cache, uint64_t written) {
+    for (int i = 0; i < 1000 && writesDone(cache) == written; i++) {
+      time_system_.realSleepDoNotUseWithoutScrutiny(std::chrono::milliseconds(10));
+    }
+  }
+
+  static uint64_t writesDone(FileSystemHttpCache& cache) {
+    return cache.stats().inserts_.value() + cache.stats().insert_rejected_.value() +
+           cache.stats().write_errors_.value();
+  }
+
+  // Inserts a response for the path, and waits for it to be written.
+  void insert(FileSystemHttpCache& cache, absl::string_view path,
+              const std::string& body = std::string(BodySize, 'x')) {
+    const uint64_t written = writesDone(cache);
+    InsertContextPtr context = cache.makeInsertContext(
+        cache.makeLookupContext(makeLookupRequest(path), decoder_callbacks_), encoder_callbacks_);
+    context->insertHeaders(
+        Http::TestResponseHeaderMapImpl{{":status", "200"}, {"cache-control", "max-age=3600"}},
+        ResponseMetadata{time_system_.systemTime()}, false);
+    context->insertBody(Buffer::OwnedImpl(body), nullptr, true);
+    context->onDestroy();
+    waitForWrites(cache, written);
+  }
+
+  const std::string cache_path_;
+  Event::TestRealTimeSystem time_system_;
+  Stats::TestUtil::TestStore store_;
+  VaryAllowList vary_allow_list_;
+  Singleton::ManagerImpl singleton_manager_{Thread::threadFactoryForTest()};
+  std::shared_ptr<Common::AsyncFiles::AsyncFileManagerFactory> factory_;
+  ConfigProto config_;
+  std::unique_ptr<FileSystemHttpCache> cache_;
+  testing::NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+  testing::NiceMock<Http::MockStreamEncoderFilterCallbacks> encoder_callbacks_;
+};
+
+TEST_F(FileSystemHttpCacheTest, InsertAndLookup) {
+  cache_ = makeCache();
+  EXPECT_EQ(absl::nullopt, lookup(*cache_, "/a"));
+  EXPECT_EQ(1, cache_->stats().misses_.value());
+
+  insert(*cache_, "/a");
+  insert(*cache_, "/b", "b");
+  EXPECT_EQ(2, cache_->stats().inserts_.value());
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*cache_, "/a"));
+  EXPECT_EQ("b", lookup(*cache_, "/b"));
+  EXPECT_EQ(2, cache_->stats().hits_.value());
+}
+
+TEST_F(FileSystemHttpCacheTest, PersistsAcrossRestarts) {
+  cache_ = makeCache();
+  insert(*cache_, "/a");
+  cache_.reset();
+
+  cache_ = makeCache();
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*cache_, "/a"));
+  // New responses go to a new segment.
+  insert(*cache_, "/b");
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*cache_, "/b"));
+}
+
+TEST_F(FileSystemHttpCacheTest, ForgetsDeletedSegments) {
+  cache_ = makeCache();
+  insert(*cache_, "/a");
+  cache_.reset();
+  TestEnvironment::removePath(cache_path_ + "/segment-00000001");
+
+  cache_ = makeCache();
+  EXPECT_EQ(absl::nullopt, lookup(*cache_, "/a"));
+  EXPECT_EQ(0, cache_->stats().read_errors_.value());
+}
+
+TEST_F(FileSystemHttpCacheTest, EvictsOldestSegment) {
+  // Each response fills a segment, and two segments fit in the cache.
+  config_.mutable_segment_size_bytes()->set_value(BodySize);
+  config_.mutable_max_cache_size_bytes()->set_value(2 * BodySize);
+  cache_ = makeCache();
+  for (absl::string_view path : {"/a", "/b", "/c"}) {
+    insert(*cache_, path);
+  }
+  EXPECT_EQ(3, cache_->stats().inserts_.value());
+  EXPECT_EQ(1, cache_->stats().evicted_segments_.value());
+  EXPECT_EQ(absl::nullopt, lookup(*cache_, "/a"));
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*cache_, "/b"));
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*cache_, "/c"));
+  EXPECT_FALSE(Filesystem::fileSystemForTest().fileExists(cache_path_ + "/segment-00000001"));
+}
+
+TEST_F(FileSystemHttpCacheTest, ReadsBodyOfSegmentEvictedAfterLookup) {
+  config_.mutable_segment_size_bytes()->set_value(BodySize);
+  config_.mutable_max_cache_size_bytes()->set_value(2 * BodySize);
+  cache_ = makeCache();
+  insert(*cache_, "/a");
+
+  // The updated headers go to the second segment, while the body stays in the first one.
+  LookupContextPtr context =
+      cache_->makeLookupContext(makeLookupRequest("/a"), decoder_callbacks_);
+  ASSERT_EQ(CacheEntryStatus::Ok, getHeaders(*context).cache_entry_status_);
+  uint64_t written = writesDone(*cache_);
+  cache_->updateHeaders(
+      *context,
+      Http::TestResponseHeaderMapImpl{{":status", "200"}, {"cache-control", "max-age=7200"}},
+      ResponseMetadata{time_system_.systemTime()});
+  waitForWrites(*cache_, written);
+  context->onDestroy();
+
+  context = cache_->makeLookupContext(makeLookupRequest("/a"), decoder_callbacks_);
+  const LookupResult result = getHeaders(*context);
+  ASSERT_EQ(CacheEntryStatus::Ok, result.cache_entry_status_);
+  insert(*cache_, "/b");
+  insert(*cache_, "/c");
+  EXPECT_EQ(1, cache_->stats().evicted_segments_.value());
+  EXPECT_FALSE(Filesystem::fileSystemForTest().fileExists(cache_path_ + "/segment-00000001"));
+
+  EXPECT_EQ(std::string(BodySize, 'x'), getBody(*context, result.content_length_));
+  context->onDestroy();
+  EXPECT_EQ(0, cache_->stats().read_errors_.value());
+  EXPECT_EQ(absl::nullopt, lookup(*cache_, "/a"));
+}
+
+TEST_F(FileSystemHttpCacheTest, UpdateAddingVaryHeaderRemovesResponse) {
+  cache_ = makeCache();
+  insert(*cache_, "/a");
+  LookupContextPtr context =
+      cache_->makeLookupContext(makeLookupRequest("/a"), decoder_callbacks_);
+  ASSERT_EQ(CacheEntryStatus::Ok, getHeaders(*context).cache_entry_status_);
+  cache_->updateHeaders(*context,
+                        Http::TestResponseHeaderMapImpl{{":status", "200"},
+                                                        {"cache-control", "max-age=3600"},
+                                                        {"vary", "accept"}},
+                        ResponseMetadata{time_system_.systemTime()});
+  context->onDestroy();
+  EXPECT_EQ(absl::nullopt, lookup(*cache_, "/a"));
+}
+
+TEST_F(FileSystemHttpCacheTest, RejectsLargeResponses) {
+  config_.mutable_max_entry_size_bytes()->set_value(BodySize - 1);
+  cache_ = makeCache();
+  insert(*cache_, "/a");
+  EXPECT_EQ(1, cache_->stats().insert_rejected_.value());
+  EXPECT_EQ(0, cache_->stats().inserts_.value());
+  EXPECT_EQ(absl::nullopt, lookup(*cache_, "/a"));
+}
+
+TEST_F(FileSystemHttpCacheTest, ReadsWithoutWritingWhileIndexIsLocked) {
+  cache_ = makeCache();
+  insert(*cache_, "/a");
+
+  // Like the new Envoy of a hot restart, while the previous one is still running.
+  std::unique_ptr<FileSystemHttpCache> second = makeCache();
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*second, "/a"));
+  insert(*second, "/b");
+  EXPECT_EQ(1, second->stats().insert_rejected_.value());
+  EXPECT_EQ(absl::nullopt, lookup(*second, "/b"));
+
+  // Once the previous one is gone, the new one takes over.
+  cache_.reset();
+  insert(*second, "/b");
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*second, "/b"));
+}
+
+// A listener update changing the settings of a cache doesn't wait for the listener using the
+// previous ones to drain.
+TEST_F(FileSystemHttpCacheTest, ReconfiguredCacheTakesOverWhenPreviousOneIsReleased) {
+  HttpCacheFactory* factory = Registry::FactoryRegistry<HttpCacheFactory>::getFactoryByType(
+      "envoy.extensions.cache.file_system_http_cache.v3.FileSystemHttpCacheConfig");
+  ASSERT_NE(factory, nullptr);
+  testing::NiceMock<Server::Configuration::MockFactoryContext> factory_context;
+  auto get_cache = [&]() {
+    envoy::extensions::filters::http::cache::v3::CacheConfig config;
+    config.mutable_typed_config()->PackFrom(config_);
+    return std::dynamic_pointer_cast<FileSystemHttpCache>(
+        factory->getCache(config, factory_context));
+  };
+  std::shared_ptr<FileSystemHttpCache> draining = get_cache();
+  ASSERT_NE(nullptr, draining);
+  insert(*draining, "/a");
+
+  config_.mutable_segment_size_bytes()->set_value(4 * BodySize);
+  // The index stays mapped by the draining cache, so its capacity is kept.
+  config_.mutable_max_entries()->set_value(128);
+  std::shared_ptr<FileSystemHttpCache> updated;
+  EXPECT_LOG_CONTAINS("warn", "keeps max_entries 64 until Envoy restarts", updated = get_cache());
+  ASSERT_NE(nullptr, updated);
+  EXPECT_NE(draining, updated);
+  EXPECT_EQ(updated, get_cache());
+
+  // Like the new Envoy of a hot restart, the updated cache only reads until it gets the index.
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*updated, "/a"));
+  insert(*updated, "/b");
+  EXPECT_EQ(1, updated->stats().insert_rejected_.value());
+
+  draining.reset();
+  insert(*updated, "/b");
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*updated, "/b"));
+  EXPECT_EQ(std::string(BodySize, 'x'), lookup(*updated, "/a"));
+}
+
+TEST(Registration, GetFactory) {
+  HttpCacheFactory* factory = Registry::FactoryRegistry<HttpCacheFactory>::getFactoryByType(
+      "envoy.extensions.cache.file_system_http_cache.v3.FileSystemHttpCacheConfig");
+  ASSERT_NE(factory, nullptr);
+  ConfigProto cache_config;
+  cache_config.mutable_manager_config()->mutable_thread_pool()->set_thread_count(1);
+  cache_config.set_cache_path(TestEnvironment::temporaryDirectory());
+  cache_config.mutable_max_entries()->set_value(16);
+  envoy::extensions::filters::http::cache::v3::CacheConfig config;
+  config.mutable_typed_config()->PackFrom(cache_config);
+  testing::NiceMock<Server::Configuration::MockFactoryContext> factory_context;
+  std::shared_ptr<HttpCache> cache = factory->getCache(config, factory_context);
+  EXPECT_EQ(cache->cacheInfo().name_, "envoy.extensions.http.cache.file_system_http_cache");
+
+  // Filters configured with the same settings share the cache.
+  EXPECT_EQ(cache, factory->getCache(config, factory_context));
+}
+
+} // namespace
+} // namespace FileSystemHttpCache
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
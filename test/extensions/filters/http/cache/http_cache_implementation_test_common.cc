@@ -528,7 +528,7 @@ TEST_P(HttpCacheImplementationTest, UpdateHeadersForMissingKey) {
   EXPECT_EQ(CacheEntryStatus::Unusable, lookup_result_.cache_entry_status_);
 }
 
-TEST_P(HttpCacheImplementationTest, UpdateHeadersDisabledForVaryHeaders) {
+TEST_P(HttpCacheImplementationTest, UpdateHeadersForVaryHeaders) {
   if (!validationEnabled()) {
     // UpdateHeaders would not be called when validation is disabled.
     GTEST_SKIP();
@@ -556,9 +556,14 @@ TEST_P(HttpCacheImplementationTest, UpdateHeadersDisabledForVaryHeaders) {
                                                      {"accept", "image/*"},
                                                      {"vary", "accept"}};
   updateHeaders(request_path_1, response_headers_2, {time_2});
-  response_headers_1.setReferenceKey(Http::LowerCaseString("age"), "3600");
-  // the age is still 0 because an entry is considered fresh after validation
-  EXPECT_TRUE(expectLookupSuccessWithHeaders(lookup(request_path_1).get(), response_headers_1));
+  if (varyUpdatesEnabled()) {
+    // the age is 0 because an entry is considered fresh after validation
+    response_headers_2.setReferenceKey(Http::LowerCaseString("age"), "0");
+    EXPECT_TRUE(expectLookupSuccessWithHeaders(lookup(request_path_1).get(), response_headers_2));
+  } else {
+    response_headers_1.setReferenceKey(Http::LowerCaseString("age"), "3600");
+    EXPECT_TRUE(expectLookupSuccessWithHeaders(lookup(request_path_1).get(), response_headers_1));
+  }
 }
 
 TEST_P(HttpCacheImplementationTest, UpdateHeadersSkipEtagHeader) {
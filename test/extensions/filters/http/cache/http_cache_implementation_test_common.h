@@ -38,6 +38,10 @@ public:
   // RequiresValidation.
   virtual bool validationEnabled() const = 0;
 
+  // Specifies whether or not the cache updates the headers of responses with a
+  // vary header. If false, tests will expect such updates to be ignored.
+  virtual bool varyUpdatesEnabled() const { return false; }
+
   Event::MockDispatcher& dispatcher() { return *dispatcher_; }
 
 private:
@@ -55,6 +59,7 @@ protected:
 
   std::shared_ptr<HttpCache> cache() const { return delegate_->cache(); }
   bool validationEnabled() const { return delegate_->validationEnabled(); }
+  bool varyUpdatesEnabled() const { return delegate_->varyUpdatesEnabled(); }
   LookupContextPtr lookup(absl::string_view request_path);
 
   absl::Status insert(LookupContextPtr lookup, const Http::TestResponseHeaderMapImpl& headers,
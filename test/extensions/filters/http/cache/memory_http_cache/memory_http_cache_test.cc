@@ -0,0 +1,258 @@
+#include "envoy/extensions/cache/memory_http_cache/v3/config.pb.h"
+#include "envoy/registry/registry.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/extensions/filters/http/cache/cache_headers_utils.h"
+#include "source/extensions/filters/http/cache/memory_http_cache/frequency_sketch.h"
+#include "source/extensions/filters/http/cache/memory_http_cache/memory_http_cache.h"
+
+#include "test/common/stats/stat_test_utility.h"
+#include "test/extensions/filters/http/cache/common.h"
+#include "test/extensions/filters/http/cache/http_cache_implementation_test_common.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/server/factory_context.h"
+#include "test/test_common/simulated_time_system.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Cache {
+namespace {
+
+class MemoryHttpCacheTestDelegate : public HttpCacheTestDelegate {
+public:
+  std::shared_ptr<HttpCache> cache() override { return cache_; }
+  bool validationEnabled() const override { return true; }
+  bool varyUpdatesEnabled() const override { return true; }
+
+private:
+  Stats::TestUtil::TestStore store_;
+  std::shared_ptr<MemoryHttpCache> cache_ = std::make_shared<MemoryHttpCache>(
+      envoy::extensions::cache::memory_http_cache::v3::MemoryHttpCacheConfig(), store_);
+};
+
+INSTANTIATE_TEST_SUITE_P(MemoryHttpCacheTest, HttpCacheImplementationTest,
+                         testing::Values(std::make_unique<MemoryHttpCacheTestDelegate>),
+                         [](const testing::TestParamInfo<HttpCacheImplementationTest::ParamType>&) {
+                           return "MemoryHttpCache";
+                         });
+
+// Bodies are large enough for the overhead of an entry to be small in comparison, so that a cache
+// of 35000 bytes holds three entries but not four.
+constexpr uint64_t BodySize = 10000;
+constexpr uint64_t MaxSizeBytes = 35000;
+
+class MemoryHttpCacheEvictionTest : public testing::Test {
+protected:
+  MemoryHttpCacheEvictionTest()
+      : vary_allow_list_(Protobuf::RepeatedPtrField<envoy::type::matcher::v3::StringMatcher>()) {
+    envoy::extensions::cache::memory_http_cache::v3::MemoryHttpCacheConfig config;
+    config.mutable_max_size_bytes()->set_value(MaxSizeBytes);
+    config.mutable_shards()->set_value(1);
+    cache_ = std::make_unique<MemoryHttpCache>(config, store_);
+  }
+
+  LookupRequest makeLookupRequest(absl::string_view path) {
+    Http::TestRequestHeaderMapImpl request_headers{
+        {":method", "GET"}, {":scheme", "https"}, {":authority", "example.com"}, {":path", path}};
+    return LookupRequest(request_headers, time_system_.systemTime(), vary_allow_list_);
+  }
+
+  // Looks up the path the given number of times, returning whether the last lookup was a hit.
+  bool lookup(absl::string_view path, uint32_t times = 1) {
+    MemoryHttpCache::EntrySharedPtr entry;
+    for (uint32_t i = 0; i < times; i++) {
+      entry = cache_->lookup(makeLookupRequest(path));
+    }
+    return entry != nullptr;
+  }
+
+  void insert(absl::string_view path, uint64_t body_size = BodySize) {
+    cache_->insert(makeLookupRequest(path).key(),
+                   Http::createHeaderMap<Http::ResponseHeaderMapImpl>(
+                       {{Http::Headers::get().Status, "200"}}),
+                   ResponseMetadata{time_system_.systemTime()}, std::string(body_size, 'x'),
+                   nullptr);
+  }
+
+  Event::SimulatedTimeSystem time_system_;
+  Stats::TestUtil::TestStore store_;
+  VaryAllowList vary_allow_list_;
+  std::unique_ptr<MemoryHttpCache> cache_;
+};
+
+TEST_F(MemoryHttpCacheEvictionTest, EvictsLeastRecentlyUsed) {
+  for (absl::string_view path : {"/a", "/b", "/c"}) {
+    EXPECT_FALSE(lookup(path));
+    insert(path);
+  }
+  EXPECT_EQ(3, cache_->stats().entries_.value());
+  EXPECT_LE(cache_->stats().size_bytes_.value(), MaxSizeBytes);
+
+  // /a is the oldest entry, but was looked up since being inserted so /b is evicted instead.
+  EXPECT_TRUE(lookup("/a"));
+  EXPECT_FALSE(lookup("/d"));
+  insert("/d");
+  EXPECT_EQ(1, cache_->stats().evictions_.value());
+  EXPECT_EQ(0, cache_->stats().insert_rejected_.value());
+  EXPECT_EQ(3, cache_->stats().entries_.value());
+  EXPECT_LE(cache_->stats().size_bytes_.value(), MaxSizeBytes);
+
+  EXPECT_FALSE(lookup("/b"));
+  EXPECT_TRUE(lookup("/a"));
+  EXPECT_TRUE(lookup("/c"));
+  EXPECT_TRUE(lookup("/d"));
+}
+
+TEST_F(MemoryHttpCacheEvictionTest, RejectsLessPopularEntries) {
+  // Make the cached entries popular.
+  for (absl::string_view path : {"/a", "/b", "/c"}) {
+    EXPECT_FALSE(lookup(path, 5));
+    insert(path);
+  }
+
+  // /d has been requested less often than /a, which would have to be evicted.
+  EXPECT_FALSE(lookup("/d"));
+  insert("/d");
+  EXPECT_EQ(1, cache_->stats().insert_rejected_.value());
+  EXPECT_EQ(0, cache_->stats().evictions_.value());
+  EXPECT_EQ(3, cache_->stats().entries_.value());
+  EXPECT_FALSE(lookup("/d"));
+
+  // Once /d is requested more often than /a, it takes its place.
+  EXPECT_FALSE(lookup("/d", 5));
+  insert("/d");
+  EXPECT_EQ(1, cache_->stats().evictions_.value());
+  EXPECT_EQ(3, cache_->stats().entries_.value());
+  EXPECT_TRUE(lookup("/d"));
+  EXPECT_FALSE(lookup("/a"));
+}
+
+TEST_F(MemoryHttpCacheEvictionTest, ReplacingEntryIsAlwaysAdmitted) {
+  for (absl::string_view path : {"/a", "/b", "/c"}) {
+    EXPECT_FALSE(lookup(path, 5));
+    insert(path);
+  }
+  // A larger response for /c doesn't fit without evicting another entry, but a newer response
+  // always replaces the cached one.
+  insert("/c", 2 * BodySize);
+  EXPECT_EQ(0, cache_->stats().insert_rejected_.value());
+  EXPECT_EQ(1, cache_->stats().evictions_.value());
+  EXPECT_EQ(2, cache_->stats().entries_.value());
+  EXPECT_TRUE(lookup("/c"));
+}
+
+TEST_F(MemoryHttpCacheEvictionTest, RejectedInsertLeavesEntriesUnchanged) {
+  for (absl::string_view path : {"/a", "/b", "/c"}) {
+    EXPECT_FALSE(lookup(path, 5));
+    insert(path);
+  }
+  MemoryHttpCache::EntrySharedPtr a = cache_->lookup(makeLookupRequest("/a"));
+  ASSERT_NE(a, nullptr);
+
+  // Making room for /d would spare /a and evict /b, but /d is rejected for being less popular than
+  // /b. /a keeps its second chance.
+  EXPECT_FALSE(lookup("/d"));
+  insert("/d");
+  EXPECT_EQ(1, cache_->stats().insert_rejected_.value());
+  EXPECT_TRUE(a->referenced_.load());
+
+  EXPECT_FALSE(lookup("/e", 10));
+  insert("/e");
+  EXPECT_EQ(1, cache_->stats().evictions_.value());
+  EXPECT_FALSE(a->referenced_.load());
+  EXPECT_FALSE(lookup("/b"));
+  EXPECT_TRUE(lookup("/a"));
+  EXPECT_TRUE(lookup("/c"));
+  EXPECT_TRUE(lookup("/e"));
+}
+
+TEST_F(MemoryHttpCacheEvictionTest, RejectsEntriesLargerThanShard) {
+  insert("/a");
+  insert("/large", MaxSizeBytes);
+  EXPECT_EQ(1, cache_->stats().insert_rejected_.value());
+  EXPECT_EQ(1, cache_->stats().entries_.value());
+  EXPECT_TRUE(lookup("/a"));
+  EXPECT_FALSE(lookup("/large"));
+}
+
+TEST_F(MemoryHttpCacheEvictionTest, BodyOutlivesEviction) {
+  insert("/a");
+  testing::NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  LookupContextPtr context = cache_->makeLookupContext(makeLookupRequest("/a"), decoder_callbacks);
+  context->getHeaders([](LookupResult&& result) {
+    EXPECT_NE(result.headers_, nullptr);
+    EXPECT_EQ(BodySize, result.content_length_);
+  });
+
+  // /a gets a second chance for having been looked up, but is evicted by the second insert that
+  // doesn't fit.
+  for (absl::string_view path : {"/b", "/c", "/d", "/e", "/f"}) {
+    EXPECT_FALSE(lookup(path, 2));
+    insert(path);
+  }
+  EXPECT_FALSE(lookup("/a"));
+
+  Buffer::InstancePtr body;
+  context->getBody(AdjustedByteRange(0, BodySize),
+                   [&body](Buffer::InstancePtr&& data) { body = std::move(data); });
+  ASSERT_NE(body, nullptr);
+  EXPECT_EQ(std::string(BodySize, 'x'), body->toString());
+  context->onDestroy();
+}
+
+TEST_F(MemoryHttpCacheEvictionTest, UpdateAddingVaryHeaderRemovesEntry) {
+  insert("/a");
+  testing::NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  LookupContextPtr context = cache_->makeLookupContext(makeLookupRequest("/a"), decoder_callbacks);
+  context->getHeaders([](LookupResult&& result) { EXPECT_NE(result.headers_, nullptr); });
+
+  // The entry is stored under the request key alone, which doesn't account for the vary header.
+  cache_->updateHeaders(*context, Http::TestResponseHeaderMapImpl{{"vary", "accept"}},
+                        ResponseMetadata{time_system_.systemTime()});
+  EXPECT_EQ(0, cache_->stats().entries_.value());
+  EXPECT_FALSE(lookup("/a"));
+  context->onDestroy();
+}
+
+TEST(FrequencySketchTest, EstimatesAndAges) {
+  FrequencySketch sketch(16);
+  EXPECT_EQ(0, sketch.estimate(1));
+  for (int i = 0; i < 3; i++) {
+    sketch.increment(1);
+  }
+  EXPECT_EQ(3, sketch.estimate(1));
+
+  // Counters saturate.
+  for (int i = 0; i < 20; i++) {
+    sketch.increment(2);
+  }
+  EXPECT_EQ(FrequencySketch::MaxCount, sketch.estimate(2));
+
+  // Counters are halved once there have been ten increments per counter of a row.
+  for (int i = 0; i < 160 - 23; i++) {
+    sketch.increment(3);
+  }
+  EXPECT_EQ(1, sketch.estimate(1));
+  EXPECT_EQ(FrequencySketch::MaxCount / 2, sketch.estimate(2));
+}
+
+TEST(Registration, GetFactory) {
+  HttpCacheFactory* factory = Registry::FactoryRegistry<HttpCacheFactory>::getFactoryByType(
+      "envoy.extensions.cache.memory_http_cache.v3.MemoryHttpCacheConfig");
+  ASSERT_NE(factory, nullptr);
+  envoy::extensions::filters::http::cache::v3::CacheConfig config;
+  testing::NiceMock<Server::Configuration::MockFactoryContext> factory_context;
+  config.mutable_typed_config()->PackFrom(*factory->createEmptyConfigProto());
+  EXPECT_EQ(factory->getCache(config, factory_context)->cacheInfo().name_,
+            "envoy.extensions.http.cache.memory");
+}
+
+} // namespace
+} // namespace Cache
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
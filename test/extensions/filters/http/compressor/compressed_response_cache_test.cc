@@ -0,0 +1,81 @@
+#include "source/extensions/filters/http/compressor/compressed_response_cache.h"
+
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace Compressor {
+namespace {
+
+using CacheConfig =
+    envoy::extensions::filters::http::compressor::v3::Compressor::CompressedResponseCache;
+
+CacheConfig parseConfig(const std::string& yaml) {
+  CacheConfig config;
+  TestUtility::loadFromYaml(yaml, config);
+  return config;
+}
+
+TEST(CompressedResponseCacheTest, Defaults) {
+  CompressedResponseCache cache(CacheConfig{});
+  EXPECT_EQ(1024 * 1024, cache.maxBodySize());
+  EXPECT_FALSE(cache.keyByContentHash());
+  EXPECT_EQ(0, cache.size());
+}
+
+TEST(CompressedResponseCacheTest, LookupAndReplace) {
+  CompressedResponseCache cache(parseConfig("key_by_content_hash: true"));
+  EXPECT_TRUE(cache.keyByContentHash());
+  EXPECT_EQ(nullptr, cache.lookup("a"));
+
+  EXPECT_EQ(0, cache.insert("a", "compressed"));
+  EXPECT_EQ("compressed", *cache.lookup("a"));
+  EXPECT_EQ(11, cache.size());
+
+  EXPECT_EQ(0, cache.insert("a", "other"));
+  EXPECT_EQ("other", *cache.lookup("a"));
+  EXPECT_EQ(6, cache.size());
+}
+
+TEST(CompressedResponseCacheTest, EvictsLeastRecentlyUsed) {
+  CompressedResponseCache cache(parseConfig("max_cache_size_bytes: 25"));
+  EXPECT_EQ(0, cache.insert("a", std::string(9, 'a')));
+  EXPECT_EQ(0, cache.insert("b", std::string(9, 'b')));
+  // Looking "a" up makes "b" the least recently used.
+  EXPECT_NE(nullptr, cache.lookup("a"));
+
+  EXPECT_EQ(1, cache.insert("c", std::string(9, 'c')));
+  EXPECT_EQ(nullptr, cache.lookup("b"));
+  EXPECT_NE(nullptr, cache.lookup("a"));
+  EXPECT_NE(nullptr, cache.lookup("c"));
+  EXPECT_EQ(20, cache.size());
+
+  EXPECT_EQ(2, cache.insert("d", std::string(20, 'd')));
+  EXPECT_EQ(21, cache.size());
+}
+
+TEST(CompressedResponseCacheTest, BodyLargerThanCacheIsNotKept) {
+  CompressedResponseCache cache(parseConfig("max_cache_size_bytes: 25"));
+  EXPECT_EQ(0, cache.insert("a", std::string(9, 'a')));
+  EXPECT_EQ(0, cache.insert("b", std::string(25, 'b')));
+  EXPECT_EQ(nullptr, cache.lookup("b"));
+  EXPECT_NE(nullptr, cache.lookup("a"));
+}
+
+TEST(CompressedResponseCacheTest, BodyOutlivesEviction) {
+  CompressedResponseCache cache(parseConfig("max_cache_size_bytes: 25"));
+  EXPECT_EQ(0, cache.insert("a", std::string(9, 'a')));
+  CompressedResponseCache::Body body = cache.lookup("a");
+  EXPECT_EQ(1, cache.insert("b", std::string(20, 'b')));
+  EXPECT_EQ(nullptr, cache.lookup("a"));
+  EXPECT_EQ(std::string(9, 'a'), *body);
+}
+
+} // namespace
+} // namespace Compressor
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
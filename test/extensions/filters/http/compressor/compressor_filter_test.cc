@@ -812,6 +812,170 @@ TEST_F(MultipleFiltersTest, UseFirstRegisteredFilterWhenWildcard) {
   EXPECT_EQ(1, stats2_.counter("test2.compressor.test2.test.header_wildcard").value());
 }
 
+class CompressedResponseCacheTest : public CompressorFilterTest {
+public:
+  void SetUp() override {
+    setUpFilter(R"EOF(
+{
+  "response_direction_config": {
+    "compressed_response_cache": {
+      "max_body_size_bytes": 2048,
+      "key_by_content_hash": true
+    }
+  },
+  "compressor_library": {
+     "name": "test",
+     "typed_config": {
+       "@type": "type.googleapis.com/envoy.extensions.compression.gzip.compressor.v3.Gzip"
+     }
+  }
+}
+)EOF");
+  }
+
+  // Passes a request for the path through a new filter, and the response headers with the given
+  // entity tag. The test compressor leaves the body as is, so it is its own compressed form.
+  Http::TestResponseHeaderMapImpl startResponse(uint32_t expected_compress_calls,
+                                                const std::string& etag,
+                                                absl::optional<uint64_t> content_length,
+                                                const std::string& path = "/app.js") {
+    compressor_factory_->setExpectedCompressCalls(expected_compress_calls);
+    filter_ = std::make_unique<CompressorFilter>(config_);
+    filter_->setDecoderFilterCallbacks(decoder_callbacks_);
+    filter_->setEncoderFilterCallbacks(encoder_callbacks_);
+    Http::TestRequestHeaderMapImpl request_headers{{":method", "get"},
+                                                   {":authority", "example.com"},
+                                                   {":path", path},
+                                                   {"accept-encoding", "test"}};
+    EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, true));
+    Http::TestResponseHeaderMapImpl headers{{":status", "200"}};
+    if (!etag.empty()) {
+      headers.addCopy("etag", etag);
+    }
+    if (content_length.has_value()) {
+      headers.setContentLength(content_length.value());
+    }
+    EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_->encodeHeaders(headers, false));
+    EXPECT_EQ("test", headers.get_("content-encoding"));
+    return headers;
+  }
+
+  // Sends a response with the given body in a single chunk and returns the body sent downstream.
+  std::string doResponse(uint32_t expected_compress_calls, const std::string& body,
+                         const std::string& etag = "", const std::string& path = "/app.js") {
+    startResponse(expected_compress_calls, etag, body.size(), path);
+    Buffer::OwnedImpl data(body);
+    EXPECT_EQ(Http::FilterDataStatus::Continue, filter_->encodeData(data, true));
+    return data.toString();
+  }
+
+  uint64_t counter(const std::string& name) {
+    return stats_.counter("test.compressor.test.test." + name).value();
+  }
+};
+
+TEST_F(CompressedResponseCacheTest, HitByEtag) {
+  const std::string body(100, 'a');
+  EXPECT_EQ(body, doResponse(1, body, "\"v1\""));
+  EXPECT_EQ(1, counter("compressed_cache_miss"));
+
+  // A body with the same entity tag is served from the cache without being compressed. The body
+  // of the upstream response differs only to tell the two apart.
+  EXPECT_EQ(body, doResponse(0, std::string(100, 'b'), "\"v1\""));
+  EXPECT_EQ(1, counter("compressed_cache_hit"));
+  EXPECT_EQ(2, counter("response.compressed"));
+
+  // Another entity tag is a miss.
+  EXPECT_EQ(std::string(100, 'c'), doResponse(1, std::string(100, 'c'), "\"v2\""));
+  EXPECT_EQ(2, counter("compressed_cache_miss"));
+}
+
+TEST_F(CompressedResponseCacheTest, HitByEtagWithTrailers) {
+  const std::string body(100, 'a');
+  EXPECT_EQ(body, doResponse(1, body, "\"v1\""));
+
+  startResponse(0, "\"v1\"", absl::nullopt);
+  Buffer::OwnedImpl added;
+  EXPECT_CALL(encoder_callbacks_, addEncodedData(_, true))
+      .WillOnce(Invoke([&](Buffer::Instance& data, bool) { added.move(data); }));
+  Http::TestResponseTrailerMapImpl trailers;
+  EXPECT_EQ(Http::FilterTrailersStatus::Continue, filter_->encodeTrailers(trailers));
+  EXPECT_EQ(body, added.toString());
+  EXPECT_EQ(1, counter("compressed_cache_hit"));
+}
+
+TEST_F(CompressedResponseCacheTest, WeakEtagIsKeyedByContentHash) {
+  const std::string body(100, 'a');
+  EXPECT_EQ(body, doResponse(1, body, "W/\"v1\""));
+  EXPECT_EQ(body, doResponse(0, body, "W/\"v2\""));
+  EXPECT_EQ(1, counter("compressed_cache_miss"));
+  EXPECT_EQ(1, counter("compressed_cache_hit"));
+}
+
+TEST_F(CompressedResponseCacheTest, HitByContentHash) {
+  const std::string body(1000, 'a');
+  startResponse(1, "", absl::nullopt);
+  Buffer::OwnedImpl first(body.substr(0, 600));
+  // The body is buffered until it is complete.
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, filter_->encodeData(first, false));
+  EXPECT_EQ(0, first.length());
+  Buffer::OwnedImpl last(body.substr(600));
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_->encodeData(last, true));
+  EXPECT_EQ(body, last.toString());
+  EXPECT_EQ(1, counter("compressed_cache_miss"));
+
+  EXPECT_EQ(body, doResponse(0, body));
+  EXPECT_EQ(1, counter("compressed_cache_hit"));
+  EXPECT_EQ(std::string(1000, 'b'), doResponse(1, std::string(1000, 'b')));
+  EXPECT_EQ(2, counter("compressed_cache_miss"));
+}
+
+TEST_F(CompressedResponseCacheTest, ContentHashIsScopedToTheRequestTarget) {
+  const std::string body(100, 'a');
+  EXPECT_EQ(body, doResponse(1, body));
+  // The same body served for another path is kept apart, so that a response can only be served
+  // in place of one for the same target.
+  EXPECT_EQ(body, doResponse(1, body, "", "/other.js"));
+  EXPECT_EQ(2, counter("compressed_cache_miss"));
+  EXPECT_EQ(0, counter("compressed_cache_hit"));
+  EXPECT_EQ(body, doResponse(0, body, "", "/other.js"));
+  EXPECT_EQ(1, counter("compressed_cache_hit"));
+}
+
+TEST_F(CompressedResponseCacheTest, LargeBodyIsNotKept) {
+  const std::string body(4096, 'a');
+  EXPECT_EQ(body, doResponse(1, body, "\"v1\""));
+  EXPECT_EQ(body, doResponse(1, body, "\"v1\""));
+  EXPECT_EQ(0, counter("compressed_cache_miss"));
+  EXPECT_EQ(0, counter("compressed_cache_hit"));
+
+  // Without a Content-Length the body is buffered until it turns out to be too large, then it is
+  // compressed as usual.
+  startResponse(2, "", absl::nullopt);
+  Buffer::OwnedImpl first(body.substr(0, 2000));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, filter_->encodeData(first, false));
+  Buffer::OwnedImpl second(body.substr(2000, 1000));
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_->encodeData(second, false));
+  EXPECT_EQ(3000, second.length());
+  Buffer::OwnedImpl last(body.substr(3000));
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_->encodeData(last, true));
+  EXPECT_EQ(1096, last.length());
+  EXPECT_EQ(0, counter("compressed_cache_miss"));
+}
+
+TEST_F(CompressedResponseCacheTest, PartialContentIsNotKept) {
+  Http::TestRequestHeaderMapImpl request_headers{
+      {":method", "get"}, {":path", "/app.js"}, {"accept-encoding", "test"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, true));
+  Http::TestResponseHeaderMapImpl headers{
+      {":status", "206"}, {"etag", "\"v1\""}, {"content-length", "100"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_->encodeHeaders(headers, false));
+  Buffer::OwnedImpl data(std::string(100, 'a'));
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_->encodeData(data, true));
+  EXPECT_EQ(0, counter("compressed_cache_miss"));
+  EXPECT_EQ(0, config_->responseDirectionConfig().compressedResponseCache()->size());
+}
+
 TEST(CompressorFilterConfigTests, MakeCompressorTest) {
   const envoy::extensions::filters::http::compressor::v3::Compressor compressor_cfg;
   NiceMock<Runtime::MockLoader> runtime;
@@ -1,4 +1,5 @@
 #include "envoy/config/core/v3/base.pb.h"
+#include "envoy/config/trace/v3/datadog.pb.h"
 #include "envoy/config/trace/v3/http_tracer.pb.h"
 #include "envoy/config/trace/v3/opencensus.pb.h"
 #include "envoy/config/trace/v3/zipkin.pb.h"
@@ -179,6 +180,109 @@ http_filters:
   EXPECT_EQ(HttpConnectionManagerConfig::HttpConnectionManagerProto::OVERWRITE,
             config.serverHeaderTransformation());
   EXPECT_EQ(5 * 60 * 1000, config.streamIdleTimeout().count());
+  EXPECT_EQ(nullptr, config.tracingConfig()->tail_sampler_);
+}
+
+TEST_F(HttpConnectionManagerConfigTest, TailSamplingConfig) {
+  const std::string yaml_string = R"EOF(
+codec_type: http1
+stat_prefix: router
+route_config:
+  virtual_hosts:
+  - name: service
+    domains:
+    - "*"
+    routes:
+    - match:
+        prefix: "/"
+      route:
+        cluster: cluster
+tracing:
+  tail_sampling:
+    latency_threshold: 0.5s
+http_filters:
+- name: envoy.filters.http.router
+  typed_config:
+    "@type": type.googleapis.com/envoy.extensions.filters.http.router.v3.Router
+  )EOF";
+
+  HttpConnectionManagerConfig config(parseHttpConnectionManagerFromYaml(yaml_string), context_,
+                                     date_provider_, route_config_provider_manager_,
+                                     scoped_routes_config_provider_manager_, http_tracer_manager_,
+                                     filter_config_provider_manager_);
+
+  ASSERT_NE(nullptr, config.tracingConfig()->tail_sampler_);
+  EXPECT_EQ(0, config.tracingConfig()->tail_sampler_->stats().exported_.value());
+}
+
+TEST_F(HttpConnectionManagerConfigTest, TailSamplingRejectedForOpenCensus) {
+  const std::string yaml_string = R"EOF(
+codec_type: http1
+stat_prefix: router
+route_config:
+  virtual_hosts:
+  - name: service
+    domains:
+    - "*"
+    routes:
+    - match:
+        prefix: "/"
+      route:
+        cluster: cluster
+tracing:
+  tail_sampling:
+    latency_threshold: 0.5s
+http_filters:
+- name: envoy.filters.http.router
+  typed_config:
+    "@type": type.googleapis.com/envoy.extensions.filters.http.router.v3.Router
+  )EOF";
+
+  // The tracer provider is configured in the bootstrap config.
+  envoy::config::trace::v3::Tracing bootstrap_tracing_config;
+  bootstrap_tracing_config.mutable_http()->set_name("opencensus");
+  bootstrap_tracing_config.mutable_http()->mutable_typed_config()->PackFrom(
+      envoy::config::trace::v3::OpenCensusConfig{});
+  context_.http_context_.setDefaultTracingConfig(bootstrap_tracing_config);
+
+  EXPECT_THROW_WITH_MESSAGE(createHttpConnectionManagerConfig(yaml_string), EnvoyException,
+                            "tail_sampling is not supported by the tracer 'opencensus'");
+}
+
+// The Datadog tracer locks the sampling priority once the context is propagated upstream, so it
+// is not on the list of tracers supporting tail sampling.
+TEST_F(HttpConnectionManagerConfigTest, TailSamplingRejectedForDatadog) {
+  const std::string yaml_string = R"EOF(
+codec_type: http1
+stat_prefix: router
+route_config:
+  virtual_hosts:
+  - name: service
+    domains:
+    - "*"
+    routes:
+    - match:
+        prefix: "/"
+      route:
+        cluster: cluster
+tracing:
+  tail_sampling:
+    latency_threshold: 0.5s
+http_filters:
+- name: envoy.filters.http.router
+  typed_config:
+    "@type": type.googleapis.com/envoy.extensions.filters.http.router.v3.Router
+  )EOF";
+
+  // The tracer provider is configured in the bootstrap config.
+  envoy::config::trace::v3::Tracing bootstrap_tracing_config;
+  bootstrap_tracing_config.mutable_http()->set_name("datadog");
+  bootstrap_tracing_config.mutable_http()->mutable_typed_config()->PackFrom(
+      envoy::config::trace::v3::DatadogConfig{});
+  context_.http_context_.setDefaultTracingConfig(bootstrap_tracing_config);
+
+  EXPECT_THROW_WITH_MESSAGE(createHttpConnectionManagerConfig(yaml_string), EnvoyException,
+                            "tail_sampling is not supported by the tracer 'datadog'");
 }
 
 TEST_F(HttpConnectionManagerConfigTest, Http3Configured) {
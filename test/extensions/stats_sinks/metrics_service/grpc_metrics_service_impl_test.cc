@@ -10,6 +10,7 @@
 #include "test/mocks/thread_local/mocks.h"
 #include "test/test_common/simulated_time_system.h"
 
+#include "circllhist.h"
 #include "io/prometheus/client/metrics.pb.h"
 
 using namespace std::chrono_literals;
@@ -17,6 +18,7 @@ using testing::_;
 using testing::InSequence;
 using testing::Invoke;
 using testing::NiceMock;
+using testing::ReturnRef;
 
 namespace Envoy {
 namespace Extensions {
@@ -316,6 +318,55 @@ TEST_F(MetricsServiceSinkTest, FlushPredicate) {
   EXPECT_EQ(0, metrics->size());
 }
 
+// Test that only metrics which changed since the previous flush are reported when configured to
+// do so.
+TEST_F(MetricsServiceSinkTest, ReportOnlyChangedMetrics) {
+  addCounterToSnapshot("idle_counter", 0, 100);
+  addCounterToSnapshot("active_counter", 5, 105);
+  addGaugeToSnapshot("test_gauge", 1);
+  addHistogramToSnapshot("idle_histogram");
+  addHistogramToSnapshot("active_histogram");
+
+  histogram_t* hist = hist_alloc();
+  hist_insert_intscale(hist, 10, 0, 1);
+  Stats::HistogramStatisticsImpl active_stats(hist);
+  hist_free(hist);
+  ON_CALL(*histogram_storage_.back(), intervalStatistics()).WillByDefault(ReturnRef(active_stats));
+
+  MetricsServiceSink<envoy::service::metrics::v3::StreamMetricsMessage,
+                     envoy::service::metrics::v3::StreamMetricsResponse>
+      sink(streamer_, true, false, true);
+
+  // The gauge has not been reported before, so it is sent on the first flush. The histogram
+  // reports a summary and a histogram family.
+  EXPECT_CALL(*streamer_, send(_)).WillOnce(Invoke([](MetricsPtr&& metrics) {
+    ASSERT_EQ(4, metrics->size());
+    EXPECT_EQ("active_counter", (*metrics)[0].name());
+    EXPECT_EQ(5, (*metrics)[0].metric(0).counter().value());
+    EXPECT_EQ("test_gauge", (*metrics)[1].name());
+    EXPECT_EQ("active_histogram", (*metrics)[2].name());
+    EXPECT_EQ("active_histogram", (*metrics)[3].name());
+  }));
+  sink.flush(snapshot_);
+
+  // The gauge keeps its value, so it is omitted.
+  EXPECT_CALL(*streamer_, send(_)).WillOnce(Invoke([](MetricsPtr&& metrics) {
+    ASSERT_EQ(3, metrics->size());
+    EXPECT_EQ("active_counter", (*metrics)[0].name());
+    EXPECT_EQ("active_histogram", (*metrics)[1].name());
+  }));
+  sink.flush(snapshot_);
+
+  // Once the gauge changes it is reported again.
+  gauge_storage_.back()->value_ = 2;
+  EXPECT_CALL(*streamer_, send(_)).WillOnce(Invoke([](MetricsPtr&& metrics) {
+    ASSERT_EQ(4, metrics->size());
+    EXPECT_EQ("test_gauge", (*metrics)[1].name());
+    EXPECT_EQ(2, (*metrics)[1].metric(0).gauge().value());
+  }));
+  sink.flush(snapshot_);
+}
+
 } // namespace
 } // namespace MetricsService
 } // namespace StatSinks
@@ -3,6 +3,7 @@
 #include "envoy/common/exception.h"
 
 #include "source/common/tracing/http_tracer_impl.h"
+#include "source/common/tracing/tail_sampler_impl.h"
 #include "source/extensions/tracers/opentelemetry/opentelemetry_tracer_impl.h"
 
 #include "test/mocks/common.h"
@@ -388,6 +389,30 @@ TEST_F(OpenTelemetryDriverTest, IgnoreNotSampledSpan) {
   EXPECT_EQ(0U, stats_.counter("tracing.opentelemetry.spans_sent").value());
 }
 
+// A span started as not sampled is exported when tail sampling marks it as sampled as it
+// finishes, which is what tail sampling relies on.
+TEST_F(OpenTelemetryDriverTest, ExportSpanSampledByTailSampling) {
+  setupValidDriver();
+  Http::TestRequestHeaderMapImpl request_headers{
+      {":authority", "test.com"}, {":path", "/"}, {":method", "GET"}};
+  Tracing::TailSampler tail_sampler(std::chrono::milliseconds(10), true, 16,
+                                    context_.server_factory_context_.thread_local_, time_system_,
+                                    "tail_sampling.", stats_);
+  Tracing::SpanPtr span = tail_sampler.wrap(
+      driver_->startSpan(mock_tracing_config_, request_headers, operation_name_,
+                         time_system_.systemTime(), {Tracing::Reason::NotTraceable, false}),
+      operation_name_, time_system_.systemTime(),
+      time_system_.monotonicTime() - std::chrono::milliseconds(20));
+  EXPECT_NE(span.get(), nullptr);
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("tracing.opentelemetry.min_flush_spans", 5U))
+      .WillOnce(Return(1));
+  EXPECT_CALL(*mock_stream_ptr_, sendMessageRaw_(_, _));
+  span->finishSpan();
+  EXPECT_EQ(1U, stats_.counter("tracing.opentelemetry.spans_sent").value());
+  EXPECT_EQ(1U, tail_sampler.stats().exported_.value());
+}
+
 } // namespace OpenTelemetry
 } // namespace Tracers
 } // namespace Extensions
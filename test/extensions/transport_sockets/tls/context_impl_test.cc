@@ -8,6 +8,7 @@
 
 #include "source/common/common/base64.h"
 #include "source/common/json/json_loader.h"
+#include "source/common/network/transport_socket_options_impl.h"
 #include "source/common/secret/sds_api.h"
 #include "source/common/stats/isolated_store_impl.h"
 #include "source/extensions/transport_sockets/tls/context_config_impl.h"
@@ -1651,6 +1652,97 @@ TEST_F(ClientContextConfigImplTest, MissingStaticCertificateValidationContext) {
       "Unknown static certificate validation context: missing");
 }
 
+class ClientSessionCacheTest : public ClientContextConfigImplTest {
+public:
+  void SetUp() override {
+    envoy::extensions::transport_sockets::tls::v3::UpstreamTlsContext tls_context;
+    tls_context.mutable_max_session_keys()->set_value(2);
+    ClientContextConfigImpl client_context_config(tls_context, factory_context_);
+    context_ = manager_.createSslClientContext(store_, client_context_config);
+  }
+
+  void TearDown() override { manager_.removeContext(context_); }
+
+  bssl::UniquePtr<SSL> newSsl(absl::string_view server_name) {
+    return std::dynamic_pointer_cast<ClientContextImpl>(context_)->newSsl(
+        std::make_shared<Network::TransportSocketOptionsImpl>(server_name));
+  }
+
+  // Stores a session for the server name through the context's new session callback, like
+  // BoringSSL does once a handshake completes.
+  void storeSession(absl::string_view server_name, std::chrono::seconds timeout) {
+    bssl::UniquePtr<SSL> ssl = newSsl(server_name);
+    SSL_CTX* ssl_ctx = SSL_get_SSL_CTX(ssl.get());
+    SSL_SESSION* session = SSL_SESSION_new(ssl_ctx);
+    SSL_SESSION_set_time(session, std::chrono::duration_cast<std::chrono::seconds>(
+                                      time_system_.systemTime().time_since_epoch())
+                                      .count());
+    SSL_SESSION_set_timeout(session, static_cast<uint32_t>(timeout.count()));
+    EXPECT_EQ(1, SSL_CTX_sess_get_new_cb(ssl_ctx)(ssl.get(), session));
+  }
+
+  // Returns whether a session is offered to the server name, checking that the offer is counted.
+  bool sessionOffered(absl::string_view server_name) {
+    const uint64_t offered = counter("ssl.session_cache_offered");
+    const uint64_t missed = counter("ssl.session_cache_miss");
+    const bool session_set = SSL_get_session(newSsl(server_name).get()) != nullptr;
+    EXPECT_EQ(offered + (session_set ? 1 : 0), counter("ssl.session_cache_offered"));
+    EXPECT_EQ(missed + (session_set ? 0 : 1), counter("ssl.session_cache_miss"));
+    return session_set;
+  }
+
+  uint64_t counter(const std::string& name) { return store_.counterFromString(name).value(); }
+
+  Envoy::Ssl::ClientContextSharedPtr context_;
+};
+
+// Sessions are only offered to the server name they were stored for.
+TEST_F(ClientSessionCacheTest, SessionsKeptPerServerName) {
+  storeSession("a.example.com", std::chrono::hours(1));
+
+  EXPECT_TRUE(sessionOffered("a.example.com"));
+  EXPECT_FALSE(sessionOffered("b.example.com"));
+
+  // Storing sessions for another server name doesn't evict the first one's.
+  storeSession("b.example.com", std::chrono::hours(1));
+  storeSession("b.example.com", std::chrono::hours(1));
+  storeSession("b.example.com", std::chrono::hours(1));
+  EXPECT_TRUE(sessionOffered("a.example.com"));
+  EXPECT_TRUE(sessionOffered("b.example.com"));
+}
+
+// Expired sessions are no longer offered, while sessions stored afterwards are.
+TEST_F(ClientSessionCacheTest, ExpiredSessionsEvicted) {
+  storeSession("a.example.com", std::chrono::seconds(60));
+  EXPECT_TRUE(sessionOffered("a.example.com"));
+
+  time_system_.advanceTimeWait(std::chrono::seconds(61));
+  EXPECT_FALSE(sessionOffered("a.example.com"));
+
+  storeSession("a.example.com", std::chrono::seconds(60));
+  EXPECT_TRUE(sessionOffered("a.example.com"));
+}
+
+// The number of server names with stored sessions is bounded, so per-request server names can't
+// grow the cache without limit.
+TEST_F(ClientSessionCacheTest, ServerNamesBounded) {
+  // Matches MaxSessionKeysServerNames in context_impl.cc.
+  constexpr size_t max_server_names = 1024;
+  for (size_t i = 0; i <= max_server_names; ++i) {
+    storeSession(absl::StrCat("host", i, ".example.com"), std::chrono::hours(1));
+  }
+
+  size_t offered = 0;
+  for (size_t i = 0; i <= max_server_names; ++i) {
+    if (sessionOffered(absl::StrCat("host", i, ".example.com"))) {
+      ++offered;
+    }
+  }
+  EXPECT_EQ(max_server_names, offered);
+  // The most recently stored server name is never the one evicted.
+  EXPECT_TRUE(sessionOffered(absl::StrCat("host", max_server_names, ".example.com")));
+}
+
 class ServerContextConfigImplTest : public SslCertsTest {};
 
 // Multiple TLS certificates are supported.
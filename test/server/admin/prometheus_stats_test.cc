@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "source/common/stats/custom_stat_namespaces_impl.h"
+#include "source/common/stats/thread_local_store.h"
 #include "source/server/admin/prometheus_stats.h"
 
 #include "test/mocks/stats/mocks.h"
@@ -840,5 +841,54 @@ envoy_cluster_test_1_upstream_cx_total{a_tag_name="a.tag-value"} 0
   }
 }
 
+// The streaming request must produce the same output as the buffered formatter,
+// no matter how the output is split into chunks.
+TEST_F(PrometheusStatsFormatterTest, StreamingRequestMatchesBufferedOutput) {
+  Stats::CustomStatNamespacesImpl custom_namespaces;
+  custom_namespaces.registerStatNamespace("promtest");
+  Stats::ThreadLocalStoreImpl store(alloc_);
+  store.counterFromString("cluster.test_1.upstream_cx_total").add(3);
+  store.counterFromString("cluster.test_2.upstream_cx_total").inc();
+  store.counterFromString("promtest.myapp.test.foo");
+  store.gaugeFromString("cluster.test_1.upstream_cx_active", Stats::Gauge::ImportMode::Accumulate)
+      .set(5);
+  store.gaugeFromString("promtest.1234abcd.test.bar", Stats::Gauge::ImportMode::Accumulate);
+  store.textReadoutFromString("control_plane.identifier").set("cp-1");
+  store.histogramFromString("cluster.test_1.upstream_rq_time",
+                            Stats::Histogram::Unit::Milliseconds);
+
+  StatsParams params;
+  params.prometheus_text_readouts_ = true;
+  Buffer::OwnedImpl buffered;
+  PrometheusStatsFormatter::statsAsPrometheus(store.counters(), store.gauges(), store.histograms(),
+                                              store.textReadouts(), buffered, params,
+                                              custom_namespaces);
+
+  const std::vector<uint64_t> chunk_sizes = {1, 100, PrometheusStatsRequest::DefaultChunkSize};
+  for (uint64_t chunk_size : chunk_sizes) {
+    PrometheusStatsRequest request(store, custom_namespaces, params);
+    request.setChunkSize(chunk_size);
+    Http::TestResponseHeaderMapImpl response_headers;
+    EXPECT_EQ(Http::Code::OK, request.start(response_headers));
+
+    Buffer::OwnedImpl streamed;
+    uint32_t num_chunks = 0;
+    bool more;
+    do {
+      Buffer::OwnedImpl chunk;
+      more = request.nextChunk(chunk);
+      ++num_chunks;
+      streamed.move(chunk);
+    } while (more);
+    EXPECT_EQ(buffered.toString(), streamed.toString()) << "chunk_size=" << chunk_size;
+    if (chunk_size == 1) {
+      // Each non-empty chunk holds exactly one metric family.
+      EXPECT_LT(4, num_chunks);
+    } else if (chunk_size == PrometheusStatsRequest::DefaultChunkSize) {
+      EXPECT_EQ(1, num_chunks);
+    }
+  }
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -3,6 +3,7 @@
 
 #include "source/common/buffer/buffer_impl.h"
 #include "source/common/http/header_map_impl.h"
+#include "source/common/memory/stats.h"
 #include "source/common/stats/custom_stat_namespaces_impl.h"
 #include "source/common/stats/thread_local_store.h"
 #include "source/server/admin/stats_handler.h"
@@ -34,32 +35,56 @@ public:
   }
 
   /**
-   * Issues an admin request against the stats saved in store_.
+   * Issues an admin request against the stats saved in store_. Prometheus
+   * requests are streamed unless `buffered` is set, in which case the entire
+   * response is rendered in one shot.
    */
-  uint64_t handlerStats(const StatsParams& params) {
+  uint64_t handlerStats(const StatsParams& params, bool buffered = false) {
     Buffer::OwnedImpl data;
-    if (params.format_ == Envoy::Server::StatsFormat::Prometheus) {
+    const uint64_t memory_at_start = Memory::Stats::totalCurrentlyAllocated();
+    peak_memory_ = 0;
+    if (buffered) {
+      ASSERT(params.format_ == Envoy::Server::StatsFormat::Prometheus);
       Envoy::Server::StatsHandler::prometheusRender(store_, custom_namespaces_, params, data);
+      updatePeakMemory(memory_at_start);
       return data.length();
     }
-    Admin::RequestPtr request = StatsHandler::makeRequest(store_, params);
+    Admin::RequestPtr request =
+        params.format_ == Envoy::Server::StatsFormat::Prometheus
+            ? StatsHandler::makePrometheusRequest(store_, custom_namespaces_, params)
+            : StatsHandler::makeRequest(store_, params);
     auto response_headers = Http::ResponseHeaderMapImpl::create();
     request->start(*response_headers);
     uint64_t count = 0;
     bool more = true;
     do {
       more = request->nextChunk(data);
+      updatePeakMemory(memory_at_start);
       count += data.length();
       data.drain(data.length());
     } while (more);
     return count;
   }
 
+  /**
+   * @return the highest memory growth observed between chunks during the last
+   *         call to handlerStats, or 0 if memory usage data is not available.
+   */
+  uint64_t peakMemory() const { return peak_memory_; }
+
+  void updatePeakMemory(uint64_t memory_at_start) {
+    const uint64_t memory = Memory::Stats::totalCurrentlyAllocated();
+    if (memory > memory_at_start) {
+      peak_memory_ = std::max(peak_memory_, memory - memory_at_start);
+    }
+  }
+
   Stats::SymbolTableImpl symbol_table_;
   Stats::AllocatorImpl alloc_;
   Stats::ThreadLocalStoreImpl store_;
   std::vector<Stats::ScopeSharedPtr> scopes_;
   Envoy::Stats::CustomStatNamespacesImpl custom_namespaces_;
+  uint64_t peak_memory_{0};
 };
 
 } // namespace Server
@@ -89,6 +114,7 @@ static void BM_AllCountersText(benchmark::State& state) {
     uint64_t count = test_context.handlerStats(params);
     RELEASE_ASSERT(count > 100 * 1000 * 1000, "expected count > 100M"); // actual = 117,789,000
   }
+  state.counters["peak_bytes"] = test_context.peakMemory();
 }
 BENCHMARK(BM_AllCountersText)->Unit(benchmark::kMillisecond);
 
@@ -148,6 +174,7 @@ static void BM_AllCountersJson(benchmark::State& state) {
     uint64_t count = test_context.handlerStats(params);
     RELEASE_ASSERT(count > 130 * 1000 * 1000, "expected count > 130M"); // actual = 135,789,011
   }
+  state.counters["peak_bytes"] = test_context.peakMemory();
 }
 BENCHMARK(BM_AllCountersJson)->Unit(benchmark::kMillisecond);
 
@@ -207,9 +234,27 @@ static void BM_AllCountersPrometheus(benchmark::State& state) {
     uint64_t count = test_context.handlerStats(params);
     RELEASE_ASSERT(count > 250 * 1000 * 1000, "expected count > 250M"); // actual = 261,578,000
   }
+  state.counters["peak_bytes"] = test_context.peakMemory();
 }
 BENCHMARK(BM_AllCountersPrometheus)->Unit(benchmark::kMillisecond);
 
+// Renders the same output as BM_AllCountersPrometheus into a single buffer,
+// to compare peak memory against the streaming implementation.
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_AllCountersPrometheusBuffered(benchmark::State& state) {
+  Envoy::Server::StatsHandlerTest& test_context = testContext();
+  Envoy::Server::StatsParams params;
+  Envoy::Buffer::OwnedImpl response;
+  params.parse("?format=prometheus", response);
+
+  for (auto _ : state) { // NOLINT
+    uint64_t count = test_context.handlerStats(params, true);
+    RELEASE_ASSERT(count > 250 * 1000 * 1000, "expected count > 250M"); // actual = 261,578,000
+  }
+  state.counters["peak_bytes"] = test_context.peakMemory();
+}
+BENCHMARK(BM_AllCountersPrometheusBuffered)->Unit(benchmark::kMillisecond);
+
 // NOLINTNEXTLINE(readability-identifier-naming)
 static void BM_UsedCountersPrometheus(benchmark::State& state) {
   Envoy::Server::StatsHandlerTest& test_context = testContext();
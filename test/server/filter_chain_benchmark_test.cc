@@ -7,6 +7,7 @@
 #include "envoy/network/listen_socket.h"
 #include "envoy/protobuf/message_validator.h"
 
+#include "source/common/memory/stats.h"
 #include "source/common/network/socket_impl.h"
 #include "source/server/filter_chain_manager_impl.h"
 
@@ -189,6 +190,11 @@ const char YamlSingleDstPortBottom[] = R"EOF(
           session_ticket_keys:
             keys:
             - filename: "{{ test_rundir }}/test/extensions/transport_sockets/tls/test_data/ticket_key_a")EOF";
+const char YamlSingleSniTop[] = R"EOF(
+    - filter_chain_match:
+        transport_protocol: "tls"
+        server_names: "server)EOF";
+const char YamlSingleSniBottom[] = R"EOF(.example.com")EOF";
 } // namespace
 
 class FilterChainBenchmarkFixture : public ::benchmark::Fixture {
@@ -207,6 +213,21 @@ public:
     filter_chains_ = listener_config_.filter_chains();
   }
 
+  // Builds a listener with one filter chain per server name in addition to the catch-all chain.
+  void initializeSni(::benchmark::State& state) {
+    int64_t input_size = state.range(0);
+    std::vector<std::string> sni_chains;
+    sni_chains.reserve(input_size);
+    for (int i = 0; i < input_size; i++) {
+      sni_chains.push_back(absl::StrCat(YamlSingleSniTop, i, YamlSingleSniBottom));
+    }
+    listener_yaml_config_ =
+        TestEnvironment::substitute(absl::StrCat(YamlHeader, absl::StrJoin(sni_chains, "")),
+                                    Network::Address::IpVersion::v4);
+    TestUtility::loadFromYaml(listener_yaml_config_, listener_config_);
+    filter_chains_ = listener_config_.filter_chains();
+  }
+
   Envoy::Thread::MutexBasicLockable lock_;
   Logger::Context logging_state_{spdlog::level::warn, Logger::Logger::DEFAULT_LOG_FORMAT, lock_,
                                  false};
@@ -265,6 +286,66 @@ BENCHMARK_DEFINE_F(FilterChainBenchmarkFixture, FilterChainFindTest)
     }
   }
 }
+// Measures the time and memory needed to build the lookup structures for server name based
+// filter chains.
+// NOLINTNEXTLINE(readability-redundant-member-init)
+BENCHMARK_DEFINE_F(FilterChainBenchmarkFixture, FilterChainManagerBuildBySniTest)
+(::benchmark::State& state) {
+  if (benchmark::skipExpensiveBenchmarks() && state.range(0) > 64) {
+    state.SkipWithError("Skipping expensive benchmark");
+    return;
+  }
+
+  initializeSni(state);
+  NiceMock<Server::Configuration::MockFactoryContext> factory_context;
+  std::vector<Network::Address::InstanceConstSharedPtr> addresses;
+  addresses.emplace_back(std::make_shared<Network::Address::Ipv4Instance>("127.0.0.1", 1234));
+  uint64_t bytes = 0;
+  for (auto _ : state) {
+    UNREFERENCED_PARAMETER(_);
+    const uint64_t start_bytes = Memory::Stats::totalCurrentlyAllocated();
+    FilterChainManagerImpl filter_chain_manager{addresses, factory_context, init_manager_};
+    filter_chain_manager.addFilterChains(nullptr, filter_chains_, nullptr, dummy_builder_,
+                                         filter_chain_manager);
+    bytes = Memory::Stats::totalCurrentlyAllocated() - start_bytes;
+  }
+  state.counters["bytes_per_chain"] = bytes / (state.range(0) + 1);
+}
+
+// Looks up filter chains by server name, alternating between names that have their own chain and
+// names that only match the catch-all chain after trying each wildcard suffix.
+BENCHMARK_DEFINE_F(FilterChainBenchmarkFixture, FilterChainFindBySniTest)
+(::benchmark::State& state) {
+  if (benchmark::skipExpensiveBenchmarks() && state.range(0) > 64) {
+    state.SkipWithError("Skipping expensive benchmark");
+    return;
+  }
+
+  initializeSni(state);
+  std::vector<MockConnectionSocket> sockets;
+  sockets.reserve(state.range(0));
+  for (int i = 0; i < state.range(0); i++) {
+    const std::string server_name =
+        absl::StrCat(i % 2 == 0 ? "server" : "unknown", i, ".example.com");
+    sockets.push_back(std::move(*MockConnectionSocket::createMockConnectionSocket(
+        1234, "127.0.0.1", server_name, "", "tls", {}, "8.8.8.8", 111)));
+  }
+  NiceMock<Server::Configuration::MockFactoryContext> factory_context;
+  std::vector<Network::Address::InstanceConstSharedPtr> addresses;
+  addresses.emplace_back(std::make_shared<Network::Address::Ipv4Instance>("127.0.0.1", 1234));
+  FilterChainManagerImpl filter_chain_manager{addresses, factory_context, init_manager_};
+
+  filter_chain_manager.addFilterChains(nullptr, filter_chains_, nullptr, dummy_builder_,
+                                       filter_chain_manager);
+  for (auto _ : state) {
+    UNREFERENCED_PARAMETER(_);
+    for (int i = 0; i < state.range(0); i++) {
+      benchmark::DoNotOptimize(filter_chain_manager.findFilterChain(sockets[i]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
 BENCHMARK_REGISTER_F(FilterChainBenchmarkFixture, FilterChainManagerBuildTest)
     ->Ranges({
         // scale of the chains
@@ -278,6 +359,19 @@ BENCHMARK_REGISTER_F(FilterChainBenchmarkFixture, FilterChainFindTest)
     })
     ->Unit(::benchmark::kMillisecond);
 
+BENCHMARK_REGISTER_F(FilterChainBenchmarkFixture, FilterChainManagerBuildBySniTest)
+    ->Ranges({
+        // scale of the chains
+        {1, 16384},
+    })
+    ->Unit(::benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(FilterChainBenchmarkFixture, FilterChainFindBySniTest)
+    ->Ranges({
+        // scale of the chains
+        {1, 16384},
+    })
+    ->Unit(::benchmark::kMicrosecond);
+
 /*
 clang-format off
 
@@ -6,6 +6,11 @@
 #include <utility>
 #include <vector>
 
+#if defined(__linux__)
+#include <linux/filter.h>
+#include <sched.h>
+#endif
+
 #include "envoy/admin/v3/config_dump.pb.h"
 #include "envoy/config/core/v3/address.pb.h"
 #include "envoy/config/core/v3/base.pb.h"
@@ -16,11 +21,14 @@
 #include "envoy/stream_info/filter_state.h"
 
 #include "source/common/api/os_sys_calls_impl.h"
+#include "source/common/common/cleanup.h"
 #include "source/common/config/metadata.h"
 #include "source/common/init/manager_impl.h"
 #include "source/common/network/address_impl.h"
+#include "source/common/network/connection_balancer_impl.h"
 #include "source/common/network/io_socket_handle_impl.h"
 #include "source/common/network/socket_interface_impl.h"
+#include "source/common/network/socket_option_factory.h"
 #include "source/common/network/utility.h"
 #include "source/common/protobuf/protobuf.h"
 #include "source/extensions/common/matcher/trie_matcher.h"
@@ -32,12 +40,14 @@
 #include "test/mocks/matcher/mocks.h"
 #include "test/server/utility.h"
 #include "test/test_common/network_utility.h"
+#include "test/test_common/logging.h"
 #include "test/test_common/registry.h"
 #include "test/test_common/test_runtime.h"
 #include "test/test_common/utility.h"
 
 #include "absl/strings/escaping.h"
 #include "absl/strings/match.h"
+#include "absl/time/clock.h"
 
 namespace Envoy {
 namespace Server {
@@ -45,6 +55,7 @@ namespace {
 
 using testing::AtLeast;
 using testing::ByMove;
+using testing::Field;
 using testing::InSequence;
 using testing::Return;
 using testing::ReturnRef;
@@ -205,6 +216,32 @@ filter_chains:
             manager_->listeners().front().get().listenerFiltersTimeout());
 }
 
+#ifndef WIN32
+// Windows forces exact balancing for all TCP listeners.
+TEST_P(ListenerManagerImplWithRealFiltersTest, PowerOfTwoChoicesConnectionBalance) {
+  const std::string yaml = R"EOF(
+name: foo
+address:
+  socket_address:
+    address: 127.0.0.1
+    port_value: 1234
+connection_balance_config:
+  power_of_two_choices_balance: {}
+filter_chains:
+- filters: []
+  name: foo
+  )EOF";
+
+  EXPECT_CALL(listener_factory_, createListenSocket(_, _, _, default_bind_type, _, 0));
+  addOrUpdateListener(parseListenerFromV3Yaml(yaml));
+  ASSERT_EQ(1U, manager_->listeners().size());
+  Network::ListenerConfig& listener = manager_->listeners().front().get();
+  Network::ConnectionBalancer& balancer =
+      listener.connectionBalancer(*listener.listenSocketFactories()[0]->localAddress());
+  EXPECT_NE(nullptr, dynamic_cast<Network::PowerOfTwoChoicesConnectionBalancerImpl*>(&balancer));
+}
+#endif
+
 TEST_P(ListenerManagerImplWithRealFiltersTest, DefaultListenerPerConnectionBufferLimit) {
   const std::string yaml = R"EOF(
 address:
@@ -2577,6 +2614,146 @@ filter_chains:
       server_.stats_store_.counterFromString("listener_manager.listener_create_failure").value());
 }
 
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+// Verify that the CPU steering program is attached to the reuse_port group once the listen
+// sockets are listening, and that it steers by the CPU modulo the number of workers.
+TEST_P(ListenerManagerImplTest, ReusePortCpuSteering) {
+  InSequence s;
+
+  EXPECT_CALL(*worker_, start(_, _));
+  manager_->startWorkers(guard_dog_, callback_.AsStdFunction());
+
+  const std::string listener_foo_yaml = R"EOF(
+name: foo
+address:
+  socket_address:
+    address: 127.0.0.1
+    port_value: 1234
+enable_reuse_port_cpu_steering: true
+filter_chains:
+- filters: []
+  )EOF";
+
+  ListenerHandle* listener_foo = expectListenerCreate(true, true);
+  EXPECT_CALL(listener_factory_,
+              createListenSocket(_, _, _, ListenerComponentFactory::BindType::ReusePort,
+                                 Field(&Network::SocketCreationOptions::reuse_port_cpu_steering_,
+                                       true),
+                                 0));
+  EXPECT_CALL(listener_foo->target_, initialize());
+  addOrUpdateListener(parseListenerFromV3Yaml(listener_foo_yaml));
+
+  EXPECT_CALL(*listener_factory_.socket_->io_handle_, listen(_))
+      .WillOnce(Return(Api::SysCallIntResult{0, 0}));
+  EXPECT_CALL(*listener_factory_.socket_,
+              setSocketOption(SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, _, sizeof(sock_fprog)))
+      .WillOnce(Invoke([](int, int, const void* optval, socklen_t) -> Api::SysCallIntResult {
+        const auto* program = static_cast<const sock_fprog*>(optval);
+        EXPECT_EQ(3, program->len);
+        EXPECT_EQ(static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU), program->filter[0].k);
+        EXPECT_EQ(BPF_ALU | BPF_MOD | BPF_K, program->filter[1].code);
+        // A single worker.
+        EXPECT_EQ(1, program->filter[1].k);
+        return {0, 0};
+      }));
+  EXPECT_CALL(*worker_, addListener(_, _, _, _));
+  listener_foo->target_.ready();
+  worker_->callAddCompletion();
+  EXPECT_EQ(1UL, manager_->listeners().size());
+
+  EXPECT_CALL(*listener_foo, onDestroy());
+}
+
+// Connects to the address and returns the index of the socket of the factory which accepts the
+// connection.
+uint32_t acceptingSocket(ListenSocketFactoryImpl& factory, uint32_t num_sockets) {
+  Network::SocketImpl client(Network::Socket::Type::Stream, factory.localAddress(), nullptr,
+                             Network::SocketCreationOptions{});
+  const Api::SysCallIntResult result = client.ioHandle().connect(factory.localAddress());
+  EXPECT_TRUE(result.return_value_ == 0 || result.errno_ == SOCKET_ERROR_IN_PROGRESS);
+  for (int attempt = 0; attempt < 1000; attempt++) {
+    for (uint32_t i = 0; i < num_sockets; i++) {
+      Network::IoHandlePtr accepted =
+          factory.getListenSocket(i)->ioHandle().accept(nullptr, nullptr);
+      if (accepted != nullptr) {
+        accepted->close();
+        return i;
+      }
+    }
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  ADD_FAILURE() << "no socket accepted the connection";
+  return num_sockets;
+}
+
+// Verify with real reuse_port sockets that connections are steered to the socket of the worker
+// matching the CPU they arrive on, and that a factory whose reuse_port group already has members,
+// as when a socket is replaced by one handed over listening, neither attaches the program nor
+// keeps the one attached to the group, so connections are spread by the kernel's hash again.
+TEST_P(ListenerManagerImplTest, ReusePortCpuSteeringWithRealSockets) {
+  // Loopback connections are received on the CPU that sends them, so stay on one CPU.
+  cpu_set_t original_cpus;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(original_cpus), &original_cpus));
+  Cleanup restore_cpus([&original_cpus] {
+    sched_setaffinity(0, sizeof(original_cpus), &original_cpus);
+  });
+  const int cpu = sched_getcpu();
+  ASSERT_GE(cpu, 0);
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  ASSERT_EQ(0, sched_setaffinity(0, sizeof(cpus), &cpus));
+
+  const Network::Socket::OptionsSharedPtr options =
+      Network::SocketOptionFactory::buildReusePortOptions();
+  Network::SocketCreationOptions creation_options;
+  creation_options.reuse_port_cpu_steering_ = true;
+  auto create_socket = [](Network::Address::InstanceConstSharedPtr address, Network::Socket::Type,
+                          const Network::Socket::OptionsSharedPtr& options,
+                          ListenerComponentFactory::BindType,
+                          const Network::SocketCreationOptions& creation_options,
+                          uint32_t) -> Network::SocketSharedPtr {
+    return std::make_shared<Network::TcpListenSocket>(address, options, true, creation_options);
+  };
+
+  EXPECT_CALL(listener_factory_, createListenSocket(_, _, _, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(create_socket));
+  ListenSocketFactoryImpl steered(listener_factory_,
+                                  Network::Utility::getCanonicalIpv4LoopbackAddress(),
+                                  Network::Socket::Type::Stream, options, "steered", 128,
+                                  ListenerComponentFactory::BindType::ReusePort,
+                                  creation_options, 2);
+  steered.doFinalPreWorkerInit();
+  for (int i = 0; i < 8; i++) {
+    EXPECT_EQ(static_cast<uint32_t>(cpu % 2), acceptingSocket(steered, 2));
+  }
+
+  // Replace the second socket. The first one is handed over listening, which is how a hot restart
+  // parent passes its sockets, so the new factory cannot know the order of the group.
+  Network::SocketSharedPtr handed_over = steered.getListenSocket(0)->duplicate();
+  steered.getListenSocket(1)->close();
+  EXPECT_CALL(listener_factory_, createListenSocket(_, _, _, _, _, 0))
+      .WillOnce(Return(handed_over));
+  EXPECT_CALL(listener_factory_, createListenSocket(_, _, _, _, _, 1))
+      .WillOnce(Invoke(create_socket));
+  ListenSocketFactoryImpl replaced(listener_factory_, steered.localAddress(),
+                                   Network::Socket::Type::Stream, options, "replaced", 128,
+                                   ListenerComponentFactory::BindType::ReusePort,
+                                   creation_options, 2);
+  EXPECT_LOG_CONTAINS("warn", "replaced: not steering connections by CPU",
+                      replaced.doFinalPreWorkerInit());
+  std::vector<uint32_t> accepted(2);
+  for (int i = 0; i < 32; i++) {
+    const uint32_t index = acceptingSocket(replaced, 2);
+    ASSERT_LT(index, 2);
+    accepted[index]++;
+  }
+  EXPECT_GT(accepted[0], 0);
+  EXPECT_GT(accepted[1], 0);
+}
+#endif
+
 TEST_P(ListenerManagerImplTest, CantBindSocket) {
   time_system_.setSystemTime(std::chrono::milliseconds(1001001001001));
   InSequence s;
@@ -5845,6 +6022,42 @@ TEST_P(ListenerManagerImplWithRealFiltersTest, MptcpNotSupported) {
       "listener mptcp-udp: enable_mptcp is set but MPTCP is not supported by the operating system");
 }
 
+TEST_P(ListenerManagerImplWithRealFiltersTest, ReusePortCpuSteeringOnUdp) {
+  envoy::config::listener::v3::Listener listener = parseListenerFromV3Yaml(R"EOF(
+      name: steering-udp
+      enable_reuse_port_cpu_steering: true
+      address:
+        socket_address:
+          address: 127.0.0.1
+          port_value: 1111
+          protocol: UDP
+      filter_chains:
+      - filters: []
+        name: foo
+    )EOF");
+  EXPECT_THROW_WITH_MESSAGE(
+      addOrUpdateListener(listener), EnvoyException,
+      "listener steering-udp: enable_reuse_port_cpu_steering can only be used with TCP listeners");
+}
+
+TEST_P(ListenerManagerImplWithRealFiltersTest, ReusePortCpuSteeringWithoutReusePort) {
+  envoy::config::listener::v3::Listener listener = parseListenerFromV3Yaml(R"EOF(
+      name: steering-tcp
+      enable_reuse_port: false
+      enable_reuse_port_cpu_steering: true
+      address:
+        socket_address:
+          address: 127.0.0.1
+          port_value: 1111
+      filter_chains:
+      - filters: []
+        name: foo
+    )EOF");
+  EXPECT_THROW_WITH_MESSAGE(
+      addOrUpdateListener(listener), EnvoyException,
+      "listener steering-tcp: enable_reuse_port_cpu_steering requires enable_reuse_port");
+}
+
 // Set the resolver to the default IP resolver. The address resolver logic is unit tested in
 // resolver_impl_test.cc.
 TEST_P(ListenerManagerImplWithRealFiltersTest, AddressResolver) {